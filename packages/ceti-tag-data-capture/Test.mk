@@ -5,6 +5,8 @@ MOCK_DIR := $(TEST_DIR)/mocks
 FAKE_DIR := $(TEST_DIR)/fakes
 TEST_SRC_DIR := $(TEST_DIR)/src
 TEST_BIN_DIR := $(TEST_DIR)/bin
+BENCH_SRC_DIR := $(TEST_DIR)/bench
+BENCH_BIN_DIR := $(TEST_BIN_DIR)/bench
 
 STUB_SRC := $(shell find $(STUB_DIR) -type f -iname '*.c' 2> /dev/null)
 MOCK_SRC := $(shell find $(MOCK_DIR) -type f -iname '*.c' 2> /dev/null)
@@ -19,15 +21,24 @@ TEST_BIN = $(patsubst $(TEST_SRC_DIR)/%.c, $(TEST_BIN_DIR)/%, $(TEST_SRC))
 TEST_OUT_DIRS :=  $(sort $(dir $(TEST_BIN)))
 TEST_OBJ = $(TEST_SRC:.c=.o)
 
+BENCH_SRC := $(shell find $(BENCH_SRC_DIR) -type f -iname '*.bench.c' 2> /dev/null)
+BENCH_BIN = $(patsubst $(BENCH_SRC_DIR)/%.bench.c, $(BENCH_BIN_DIR)/%, $(BENCH_SRC))
+BENCH_OUT_DIRS := $(sort $(dir $(BENCH_BIN)))
+
 TEST_C_INCLUDE_FLAGS = -I $(UNITY_DIR)/src/ -I src/
 TEST_CFLAGS     = -Wall -O2 -Wdate-time -D_FORTIFY_SOURCE=2 -D_GNU_SOURCE -DUNIT_TEST $(TEST_C_INCLUDE_FLAGS)
 TEST_LDFLAGS    = -lpthread -lFLAC -lm -lrt -L $(UNITY_DIR) -lunity
+BENCH_CFLAGS    = -Wall -O2 -Wdate-time -D_FORTIFY_SOURCE=2 -D_GNU_SOURCE -I src/
+BENCH_LDFLAGS   = -lpthread -lFLAC -lm -lrt
 
 TESTABLE_OBJ = $(SRC_DIR)/cetiTagApp/utils/str.o \
 	$(SRC_DIR)/cetiTagApp/state_machine.o \
 	$(SRC_DIR)/cetiTagApp/aprs.o \
 	$(SRC_DIR)/cetiTagApp/utils/logging.o \
-	$(SRC_DIR)/cetiTagApp/utils/error.o
+	$(SRC_DIR)/cetiTagApp/utils/error.o \
+	$(SRC_DIR)/cetiTagApp/utils/audio_file.o \
+	$(SRC_DIR)/cetiTagApp/utils/ring.o \
+	$(SRC_DIR)/cetiTagApp/utils/seqlock.o
 
 # Colorful text printing
 NO_COL  := \033[0m
@@ -50,7 +61,7 @@ $(UNITY): $(UNITY_DIR)/Makefile
 -include $(DEPFILES)
 
 ## test directories
-$(TEST_OUT_DIRS):
+$(TEST_OUT_DIRS) $(BENCH_OUT_DIRS):
 	@mkdir -p $@
 
 %.test.o: %.test.c
@@ -86,11 +97,25 @@ test: $(TEST_BIN)
 	fi 
 	@rm -f .test.result
 
+# Benchmarks are built against the real sources with the app's optimisation
+# flags and print their own results; they are not pass/fail.
+# (relies on .SECONDEXPANSION from the top level Makefile)
+$(BENCH_BIN_DIR)/%: $(BENCH_SRC_DIR)/%.bench.c $$(addprefix $(SRC_DIR)/, $$(BENCH_REAL_DEP)) | $(BENCH_OUT_DIRS)
+	$(CC) $(BENCH_CFLAGS) -o $@ $^ $(BENCH_LDFLAGS)
+
+bench: CFLAGS = $(BENCH_CFLAGS)
+bench: $(BENCH_BIN)
+	-@for bench in $(BENCH_BIN); do \
+		printf "\n$(BLUE)$$bench$(NO_COL)\n"; \
+		./$$bench; \
+	done
+
 test_clean:
 	rm -f $(TEST_OBJ) $(TESTABLE_OBJ)
 	rm -rf $(TEST_BIN_DIR)
 
 .PHONY: \
+	bench \
 	test \
 	test_clean
 
@@ -100,6 +125,7 @@ TEST_TEST_DEP =
 TEST_STUB_DEP = 
 TEST_MOCK_DEP = 
 TEST_FAKE_DEP = 
+BENCH_REAL_DEP = 
 TEST_DEP = $(addprefix $(SRC_DIR)/, $(TEST_REAL_DEP)) \
 	$(addprefix $(TEST_SRC_DIR)/,  $(patsubst %.o, %.test.o, $(TEST_TEST_DEP))) \
 	$(addprefix $(STUB_DIR)/, $(patsubst %.o, %.stub.o, $(TEST_STUB_DEP))) \
@@ -116,6 +142,57 @@ $(TEST_BIN_DIR)/cetiTagApp/utils/timing.test: TEST_STUB_DEP = cetiTagApp/device/
 $(TEST_BIN_DIR)/cetiTagApp/utils/str.test: TEST_TEST_DEP = cetiTagApp/utils/str.o
 $(TEST_BIN_DIR)/cetiTagApp/utils/str.test: TEST_REAL_DEP = cetiTagApp/utils/str.o
 
+$(TEST_BIN_DIR)/cetiTagApp/utils/ring.test: TEST_TEST_DEP = cetiTagApp/utils/ring.o
+$(TEST_BIN_DIR)/cetiTagApp/utils/ring.test: TEST_REAL_DEP = cetiTagApp/utils/ring.o
+
+$(TEST_BIN_DIR)/cetiTagApp/utils/histogram.test: TEST_TEST_DEP = cetiTagApp/utils/histogram.o
+$(TEST_BIN_DIR)/cetiTagApp/utils/histogram.test: TEST_REAL_DEP = cetiTagApp/utils/histogram.o
+
+$(TEST_BIN_DIR)/cetiTagApp/utils/seqlock.test: TEST_TEST_DEP = cetiTagApp/utils/seqlock.o
+$(TEST_BIN_DIR)/cetiTagApp/utils/seqlock.test: TEST_REAL_DEP = cetiTagApp/utils/seqlock.o
+
+$(TEST_BIN_DIR)/cetiTagApp/utils/file_rotation.test: TEST_TEST_DEP = cetiTagApp/utils/file_rotation.o
+$(TEST_BIN_DIR)/cetiTagApp/utils/file_rotation.test: TEST_REAL_DEP = cetiTagApp/utils/file_rotation.o
+
+$(TEST_BIN_DIR)/cetiTagApp/utils/audio_file.test: TEST_TEST_DEP = cetiTagApp/utils/audio_file.o
+$(TEST_BIN_DIR)/cetiTagApp/utils/audio_file.test: TEST_REAL_DEP = cetiTagApp/utils/audio_file.o
+
+$(TEST_BIN_DIR)/cetiTagApp/utils/ecg_file.test: TEST_TEST_DEP = cetiTagApp/utils/ecg_file.o
+$(TEST_BIN_DIR)/cetiTagApp/utils/ecg_file.test: TEST_REAL_DEP = cetiTagApp/utils/ecg_file.o cetiTagApp/utils/error.o
+
+$(TEST_BIN_DIR)/cetiTagApp/utils/flac_index.test: TEST_TEST_DEP = cetiTagApp/utils/flac_index.o
+$(TEST_BIN_DIR)/cetiTagApp/utils/flac_index.test: TEST_REAL_DEP = cetiTagApp/utils/flac_index.o cetiTagApp/utils/audio_file.o
+
+$(TEST_BIN_DIR)/cetiTagApp/sensors/audio_sim.test: TEST_TEST_DEP = cetiTagApp/sensors/audio_sim.o
+$(TEST_BIN_DIR)/cetiTagApp/sensors/audio_sim.test: TEST_REAL_DEP = cetiTagApp/sensors/audio_sim.o cetiTagApp/utils/audio_file.o
+
+$(TEST_BIN_DIR)/cetiTagApp/sensors/audio_duty.test: TEST_TEST_DEP = cetiTagApp/sensors/audio_duty.o
+$(TEST_BIN_DIR)/cetiTagApp/sensors/audio_duty.test: TEST_REAL_DEP = cetiTagApp/sensors/audio_duty.o
+
+$(TEST_BIN_DIR)/cetiTagApp/sensors/ecg_helpers/ecg_drdy.test: TEST_TEST_DEP = cetiTagApp/sensors/ecg_helpers/ecg_drdy.o
+$(TEST_BIN_DIR)/cetiTagApp/sensors/ecg_helpers/ecg_drdy.test: TEST_REAL_DEP = cetiTagApp/sensors/ecg_helpers/ecg_drdy.o cetiTagApp/utils/seqlock.o
+
+$(TEST_BIN_DIR)/cetiTagApp/dsp/audio_unpack.test: TEST_TEST_DEP = cetiTagApp/dsp/audio_unpack.o
+$(TEST_BIN_DIR)/cetiTagApp/dsp/audio_unpack.test: TEST_REAL_DEP = cetiTagApp/dsp/audio_unpack.o
+
+$(TEST_BIN_DIR)/cetiTagApp/dsp/decimate.test: TEST_TEST_DEP = cetiTagApp/dsp/decimate.o
+$(TEST_BIN_DIR)/cetiTagApp/dsp/decimate.test: TEST_REAL_DEP = cetiTagApp/dsp/decimate.o
+
+$(TEST_BIN_DIR)/cetiTagApp/dsp/click_detect.test: TEST_TEST_DEP = cetiTagApp/dsp/click_detect.o
+$(TEST_BIN_DIR)/cetiTagApp/dsp/click_detect.test: TEST_REAL_DEP = cetiTagApp/dsp/click_detect.o
+
+$(TEST_BIN_DIR)/cetiTagApp/dsp/audio_levels.test: TEST_TEST_DEP = cetiTagApp/dsp/audio_levels.o
+$(TEST_BIN_DIR)/cetiTagApp/dsp/audio_levels.test: TEST_REAL_DEP = cetiTagApp/dsp/audio_levels.o
+
 $(TEST_BIN_DIR)/cetiTagApp/state_machine.test: TEST_TEST_DEP = cetiTagApp/state_machine.o 
 $(TEST_BIN_DIR)/cetiTagApp/state_machine.test: TEST_REAL_DEP = cetiTagApp/state_machine.o cetiTagApp/aprs.o cetiTagApp/utils/error.o cetiTagApp/utils/logging.o cetiTagApp/utils/str.o
 $(TEST_BIN_DIR)/cetiTagApp/state_machine.test: TEST_STUB_DEP = cetiTagApp/utils/power.o cetiTagApp/burnwire.o cetiTagApp/recovery.o
+
+# benchmark dependencies
+$(BENCH_BIN_DIR)/cetiTagApp/dsp/audio_unpack: BENCH_REAL_DEP = cetiTagApp/dsp/audio_unpack.o
+$(BENCH_BIN_DIR)/cetiTagApp/dsp/flac_tuning: BENCH_REAL_DEP = cetiTagApp/dsp/flac_tuning.o cetiTagApp/dsp/audio_unpack.o
+$(BENCH_BIN_DIR)/cetiTagApp/dsp/decimate: BENCH_REAL_DEP = cetiTagApp/dsp/decimate.o
+$(BENCH_BIN_DIR)/cetiTagApp/dsp/click_detect: BENCH_REAL_DEP = cetiTagApp/dsp/click_detect.o
+$(BENCH_BIN_DIR)/cetiTagApp/utils/file_rotation: BENCH_REAL_DEP = cetiTagApp/utils/file_rotation.o
+$(BENCH_BIN_DIR)/cetiTagApp/utils/ecg_file: BENCH_REAL_DEP = cetiTagApp/utils/ecg_file.o cetiTagApp/utils/error.o
+$(BENCH_BIN_DIR)/cetiTagApp/sensors/ecg_helpers/ecg_drdy: BENCH_REAL_DEP = cetiTagApp/sensors/ecg_helpers/ecg_drdy.o cetiTagApp/utils/seqlock.o
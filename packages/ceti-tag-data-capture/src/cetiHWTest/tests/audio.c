@@ -24,28 +24,34 @@
 
 TestState test_audio(FILE *pResultsFile) {
     char input = 0;
-    int channel_pass[AUDIO_CHANNELS] = {0, 0, 0};
+    int channel_pass[AUDIO_MAX_CHANNELS] = {0};
     const double target = 0.25;
 
     CetiAudioBuffer *shm_audio;
+    size_t shm_audio_size;
     sem_t *sem_audio_block;
 
     // === open audio shared memory ===
-    int shm_fd = shm_open(AUDIO_SHM_NAME, O_RDWR, 0444);
+    int shm_fd = shm_open(AUDIO_SHM_NAME, O_RDONLY, 0444);
     if (shm_fd < 0) {
         fprintf(pResultsFile, "[FAIL]: Audio: Failed to open shared memory\n");
         perror("shm_open");
         return TEST_STATE_FAILED;
     }
-    // size to sample size
-    if (ftruncate(shm_fd, sizeof(CetiAudioBuffer))) {
-        fprintf(pResultsFile, "[FAIL]: Audio: Failed to size shared memory\n");
-        perror("ftruncate");
+    // map the header to learn the ring capacity
+    shm_audio = mmap(NULL, sizeof(CetiAudioBuffer), PROT_READ, MAP_SHARED, shm_fd, 0);
+    if (shm_audio == MAP_FAILED) {
+        perror("mmap");
+        fprintf(pResultsFile, "[FAIL]: Audio: Failed to map shared memory\n");
         close(shm_fd);
         return TEST_STATE_FAILED;
     }
-    // memory map address
-    shm_audio = mmap(NULL, sizeof(CetiAudioBuffer), PROT_READ, MAP_SHARED, shm_fd, 0);
+    uint32_t capacity = shm_audio->ring.capacity;
+    munmap(shm_audio, sizeof(CetiAudioBuffer));
+
+    // memory map the entire ring
+    shm_audio_size = AUDIO_BUFFER_SHM_SIZE(capacity);
+    shm_audio = mmap(NULL, shm_audio_size, PROT_READ, MAP_SHARED, shm_fd, 0);
     if (shm_audio == MAP_FAILED) {
         perror("mmap");
         fprintf(pResultsFile, "[FAIL]: Audio: Failed to map shared memory\n");
@@ -54,14 +60,30 @@ TestState test_audio(FILE *pResultsFile) {
     }
     close(shm_fd);
 
+    if (shm_audio->bit_depth != 16) {
+        fprintf(pResultsFile, "[FAIL]: Audio: Test expects 16-bit audio, tag is recording %d-bit\n", shm_audio->bit_depth);
+        munmap(shm_audio, shm_audio_size);
+        return TEST_STATE_FAILED;
+    }
+    int channels = shm_audio->channels;
+    if ((channels < 1) || (channels > AUDIO_MAX_CHANNELS)) {
+        fprintf(pResultsFile, "[FAIL]: Audio: Tag is recording an unexpected %d channels\n", channels);
+        munmap(shm_audio, shm_audio_size);
+        return TEST_STATE_FAILED;
+    }
+
     sem_audio_block = sem_open(AUDIO_BLOCK_SEM_NAME, O_RDWR, 0444, 0);
     if (sem_audio_block == SEM_FAILED) {
         perror("sem_open");
-        munmap(shm_audio, sizeof(CetiAudioBuffer));
+        munmap(shm_audio, shm_audio_size);
         return TEST_STATE_FAILED;
     }
 
-    for (int i = 0; i < AUDIO_CHANNELS; i++) {
+    // the ring is a circular byte buffer holding a whole number of samples
+    uint8_t *buffer_start = AUDIO_BUFFER_BLOCK(shm_audio, 0);
+    uint8_t *buffer_end = AUDIO_BUFFER_BLOCK(shm_audio, capacity);
+
+    for (int i = 0; i < channels; i++) {
         printf("\033[%d;0H", 3 + i * 6);
         printf("CH %d:", i + 1);
         printf("\033[%d;0H", 4 + i * 6);
@@ -75,9 +97,9 @@ TestState test_audio(FILE *pResultsFile) {
     // set read location as starting write location
     sem_wait(sem_audio_block);
     // align to audio signal
-    size_t offset = (uint8_t *)(shm_audio->data[shm_audio->page].blocks[shm_audio->block]) - shm_audio->data[shm_audio->page].raw;
-    size_t next_sample_index = (offset + (AUDIO_CHANNELS * sizeof(uint16_t)) - 1) / (AUDIO_CHANNELS * sizeof(uint16_t));
-    uint8_t *read_ptr = shm_audio->data[shm_audio->page].sample16[next_sample_index][0];
+    size_t offset = (size_t)(atomic_load(&shm_audio->ring.head) % capacity) * SPI_BLOCK_SIZE;
+    size_t next_sample_index = (offset + (channels * sizeof(uint16_t)) - 1) / (channels * sizeof(uint16_t));
+    uint8_t *read_ptr = buffer_start + next_sample_index * channels * sizeof(uint16_t);
     uint8_t *window_ptr = read_ptr;
 
     int sample_count = 0;
@@ -88,14 +110,18 @@ TestState test_audio(FILE *pResultsFile) {
         sem_wait(sem_audio_block);
 
         // === analyze sample ===
-        uint8_t *end_ptr = (uint8_t *)shm_audio->data[shm_audio->page].blocks[shm_audio->block];
-        double min[AUDIO_CHANNELS] = {1.0, 1.0, 1.0};
-        double max[AUDIO_CHANNELS] = {-1.0, -1.0, -1.0};
-        double sum[AUDIO_CHANNELS] = {0.0, 0.0, 0.0};
-        double sq_sum[AUDIO_CHANNELS] = {0.0, 0.0, 0.0};
-        double avg[AUDIO_CHANNELS] = {0.0, 0.0, 0.0};
-        double rms[AUDIO_CHANNELS] = {0.0, 0.0, 0.0};
-        double amp[AUDIO_CHANNELS] = {0.0, 0.0, 0.0};
+        uint8_t *end_ptr = AUDIO_BUFFER_BLOCK(shm_audio, atomic_load(&shm_audio->ring.head) % capacity);
+        double min[AUDIO_MAX_CHANNELS];
+        double max[AUDIO_MAX_CHANNELS];
+        double sum[AUDIO_MAX_CHANNELS] = {0.0};
+        double sq_sum[AUDIO_MAX_CHANNELS] = {0.0};
+        double avg[AUDIO_MAX_CHANNELS] = {0.0};
+        double rms[AUDIO_MAX_CHANNELS] = {0.0};
+        double amp[AUDIO_MAX_CHANNELS] = {0.0};
+        for (int i_channel = 0; i_channel < channels; i_channel++) {
+            min[i_channel] = 1.0;
+            max[i_channel] = -1.0;
+        }
         // int sample_count = 0;
 
         // ToDo: apply HPF
@@ -103,8 +129,8 @@ TestState test_audio(FILE *pResultsFile) {
         // check if circular buffer wrapped
         if (end_ptr < read_ptr) {
             // process until end of buffer
-            while (read_ptr < shm_audio->data[1].raw + AUDIO_BUFFER_SIZE_BYTES) {
-                for (int i_channel = 0; i_channel < AUDIO_CHANNELS; i_channel++) {
+            while (read_ptr < buffer_end) {
+                for (int i_channel = 0; i_channel < channels; i_channel++) {
                     int16_t sample = ((int16_t)(read_ptr[0]) << 8) | ((int16_t)read_ptr[1]);
                     double sample_f = ((double)sample / 0x8000);
                     sum[i_channel] += sample_f;
@@ -115,12 +141,12 @@ TestState test_audio(FILE *pResultsFile) {
                 }
                 sample_count++;
             }
-            read_ptr = shm_audio->data[0].raw;
+            read_ptr = buffer_start;
         }
 
         // read
-        while (read_ptr + AUDIO_CHANNELS * 2 <= end_ptr) {
-            for (int i_channel = 0; i_channel < AUDIO_CHANNELS; i_channel++) {
+        while (read_ptr + channels * 2 <= end_ptr) {
+            for (int i_channel = 0; i_channel < channels; i_channel++) {
                 int16_t sample = ((int16_t)(read_ptr[0]) << 8) | ((int16_t)read_ptr[1]);
                 double sample_f = ((double)sample / 0x8000);
                 sum[i_channel] += sample_f;
@@ -134,21 +160,21 @@ TestState test_audio(FILE *pResultsFile) {
 
         // drop old samples
         while (sample_count > AUDIO_WINDOW_SIZE_SAMPLES) {
-            for (int i_channel = 0; i_channel < AUDIO_CHANNELS; i_channel++) {
+            for (int i_channel = 0; i_channel < channels; i_channel++) {
                 int16_t sample = ((int16_t)(window_ptr[0]) << 8) | ((int16_t)window_ptr[1]);
                 double sample_f = ((double)sample / 0x8000);
                 sum[i_channel] -= sample_f;
                 sq_sum[i_channel] -= sample_f * sample_f;
                 window_ptr += 2;
                 // check for wrap
-                if (!(window_ptr < shm_audio->data[1].raw + AUDIO_BUFFER_SIZE_BYTES)) {
-                    window_ptr = shm_audio->data[0].raw;
+                if (!(window_ptr < buffer_end)) {
+                    window_ptr = buffer_start;
                 }
             }
             sample_count--;
         }
 
-        for (int i_channel = 0; i_channel < AUDIO_CHANNELS; i_channel++) {
+        for (int i_channel = 0; i_channel < channels; i_channel++) {
             avg[i_channel] = sum[i_channel] / ((double)sample_count);
             rms[i_channel] = sq_sum[i_channel] / ((double)sample_count);
             rms[i_channel] = sqrt(rms[i_channel]);
@@ -159,7 +185,7 @@ TestState test_audio(FILE *pResultsFile) {
         }
 
         // === display results ===
-        for (int i_channel = 0; i_channel < AUDIO_CHANNELS; i_channel++) {
+        for (int i_channel = 0; i_channel < channels; i_channel++) {
             tui_draw_horzontal_bar(amp[i_channel], 1.0, 7, 3 + i_channel * 6, tui_get_screen_width() - 7);
             printf("\e[%d;%dH\e[96m|\e[0m\n", 3 + i_channel * 6, 7 + (int)(tui_get_screen_width() * target));
             tui_goto(14, 4 + i_channel * 6);
@@ -175,13 +201,13 @@ TestState test_audio(FILE *pResultsFile) {
 
     // record results
     int all_pass = 1;
-    for (int i = 0; i < AUDIO_CHANNELS; i++) {
+    for (int i = 0; i < channels; i++) {
         fprintf(pResultsFile, "Ch%d: %s", i, channel_pass[i] ? "PASS" : "FAIL");
         all_pass = all_pass && channel_pass[i];
     }
 
     sem_close(sem_audio_block);
-    munmap(shm_audio, sizeof(CetiAudioBuffer));
+    munmap(shm_audio, shm_audio_size);
 
     if (input == 27)
         return TEST_STATE_TERMINATE;
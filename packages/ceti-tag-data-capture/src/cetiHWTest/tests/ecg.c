@@ -53,6 +53,12 @@ TestState test_ecg(FILE *pResultsFile) {
     }
     close(shm_fd);
 
+    if (shm_ecg->version != ECG_BUFFER_VERSION) {
+        fprintf(pResultsFile, "[FAIL]: ECG: Shared memory is version %u, expected %u\n", shm_ecg->version, ECG_BUFFER_VERSION);
+        munmap(shm_ecg, sizeof(CetiEcgBuffer));
+        return TEST_STATE_FAILED;
+    }
+
     sem_ecg_sample_ready = sem_open(ECG_SAMPLE_SEM_NAME, O_RDWR, 0444, 0);
     if (sem_ecg_sample_ready == SEM_FAILED) {
         perror("sem_open");
@@ -10,12 +10,19 @@
 #ifndef CETI_TAG_H
 #define CETI_TAG_H
 
+#include <stdatomic.h>
 #include <stdint.h>
 
 // === AUDIO ===
 #define AUDIO_SHM_NAME "/audio_shm"
 #define AUDIO_BLOCK_SEM_NAME "/audio_block_sem"
-#define AUDIO_PAGE_SEM_NAME "/audio_page_sem"
+#define AUDIO_DECIMATED_SHM_NAME "/audio_decimated_shm"
+#define AUDIO_DECIMATED_SEM_NAME "/audio_decimated_sem"
+#define AUDIO_CLICK_SHM_NAME "/audio_click_shm"
+#define AUDIO_CLICK_SEM_NAME "/audio_click_sem"
+#define AUDIO_LEVELS_SHM_NAME "/audio_levels_shm"
+#define AUDIO_LEVELS_SEM_NAME "/audio_levels_sem"
+#define AUDIO_STATS_SHM_NAME "/audio_stats_shm"
 
 // === BMS ===
 #define BATTERY_SHM_NAME "/battery_shm"
@@ -46,12 +53,15 @@
 //-----------------------------------------------------------------------------
 // Definitions/Configurations
 //-----------------------------------------------------------------------------
+// === HISTOGRAM ===
+// bucket 0 counts zeros, bucket i counts values in [2^(i-1), 2^i), and the
+// last bucket also counts everything larger.
+#define CETI_HISTOGRAM_BUCKET_COUNT (24)
+
 // === AUDIO ===
-//  - SPI block HWM * 32 bytes = 8192 bytes (25% of the hardware FIFO in this example)
+//  - SPI block HWM * 32 bytes = 16384 bytes (50% of the 32 KiB hardware FIFO)
 //  - Sampling rate 96000 Hz
 //  - 6 bytes per sample set (3 channels, 16 bits per channel)
-// N.B. Make NUM_SPI_BLOCKS an integer multiple of 3 for alignment
-// reasons
 // SPI Block Size
 #define HWM (512)                 // High Water Mark from Verilog code - these are 32 byte chunks (2 sample sets)
 #define SPI_BLOCK_SIZE (HWM * 32) // make SPI block size <= HWM * 32 otherwise may underflow
@@ -63,24 +73,45 @@
 // and divisible by 24-bit 4 channel = 12
 #define AUDIO_LCM_BYTES (147456)
 
-#define AUDIO_CHANNELS (3)
-// multiple of AUDIO_LCM_BYTES closest to 75 seconds @ 16-bit, 96kSPS, (14401536)
-#define AUDIO_BUFFER_SIZE_BYTES_PER_CHANNEL (14401536)
-#define AUDIO_BUFFER_SIZE_BYTES (AUDIO_CHANNELS * AUDIO_BUFFER_SIZE_BYTES_PER_CHANNEL)
-#define AUDIO_BUFFER_SIZE_BLOCKS (AUDIO_BUFFER_SIZE_BYTES / SPI_BLOCK_SIZE)
-#define AUDIO_BUFFER_SIZE_SAMPLE16 (AUDIO_BUFFER_SIZE_BYTES / (sizeof(int16_t) * AUDIO_CHANNELS))
-#define AUDIO_BUFFER_SIZE_SAMPLE24 (AUDIO_BUFFER_SIZE_BYTES / (3 * AUDIO_CHANNELS))
-#define AUDIO_BLOCK_FILL_SPEED_US(sample_rate, bit_depth) (SPI_BLOCK_SIZE * 1000000.0 / (AUDIO_CHANNELS * (sample_rate) * ((bit_depth) / 8)))
-#define AUDIO_PAGE_FILL_SPEED_US(sample_rate, bit_depth) (AUDIO_BUFFER_SIZE_BYTES * 1000000.0 / (AUDIO_CHANNELS * (sample_rate) * ((bit_depth) / 8)))
+#define AUDIO_MAX_CHANNELS (4) // the channel count is configured at runtime (AudioConfig.channels)
+// Smallest run of SPI blocks that always holds a whole number of sample sets.
+// The ring capacity is kept a multiple of this so sample sets never straddle
+// the end of the ring, and blocks are only ever dropped in whole groups.
+#define AUDIO_BLOCKS_PER_GROUP (AUDIO_LCM_BYTES / SPI_BLOCK_SIZE)
+#define AUDIO_BUFFER_ALIGNMENT (4096) // block data starts on a page boundary
+#define AUDIO_BLOCK_FILL_SPEED_US(channels, sample_rate, bit_depth) (SPI_BLOCK_SIZE * 1000000.0 / ((channels) * (sample_rate) * ((bit_depth) / 8)))
+#define AUDIO_DECIMATED_BLOCK_SAMPLES (512) // sample sets per decimated block
+#define AUDIO_DECIMATED_BUFFER_S (10)       // seconds of decimated audio kept in shared memory
+#define AUDIO_CLICK_BUFFER_CAPACITY (4096)  // most recent clicks kept in shared memory
+#define AUDIO_LEVELS_INTERVAL_US (1000000)  // audio summarized per level record
+#define AUDIO_LEVELS_BUFFER_CAPACITY (300)  // most recent level records kept in shared memory
+#define AUDIO_LEVELS_BANDS (16) // equal width spectrum bands from 0 Hz to the Nyquist frequency
+#define AUDIO_LEVELS_FLOOR_DBFS (-200.0f) // reported for silence
+#define AUDIO_STATS_VERSION (1) // bumped when CetiAudioStats changes
 
 // === BMS ===
 #define BATTERY_SAMPLING_PERIOD_US 1000000
 
 // === ECG ===
-#define ECG_NUM_BUFFERS 2       // One for logging, one for writing.
-#define ECG_BUFFER_LENGTH 10000 // Once a buffer fills, it will be flushed to a file
-#define ECG_SAMPLING_PERIOD_US 1000
-#define ECG_PAGE_FILL_PERIOD_US (ECG_SAMPLING_PERIOD_US * ECG_BUFFER_LENGTH)
+#define ECG_NUM_BUFFERS 2        // One for logging, one for writing.
+#define ECG_MAX_SAMPLE_RATE 1000 // samples per second
+#define ECG_PAGE_DURATION_S 10   // Once a buffer holds this long of samples, it will be flushed to a file
+#define ECG_BUFFER_LENGTH (ECG_MAX_SAMPLE_RATE * ECG_PAGE_DURATION_S) // samples a buffer can hold, enough at the fastest rate
+#define ECG_PAGE_LENGTH(sample_rate) ((sample_rate) * ECG_PAGE_DURATION_S)
+#define ECG_SAMPLING_PERIOD_US(sample_rate) (1000000 / (sample_rate))
+#define ECG_PAGE_FILL_PERIOD_US (ECG_PAGE_DURATION_S * 1000000)
+#define ECG_BUFFER_VERSION (3) // bumped when CetiEcgBuffer or CetiEcgSample changes, 1 had neither version nor flags
+
+// CetiEcgSample flags, also the flags stored in ECG files (utils/ecg_file.h)
+#define ECG_SAMPLE_FLAG_LEADS_OFF_P (1 << 0)
+#define ECG_SAMPLE_FLAG_LEADS_OFF_N (1 << 1)
+#define ECG_SAMPLE_FLAG_LEADS_OFF_INVALID (1 << 2) // the IO expander could not be read
+#define ECG_SAMPLE_FLAG_ERROR (1 << 3)             // sample has an error code
+#define ECG_SAMPLE_FLAG_RESTARTED (1 << 4)         // first sample logged since the program started
+#define ECG_SAMPLE_FLAG_NEW_LOG (1 << 5)           // first sample of a new data file
+#define ECG_SAMPLE_FLAG_ZEROS (1 << 6)             // ADC returned zero too many times in a row
+#define ECG_SAMPLE_FLAG_TIMEOUT (1 << 7)           // sample took longer than ECG_SAMPLE_TIMEOUT_US
+#define ECG_SAMPLE_FLAG_MAYBE_INVALID (1 << 8)     // the electronics were reinitialized after this sample
 
 // === IMU ===
 #define IMU_BUFFER_FLUSH_INTERVAL_US (1000000)
@@ -100,18 +131,173 @@
 //-----------------------------------------------------------------------------
 // Type Definitions
 //-----------------------------------------------------------------------------
+// === RING ===
+// Lock-free single-producer/single-consumer ring bookkeeping. `head` and `tail`
+// are free running element counts, so an element lives in slot
+// `count % capacity` and `head - tail` elements are waiting to be consumed.
+// Processes other than the owning consumer may follow `head`, but only the
+// owning consumer may advance `tail`.
+typedef struct {
+    _Atomic uint64_t head;     // elements published by the producer
+    _Atomic uint64_t tail;     // elements released by the consumer
+    _Atomic uint64_t overruns; // elements dropped by the producer because the ring was full
+    uint32_t capacity;         // number of elements the ring can hold
+    uint32_t element_size;     // size of a single element in bytes
+} CetiRing;
+
+// === HISTOGRAM ===
+// Log2 histogram of unsigned values, see CETI_HISTOGRAM_BUCKET_COUNT.
+// `min` is UINT32_MAX until a value is counted.
+typedef struct {
+    uint64_t count;
+    uint64_t sum;
+    uint32_t min;
+    uint32_t max;
+    uint64_t bucket[CETI_HISTOGRAM_BUCKET_COUNT];
+} CetiHistogram;
+
 // === AUDIO ===
+#define AUDIO_BLOCK_FLAG_OVERFLOW (1 << 0)     // FPGA FIFO overflow was flagged when the block was read
+#define AUDIO_BLOCK_FLAG_DISCONTINUITY (1 << 1) // blocks were dropped immediately before this one
+#define AUDIO_BLOCK_FLAG_PADDING (1 << 2)       // silence inserted to keep the ring group aligned after a FIFO restart
+
 typedef struct {
-    int page;  // which buffer will be populated with new incoming data
-    int block; // which block will be populated with new incoming data
-    union {
-        uint8_t raw[AUDIO_BUFFER_SIZE_BYTES];
-        char blocks[AUDIO_BUFFER_SIZE_BLOCKS][SPI_BLOCK_SIZE];
-        uint8_t sample16[AUDIO_BUFFER_SIZE_SAMPLE16][AUDIO_CHANNELS][2];
-        uint8_t sample24[AUDIO_BUFFER_SIZE_SAMPLE24][AUDIO_CHANNELS][3];
-    } data[2];
+    int64_t sys_time_us; // time the SPI read of the block started
+    uint32_t rtc_count;  // RTC seconds when the block was read
+    uint32_t flags;      // AUDIO_BLOCK_FLAG_*
+} CetiAudioBlockInfo;
+
+// Ring of SPI blocks. The header is followed by `ring.capacity` block info
+// entries and then, starting on a page boundary, `ring.capacity` blocks of
+// SPI_BLOCK_SIZE bytes. Use the accessor macros below rather than computing
+// offsets by hand. The region is recreated with a new size when the audio
+// format is changed at runtime, so readers should map it again once
+// `sample_rate` or `bit_depth` change.
+typedef struct {
+    CetiRing ring;
+    uint32_t sample_rate; // Hz
+    uint16_t bit_depth;   // bits per sample
+    uint16_t channels;    // interleaved channels per sample set
+    uint32_t info_offset; // byte offset of the block info array from the start of this struct
+    uint32_t data_offset; // byte offset of the block data from the start of this struct
 } CetiAudioBuffer;
 
+#define AUDIO_BUFFER_INFO_OFFSET (sizeof(CetiAudioBuffer))
+#define AUDIO_BUFFER_DATA_OFFSET(capacity) \
+    (((AUDIO_BUFFER_INFO_OFFSET + (size_t)(capacity) * sizeof(CetiAudioBlockInfo)) + AUDIO_BUFFER_ALIGNMENT - 1) & ~((size_t)AUDIO_BUFFER_ALIGNMENT - 1))
+#define AUDIO_BUFFER_SHM_SIZE(capacity) (AUDIO_BUFFER_DATA_OFFSET(capacity) + (size_t)(capacity) * SPI_BLOCK_SIZE)
+#define AUDIO_BUFFER_BLOCK_INFO(buffer, slot) (&((CetiAudioBlockInfo *)((uint8_t *)(buffer) + (buffer)->info_offset))[(slot)])
+#define AUDIO_BUFFER_BLOCK(buffer, slot) ((uint8_t *)(buffer) + (buffer)->data_offset + (size_t)(slot) * SPI_BLOCK_SIZE)
+
+// Ring of low-pass filtered and decimated audio, laid out like
+// CetiAudioBuffer. Each block holds AUDIO_DECIMATED_BLOCK_SAMPLES interleaved
+// sample sets of native-endian int16_t, and its info entry has the time of
+// the first sample set. Readers follow `ring.head` and never release; the
+// oldest block is discarded when the ring is full, so a reader more than
+// `ring.capacity` blocks behind has lost data.
+typedef struct {
+    CetiRing ring;
+    uint32_t sample_rate; // Hz
+    uint16_t channels;    // interleaved channels per sample set
+    uint16_t decimation;  // full rate sample sets per decimated sample set
+    uint32_t info_offset; // byte offset of the block info array from the start of this struct
+    uint32_t data_offset; // byte offset of the block data from the start of this struct
+} CetiAudioDecimatedBuffer;
+
+#define AUDIO_DECIMATED_BLOCK_SIZE(channels) ((size_t)AUDIO_DECIMATED_BLOCK_SAMPLES * (channels) * sizeof(int16_t))
+#define AUDIO_DECIMATED_BUFFER_INFO_OFFSET (sizeof(CetiAudioDecimatedBuffer))
+#define AUDIO_DECIMATED_BUFFER_DATA_OFFSET(capacity) \
+    (((AUDIO_DECIMATED_BUFFER_INFO_OFFSET + (size_t)(capacity) * sizeof(CetiAudioBlockInfo)) + AUDIO_BUFFER_ALIGNMENT - 1) & ~((size_t)AUDIO_BUFFER_ALIGNMENT - 1))
+#define AUDIO_DECIMATED_BUFFER_SHM_SIZE(capacity, channels) (AUDIO_DECIMATED_BUFFER_DATA_OFFSET(capacity) + (size_t)(capacity) * AUDIO_DECIMATED_BLOCK_SIZE(channels))
+#define AUDIO_DECIMATED_BUFFER_BLOCK_INFO(buffer, slot) (&((CetiAudioBlockInfo *)((uint8_t *)(buffer) + (buffer)->info_offset))[(slot)])
+#define AUDIO_DECIMATED_BUFFER_BLOCK(buffer, slot) ((int16_t *)((uint8_t *)(buffer) + (buffer)->data_offset + (size_t)(slot) * (buffer)->ring.element_size))
+
+// One echolocation click found by the live click detector. The click index
+// file is a header followed by these records.
+typedef struct {
+    int64_t sys_time_us; // onset of the click
+    uint32_t ici_us;     // time since the previous click on the same channel, 0 for none
+    uint16_t amplitude;  // peak band-passed amplitude, 65535 is full scale
+    uint8_t channel;
+    uint8_t snr_db;      // peak energy over the noise floor
+} CetiAudioClick;
+
+// Ring of detected clicks, followed by `ring.capacity` CetiAudioClick
+// entries. Readers follow `ring.head` and never release; the oldest click is
+// discarded when the ring is full.
+typedef struct {
+    CetiRing ring;
+    uint32_t sample_rate;     // Hz of the audio the clicks were found in
+    uint16_t channels;        // channels searched
+    uint16_t reserved;
+    _Atomic uint64_t dropped; // clicks not recorded because a block held more than could be reported
+} CetiAudioClickBuffer;
+
+#define AUDIO_CLICK_BUFFER_SHM_SIZE(capacity) (sizeof(CetiAudioClickBuffer) + (size_t)(capacity) * sizeof(CetiAudioClick))
+#define AUDIO_CLICK_BUFFER_CLICK(buffer, slot) (&((CetiAudioClick *)((buffer) + 1))[(slot)])
+
+// Summary of AUDIO_LEVELS_INTERVAL_US of audio per channel, for checking the
+// hydrophones during a deployment. Levels are 10 * log10 of the mean square
+// where 1.0 is full scale, so a full scale sine is about -3 dBFS.
+typedef struct {
+    int64_t sys_time_us;  // first sample set summarized
+    uint32_t rtc_count;
+    uint32_t flags;       // AUDIO_BLOCK_FLAG_* of any block summarized
+    uint32_t samples;     // sample sets summarized
+    uint16_t channels;    // valid entries in the arrays below
+    uint16_t spectra;     // FFT frames averaged into band_dbfs
+    float rms_dbfs[AUDIO_MAX_CHANNELS];
+    float peak_dbfs[AUDIO_MAX_CHANNELS]; // largest sample, 0 dBFS is full scale
+    float dc[AUDIO_MAX_CHANNELS];        // mean sample value, 1.0 is full scale
+    float band_dbfs[AUDIO_MAX_CHANNELS][AUDIO_LEVELS_BANDS]; // mean square in each band, DC removed
+} CetiAudioLevels;
+
+// Ring of level records, followed by `ring.capacity` CetiAudioLevels
+// entries. Readers follow `ring.head` and never release; the oldest record is
+// discarded when the ring is full.
+typedef struct {
+    CetiRing ring;
+    uint32_t sample_rate; // Hz
+    uint32_t reserved;
+} CetiAudioLevelsBuffer;
+
+#define AUDIO_LEVELS_BUFFER_SHM_SIZE(capacity) (sizeof(CetiAudioLevelsBuffer) + (size_t)(capacity) * sizeof(CetiAudioLevels))
+#define AUDIO_LEVELS_BUFFER_RECORD(buffer, slot) (&((CetiAudioLevels *)((buffer) + 1))[(slot)])
+
+// Audio pipeline instrumentation. Each section is updated in place by the
+// one thread that owns it and is guarded by its `sequence`, which is odd
+// while an update is in progress: copy the section, then retry if the
+// sequence was odd or changed meanwhile (see utils/seqlock.c). Counters run
+// from `start_time_us`, times are in microseconds.
+typedef struct {
+    _Atomic uint32_t sequence;
+    uint32_t reserved;
+    uint64_t blocks_read;      // blocks read into the ring
+    uint64_t blocks_dropped;   // blocks read and discarded because the ring was full
+    uint64_t bytes_read;       // from the FIFO, including dropped blocks
+    CetiHistogram read_us;     // SPI transfer of one block
+    CetiHistogram interval_us; // between the starts of consecutive block reads
+    CetiHistogram lag_blocks;  // blocks waiting for the writer as each block is published
+} CetiAudioSpiStats;
+
+typedef struct {
+    _Atomic uint32_t sequence;
+    uint32_t reserved;
+    uint64_t chunks;        // groups of blocks encoded (FLAC) or queued (raw)
+    uint64_t blocks;        // blocks taken out of the ring
+    uint64_t files;         // files started
+    uint64_t bytes_written; // to files, FLAC output is counted as each file or segment is completed
+    CetiHistogram chunk_us; // unpacking and encoding (FLAC) or queueing (raw) one chunk
+} CetiAudioWriterStats;
+
+typedef struct {
+    uint32_t version; // AUDIO_STATS_VERSION
+    uint32_t reserved;
+    int64_t start_time_us;
+    CetiAudioSpiStats spi;
+    CetiAudioWriterStats writer;
+} CetiAudioStats;
+
 // === BMS ===
 typedef struct {
     int64_t sys_time_us;
@@ -134,12 +320,37 @@ typedef struct {
     int32_t ecg_reading;
     uint16_t leadsOff_reading_n;
     uint16_t leadsOff_reading_p;
+    uint32_t flags; // ECG_SAMPLE_FLAG_*
+    uint32_t reserved;
 } CetiEcgSample;
 
+// What an ECG reading means: the ADC settings it was acquired with.
+typedef struct {
+    uint32_t sampling_period_us;
+    uint8_t gain;    // 1 or 4
+    uint8_t vref;    // EcgVoltageReference
+    uint8_t channel; // ADC input, 0 to 3
+    uint8_t reserved;
+} CetiEcgFormat;
+
+typedef struct {
+    uint32_t sample_count; // samples in the buffer, set once it is complete
+    CetiEcgFormat format;  // of the samples in the buffer
+} CetiEcgPageInfo;
+
+// Readers should check `version` before using anything else.
+// RESTARTED and NEW_LOG are set on the first sample of a page when the page
+// is flushed; all other flags are set as the sample is acquired.
+// A page is complete once it holds `page_length` samples, or earlier when
+// the ADC settings are changed; its info then has the number it holds.
 typedef struct {
-    int page;   // which buffer will be populated with new incoming data
-    int sample; // which sample will be populated with new incoming data
+    uint32_t version; // ECG_BUFFER_VERSION
+    _Atomic int page; // which buffer will be populated with new incoming data, stored with release after its info is complete
+    int sample;       // which sample will be populated with new incoming data
     int lod_enabled;
+    uint32_t sample_rate; // samples per second being acquired
+    uint32_t page_length; // samples in a complete page at sample_rate, at most ECG_BUFFER_LENGTH
+    CetiEcgPageInfo pages[ECG_NUM_BUFFERS];
     CetiEcgSample data[ECG_NUM_BUFFERS][ECG_BUFFER_LENGTH];
 } CetiEcgBuffer;
 
@@ -47,6 +47,7 @@ static int __command_stopLogging(const char *args);
 static int handle_audio_command(const char *args);
 static int handle_battery_command(const char *args);
 static int handle_burnwire_command(const char *args);
+static int handle_ecg_command(const char *args);
 static int handle_imu_command(const char *args);
 static int handle_fpga_command(const char *args);
 static int handle_mission_command(const char *args);
@@ -90,6 +91,10 @@ static const CommandDescription command_list[] = {
 #endif
 #endif
 
+#if ENABLE_ECG
+    {.name = STR_FROM("ecg"), .description = "Send subcommand for ecg", .parse = handle_ecg_command},
+#endif
+
 #if ENABLE_IMU
     {.name = STR_FROM("imu"), .description = "Send subcommand for imu", .parse = handle_imu_command},
 #if ENABLE_LEGACY_COMMANDS
@@ -248,6 +253,10 @@ static int handle_burnwire_command(const char *args) {
     return __handle_subcommand("burnwire", args, burnwire_subcommand_list, burnwire_subcommand_list_size);
 }
 
+static int handle_ecg_command(const char *args) {
+    return __handle_subcommand("ecg", args, ecg_subcommand_list, ecg_subcommand_list_size);
+}
+
 static int handle_imu_command(const char *args) {
     return __handle_subcommand("imu", args, imu_subcommand_list, imu_subcommand_list_size);
 }
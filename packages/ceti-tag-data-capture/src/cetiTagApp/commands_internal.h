@@ -41,6 +41,9 @@ extern const size_t battery_subcommand_list_size;
 extern const CommandDescription burnwire_subcommand_list[];
 extern const size_t burnwire_subcommand_list_size;
 
+extern const CommandDescription ecg_subcommand_list[];
+extern const size_t ecg_subcommand_list_size;
+
 extern const CommandDescription fpga_subcommand_list[];
 extern const size_t fpga_subcommand_list_size;
 
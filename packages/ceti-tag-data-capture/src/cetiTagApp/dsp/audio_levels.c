@@ -0,0 +1,225 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+// Audio level and coarse spectrum summaries for hydrophone health checks.
+//
+// The spectrum is a Welch average of Hann windowed frames taken at a fixed
+// rate. Channels are transformed two at a time, one in the real part and one
+// in the imaginary part of a single complex FFT, and separated afterwards
+// using the symmetry of real signals' spectra.
+//-----------------------------------------------------------------------------
+#include "audio_levels.h"
+
+#include <math.h>
+#include <string.h>
+
+/**
+ * @brief Sets up the window and FFT tables. Input samples are sign-extended
+ * `input_bit_depth` values (as from dsp/audio_unpack.h).
+ *
+ * @param frame_interval sample sets between spectrum frames, at least
+ * AUDIO_LEVELS_FFT_SIZE
+ * @return 0 on success, -1 for an unsupported format or frame interval
+ */
+int audio_levels_init(AudioLevels *self, uint32_t channels, int input_bit_depth, uint32_t frame_interval) {
+    memset(self, 0, sizeof(*self));
+    if ((channels == 0) || (channels > AUDIO_MAX_CHANNELS) || (input_bit_depth < 16) || (input_bit_depth > 32) || (frame_interval < AUDIO_LEVELS_FFT_SIZE)) {
+        return -1;
+    }
+    self->channels = channels;
+    self->input_scale = (float)ldexp(1.0, 1 - input_bit_depth);
+    self->frame_interval = frame_interval;
+
+    const uint32_t n = AUDIO_LEVELS_FFT_SIZE;
+    double window_power = 0.0;
+    for (uint32_t i = 0; i < n; i++) {
+        self->window[i] = (float)(0.5 - 0.5 * cos(2.0 * M_PI * i / n));
+        window_power += (double)self->window[i] * self->window[i];
+    }
+    for (uint32_t k = 0; k < n / 2; k++) {
+        self->twiddle_re[k] = (float)cos(2.0 * M_PI * k / n);
+        self->twiddle_im[k] = (float)-sin(2.0 * M_PI * k / n);
+    }
+    int bits = 0;
+    while ((1u << bits) < n) {
+        bits++;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t reversed = 0;
+        for (int b = 0; b < bits; b++) {
+            reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        self->bit_reverse[i] = (uint16_t)reversed;
+    }
+
+    // Parseval, folding the negative frequencies onto the positive ones and
+    // undoing the window's loss of power
+    self->power_scale = (float)(2.0 / (n * window_power));
+    audio_levels_reset(self);
+    return 0;
+}
+
+/**
+ * @brief Discards the interval so far, for when the input is not continuous.
+ */
+void audio_levels_reset(AudioLevels *self) {
+    self->frame_position = 0;
+    self->samples = 0;
+    self->spectra = 0;
+    memset(self->sum, 0, sizeof(self->sum));
+    memset(self->sum_squares, 0, sizeof(self->sum_squares));
+    memset(self->band_power, 0, sizeof(self->band_power));
+    for (uint32_t c = 0; c < AUDIO_MAX_CHANNELS; c++) {
+        self->min[c] = INT32_MAX;
+        self->max[c] = INT32_MIN;
+    }
+}
+
+// in place radix-2 decimation in time FFT
+static void __fft(const AudioLevels *self, float *re, float *im) {
+    const uint32_t n = AUDIO_LEVELS_FFT_SIZE;
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t j = self->bit_reverse[i];
+        if (i < j) {
+            float t = re[i];
+            re[i] = re[j];
+            re[j] = t;
+            t = im[i];
+            im[i] = im[j];
+            im[j] = t;
+        }
+    }
+    for (uint32_t size = 2; size <= n; size *= 2) {
+        uint32_t half = size / 2;
+        uint32_t step = n / size;
+        for (uint32_t start = 0; start < n; start += size) {
+            for (uint32_t k = 0; k < half; k++) {
+                float wr = self->twiddle_re[k * step];
+                float wi = self->twiddle_im[k * step];
+                uint32_t a = start + k;
+                uint32_t b = a + half;
+                float tr = re[b] * wr - im[b] * wi;
+                float ti = re[b] * wi + im[b] * wr;
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+}
+
+// mean removed and windowed copy of a frame, scaled to full scale 1.0
+static void __window_frame(const AudioLevels *self, float *dst, const float *frame) {
+    const uint32_t n = AUDIO_LEVELS_FFT_SIZE;
+    float mean = 0.0f;
+    for (uint32_t i = 0; i < n; i++) {
+        mean += frame[i];
+    }
+    mean /= n;
+    for (uint32_t i = 0; i < n; i++) {
+        dst[i] = (frame[i] - mean) * self->window[i] * self->input_scale;
+    }
+}
+
+// adds the power spectrum of the current frames to the band totals
+static void __audio_levels_spectrum(AudioLevels *self) {
+    const uint32_t n = AUDIO_LEVELS_FFT_SIZE;
+    float re[AUDIO_LEVELS_FFT_SIZE];
+    float im[AUDIO_LEVELS_FFT_SIZE];
+    for (uint32_t c = 0; c < self->channels; c += 2) {
+        int paired = (c + 1 < self->channels);
+        __window_frame(self, re, self->frame[c]);
+        if (paired) {
+            __window_frame(self, im, self->frame[c + 1]);
+        } else {
+            memset(im, 0, sizeof(im));
+        }
+        __fft(self, re, im);
+
+        // Z[k] = A[k] + iB[k] for real A and B, so A[k] = (Z[k] + Z*[n-k]) / 2
+        // and B[k] = (Z[k] - Z*[n-k]) / 2i
+        for (uint32_t k = 1; k <= n / 2; k++) {
+            float zr = re[k], zi = im[k];
+            float nr = re[n - k], ni = im[n - k];
+            float weight = (k == n / 2) ? 0.5f : 1.0f; // Nyquist has no mirror image
+            uint32_t band = k * AUDIO_LEVELS_BANDS / (n / 2);
+            band = (band < AUDIO_LEVELS_BANDS) ? band : AUDIO_LEVELS_BANDS - 1;
+            float power_a = ((zr + nr) * (zr + nr) + (zi - ni) * (zi - ni)) * 0.25f;
+            self->band_power[c][band] += weight * power_a * self->power_scale;
+            if (paired) {
+                float power_b = ((zr - nr) * (zr - nr) + (zi + ni) * (zi + ni)) * 0.25f;
+                self->band_power[c + 1][band] += weight * power_b * self->power_scale;
+            }
+        }
+    }
+    self->spectra++;
+}
+
+/**
+ * @brief Adds `n_samples` interleaved sample sets to the interval. The input
+ * may be split anywhere.
+ */
+void audio_levels_process(AudioLevels *self, const int32_t *src, size_t n_samples) {
+    const uint32_t channels = self->channels;
+    for (size_t i = 0; i < n_samples; i++, src += channels) {
+        for (uint32_t c = 0; c < channels; c++) {
+            int32_t value = src[c];
+            self->sum[c] += value;
+            self->sum_squares[c] += (double)value * value;
+            self->min[c] = (value < self->min[c]) ? value : self->min[c];
+            self->max[c] = (value > self->max[c]) ? value : self->max[c];
+            if (self->frame_position < AUDIO_LEVELS_FFT_SIZE) {
+                self->frame[c][self->frame_position] = (float)value;
+            }
+        }
+        if (++self->frame_position == AUDIO_LEVELS_FFT_SIZE) {
+            __audio_levels_spectrum(self);
+        }
+        if (self->frame_position == self->frame_interval) {
+            self->frame_position = 0;
+        }
+    }
+    self->samples += n_samples;
+}
+
+static float __dbfs(double mean_square) {
+    if (mean_square <= 0.0) {
+        return AUDIO_LEVELS_FLOOR_DBFS;
+    }
+    float level = (float)(10.0 * log10(mean_square));
+    return (level > AUDIO_LEVELS_FLOOR_DBFS) ? level : AUDIO_LEVELS_FLOOR_DBFS;
+}
+
+/**
+ * @brief Writes the levels of the interval so far to `dst` and starts a new
+ * interval. Only the level fields of `dst` are set; the caller fills in the
+ * times and flags.
+ */
+void audio_levels_finish(AudioLevels *self, CetiAudioLevels *dst) {
+    dst->samples = (uint32_t)self->samples;
+    dst->channels = (uint16_t)self->channels;
+    dst->spectra = (uint16_t)self->spectra;
+    double scale = self->input_scale;
+    for (uint32_t c = 0; c < AUDIO_MAX_CHANNELS; c++) {
+        int valid = (c < self->channels) && (self->samples != 0);
+        double mean = valid ? (double)self->sum[c] / self->samples : 0.0;
+        double mean_square = valid ? self->sum_squares[c] / self->samples : 0.0;
+        double peak = valid ? fmax(fabs((double)self->min[c]), fabs((double)self->max[c])) : 0.0;
+        dst->dc[c] = (float)(mean * scale);
+        dst->rms_dbfs[c] = __dbfs(mean_square * scale * scale);
+        dst->peak_dbfs[c] = __dbfs(peak * peak * scale * scale);
+        for (uint32_t b = 0; b < AUDIO_LEVELS_BANDS; b++) {
+            dst->band_dbfs[c][b] = (valid && (self->spectra != 0)) ? __dbfs(self->band_power[c][b] / self->spectra) : AUDIO_LEVELS_FLOOR_DBFS;
+        }
+    }
+
+    // the spectrum frame in progress carries on into the next interval
+    uint32_t frame_position = self->frame_position;
+    audio_levels_reset(self);
+    self->frame_position = frame_position;
+}
@@ -0,0 +1,59 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+#ifndef CETI_DSP_AUDIO_LEVELS_H
+#define CETI_DSP_AUDIO_LEVELS_H
+
+#include "../cetiTag.h" // for CetiAudioLevels
+
+#include <stddef.h>
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Definitions/Configurations
+//-----------------------------------------------------------------------------
+#define AUDIO_LEVELS_FFT_SIZE (512) // samples per spectrum frame, must be a power of 2
+
+//-----------------------------------------------------------------------------
+// Typedefs
+//-----------------------------------------------------------------------------
+// Running per-channel statistics over an interval of interleaved audio.
+// Every `frame_interval` sample sets the next AUDIO_LEVELS_FFT_SIZE are Hann
+// windowed and their power spectrum summed into bands, so the FFT cost is
+// set by the frame rate rather than the sample rate.
+typedef struct {
+    uint32_t channels;
+    float input_scale;       // input sample to full scale 1.0
+    uint32_t frame_interval; // sample sets between the starts of spectrum frames
+    uint32_t frame_position; // sample sets since the current frame started
+
+    // interval totals
+    uint64_t samples;
+    int64_t sum[AUDIO_MAX_CHANNELS];
+    double sum_squares[AUDIO_MAX_CHANNELS];
+    int32_t min[AUDIO_MAX_CHANNELS];
+    int32_t max[AUDIO_MAX_CHANNELS];
+    double band_power[AUDIO_MAX_CHANNELS][AUDIO_LEVELS_BANDS];
+    uint32_t spectra;
+
+    float frame[AUDIO_MAX_CHANNELS][AUDIO_LEVELS_FFT_SIZE];
+    float window[AUDIO_LEVELS_FFT_SIZE];
+    float twiddle_re[AUDIO_LEVELS_FFT_SIZE / 2];
+    float twiddle_im[AUDIO_LEVELS_FFT_SIZE / 2];
+    uint16_t bit_reverse[AUDIO_LEVELS_FFT_SIZE];
+    float power_scale; // |X|^2 to one-sided mean square
+} AudioLevels;
+
+//-----------------------------------------------------------------------------
+// Methods
+//-----------------------------------------------------------------------------
+int audio_levels_init(AudioLevels *self, uint32_t channels, int input_bit_depth, uint32_t frame_interval);
+void audio_levels_reset(AudioLevels *self);
+void audio_levels_process(AudioLevels *self, const int32_t *src, size_t n_samples);
+void audio_levels_finish(AudioLevels *self, CetiAudioLevels *dst);
+
+#endif // CETI_DSP_AUDIO_LEVELS_H
@@ -0,0 +1,220 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+// Big-endian ADC sample unpacking kernels.
+//
+// The stream is interleaved, so a kernel only needs to know how many values a
+// sample set holds; the per-layout entries below exist so callers can select
+// by (channels, bit depth) and so each layout is benchmarked on its own.
+// NEON kernels are only built for AArch64 and are only handed out when the
+// CPU reports Advanced SIMD support. A channel selection falls back to the
+// whole sample set kernels when every channel is kept.
+//-----------------------------------------------------------------------------
+#include "audio_unpack.h"
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define AUDIO_UNPACK_HAVE_NEON 1
+#include <arm_neon.h>
+#include <sys/auxv.h> // for getauxval()
+#ifndef HWCAP_ASIMD
+#define HWCAP_ASIMD (1 << 1)
+#endif
+#else
+#define AUDIO_UNPACK_HAVE_NEON 0
+#endif
+
+//-----------------------------------------------------------------------------
+// Scalar kernels
+//-----------------------------------------------------------------------------
+static void __unpack16_scalar(int32_t *dst, const uint8_t *src, size_t n_values) {
+    for (size_t i = 0; i < n_values; i++, src += 2) {
+        dst[i] = (int16_t)(((uint16_t)src[0] << 8) | (uint16_t)src[1]);
+    }
+}
+
+static void __unpack24_scalar(int32_t *dst, const uint8_t *src, size_t n_values) {
+    for (size_t i = 0; i < n_values; i++, src += 3) {
+        // place in the top 24 bits and arithmetic shift back to sign-extend
+        dst[i] = (int32_t)(((uint32_t)src[0] << 24) | ((uint32_t)src[1] << 16) | ((uint32_t)src[2] << 8)) >> 8;
+    }
+}
+
+static void __unpack_3ch_16_scalar(int32_t *dst, const uint8_t *src, size_t n_samples) { __unpack16_scalar(dst, src, 3 * n_samples); }
+static void __unpack_4ch_16_scalar(int32_t *dst, const uint8_t *src, size_t n_samples) { __unpack16_scalar(dst, src, 4 * n_samples); }
+static void __unpack_3ch_24_scalar(int32_t *dst, const uint8_t *src, size_t n_samples) { __unpack24_scalar(dst, src, 3 * n_samples); }
+static void __unpack_4ch_24_scalar(int32_t *dst, const uint8_t *src, size_t n_samples) { __unpack24_scalar(dst, src, 4 * n_samples); }
+
+static const AudioUnpackKernel s_scalar_kernels[] = {
+    {.name = "scalar 3ch 16-bit", .channels = 3, .bit_depth = 16, .unpack = __unpack_3ch_16_scalar},
+    {.name = "scalar 4ch 16-bit", .channels = 4, .bit_depth = 16, .unpack = __unpack_4ch_16_scalar},
+    {.name = "scalar 3ch 24-bit", .channels = 3, .bit_depth = 24, .unpack = __unpack_3ch_24_scalar},
+    {.name = "scalar 4ch 24-bit", .channels = 4, .bit_depth = 24, .unpack = __unpack_4ch_24_scalar},
+};
+
+//-----------------------------------------------------------------------------
+// NEON kernels
+//-----------------------------------------------------------------------------
+#if AUDIO_UNPACK_HAVE_NEON
+static void __unpack16_neon(int32_t *dst, const uint8_t *src, size_t n_values) {
+    size_t i = 0;
+    for (; i + 16 <= n_values; i += 16, src += 32, dst += 16) {
+        // byte swap each 16-bit value, then sign extend to 32 bits
+        int16x8_t a = vreinterpretq_s16_u8(vrev16q_u8(vld1q_u8(src)));
+        int16x8_t b = vreinterpretq_s16_u8(vrev16q_u8(vld1q_u8(src + 16)));
+        vst1q_s32(dst + 0, vmovl_s16(vget_low_s16(a)));
+        vst1q_s32(dst + 4, vmovl_s16(vget_high_s16(a)));
+        vst1q_s32(dst + 8, vmovl_s16(vget_low_s16(b)));
+        vst1q_s32(dst + 12, vmovl_s16(vget_high_s16(b)));
+    }
+    __unpack16_scalar(dst, src, n_values - i);
+}
+
+static void __unpack24_neon(int32_t *dst, const uint8_t *src, size_t n_values) {
+    const uint8x16_t zero = vdupq_n_u8(0);
+    size_t i = 0;
+    for (; i + 16 <= n_values; i += 16, src += 48, dst += 16) {
+        // de-interleave into most, middle and least significant bytes
+        uint8x16x3_t v = vld3q_u8(src);
+        // build little-endian words {0, lsb, mid, msb}
+        uint16x8_t lo_a = vreinterpretq_u16_u8(vzip1q_u8(zero, v.val[2]));
+        uint16x8_t lo_b = vreinterpretq_u16_u8(vzip2q_u8(zero, v.val[2]));
+        uint16x8_t hi_a = vreinterpretq_u16_u8(vzip1q_u8(v.val[1], v.val[0]));
+        uint16x8_t hi_b = vreinterpretq_u16_u8(vzip2q_u8(v.val[1], v.val[0]));
+        // arithmetic shift right by 8 to sign-extend
+        vst1q_s32(dst + 0, vshrq_n_s32(vreinterpretq_s32_u16(vzip1q_u16(lo_a, hi_a)), 8));
+        vst1q_s32(dst + 4, vshrq_n_s32(vreinterpretq_s32_u16(vzip2q_u16(lo_a, hi_a)), 8));
+        vst1q_s32(dst + 8, vshrq_n_s32(vreinterpretq_s32_u16(vzip1q_u16(lo_b, hi_b)), 8));
+        vst1q_s32(dst + 12, vshrq_n_s32(vreinterpretq_s32_u16(vzip2q_u16(lo_b, hi_b)), 8));
+    }
+    __unpack24_scalar(dst, src, n_values - i);
+}
+
+static void __unpack_3ch_16_neon(int32_t *dst, const uint8_t *src, size_t n_samples) { __unpack16_neon(dst, src, 3 * n_samples); }
+static void __unpack_4ch_16_neon(int32_t *dst, const uint8_t *src, size_t n_samples) { __unpack16_neon(dst, src, 4 * n_samples); }
+static void __unpack_3ch_24_neon(int32_t *dst, const uint8_t *src, size_t n_samples) { __unpack24_neon(dst, src, 3 * n_samples); }
+static void __unpack_4ch_24_neon(int32_t *dst, const uint8_t *src, size_t n_samples) { __unpack24_neon(dst, src, 4 * n_samples); }
+
+static const AudioUnpackKernel s_neon_kernels[] = {
+    {.name = "neon 3ch 16-bit", .channels = 3, .bit_depth = 16, .unpack = __unpack_3ch_16_neon},
+    {.name = "neon 4ch 16-bit", .channels = 4, .bit_depth = 16, .unpack = __unpack_4ch_16_neon},
+    {.name = "neon 3ch 24-bit", .channels = 3, .bit_depth = 24, .unpack = __unpack_3ch_24_neon},
+    {.name = "neon 4ch 24-bit", .channels = 4, .bit_depth = 24, .unpack = __unpack_4ch_24_neon},
+};
+#endif
+
+//-----------------------------------------------------------------------------
+// Selection
+//-----------------------------------------------------------------------------
+static const AudioUnpackKernel *__find_kernel(const AudioUnpackKernel *table, size_t table_len, int channels, int bit_depth) {
+    for (size_t i = 0; i < table_len; i++) {
+        if ((table[i].channels == channels) && (table[i].bit_depth == bit_depth)) {
+            return &table[i];
+        }
+    }
+    return NULL;
+}
+
+int audio_unpack_neon_available(void) {
+#if AUDIO_UNPACK_HAVE_NEON
+    static int s_neon_available = -1;
+    if (s_neon_available < 0) {
+        s_neon_available = ((getauxval(AT_HWCAP) & HWCAP_ASIMD) != 0);
+    }
+    return s_neon_available;
+#else
+    return 0;
+#endif
+}
+
+const AudioUnpackKernel *audio_unpack_get_scalar_kernel(int channels, int bit_depth) {
+    return __find_kernel(s_scalar_kernels, sizeof(s_scalar_kernels) / sizeof(*s_scalar_kernels), channels, bit_depth);
+}
+
+/**
+ * @return NEON kernel for the layout, or NULL if NEON is unavailable.
+ */
+const AudioUnpackKernel *audio_unpack_get_neon_kernel(int channels, int bit_depth) {
+#if AUDIO_UNPACK_HAVE_NEON
+    if (audio_unpack_neon_available()) {
+        return __find_kernel(s_neon_kernels, sizeof(s_neon_kernels) / sizeof(*s_neon_kernels), channels, bit_depth);
+    }
+#endif
+    return NULL;
+}
+
+/**
+ * @brief Fastest kernel the running CPU supports for the layout.
+ *
+ * @return kernel, or NULL if the layout is not supported.
+ */
+const AudioUnpackKernel *audio_unpack_get_kernel(int channels, int bit_depth) {
+    const AudioUnpackKernel *kernel = audio_unpack_get_neon_kernel(channels, bit_depth);
+    if (kernel == NULL) {
+        kernel = audio_unpack_get_scalar_kernel(channels, bit_depth);
+    }
+    return kernel;
+}
+
+//-----------------------------------------------------------------------------
+// Channel selection
+//-----------------------------------------------------------------------------
+static void __unpack_select16(const AudioUnpackSelection *self, int32_t *dst, const uint8_t *src, size_t n_samples) {
+    size_t frame_size = (size_t)self->channels * 2;
+    for (size_t i = 0; i < n_samples; i++, src += frame_size) {
+        for (int c = 0; c < self->n_selected; c++) {
+            const uint8_t *value = src + self->selected[c] * 2;
+            *dst++ = (int16_t)(((uint16_t)value[0] << 8) | (uint16_t)value[1]);
+        }
+    }
+}
+
+static void __unpack_select24(const AudioUnpackSelection *self, int32_t *dst, const uint8_t *src, size_t n_samples) {
+    size_t frame_size = (size_t)self->channels * 3;
+    for (size_t i = 0; i < n_samples; i++, src += frame_size) {
+        for (int c = 0; c < self->n_selected; c++) {
+            const uint8_t *value = src + self->selected[c] * 3;
+            *dst++ = (int32_t)(((uint32_t)value[0] << 24) | ((uint32_t)value[1] << 16) | ((uint32_t)value[2] << 8)) >> 8;
+        }
+    }
+}
+
+/**
+ * @brief Sets up unpacking of the channels in `channel_mask` (bit n is
+ * stream channel n). Bits beyond the stream's channels are ignored.
+ *
+ * @return 0 on success, -1 if the layout is not supported or no channel is
+ * selected
+ */
+int audio_unpack_selection_init(AudioUnpackSelection *self, int channels, int bit_depth, uint32_t channel_mask) {
+    self->kernel = audio_unpack_get_kernel(channels, bit_depth);
+    if ((self->kernel == NULL) || (channels > AUDIO_UNPACK_MAX_CHANNELS)) {
+        return -1;
+    }
+    self->channels = channels;
+    self->bit_depth = bit_depth;
+    self->n_selected = 0;
+    for (int c = 0; c < channels; c++) {
+        if (channel_mask & (1u << c)) {
+            self->selected[self->n_selected++] = c;
+        }
+    }
+    return (self->n_selected == 0) ? -1 : 0;
+}
+
+/**
+ * @brief Unpacks the selected channels of `n_samples` sample sets into
+ * `n_samples * self->n_selected` values.
+ */
+void audio_unpack_selection_run(const AudioUnpackSelection *self, int32_t *dst, const uint8_t *src, size_t n_samples) {
+    if (self->n_selected == self->channels) {
+        self->kernel->unpack(dst, src, n_samples);
+    } else if (self->bit_depth == 16) {
+        __unpack_select16(self, dst, src, n_samples);
+    } else {
+        __unpack_select24(self, dst, src, n_samples);
+    }
+}
@@ -0,0 +1,56 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+#ifndef CETI_DSP_AUDIO_UNPACK_H
+#define CETI_DSP_AUDIO_UNPACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Definitions
+//-----------------------------------------------------------------------------
+#define AUDIO_UNPACK_MAX_CHANNELS (4)
+
+//-----------------------------------------------------------------------------
+// Typedefs
+//-----------------------------------------------------------------------------
+/**
+ * @brief Converts `n_samples` interleaved big-endian sample sets from the
+ * FPGA stream to sign-extended 32-bit values (the layout libFLAC expects).
+ */
+typedef void (*AudioUnpackFn)(int32_t *dst, const uint8_t *src, size_t n_samples);
+
+typedef struct {
+    const char *name;
+    int channels;
+    int bit_depth;
+    AudioUnpackFn unpack;
+} AudioUnpackKernel;
+
+// Unpacks a subset of the stream's channels. Only the selected channels are
+// written, in stream order, so each output sample set holds `n_selected`
+// values.
+typedef struct {
+    const AudioUnpackKernel *kernel; // unpacks whole sample sets when every channel is selected
+    int channels;                    // interleaved channels in the stream
+    int bit_depth;
+    int n_selected;
+    uint8_t selected[AUDIO_UNPACK_MAX_CHANNELS]; // stream channel of each output value
+} AudioUnpackSelection;
+
+//-----------------------------------------------------------------------------
+// Methods
+//-----------------------------------------------------------------------------
+int audio_unpack_neon_available(void);
+const AudioUnpackKernel *audio_unpack_get_scalar_kernel(int channels, int bit_depth);
+const AudioUnpackKernel *audio_unpack_get_neon_kernel(int channels, int bit_depth);
+const AudioUnpackKernel *audio_unpack_get_kernel(int channels, int bit_depth);
+int audio_unpack_selection_init(AudioUnpackSelection *self, int channels, int bit_depth, uint32_t channel_mask);
+void audio_unpack_selection_run(const AudioUnpackSelection *self, int32_t *dst, const uint8_t *src, size_t n_samples);
+
+#endif // CETI_DSP_AUDIO_UNPACK_H
@@ -0,0 +1,232 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+// Echolocation click detection on interleaved audio.
+//
+// Each channel is band-passed to the click band, which removes flow noise and
+// most of the tag's own low frequency sounds, then the Teager-Kaiser energy
+//   psi[n] = y[n]^2 - y[n - 1] * y[n + 1]
+// tracks the instantaneous amplitude and frequency of the signal. Short
+// broadband clicks stand well out of psi where they barely move a plain
+// energy average. A click starts when the smoothed energy rises
+// `threshold_db` above the noise floor and ends once it falls 6 dB below that.
+//
+// The channels are held in the lanes of a GCC vector so the filters compile
+// to SIMD on any target that has it (NEON on the tag) and to plain scalar code
+// elsewhere, without intrinsics.
+//-----------------------------------------------------------------------------
+#include "click_detect.h"
+
+#include <math.h>
+#include <string.h>
+
+#define CLICK_DETECTOR_ENERGY_TIME_CONSTANT_S (0.0001)
+#define CLICK_DETECTOR_NOISE_TIME_CONSTANT_S (0.5)
+#define CLICK_DETECTOR_WARMUP_TIME_CONSTANT_S (0.005)
+#define CLICK_DETECTOR_WARMUP_S (0.05)
+#define CLICK_DETECTOR_MAX_BAND_FRACTION (0.45) // highest band edge, fraction of the sample rate
+#define CLICK_DETECTOR_RELEASE_DB (6.0)
+#define CLICK_DETECTOR_NOISE_MIN (1e-12f) // keeps digital silence from triggering on the first sound
+
+// one pole smoothing coefficient for a time constant
+static float __smoothing_alpha(double time_constant_s, uint32_t sample_rate_hz) {
+    return (float)(1.0 - exp(-1.0 / (time_constant_s * sample_rate_hz)));
+}
+
+// second order Butterworth section (RBJ cookbook), normalized by a0
+static void __butterworth(float b[3], float a[2], double frequency_hz, uint32_t sample_rate_hz, int high_pass) {
+    double w0 = 2.0 * M_PI * frequency_hz / sample_rate_hz;
+    double alpha = sin(w0) / (2.0 * M_SQRT1_2);
+    double cos_w0 = cos(w0);
+    double a0 = 1.0 + alpha;
+    double edge = high_pass ? (1.0 + cos_w0) : (1.0 - cos_w0);
+    b[0] = (float)(edge / 2.0 / a0);
+    b[1] = (float)((high_pass ? -edge : edge) / a0);
+    b[2] = b[0];
+    a[0] = (float)(-2.0 * cos_w0 / a0);
+    a[1] = (float)((1.0 - alpha) / a0);
+}
+
+/**
+ * @brief Designs the band-pass and sets the detection thresholds. Input
+ * samples are sign-extended `input_bit_depth` values (as from
+ * dsp/audio_unpack.h).
+ *
+ * @return 0 on success, -1 for an unsupported format or an empty band
+ */
+int click_detector_init(ClickDetector *self, const AudioClickConfig *config, uint32_t sample_rate_hz, uint32_t channels, int input_bit_depth) {
+    memset(self, 0, sizeof(*self));
+    if ((sample_rate_hz == 0) || (channels == 0) || (channels > CLICK_DETECTOR_MAX_CHANNELS) || (input_bit_depth < 16) || (input_bit_depth > 32) || (config->threshold_db <= CLICK_DETECTOR_RELEASE_DB)) {
+        return -1;
+    }
+    double high_hz = fmin(config->band_high_hz, CLICK_DETECTOR_MAX_BAND_FRACTION * sample_rate_hz);
+    if ((config->band_low_hz == 0) || (config->band_low_hz >= high_hz)) {
+        return -1;
+    }
+
+    self->channels = channels;
+    self->input_scale = (float)ldexp(1.0, 1 - input_bit_depth);
+    __butterworth(self->b[0], self->a[0], config->band_low_hz, sample_rate_hz, 1);
+    __butterworth(self->b[1], self->a[1], high_hz, sample_rate_hz, 0);
+    self->energy_alpha = __smoothing_alpha(CLICK_DETECTOR_ENERGY_TIME_CONSTANT_S, sample_rate_hz);
+    self->noise_alpha = __smoothing_alpha(CLICK_DETECTOR_NOISE_TIME_CONSTANT_S, sample_rate_hz);
+    self->warmup_alpha = __smoothing_alpha(CLICK_DETECTOR_WARMUP_TIME_CONSTANT_S, sample_rate_hz);
+    self->threshold = powf(10.0f, config->threshold_db / 10.0f);
+    self->release = powf(10.0f, (config->threshold_db - CLICK_DETECTOR_RELEASE_DB) / 10.0f);
+    self->warmup_samples = (uint32_t)(CLICK_DETECTOR_WARMUP_S * sample_rate_hz);
+    self->holdoff_samples = (uint32_t)((uint64_t)config->holdoff_ms * sample_rate_hz / 1000);
+    self->max_duration_samples = (uint32_t)((uint64_t)CLICK_DETECTOR_MAX_DURATION_MS * sample_rate_hz / 1000);
+    self->max_ici_samples = CLICK_DETECTOR_MAX_ICI_S * sample_rate_hz;
+    return 0;
+}
+
+/**
+ * @brief Clears the filters, noise floor and click history, for when the
+ * input is not continuous. Sample numbering restarts at 0.
+ */
+void click_detector_reset(ClickDetector *self) {
+    memset(self->z, 0, sizeof(self->z));
+    memset(&self->y1, 0, sizeof(self->y1));
+    memset(&self->y2, 0, sizeof(self->y2));
+    memset(&self->energy, 0, sizeof(self->energy));
+    memset(&self->noise, 0, sizeof(self->noise));
+    memset(&self->hold, 0, sizeof(self->hold));
+    memset(self->lane, 0, sizeof(self->lane));
+    self->sample = 0;
+}
+
+// End of a click on one channel, recorded if there is room
+static void __click_detector_emit(ClickDetector *self, uint32_t channel, uint64_t end, ClickEvent *events, size_t *n_events, size_t max_events) {
+    ClickLane *lane = &self->lane[channel];
+    uint32_t ici = 0;
+    if (lane->has_previous && (lane->onset - lane->previous_onset <= self->max_ici_samples)) {
+        ici = (uint32_t)(lane->onset - lane->previous_onset);
+    }
+    lane->has_previous = 1;
+    lane->previous_onset = lane->onset;
+    lane->active = 0;
+    lane->quiet_until = lane->onset + self->holdoff_samples;
+
+    if (*n_events >= max_events) {
+        self->dropped_events++;
+        return;
+    }
+    ClickEvent *event = &events[(*n_events)++];
+    event->sample = lane->onset;
+    event->ici_samples = ici;
+    event->duration_samples = (uint32_t)(end - lane->onset);
+    event->amplitude = lane->peak_amplitude;
+    event->snr_db = 10.0f * log10f(lane->peak_ratio);
+    event->channel = (uint8_t)channel;
+}
+
+/**
+ * @brief Runs `n_samples` interleaved sample sets through the detector and
+ * writes the clicks that ended among them to `events`. A click is reported
+ * once it ends, so its onset may fall in an earlier call. State carries over
+ * between calls, so the input may be split anywhere.
+ *
+ * Work per sample set is the same whether or not a click is found; clicks
+ * beyond `max_events` are counted in `dropped_events` rather than returned.
+ *
+ * @return number of events written to `events`
+ */
+size_t click_detector_process(ClickDetector *self, const int32_t *src, size_t n_samples, ClickEvent *events, size_t max_events) {
+    const uint32_t channels = self->channels;
+    const float scale = self->input_scale;
+    const float hp_b0 = self->b[0][0], hp_b1 = self->b[0][1], hp_b2 = self->b[0][2];
+    const float hp_a1 = self->a[0][0], hp_a2 = self->a[0][1];
+    const float lp_b0 = self->b[1][0], lp_b1 = self->b[1][1], lp_b2 = self->b[1][2];
+    const float lp_a1 = self->a[1][0], lp_a2 = self->a[1][1];
+    const float energy_alpha = self->energy_alpha;
+    const float threshold = self->threshold;
+    const ClickVector noise_min = (ClickVector){0} + CLICK_DETECTOR_NOISE_MIN;
+
+    ClickVector hp_z1 = self->z[0][0], hp_z2 = self->z[0][1];
+    ClickVector lp_z1 = self->z[1][0], lp_z2 = self->z[1][1];
+    ClickVector y1 = self->y1, y2 = self->y2;
+    ClickVector energy = self->energy, noise = self->noise;
+    ClickMask hold = self->hold;
+    size_t n_events = 0;
+
+    for (size_t i = 0; i < n_samples; i++, src += channels) {
+        ClickVector x = {0};
+        for (uint32_t c = 0; c < channels; c++) {
+            x[c] = (float)src[c];
+        }
+        x *= scale;
+
+        // band-pass, transposed direct form II
+        ClickVector hp = hp_b0 * x + hp_z1;
+        hp_z1 = hp_b1 * x - hp_a1 * hp + hp_z2;
+        hp_z2 = hp_b2 * x - hp_a2 * hp;
+        ClickVector y = lp_b0 * hp + lp_z1;
+        lp_z1 = lp_b1 * hp - lp_a1 * y + lp_z2;
+        lp_z2 = lp_b2 * hp - lp_a2 * y;
+
+        // Teager-Kaiser energy of the previous sample, magnitude by clearing the sign bit
+        ClickVector psi = y1 * y1 - y2 * y;
+        psi = (ClickVector)((ClickMask)psi & 0x7fffffff);
+        y2 = y1;
+        y1 = y;
+        energy += energy_alpha * (psi - energy);
+
+        // the noise floor is frozen on channels in a click
+        uint64_t n = self->sample++;
+        float noise_alpha = (n < self->warmup_samples) ? self->warmup_alpha : self->noise_alpha;
+        ClickVector noise_step = noise_alpha * (energy - noise);
+        noise += (ClickVector)((ClickMask)noise_step & ~hold);
+        ClickMask too_low = noise < noise_min;
+        noise = (ClickVector)(((ClickMask)noise & ~too_low) | ((ClickMask)noise_min & too_low));
+        if (n < self->warmup_samples) {
+            continue;
+        }
+
+        ClickMask over = energy > threshold * noise;
+        ClickMask busy = over | hold;
+        if ((busy[0] | busy[1] | busy[2] | busy[3]) == 0) {
+            continue;
+        }
+
+        // rare: a channel is starting, in or just after a click
+        uint64_t centre = n - 1; // psi is centred on the previous sample
+        for (uint32_t c = 0; c < channels; c++) {
+            ClickLane *lane = &self->lane[c];
+            if (lane->active) {
+                float ratio = energy[c] / noise[c];
+                lane->peak_amplitude = fmaxf(lane->peak_amplitude, fabsf(y2[c]));
+                lane->peak_ratio = fmaxf(lane->peak_ratio, ratio);
+                if ((ratio < self->release) || (centre - lane->onset >= self->max_duration_samples)) {
+                    __click_detector_emit(self, c, centre, events, &n_events, max_events);
+                }
+            }
+            if (lane->active || (centre < lane->quiet_until)) {
+                continue;
+            }
+            if (over[c]) {
+                lane->active = 1;
+                lane->onset = centre;
+                lane->peak_amplitude = fabsf(y2[c]);
+                lane->peak_ratio = energy[c] / noise[c];
+                hold[c] = -1;
+            } else {
+                hold[c] = 0;
+            }
+        }
+    }
+
+    self->z[0][0] = hp_z1;
+    self->z[0][1] = hp_z2;
+    self->z[1][0] = lp_z1;
+    self->z[1][1] = lp_z2;
+    self->y1 = y1;
+    self->y2 = y2;
+    self->energy = energy;
+    self->noise = noise;
+    self->hold = hold;
+    return n_events;
+}
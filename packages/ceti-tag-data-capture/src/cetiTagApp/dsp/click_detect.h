@@ -0,0 +1,86 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+#ifndef CETI_DSP_CLICK_DETECT_H
+#define CETI_DSP_CLICK_DETECT_H
+
+#include "../sensors/audio.h" // for AudioClickConfig
+
+#include <stddef.h>
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Definitions/Configurations
+//-----------------------------------------------------------------------------
+#define CLICK_DETECTOR_LANES (4) // channels are filtered side by side in one vector
+#define CLICK_DETECTOR_MAX_CHANNELS CLICK_DETECTOR_LANES
+#define CLICK_DETECTOR_MAX_DURATION_MS (20) // longer events are split
+#define CLICK_DETECTOR_MAX_ICI_S (10)       // longer gaps are reported as no previous click
+
+//-----------------------------------------------------------------------------
+// Typedefs
+//-----------------------------------------------------------------------------
+typedef float ClickVector __attribute__((vector_size(CLICK_DETECTOR_LANES * sizeof(float))));
+typedef int32_t ClickMask __attribute__((vector_size(CLICK_DETECTOR_LANES * sizeof(int32_t))));
+
+typedef struct {
+    uint64_t sample;           // sample set of the onset, counted from the last reset
+    uint32_t ici_samples;      // sample sets since the previous onset on the channel, 0 for none
+    uint32_t duration_samples; // sample sets the energy stayed above the release level
+    float amplitude;           // peak band-passed amplitude, 1.0 is full scale
+    float snr_db;              // peak energy over the noise floor
+    uint8_t channel;
+} ClickEvent;
+
+typedef struct {
+    int active;          // between onset and release
+    uint64_t onset;      // sample set the current or last event started at
+    uint64_t quiet_until; // no new onset before this sample set
+    int has_previous;
+    uint64_t previous_onset;
+    float peak_amplitude;
+    float peak_ratio;
+} ClickLane;
+
+// Band-pass (second order high-pass then low-pass) followed by the
+// Teager-Kaiser energy operator, smoothed and compared to a slowly tracking
+// noise floor. All channels go through the filters together as vector lanes;
+// only samples near an event fall back to per-channel code, so the cost per
+// block is fixed by its length.
+typedef struct {
+    uint32_t channels;
+    float input_scale; // input sample to full scale 1.0
+    float b[2][3];     // biquad numerators, high-pass then low-pass
+    float a[2][2];     // biquad denominators (a0 normalized out)
+    ClickVector z[2][2]; // transposed direct form II state per biquad
+    ClickVector y1;      // previous two band-passed samples
+    ClickVector y2;
+    ClickVector energy;  // smoothed Teager-Kaiser energy
+    ClickVector noise;   // noise floor estimate
+    ClickMask hold;      // lanes in an event or hold-off, the noise floor is frozen
+    float energy_alpha;
+    float noise_alpha;
+    float warmup_alpha;  // faster noise floor tracking right after a reset
+    float threshold;     // energy ratio to start an event
+    float release;       // energy ratio to end it
+    uint32_t warmup_samples;
+    uint32_t holdoff_samples;
+    uint32_t max_duration_samples;
+    uint32_t max_ici_samples;
+    uint64_t sample; // sample sets processed since the last reset
+    uint64_t dropped_events;
+    ClickLane lane[CLICK_DETECTOR_LANES];
+} ClickDetector;
+
+//-----------------------------------------------------------------------------
+// Methods
+//-----------------------------------------------------------------------------
+int click_detector_init(ClickDetector *self, const AudioClickConfig *config, uint32_t sample_rate_hz, uint32_t channels, int input_bit_depth);
+void click_detector_reset(ClickDetector *self);
+size_t click_detector_process(ClickDetector *self, const int32_t *src, size_t n_samples, ClickEvent *events, size_t max_events);
+
+#endif // CETI_DSP_CLICK_DETECT_H
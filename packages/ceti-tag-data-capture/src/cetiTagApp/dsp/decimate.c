@@ -0,0 +1,150 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+// Integer factor decimation of interleaved audio to 16-bit samples.
+//
+// The anti-aliasing filter is a Kaiser windowed sinc (about 80 dB of
+// stopband rejection) with its cutoff at the output Nyquist frequency. What
+// aliases lands in the top of the transition band, leaving the output clean
+// up to about 0.42 of the output sample rate.
+//-----------------------------------------------------------------------------
+#include "decimate.h"
+
+#include <math.h>
+#include <string.h>
+
+#define DECIMATOR_KAISER_BETA (8.0)
+
+// zeroth order modified Bessel function of the first kind
+static double __bessel_i0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 50; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+/**
+ * @brief Designs the filter for decimating by `factor`. Input samples are
+ * sign-extended `input_bit_depth` values (as from dsp/audio_unpack.h) and
+ * output full scale is 16 bits.
+ *
+ * @return 0 on success, -1 for an unsupported factor or channel count
+ */
+int decimator_init(Decimator *self, uint32_t factor, uint32_t channels, int input_bit_depth) {
+    memset(self, 0, sizeof(*self));
+    if ((factor < 2) || (factor > DECIMATOR_MAX_FACTOR) || (channels == 0) || (channels > DECIMATOR_MAX_CHANNELS) || (input_bit_depth < 16) || (input_bit_depth > 32)) {
+        return -1;
+    }
+    self->factor = factor;
+    self->channels = channels;
+    self->taps = DECIMATOR_TAPS_PER_PHASE * factor;
+
+    double cutoff = 0.5 / factor; // cycles per input sample
+    double center = (self->taps - 1) / 2.0;
+    double window_norm = __bessel_i0(DECIMATOR_KAISER_BETA);
+    double sum = 0.0;
+    double h[DECIMATOR_MAX_TAPS];
+    for (uint32_t n = 0; n < self->taps; n++) {
+        double t = n - center;
+        double sinc = (t == 0.0) ? 1.0 : sin(2.0 * M_PI * cutoff * t) / (2.0 * M_PI * cutoff * t);
+        double r = t / center;
+        h[n] = sinc * __bessel_i0(DECIMATOR_KAISER_BETA * sqrt(1.0 - r * r)) / window_norm;
+        sum += h[n];
+    }
+
+    // unity gain at DC, with the conversion to 16-bit full scale folded in
+    double scale = ldexp(1.0, 16 - input_bit_depth) / sum;
+    for (uint32_t n = 0; n < self->taps; n++) {
+        self->coefficients[n] = (float)(h[n] * scale);
+    }
+    return 0;
+}
+
+/**
+ * @brief Clears the filter history, for when the input is not continuous.
+ */
+void decimator_reset(Decimator *self) {
+    memset(self->history, 0, sizeof(self->history));
+    self->phase = 0;
+    self->position = 0;
+}
+
+/**
+ * @brief Most output sample sets decimator_process() can produce from
+ * `n_samples` input sample sets.
+ */
+size_t decimator_max_output(const Decimator *self, size_t n_samples) {
+    return (n_samples + self->factor - 1) / self->factor;
+}
+
+/**
+ * @brief Index of the next input sample set that will produce an output.
+ */
+size_t decimator_output_offset(const Decimator *self) {
+    return self->factor - 1 - self->phase;
+}
+
+/**
+ * @brief How many input sample sets the output lags the input by.
+ */
+double decimator_delay_samples(const Decimator *self) {
+    return (self->taps - 1) / 2.0;
+}
+
+static inline int16_t __saturate16(float value) {
+    value += (value < 0.0f) ? -0.5f : 0.5f;
+    if (value >= 32767.0f) {
+        return 32767;
+    }
+    if (value <= -32768.0f) {
+        return -32768;
+    }
+    return (int16_t)value;
+}
+
+/**
+ * @brief Filters `n_samples` interleaved input sample sets and writes every
+ * `factor`th one to `dst`. State carries over between calls, so the input
+ * may be split anywhere.
+ *
+ * @param dst room for decimator_max_output(n_samples) sample sets
+ * @return number of sample sets written to `dst`
+ */
+size_t decimator_process(Decimator *self, int16_t *dst, const int32_t *src, size_t n_samples) {
+    size_t n_out = 0;
+    const uint32_t taps = self->taps;
+    const uint32_t channels = self->channels;
+    for (size_t i = 0; i < n_samples; i++, src += channels) {
+        self->position = ((self->position == 0) ? taps : self->position) - 1;
+        for (uint32_t c = 0; c < channels; c++) {
+            float value = (float)src[c];
+            self->history[c][self->position] = value;
+            self->history[c][self->position + taps] = value;
+        }
+
+        if (++self->phase < self->factor) {
+            continue;
+        }
+        self->phase = 0;
+        for (uint32_t c = 0; c < channels; c++) {
+            const float *window = &self->history[c][self->position];
+            float acc = 0.0f;
+            for (uint32_t k = 0; k < taps; k++) {
+                acc += self->coefficients[k] * window[k];
+            }
+            *dst++ = __saturate16(acc);
+        }
+        n_out++;
+    }
+    return n_out;
+}
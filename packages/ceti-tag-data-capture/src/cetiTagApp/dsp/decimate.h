@@ -0,0 +1,49 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+#ifndef CETI_DSP_DECIMATE_H
+#define CETI_DSP_DECIMATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Definitions/Configurations
+//-----------------------------------------------------------------------------
+#define DECIMATOR_TAPS_PER_PHASE (32) // taps per polyphase branch, sets the transition band width
+#define DECIMATOR_MAX_FACTOR (24)     // 192 kHz to 8 kHz
+#define DECIMATOR_MAX_CHANNELS (4)
+#define DECIMATOR_MAX_TAPS (DECIMATOR_TAPS_PER_PHASE * DECIMATOR_MAX_FACTOR)
+
+//-----------------------------------------------------------------------------
+// Typedefs
+//-----------------------------------------------------------------------------
+// Anti-aliasing low-pass FIR followed by keeping every `factor`th sample.
+// Only the kept outputs are computed (the polyphase form), so the cost is
+// DECIMATOR_TAPS_PER_PHASE multiply-adds per input sample per channel.
+typedef struct {
+    uint32_t factor;
+    uint32_t channels;
+    uint32_t taps;
+    uint32_t phase;    // input sample sets since the last output
+    uint32_t position; // newest entry of the delay lines
+    float coefficients[DECIMATOR_MAX_TAPS];
+    // each delay line is stored twice so a full window is always contiguous
+    float history[DECIMATOR_MAX_CHANNELS][2 * DECIMATOR_MAX_TAPS];
+} Decimator;
+
+//-----------------------------------------------------------------------------
+// Methods
+//-----------------------------------------------------------------------------
+int decimator_init(Decimator *self, uint32_t factor, uint32_t channels, int input_bit_depth);
+void decimator_reset(Decimator *self);
+size_t decimator_max_output(const Decimator *self, size_t n_samples);
+size_t decimator_output_offset(const Decimator *self);
+double decimator_delay_samples(const Decimator *self);
+size_t decimator_process(Decimator *self, int16_t *dst, const int32_t *src, size_t n_samples);
+
+#endif // CETI_DSP_DECIMATE_H
@@ -0,0 +1,58 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+// FLAC encoder compression settings shared by the audio writer and the
+// offline tuning benchmark (tests/bench/cetiTagApp/dsp/flac_tuning.bench.c).
+//-----------------------------------------------------------------------------
+#include "flac_tuning.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+ * @brief Applies compression settings to an encoder that has not been
+ * initialized yet.
+ *
+ * The compression level is applied first as it selects block size, stereo
+ * decorrelation and apodization itself; any of those that are set explicitly
+ * then override the level's choice.
+ *
+ * @return 0 on success, -1 if the encoder rejected a setting
+ */
+int flac_tuning_apply(FLAC__StreamEncoder *encoder, const AudioFlacTuning *tuning) {
+    FLAC__bool ok = true;
+    ok &= FLAC__stream_encoder_set_compression_level(encoder, tuning->compression_level);
+    if (tuning->blocksize != 0) {
+        ok &= FLAC__stream_encoder_set_blocksize(encoder, tuning->blocksize);
+    }
+    if (tuning->mid_side >= 0) {
+        ok &= FLAC__stream_encoder_set_do_mid_side_stereo(encoder, tuning->mid_side);
+    }
+    if (tuning->loose_mid_side >= 0) {
+        ok &= FLAC__stream_encoder_set_loose_mid_side_stereo(encoder, tuning->loose_mid_side);
+    }
+    if (tuning->apodization[0] != '\0') {
+        ok &= FLAC__stream_encoder_set_apodization(encoder, tuning->apodization);
+    }
+    return ok ? 0 : -1;
+}
+
+/**
+ * @brief Writes a one line human readable summary of the settings.
+ */
+void flac_tuning_describe(const AudioFlacTuning *tuning, char *buffer, size_t buffer_len) {
+    char blocksize_str[16] = "default";
+    if (tuning->blocksize != 0) {
+        snprintf(blocksize_str, sizeof(blocksize_str), "%u", tuning->blocksize);
+    }
+    snprintf(buffer, buffer_len, "level %d, blocksize %s, mid-side %s, loose mid-side %s, apodization %s",
+             tuning->compression_level,
+             blocksize_str,
+             (tuning->mid_side < 0) ? "default" : (tuning->mid_side ? "on" : "off"),
+             (tuning->loose_mid_side < 0) ? "default" : (tuning->loose_mid_side ? "on" : "off"),
+             (tuning->apodization[0] != '\0') ? tuning->apodization : "default");
+}
@@ -0,0 +1,22 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+#ifndef CETI_DSP_FLAC_TUNING_H
+#define CETI_DSP_FLAC_TUNING_H
+
+#include "../sensors/audio.h" // for AudioFlacTuning
+
+#include <FLAC/stream_encoder.h>
+#include <stddef.h>
+
+//-----------------------------------------------------------------------------
+// Methods
+//-----------------------------------------------------------------------------
+int flac_tuning_apply(FLAC__StreamEncoder *encoder, const AudioFlacTuning *tuning);
+void flac_tuning_describe(const AudioFlacTuning *tuning, char *buffer, size_t buffer_len);
+
+#endif // CETI_DSP_FLAC_TUNING_H
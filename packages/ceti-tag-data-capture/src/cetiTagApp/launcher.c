@@ -94,6 +94,9 @@ int main(void) {
     int num_threads = 0;
     int audio_acquisition_thread_index = -1;
     int audio_write_thread_index = -1;
+    int audio_decimate_thread_index = -1;
+    int audio_clicks_thread_index = -1;
+    int audio_levels_thread_index = -1;
     CETI_LOG("-------------------------------------------------");
     CETI_LOG("Starting acquisition threads");
     // RTC
@@ -244,6 +247,33 @@ int main(void) {
     audio_write_thread_index = num_threads;
     num_threads++;
 #endif
+    if (g_config.audio.decimated_rate_khz != 0) {
+        pthread_create(&thread_ids[num_threads], NULL, &audio_thread_decimate, NULL);
+        threads_running[num_threads] = &g_audio_thread_decimate_is_running;
+#ifdef DEBUG
+        strcpy(thread_name[num_threads], "audio_decimate");
+#endif
+        audio_decimate_thread_index = num_threads;
+        num_threads++;
+    }
+    if (g_config.audio.clicks.enabled) {
+        pthread_create(&thread_ids[num_threads], NULL, &audio_thread_detectClicks, NULL);
+        threads_running[num_threads] = &g_audio_thread_detectClicks_is_running;
+#ifdef DEBUG
+        strcpy(thread_name[num_threads], "audio_clicks");
+#endif
+        audio_clicks_thread_index = num_threads;
+        num_threads++;
+    }
+    if (g_config.audio.levels_enabled) {
+        pthread_create(&thread_ids[num_threads], NULL, &audio_thread_levels, NULL);
+        threads_running[num_threads] = &g_audio_thread_levels_is_running;
+#ifdef DEBUG
+        strcpy(thread_name[num_threads], "audio_levels");
+#endif
+        audio_levels_thread_index = num_threads;
+        num_threads++;
+    }
 #endif
 
     usleep(100000);
@@ -263,12 +293,26 @@ int main(void) {
         if (g_exit)
             break;
 
-// Check if the audio needs to be restarted after an overflow.
+// Check if the audio threads need to be restarted. FIFO overflows are
+// recovered in place by the SPI thread, so this is only for a simulated one
+// or to change the audio format.
 #if ENABLE_AUDIO
-        if (g_audio_overflow_detected && (g_audio_thread_spi_is_running && g_audio_thread_writeData_is_running)) {
+        int restart_audio = 0;
+        int restart_live_audio = 0;
+        if (audio_reconfigure_pending()) {
+            // Stop every thread following the ring, it is resized.
+            audio_restart_begin();
+            while (g_audio_thread_spi_is_running || g_audio_thread_writeData_is_running || g_audio_thread_decimate_is_running || g_audio_thread_detectClicks_is_running || g_audio_thread_levels_is_running)
+                usleep(10000);
+            audio_reconfigure_apply();
+            restart_audio = restart_live_audio = 1;
+        } else if (g_audio_overflow_detected && (g_audio_thread_spi_is_running && g_audio_thread_writeData_is_running)) {
             // Wait for the threads to stop.
             while (g_audio_thread_spi_is_running || g_audio_thread_writeData_is_running)
                 usleep(100000);
+            restart_audio = 1;
+        }
+        if (restart_audio) {
             // Restart the threads.
             pthread_create(&thread_ids[audio_acquisition_thread_index], NULL, &audio_thread_spi, NULL);
             threads_running[audio_acquisition_thread_index] = &g_audio_thread_spi_is_running;
@@ -279,6 +323,18 @@ int main(void) {
             pthread_create(&thread_ids[audio_write_thread_index], NULL, &audio_thread_writeRaw, NULL);
             threads_running[audio_write_thread_index] = &g_audio_thread_writeData_is_running;
 #endif
+        }
+        // Live stages started at launch come back unless the new format disabled them.
+        if (restart_live_audio && (audio_decimate_thread_index >= 0) && (g_config.audio.decimated_rate_khz != 0)) {
+            pthread_create(&thread_ids[audio_decimate_thread_index], NULL, &audio_thread_decimate, NULL);
+        }
+        if (restart_live_audio && (audio_clicks_thread_index >= 0) && g_config.audio.clicks.enabled) {
+            pthread_create(&thread_ids[audio_clicks_thread_index], NULL, &audio_thread_detectClicks, NULL);
+        }
+        if (restart_live_audio && (audio_levels_thread_index >= 0) && g_config.audio.levels_enabled) {
+            pthread_create(&thread_ids[audio_levels_thread_index], NULL, &audio_thread_levels, NULL);
+        }
+        if (restart_audio) {
             usleep(100000);
         }
 #endif
@@ -405,7 +461,7 @@ int init_tag() {
     char fpga_bitstream_path[512];
     strncpy(fpga_bitstream_path, g_process_path, sizeof(fpga_bitstream_path) - 1);
 #if ENABLE_RUNTIME_AUDIO
-    snprintf(fpga_bitstream_path, sizeof(fpga_bitstream_path), "%s../config/top.%dch.%dbit.bin", g_process_path, CHANNELS, g_config.audio.bit_depth);
+    snprintf(fpga_bitstream_path, sizeof(fpga_bitstream_path), "%s../config/top.%dch.%dbit.bin", g_process_path, g_config.audio.channels, g_config.audio.bit_depth);
 #else
     snprintf(fpga_bitstream_path, sizeof(fpga_bitstream_path), "%s../config/top.bin", g_process_path);
 #endif
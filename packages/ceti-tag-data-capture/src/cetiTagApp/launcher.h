@@ -45,6 +45,9 @@
 // Setting a CPU to -1 will allow the system to decide (the thread will not set an affinity)
 #define AUDIO_SPI_CPU 3
 #define AUDIO_WRITEDATA_CPU 0
+#define AUDIO_DECIMATE_CPU 1
+#define AUDIO_CLICK_CPU 1
+#define AUDIO_LEVELS_CPU 1
 #define ECG_GETDATA_CPU 2
 #define ECG_WRITEDATA_CPU 1
 #define ECG_LOD_CPU 1
@@ -64,6 +67,8 @@
 #define LIGHT_DATA_FILEPATH "/data/data_light.csv"
 #define PRESSURETEMPERATURE_DATA_FILEPATH "/data/data_pressure_temperature.csv"
 #define AUDIO_STATUS_FILEPATH "/data/data_audio_status.csv"
+#define AUDIO_CLICK_FILEPATH "/data/data_audio_clicks.bin"
+#define AUDIO_LEVELS_FILEPATH "/data/data_audio_levels.csv"
 #define RECOVERY_DATA_FILEPATH "/data/data_gps.csv"
 #define STATEMACHINE_DATA_FILEPATH "/data/data_state.csv"
 #define STATEMACHINE_BURNWIRE_TIMEOUT_START_TIME_FILEPATH "/data/burnwire_timeout_start_time_s.csv"
@@ -28,23 +28,40 @@
 //-----------------------------------------------------------------------------
 
 #include "audio.h"
+#include "audio_duty.h"
+#include "audio_source.h"
 
 // Private local headers
+#include "../_versioning.h"
 #include "../cetiTag.h"
 #include "../device/fpga.h"
+#include "../dsp/audio_levels.h"
+#include "../dsp/audio_unpack.h"
+#include "../dsp/click_detect.h"
+#include "../dsp/decimate.h"
+#include "../dsp/flac_tuning.h"
 #include "../device/gpio.h"
 #include "../device/iox.h"
 #include "../launcher.h"      // for g_stopAcquisition, sampling rate, data filepath, and CPU affinity
+#include "../state_machine.h" // for the dive state driving duty cycling
 #include "../systemMonitor.h" // for the global CPU assignment variable to update
+#include "../utils/audio_file.h"
 #include "../utils/config.h"
 #include "../utils/error.h"
+#include "../utils/file_rotation.h"
+#include "../utils/flac_index.h"
+#include "../utils/histogram.h"
 #include "../utils/logging.h"
 #include "../utils/memory.h"
+#include "../utils/ring.h"
+#include "../utils/seqlock.h"
 #include "../utils/thread_error.h"
 #include "../utils/timing.h"
 
 // Private system headers
+#include <FLAC/metadata.h>
 #include <FLAC/stream_encoder.h>
+#include <aio.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <pigpio.h>
@@ -57,6 +74,7 @@
 #include <string.h>
 #include <sys/mman.h>
 #include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 
 #if !ENABLE_FPGA
@@ -69,25 +87,91 @@ int audio_thread_init(void) {
 //-----------------------------------------------------------------------------
 // Variables
 //-----------------------------------------------------------------------------
-static int audio_buffer_toWrite = 0; // which buffer will be flushed to the output file
 static char audio_acqDataFileName[AUDIO_DATA_FILENAME_LEN] = {};
-static int audio_acqDataFileLength = 0;
+static size_t audio_acqDataFileLength = 0;
 static FLAC__StreamEncoder *flac_encoder = 0;
-static FLAC__int32 buff[AUDIO_BUFFER_SIZE_SAMPLE16][AUDIO_CHANNELS] = {0};
+// conversion buffer for one group of blocks, the encoder is fed a group at a time
+static FLAC__int32 buff[AUDIO_LCM_BYTES / sizeof(int16_t)];
+static AudioUnpackSelection s_unpack; // channels kept in FLAC files
 
 static CetiAudioBuffer *shm_audio;
 static sem_t *sem_audio_block;
-static sem_t *sem_audio_page;
-
-static struct timeval s_file_start_time;
-static struct timeval s_block_start_time;
+static CetiAudioDecimatedBuffer *shm_audio_decimated = NULL;
+static sem_t *sem_audio_decimated = SEM_FAILED;
+static CetiAudioClickBuffer *shm_audio_clicks = NULL;
+static sem_t *sem_audio_clicks = SEM_FAILED;
+static ClickDetector s_click_detector;
+static FILE *s_click_file = NULL;
+static CetiAudioLevelsBuffer *shm_audio_levels = NULL;
+static sem_t *sem_audio_levels = SEM_FAILED;
+static FILE *s_levels_file = NULL;
+
+// Duty cycling, the policy is only run by the write thread
+static AudioDuty s_duty;
+static _Atomic int s_duty_state = AUDIO_DUTY_RECORD; // AudioDutyState, for the SPI thread
+static uint32_t s_duty_pretrigger_blocks = 0;
+
+static int64_t s_file_start_time_us;
+static uint32_t s_file_start_rtc_count;
+static FileRotation s_file_rotation; // when the write thread starts a new file, and the space it reserves
+static int s_file_preallocate_warned = 0;
+
+// SPI reads land here while the ring is full so the FPGA FIFO keeps draining
+static uint8_t s_overrun_block[SPI_BLOCK_SIZE];
+static uint32_t s_overrun_blocks_remaining = 0;
+static uint32_t s_next_block_flags = 0; // AUDIO_BLOCK_FLAG_* carried over to the next block read into the ring
+static int64_t s_last_block_time_us = 0; // capture time of the last block read from the FIFO
+
+// FIFO overflows recovered without restarting the audio threads
+static int64_t s_overflow_gap_start_us = 0; // end of the audio before the pending recovery, 0 if none is pending
+static uint64_t s_overflow_recoveries = 0;
+static int64_t s_overflow_gap_last_us = 0;
+static int64_t s_overflow_gap_max_us = 0;
+
+// Restarting the audio threads to change the sample format. The SPI thread
+// stops first, then the others finish with what is left in the ring.
+typedef enum {
+    AUDIO_RESTART_NONE = 0,
+    AUDIO_RESTART_STOPPING = 1, // the SPI thread stops reading, the others carry on
+    AUDIO_RESTART_DRAINING = 2, // the SPI thread has stopped, the others empty the ring and exit
+} AudioRestartPhase;
+
+typedef enum {
+    AUDIO_RECONFIGURE_IDLE = 0,
+    AUDIO_RECONFIGURE_PENDING = 1,    // requested, waiting for the launcher to stop the audio threads
+    AUDIO_RECONFIGURE_RESTARTING = 2, // applied, waiting for the first block in the new format
+    AUDIO_RECONFIGURE_FAILED = 3,     // the source rejected the format, the previous one was restored
+} AudioReconfigureState;
+
+static _Atomic int s_audio_restart = AUDIO_RESTART_NONE;       // AudioRestartPhase
+static _Atomic int s_reconfigure_state = AUDIO_RECONFIGURE_IDLE; // AudioReconfigureState
+static AudioSampleRate s_reconfigure_sample_rate;
+static AudioBitDepth s_reconfigure_bit_depth;
+static int64_t s_reconfigure_gap_start_us = 0; // end of the audio in the previous format, 0 if not restarting
+static _Atomic int64_t s_reconfigure_gap_us = 0;
+static AudioConfig s_audio_stage_config; // live stage settings as configured, before any were disabled
+static size_t s_audio_shm_size = 0;
+
+// data-ready edge interrupt
+static sem_t s_data_ready_sem;
+static int s_data_ready_isr_attached = 0;
+static _Atomic uint32_t s_data_ready_tick = 0;
+static _Atomic int s_data_ready_edge_pending = 0;
+
+// time from the data-ready edge until the block has been read over SPI
+static Histogram s_spi_latency_us;
+static uint64_t s_spi_backlog_reads = 0; // blocks read with data-ready still asserted from the previous read
+
+// pipeline counters and histograms for other processes to sample
+static CetiAudioStats *shm_audio_stats = NULL;
 
 int g_audio_overflow_detected = 0;
 int g_audio_force_overflow = 0;
 
-static FILE *audio_status_file = NULL;
-
-static int s_audio_status_reset = 1;
+// Kept open and appended to with a single write() per row, so rows from the
+// SPI and write threads never interleave.
+static int s_audio_status_fd = -1;
+static _Atomic int s_audio_status_reset = 1;
 #define AUDIO_STATUS_CSV_HEADER    \
     "Timestamp [us]"               \
     ",RTC Count"                   \
@@ -98,23 +182,29 @@ static int s_audio_status_reset = 1;
     ",Done Writing"                \
     ",See SPI Block"
 
+typedef enum {
+    AUDIO_STATUS_OVERFLOW,
+    AUDIO_STATUS_OVERFLOW_RECOVERED,
+    AUDIO_STATUS_START_WRITING,
+    AUDIO_STATUS_DONE_WRITING,
+} AudioStatusEvent;
+
 struct {
     uint8_t overflow;
     int8_t overflow_location;
-    uint8_t start_writing;
-    uint8_t done_writing;
 } g_audio_status = {
     .overflow = 0,
     .overflow_location = -1};
 
-static int audio_writing_to_status_file = 0;
-
 //-----------------------------------------------------------------------------
 // Initialization
 //-----------------------------------------------------------------------------
 // Global variables
 int g_audio_thread_spi_is_running = 0;
 int g_audio_thread_writeData_is_running = 0;
+int g_audio_thread_decimate_is_running = 0;
+int g_audio_thread_detectClicks_is_running = 0;
+int g_audio_thread_levels_is_running = 0;
 
 // Static variables
 static bool s_audio_initialized = 0;
@@ -142,11 +232,43 @@ int wt_audio_read_overflow(void) {
     return gpioRead(AUDIO_OVERFLOW_GPIO);
 }
 
+uint32_t audio_sample_rate_to_hz(AudioSampleRate sample_rate) {
+    switch (sample_rate) {
+        case AUDIO_SAMPLE_RATE_48KHZ:
+            return 48000;
+        case AUDIO_SAMPLE_RATE_96KHZ:
+            return 96000;
+        case AUDIO_SAMPLE_RATE_192KHZ:
+            return 192000;
+        case AUDIO_SAMPLE_RATE_DEFAULT:
+        default:
+            return 750;
+    }
+}
+
+/**
+ * @brief Number of SPI blocks needed to buffer `config->buffer_duration_s`
+ * of audio, rounded up to whole sample groups.
+ */
+uint32_t audio_buffer_capacity_blocks(const AudioConfig *config) {
+    uint64_t bytes_per_second = (uint64_t)config->channels * audio_sample_rate_to_hz(config->sample_rate) * (config->bit_depth / 8);
+    uint64_t blocks = (bytes_per_second * config->buffer_duration_s + SPI_BLOCK_SIZE - 1) / SPI_BLOCK_SIZE;
+    uint64_t groups = (blocks + AUDIO_BLOCKS_PER_GROUP - 1) / AUDIO_BLOCKS_PER_GROUP;
+    if (groups < 2) {
+        groups = 2; // leave room for the writer to work on one group while the next fills
+    }
+    return (uint32_t)(groups * AUDIO_BLOCKS_PER_GROUP);
+}
+
 //  Acquisition Hardware Setup and Control Utility Functions
 void init_audio_buffers() {
-    shm_audio->block = 0;
-    shm_audio->page = 0;
-    audio_buffer_toWrite = 0;
+    ring_reset(&shm_audio->ring);
+    shm_audio->sample_rate = audio_sample_rate_to_hz(g_config.audio.sample_rate);
+    shm_audio->bit_depth = g_config.audio.bit_depth;
+    shm_audio->channels = g_config.audio.channels;
+    s_overrun_blocks_remaining = 0;
+    s_next_block_flags = 0;
+    s_overflow_gap_start_us = 0;
 }
 
 // The setting is checked to ensure it  has been applied internal to the ADC.
@@ -158,12 +280,12 @@ int audio_setup(AudioConfig *config) {
 
     // update filter
     // ToDo: why does the first audio config write fail?
-    if (audio_set_filter_type(config->filter_type) != 0) {
+    if (audio_set_filter_type(config->filter_type, config->channels) != 0) {
         CETI_ERR("Failed to set audio filter type");
         return -1;
     }
 
-    if (audio_set_filter_type(config->filter_type) != 0) {
+    if (audio_set_filter_type(config->filter_type, config->channels) != 0) {
         CETI_ERR("Failed to set audio filter type");
         return -1;
     }
@@ -189,10 +311,8 @@ int audio_setup(AudioConfig *config) {
         attempt++;
     } while (result != expected_result);
 
-// set channel 4 to standby
-#if AUDIO_CHANNELS == 3
-    wt_fpga_adc_write(0x00, 0x08);
-#endif
+    // channels not recorded or not streamed are put in standby
+    wt_fpga_adc_write(0x00, ~config->channel_mask & 0x0F);
 
     s_audio_initialized = 1;
     CETI_LOG("Audio successfully initialized");
@@ -214,14 +334,14 @@ int audio_set_bit_depth(AudioBitDepth bit_depth) {
 
 // mode A is left sinc5 filter for energy reasons (see "applications information" in datasheet)
 // Channels are swap from mode A to mode B to change filter
-int audio_set_filter_type(AudioFilterType filter_type) {
+int audio_set_filter_type(AudioFilterType filter_type, uint16_t channels) {
     switch (filter_type) {
         case AUDIO_FILTER_WIDEBAND:
-#if AUDIO_CHANNELS == 3
-            wt_fpga_adc_write(0x03, 0x17); // channels 0-2 use mode B
-#elif AUDIO_CHANNELS == 4
-            wt_fpga_adc_write(0x03, 0x3F); // all channels use mode B
-#endif
+            if (channels == 3) {
+                wt_fpga_adc_write(0x03, 0x17); // channels 0-2 use mode B
+            } else {
+                wt_fpga_adc_write(0x03, 0x3F); // all channels use mode B
+            }
             break;
         case AUDIO_FILTER_SINC5:
             wt_fpga_adc_write(0x03, 0x00); // all channels use mode A
@@ -279,9 +399,89 @@ int audio_set_sample_rate(AudioSampleRate sample_rate) {
     }
 }
 
-int reset_audio_fifo(void) {
+//-----------------------------------------------------------------------------
+// FPGA audio source
+//-----------------------------------------------------------------------------
+static int s_spi_fd = -1;
+
+static int audio_source_fpga_init(AudioConfig *config) {
+    char err_str[512];
+    int result = 0;
+    WTResult hal_result = wt_audio_init();
+    if (hal_result != WT_OK) {
+        CETI_ERR("Failed to initialize audio hardware: %s", wt_strerror_r(hal_result, err_str, sizeof(err_str)));
+        result = -1;
+    }
+    if (!audio_setup(config)) {
+        CETI_LOG("Successfully set audio sampling rate to %d kHz", config->sample_rate);
+    } else {
+        CETI_ERR("Failed to set initial audio configuration - ADC register did not read back as expected");
+        result = -1;
+    }
+    return result;
+}
+
+static int audio_source_fpga_open(void) {
+    s_spi_fd = spiOpen(SPI_CE, SPI_CLK_RATE, 1);
+    return (s_spi_fd < 0) ? -1 : 0;
+}
+
+static void audio_source_fpga_close(void) {
+    spiClose(s_spi_fd);
+    s_spi_fd = -1;
+}
+
+static void audio_source_fpga_start(void) {
+    wt_fpga_fifo_stop();  // Stop any incoming data
+    wt_fpga_fifo_reset(); // Reset the FIFO
+    wt_fpga_fifo_start(); // starts the stream
+}
+
+static void audio_source_fpga_stop(void) {
+    wt_fpga_fifo_stop(); // stops the input stream
+}
+
+static void audio_source_fpga_reset(void) {
     wt_fpga_fifo_stop();  // Stop any incoming data
     wt_fpga_fifo_reset(); // Reset the FIFO
+}
+
+static void audio_source_fpga_read(uint8_t *dst, size_t n_bytes) {
+    spiRead(s_spi_fd, (char *)dst, n_bytes);
+}
+
+static uint32_t audio_source_fpga_tick(void) {
+    return gpioTick();
+}
+
+static int audio_source_fpga_set_data_ready_isr(AudioSourceIsr isr) {
+    return gpioSetISRFunc(AUDIO_DATA_AVAILABLE, RISING_EDGE, 0, isr);
+}
+
+static const AudioSource s_audio_source_fpga = {
+    .name = "FPGA",
+    .init = audio_source_fpga_init,
+    .configure = audio_setup,
+    .open = audio_source_fpga_open,
+    .close = audio_source_fpga_close,
+    .start = audio_source_fpga_start,
+    .stop = audio_source_fpga_stop,
+    .reset = audio_source_fpga_reset,
+    .data_ready = wt_audio_read_data_ready,
+    .overflow = wt_audio_read_overflow,
+    .read = audio_source_fpga_read,
+    .tick = audio_source_fpga_tick,
+    .set_data_ready_isr = audio_source_fpga_set_data_ready_isr,
+};
+
+const AudioSource *audio_source_fpga(void) {
+    return &s_audio_source_fpga;
+}
+
+static const AudioSource *s_audio_source = &s_audio_source_fpga;
+
+int reset_audio_fifo(void) {
+    s_audio_source->reset();
     return 0;
 }
 
@@ -291,23 +491,13 @@ int reset_audio_fifo(void) {
 
 int start_audio_acq(void) {
     CETI_LOG("Starting audio acquisition");
-    init_audio_buffers();
-#if ENABLE_AUDIO_FLAC
-    audio_createNewFlacFile();
-#else
-    audio_createNewRawFile();
-#endif
-    wt_fpga_fifo_stop();  // Stop any incoming data
-    wt_fpga_fifo_reset(); // Reset the FIFO
-    wt_fpga_fifo_start(); // starts the stream
+    s_audio_source->start();
     return 0;
 }
 
 int stop_audio_acq(void) {
     CETI_LOG("Stopping audio acquisition");
-    wt_fpga_fifo_stop(); // stops the input stream
-
-    // wt_fpga_fifo_reset(); // flushes the FIFO
+    s_audio_source->stop();
     return 0;
 }
 
@@ -315,53 +505,433 @@ int stop_audio_acq(void) {
 // SPI thread - Gets Data from HW FIFO on Interrupt
 //-----------------------------------------------------------------------------
 
-void audio_status_record(void) {
+/**
+ * @brief Appends a row for `event` to the audio status file. Safe to call
+ * from any audio thread: the row is formatted locally and written with a
+ * single append.
+ *
+ * @param overflow_location where the overflow was detected, for
+ * AUDIO_STATUS_OVERFLOW
+ */
+static void audio_status_record(AudioStatusEvent event, int overflow_location) {
     char err_str[512];
+    char row[128];
 
-    if (g_stopLogging) {
+    if (g_stopLogging || (s_audio_status_fd < 0)) {
         return;
     }
 
-    long long global_time_us = get_global_time_us();
-    uint32_t rtc_time_s = getRtcCount();
-    while (audio_writing_to_status_file) {
-        usleep(10);
-        if (g_stopLogging) {
-            return;
-        }
+    char location[12] = "";
+    if (event == AUDIO_STATUS_OVERFLOW) {
+        snprintf(location, sizeof(location), "%d", overflow_location);
+    }
+    // Notes are only written once.
+    int length = snprintf(row, sizeof(row), "%ld,%d,%s%s,%s,%s,%s,%s,\n",
+                          get_global_time_us(),
+                          getRtcCount(),
+                          atomic_exchange(&s_audio_status_reset, 0) ? "Restarted! | " : "",
+                          (event == AUDIO_STATUS_OVERFLOW_RECOVERED) ? "Overflow recovered" : "",
+                          (event == AUDIO_STATUS_OVERFLOW) ? "1" : "",
+                          location,
+                          (event == AUDIO_STATUS_START_WRITING) ? "1" : "",
+                          (event == AUDIO_STATUS_DONE_WRITING) ? "1" : "");
+    if (write(s_audio_status_fd, row, length) != length) {
+        CETI_WARN("Failed to write to " AUDIO_STATUS_FILEPATH ": %s", strerror_r(errno, err_str, sizeof(err_str)));
     }
-    audio_writing_to_status_file = 1;
-    audio_status_file = fopen(AUDIO_STATUS_FILEPATH, "at");
-    if (audio_status_file == NULL) {
-        CETI_ERR("Failed to open " AUDIO_STATUS_FILEPATH ": %s", strerror_r(errno, err_str, sizeof(err_str)));
+}
+
+//-----------------------------------------------------------------------------
+// Instrumentation
+//-----------------------------------------------------------------------------
+// Each section of the stats page has a single writing thread, which updates
+// it in place under its sequence lock without ever waiting. Samplers copy a
+// section with seqlock_read().
+
+/**
+ * @brief Creates the stats page. It is kept across format changes, so the
+ * counters cover the whole session. Failures only disable the stats.
+ */
+static void audio_stats_init(void) {
+    char err_str[512];
+    if (shm_audio_stats != NULL) {
         return;
     }
-    fprintf(audio_status_file, "%lld", global_time_us);
-    fprintf(audio_status_file, ",%d", rtc_time_s);
-    // Write any notes, then clear them so they are only written once.
-    if (s_audio_status_reset) {
-        fprintf(audio_status_file, "Restarted! | ");
-        s_audio_status_reset = 0;
+    shm_audio_stats = create_shared_memory_region(AUDIO_STATS_SHM_NAME, sizeof(CetiAudioStats));
+    if (shm_audio_stats == NULL) {
+        CETI_WARN("Failed to create audio stats shared memory region: %s", strerror_r(errno, err_str, sizeof(err_str)));
+        return;
     }
+    memset(shm_audio_stats, 0, sizeof(*shm_audio_stats));
+    histogram_reset(&shm_audio_stats->spi.read_us);
+    histogram_reset(&shm_audio_stats->spi.interval_us);
+    histogram_reset(&shm_audio_stats->spi.lag_blocks);
+    histogram_reset(&shm_audio_stats->writer.chunk_us);
+    shm_audio_stats->start_time_us = get_global_time_us();
+    shm_audio_stats->version = AUDIO_STATS_VERSION;
+}
 
-    // Write overflow status information.
-    fprintf(audio_status_file, g_audio_status.overflow ? ",1" : ",");
-    if (g_audio_status.overflow_location != -1) {
-        fprintf(audio_status_file, ",%d", g_audio_status.overflow_location);
+/**
+ * @brief Counts a block read by the SPI thread.
+ *
+ * @param interval_us time since the previous block read started, negative
+ * for the first block
+ * @param dropped the block was discarded because the ring was full
+ */
+static void audio_stats_spi_block(uint32_t read_us, int64_t interval_us, int dropped) {
+    if (shm_audio_stats == NULL) {
+        return;
+    }
+    CetiAudioSpiStats *stats = &shm_audio_stats->spi;
+    seqlock_write_begin(&stats->sequence);
+    if (dropped) {
+        stats->blocks_dropped++;
     } else {
-        fprintf(audio_status_file, ",");
+        stats->blocks_read++;
+        histogram_add(&stats->lag_blocks, ring_count(&shm_audio->ring));
+    }
+    stats->bytes_read += SPI_BLOCK_SIZE;
+    histogram_add(&stats->read_us, read_us);
+    if (interval_us >= 0) {
+        histogram_add(&stats->interval_us, (interval_us < UINT32_MAX) ? interval_us : UINT32_MAX);
+    }
+    seqlock_write_end(&stats->sequence);
+}
+
+/**
+ * @brief Counts a chunk of `n_blocks` taken out of the ring by the write
+ * thread, and the time it took.
+ */
+static void audio_stats_writer_chunk(uint32_t n_blocks, int64_t chunk_us) {
+    if (shm_audio_stats == NULL) {
+        return;
+    }
+    CetiAudioWriterStats *stats = &shm_audio_stats->writer;
+    seqlock_write_begin(&stats->sequence);
+    stats->chunks++;
+    stats->blocks += n_blocks;
+    histogram_add(&stats->chunk_us, chunk_us);
+    seqlock_write_end(&stats->sequence);
+}
+
+/**
+ * @brief Counts the chunks a FLAC worker encoded for one segment, along with
+ * its `n_blocks`. Called from the write thread once the segment is handed
+ * back, so the worker's histogram is no longer changing.
+ */
+static void audio_stats_writer_segment(const Histogram *chunk_us, uint32_t n_blocks) {
+    if (shm_audio_stats == NULL) {
+        return;
+    }
+    CetiAudioWriterStats *stats = &shm_audio_stats->writer;
+    seqlock_write_begin(&stats->sequence);
+    stats->chunks += chunk_us->count;
+    stats->blocks += n_blocks;
+    histogram_merge(&stats->chunk_us, chunk_us);
+    seqlock_write_end(&stats->sequence);
+}
+
+/**
+ * @brief Counts `bytes` written to files by the write thread, and a
+ * completed file if `file_done`.
+ */
+static void audio_stats_writer_output(uint64_t bytes, int file_done) {
+    if (shm_audio_stats == NULL) {
+        return;
+    }
+    CetiAudioWriterStats *stats = &shm_audio_stats->writer;
+    seqlock_write_begin(&stats->sequence);
+    stats->bytes_written += bytes;
+    stats->files += (file_done != 0);
+    seqlock_write_end(&stats->sequence);
+}
+
+static void audio_print_histogram(FILE *pFile, const char *name, const Histogram *histogram, const char *unit) {
+    fprintf(pFile, "%s: n=%lu, mean=%.0f%s, p50=%u%s, p99=%u%s, max=%u%s\n",
+            name, histogram->count,
+            histogram_mean(histogram), unit,
+            histogram_percentile(histogram, 50.0), unit,
+            histogram_percentile(histogram, 99.0), unit,
+            histogram->max, unit);
+}
+
+void audio_print_stats(FILE *pFile) {
+    CetiAudioSpiStats spi;
+    CetiAudioWriterStats writer;
+    if (shm_audio_stats == NULL) {
+        fprintf(pFile, "Audio stats are not available\n");
+        return;
+    }
+    if ((seqlock_read(&shm_audio_stats->spi.sequence, &spi, &shm_audio_stats->spi, sizeof(spi)) != 0) || (seqlock_read(&shm_audio_stats->writer.sequence, &writer, &shm_audio_stats->writer, sizeof(writer)) != 0)) {
+        fprintf(pFile, "Audio stats are being updated too often to sample, try again\n");
+        return;
+    }
+    double elapsed_s = (get_global_time_us() - shm_audio_stats->start_time_us) / 1000000.0;
+    fprintf(pFile, "Since %.0f s ago\n", elapsed_s);
+    fprintf(pFile, "SPI: %lu blocks read, %lu dropped, %lu bytes (%.0f B/s)\n", spi.blocks_read, spi.blocks_dropped, spi.bytes_read, (elapsed_s > 0) ? spi.bytes_read / elapsed_s : 0.0);
+    audio_print_histogram(pFile, "SPI read", &spi.read_us, "us");
+    audio_print_histogram(pFile, "Block interval", &spi.interval_us, "us");
+    audio_print_histogram(pFile, "Writer lag", &spi.lag_blocks, " blocks");
+    fprintf(pFile, "Writer: %lu chunks, %lu blocks, %lu files, %lu bytes written (%.0f B/s)\n", writer.chunks, writer.blocks, writer.files, writer.bytes_written, (elapsed_s > 0) ? writer.bytes_written / elapsed_s : 0.0);
+    audio_print_histogram(pFile, "Writer chunk", &writer.chunk_us, "us");
+}
+
+/**
+ * @brief Creates the shared memory and semaphore for the decimated stream.
+ * Failures disable the stream rather than audio acquisition.
+ */
+static int audio_decimate_init(void) {
+    char err_str[512];
+    uint32_t sample_rate_hz = audio_sample_rate_to_hz(g_config.audio.sample_rate);
+    uint32_t decimated_rate_hz = g_config.audio.decimated_rate_khz * 1000;
+    if ((sample_rate_hz % decimated_rate_hz != 0) || (sample_rate_hz / decimated_rate_hz < 2) || (sample_rate_hz / decimated_rate_hz > DECIMATOR_MAX_FACTOR)) {
+        CETI_ERR("Can't decimate %u Hz audio to %u Hz, the decimated stream is disabled", sample_rate_hz, decimated_rate_hz);
+        g_config.audio.decimated_rate_khz = 0;
+        return THREAD_OK;
+    }
+
+    uint32_t capacity = (AUDIO_DECIMATED_BUFFER_S * decimated_rate_hz + AUDIO_DECIMATED_BLOCK_SAMPLES - 1) / AUDIO_DECIMATED_BLOCK_SAMPLES;
+    if (shm_audio_decimated == NULL) {
+        // the size only depends on the decimated rate, so a restart reuses the region
+        shm_audio_decimated = create_shared_memory_region(AUDIO_DECIMATED_SHM_NAME, AUDIO_DECIMATED_BUFFER_SHM_SIZE(capacity, g_config.audio.channels));
+    }
+    if (shm_audio_decimated == NULL) {
+        CETI_ERR("Failed to create decimated audio shared memory region: %s", strerror_r(errno, err_str, sizeof(err_str)));
+        g_config.audio.decimated_rate_khz = 0;
+        return THREAD_ERR_SHM_FAILED;
+    }
+    shm_audio_decimated->info_offset = AUDIO_DECIMATED_BUFFER_INFO_OFFSET;
+    shm_audio_decimated->data_offset = AUDIO_DECIMATED_BUFFER_DATA_OFFSET(capacity);
+    shm_audio_decimated->sample_rate = decimated_rate_hz;
+    shm_audio_decimated->channels = g_config.audio.channels;
+    shm_audio_decimated->decimation = sample_rate_hz / decimated_rate_hz;
+    ring_init(&shm_audio_decimated->ring, capacity, AUDIO_DECIMATED_BLOCK_SIZE(g_config.audio.channels));
+
+    if (sem_audio_decimated == SEM_FAILED) {
+        sem_audio_decimated = sem_open(AUDIO_DECIMATED_SEM_NAME, O_CREAT, 0644, 0);
+    }
+    if (sem_audio_decimated == SEM_FAILED) {
+        CETI_ERR("Failed to create decimated audio semaphore: %s", strerror_r(errno, err_str, sizeof(err_str)));
+        g_config.audio.decimated_rate_khz = 0;
+        return THREAD_ERR_SEM_FAILED;
+    }
+    CETI_LOG("Decimated audio ring buffer holds %u blocks of %u Hz audio", capacity, decimated_rate_hz);
+    return THREAD_OK;
+}
+
+/**
+ * @brief Sets up the click detector, its shared memory and semaphore, and
+ * opens the click index file. The file header records the sample rate at
+ * the time the file was created. Failures disable click detection rather than
+ * audio acquisition.
+ */
+static int audio_clicks_init(void) {
+    char err_str[512];
+    uint32_t sample_rate_hz = audio_sample_rate_to_hz(g_config.audio.sample_rate);
+    if (click_detector_init(&s_click_detector, &g_config.audio.clicks, sample_rate_hz, g_config.audio.channels, g_config.audio.bit_depth) != 0) {
+        CETI_ERR("Can't detect clicks between %u and %u Hz in %u Hz audio, click detection is disabled", g_config.audio.clicks.band_low_hz, g_config.audio.clicks.band_high_hz, sample_rate_hz);
+        g_config.audio.clicks.enabled = 0;
+        return THREAD_OK;
+    }
+
+    if (shm_audio_clicks == NULL) {
+        shm_audio_clicks = create_shared_memory_region(AUDIO_CLICK_SHM_NAME, AUDIO_CLICK_BUFFER_SHM_SIZE(AUDIO_CLICK_BUFFER_CAPACITY));
+    }
+    if (shm_audio_clicks == NULL) {
+        CETI_ERR("Failed to create click shared memory region: %s", strerror_r(errno, err_str, sizeof(err_str)));
+        g_config.audio.clicks.enabled = 0;
+        return THREAD_ERR_SHM_FAILED;
+    }
+    shm_audio_clicks->sample_rate = sample_rate_hz;
+    shm_audio_clicks->channels = g_config.audio.channels;
+    atomic_store(&shm_audio_clicks->dropped, 0);
+    ring_init(&shm_audio_clicks->ring, AUDIO_CLICK_BUFFER_CAPACITY, sizeof(CetiAudioClick));
+
+    if (sem_audio_clicks == SEM_FAILED) {
+        sem_audio_clicks = sem_open(AUDIO_CLICK_SEM_NAME, O_CREAT, 0644, 0);
+    }
+    if (sem_audio_clicks == SEM_FAILED) {
+        CETI_ERR("Failed to create click semaphore: %s", strerror_r(errno, err_str, sizeof(err_str)));
+        g_config.audio.clicks.enabled = 0;
+        return THREAD_ERR_SEM_FAILED;
+    }
+
+    // clicks are appended to one file, which gets a header when it is created
+    s_click_file = fopen(AUDIO_CLICK_FILEPATH, "ab");
+    if (s_click_file == NULL) {
+        CETI_ERR("Failed to open/create the click index file " AUDIO_CLICK_FILEPATH ": %s", strerror_r(errno, err_str, sizeof(err_str)));
+        return THREAD_ERR_DATA_FILE_FAILED;
+    }
+    if (ftell(s_click_file) == 0) {
+        AudioClickFileHeader header = {
+            .magic = AUDIO_CLICK_FILE_MAGIC,
+            .version = AUDIO_CLICK_FILE_VERSION,
+            .header_size = sizeof(AudioClickFileHeader),
+            .record_size = sizeof(CetiAudioClick),
+            .sample_rate_hz = sample_rate_hz,
+            .channels = g_config.audio.channels,
+            .band_low_hz = g_config.audio.clicks.band_low_hz,
+            .band_high_hz = g_config.audio.clicks.band_high_hz,
+            .threshold_db = g_config.audio.clicks.threshold_db,
+            .holdoff_ms = g_config.audio.clicks.holdoff_ms,
+        };
+        fwrite(&header, sizeof(header), 1, s_click_file);
+        fflush(s_click_file);
+    }
+    return THREAD_OK;
+}
+
+/**
+ * @brief Sets up the level records' shared memory and semaphore, and opens
+ * the levels CSV file. Failures disable the level records rather than audio
+ * acquisition.
+ */
+static int audio_levels_stage_init(void) {
+    char err_str[512];
+    if (shm_audio_levels == NULL) {
+        shm_audio_levels = create_shared_memory_region(AUDIO_LEVELS_SHM_NAME, AUDIO_LEVELS_BUFFER_SHM_SIZE(AUDIO_LEVELS_BUFFER_CAPACITY));
+    }
+    if (shm_audio_levels == NULL) {
+        CETI_ERR("Failed to create audio levels shared memory region: %s", strerror_r(errno, err_str, sizeof(err_str)));
+        g_config.audio.levels_enabled = 0;
+        return THREAD_ERR_SHM_FAILED;
+    }
+    shm_audio_levels->sample_rate = audio_sample_rate_to_hz(g_config.audio.sample_rate);
+    ring_init(&shm_audio_levels->ring, AUDIO_LEVELS_BUFFER_CAPACITY, sizeof(CetiAudioLevels));
+
+    if (sem_audio_levels == SEM_FAILED) {
+        sem_audio_levels = sem_open(AUDIO_LEVELS_SEM_NAME, O_CREAT, 0644, 0);
+    }
+    if (sem_audio_levels == SEM_FAILED) {
+        CETI_ERR("Failed to create audio levels semaphore: %s", strerror_r(errno, err_str, sizeof(err_str)));
+        g_config.audio.levels_enabled = 0;
+        return THREAD_ERR_SEM_FAILED;
+    }
+
+    // Too many columns for init_data_file's header buffer, so the header is
+    // written here. Band columns are named by frequency range, which depends
+    // on the sample rate of the session that created the file.
+    int data_file_exists = (access(AUDIO_LEVELS_FILEPATH, F_OK) != -1);
+    s_levels_file = fopen(AUDIO_LEVELS_FILEPATH, "at");
+    if (s_levels_file == NULL) {
+        CETI_ERR("Failed to open/create an output data file: " AUDIO_LEVELS_FILEPATH ": %s", strerror_r(errno, err_str, sizeof(err_str)));
+        return THREAD_ERR_DATA_FILE_FAILED;
+    }
+    if (!data_file_exists) {
+        double band_khz = shm_audio_levels->sample_rate / 2000.0 / AUDIO_LEVELS_BANDS;
+        fprintf(s_levels_file, "Timestamp [us],RTC Count,Notes,Samples");
+        for (int c = 0; c < g_config.audio.channels; c++) {
+            fprintf(s_levels_file, ",CH%d RMS [dBFS],CH%d Peak [dBFS],CH%d DC", c + 1, c + 1, c + 1);
+            for (int b = 0; b < AUDIO_LEVELS_BANDS; b++) {
+                fprintf(s_levels_file, ",CH%d %g-%g kHz [dBFS]", c + 1, b * band_khz, (b + 1) * band_khz);
+            }
+        }
+        fprintf(s_levels_file, "\n");
+        fflush(s_levels_file);
+    }
+    return THREAD_OK;
+}
+
+//-----------------------------------------------------------------------------
+// Duty cycling - only record around dives and clicks
+//-----------------------------------------------------------------------------
+// The write thread runs the policy and stops writing when it leaves the
+// recording state. In standby the SPI thread keeps filling the ring and the
+// writer only releases audio older than the pre-trigger, so recording
+// resumes with the audio leading up to the trigger. When paused the SPI
+// thread also stops the FIFO, and restarts it on a group boundary as after an
+// overflow.
+static uint64_t audio_duty_click_count(void) {
+    // every click detected is published to the click ring
+    return (shm_audio_clicks != NULL) ? atomic_load(&shm_audio_clicks->ring.head) : 0;
+}
+
+static int audio_duty_diving(void) {
+    // without the state machine there is no dive state, so record throughout
+    return !g_stateMachine_thread_is_running || (stateMachine_get_state() == ST_RECORD_DIVING);
+}
+
+/**
+ * @brief Sizes the pre-trigger and starts the policy recording.
+ */
+static void audio_duty_setup(void) {
+    uint64_t bytes_per_second = (uint64_t)g_config.audio.channels * audio_sample_rate_to_hz(g_config.audio.sample_rate) * (g_config.audio.bit_depth / 8);
+    uint64_t blocks = (bytes_per_second * g_config.audio.duty.pretrigger_s + SPI_BLOCK_SIZE - 1) / SPI_BLOCK_SIZE;
+    uint64_t groups = (blocks + AUDIO_BLOCKS_PER_GROUP - 1) / AUDIO_BLOCKS_PER_GROUP;
+
+    // leave the SPI thread two groups of room while the writer polls, but
+    // keep at least one group of pre-trigger in the smallest buffer
+    uint64_t capacity_groups = shm_audio->ring.capacity / AUDIO_BLOCKS_PER_GROUP;
+    uint64_t max_groups = (capacity_groups > 2) ? capacity_groups - 2 : 1;
+    if (groups > max_groups) {
+        groups = max_groups;
+        CETI_WARN("A %us audio pre-trigger does not fit in the audio buffer, using %.1fs",
+                  g_config.audio.duty.pretrigger_s,
+                  groups * AUDIO_BLOCKS_PER_GROUP * AUDIO_BLOCK_FILL_SPEED_US(shm_audio->channels, shm_audio->sample_rate, shm_audio->bit_depth) / 1000000.0);
+    }
+    s_duty_pretrigger_blocks = (uint32_t)groups * AUDIO_BLOCKS_PER_GROUP;
+
+    audio_duty_init(&s_duty, &g_config.audio.duty, get_global_time_us(), audio_duty_click_count());
+    atomic_store(&s_duty_state, s_duty.state);
+    CETI_LOG("Audio duty cycling to %s when quiet, %.1fs pre-trigger, %us hold, %us dive silence",
+             (g_config.audio.duty.mode == AUDIO_DUTY_CYCLE_PAUSE) ? "pause" : "standby",
+             s_duty_pretrigger_blocks * AUDIO_BLOCK_FILL_SPEED_US(shm_audio->channels, shm_audio->sample_rate, shm_audio->bit_depth) / 1000000.0,
+             g_config.audio.duty.hold_s, g_config.audio.duty.silence_s);
+}
+
+/**
+ * @brief Runs the duty cycling policy. Only the write thread calls this.
+ *
+ * @return 1 if audio should be written, 0 otherwise
+ */
+static int audio_duty_poll(void) {
+    if (g_config.audio.duty.mode == AUDIO_DUTY_CYCLE_OFF) {
+        return 1;
+    }
+    if (audio_duty_update(&s_duty, get_global_time_us(), audio_duty_diving(), audio_duty_click_count())) {
+        atomic_store(&s_duty_state, s_duty.state);
+        CETI_LOG("Audio recording %s (%s)", audio_duty_state_str(s_duty.state), s_duty.diving ? "diving" : "at the surface");
+    }
+    return (s_duty.state == AUDIO_DUTY_RECORD);
+}
+
+/**
+ * @brief Releases audio that won't be recorded, keeping the pre-trigger in
+ * the ring while in standby. Whole groups are released, so recording
+ * resumes on a group boundary.
+ */
+static void audio_duty_discard(void) {
+    uint32_t keep_blocks = (s_duty.state == AUDIO_DUTY_STANDBY) ? s_duty_pretrigger_blocks : 0;
+    while (ring_count(&shm_audio->ring) >= keep_blocks + AUDIO_BLOCKS_PER_GROUP) {
+        ring_release(&shm_audio->ring, AUDIO_BLOCKS_PER_GROUP);
     }
-    fprintf(audio_status_file, g_audio_status.start_writing ? ",1" : ",");
-    fprintf(audio_status_file, g_audio_status.done_writing ? ",1" : ",");
-    fprintf(audio_status_file, ",");
-    // Finish the row of data.
-    fprintf(audio_status_file, "\n");
-    fclose(audio_status_file);
+}
 
-    // clear log
-    g_audio_status.start_writing = 0;
-    g_audio_status.done_writing = 0;
-    audio_writing_to_status_file = 0;
+/**
+ * @brief Sizes the full rate ring for the configured format, replacing the
+ * shared memory region if the size changed.
+ */
+static int audio_buffer_create(void) {
+    char err_str[512];
+    uint32_t capacity = audio_buffer_capacity_blocks(&g_config.audio);
+    size_t shm_size = AUDIO_BUFFER_SHM_SIZE(capacity);
+    if ((shm_audio != NULL) && (shm_size != s_audio_shm_size)) {
+        munmap(shm_audio, s_audio_shm_size);
+        shm_audio = NULL;
+    }
+    if (shm_audio == NULL) {
+        shm_audio = create_shared_memory_region(AUDIO_SHM_NAME, shm_size);
+        if (shm_audio == NULL) {
+            CETI_ERR("Failed to create shared memory region: %s", strerror_r(errno, err_str, sizeof(err_str)));
+            return THREAD_ERR_SHM_FAILED;
+        }
+        s_audio_shm_size = shm_size;
+    }
+    shm_audio->info_offset = AUDIO_BUFFER_INFO_OFFSET;
+    shm_audio->data_offset = AUDIO_BUFFER_DATA_OFFSET(capacity);
+    ring_init(&shm_audio->ring, capacity, SPI_BLOCK_SIZE);
+    init_audio_buffers();
+    CETI_LOG("Audio ring buffer holds %u blocks (%.1f s)", capacity, capacity * AUDIO_BLOCK_FILL_SPEED_US(shm_audio->channels, shm_audio->sample_rate, shm_audio->bit_depth) / 1000000.0);
+    return THREAD_OK;
 }
 
 int audio_thread_init(void) {
@@ -371,24 +941,21 @@ int audio_thread_init(void) {
     g_config.audio.bit_depth = AUDIO_BIT_DEPTH_16;
     g_config.audio.sample_rate = AUDIO_SAMPLE_RATE_96KHZ;
 #endif
-    WTResult hal_result = wt_audio_init();
-    if (hal_result != WT_OK) {
-        CETI_ERR("Failed to initialize audio hardware: %s", wt_strerror_r(hal_result, err_str, sizeof(err_str)));
-        thread_result |= THREAD_ERR_HW;
+    uint32_t stream_mask = (1u << g_config.audio.channels) - 1;
+    if ((g_config.audio.channel_mask & stream_mask) == 0) {
+        CETI_WARN("None of the audio channels selected are streamed, recording all of them");
+        g_config.audio.channel_mask = stream_mask;
     }
-    if (!audio_setup(&g_config.audio)) {
-        CETI_LOG("Successfully set audio sampling rate to %d kHz", g_config.audio.sample_rate);
-    } else {
-        CETI_ERR("Failed to set initial audio configuration - ADC register did not read back as expected");
+    g_config.audio.channel_mask &= stream_mask;
+
+    s_audio_source = audio_source_get(g_config.audio.source);
+    CETI_LOG("Acquiring audio from the %s source", s_audio_source->name);
+    if (s_audio_source->init(&g_config.audio) != 0) {
         thread_result |= THREAD_ERR_HW;
     }
 
     // create shared memory region for audio buffer
-    shm_audio = create_shared_memory_region(AUDIO_SHM_NAME, sizeof(CetiAudioBuffer));
-    if (shm_audio == NULL) {
-        CETI_ERR("Failed to create shared memory region: %s", strerror_r(errno, err_str, sizeof(err_str)));
-        thread_result |= THREAD_ERR_SHM_FAILED;
-    }
+    thread_result |= audio_buffer_create();
 
     // create synchronization semaphores
     sem_audio_block = sem_open(AUDIO_BLOCK_SEM_NAME, O_CREAT, 0644, 0);
@@ -397,24 +964,39 @@ int audio_thread_init(void) {
         thread_result |= THREAD_ERR_SEM_FAILED;
     }
 
-    sem_audio_page = sem_open(AUDIO_BLOCK_SEM_NAME, O_CREAT, 0644, 0);
-    if (sem_audio_page == SEM_FAILED) {
-        CETI_ERR("Failed to create page ready semaphore: %s", strerror_r(errno, err_str, sizeof(err_str)));
-        thread_result |= THREAD_ERR_SEM_FAILED;
+    // the live stages may be disabled for a format, and come back with another
+    s_audio_stage_config = g_config.audio;
+    if (g_config.audio.decimated_rate_khz != 0) {
+        thread_result |= audio_decimate_init();
+    }
+
+    if (g_config.audio.clicks.enabled) {
+        thread_result |= audio_clicks_init();
+    }
+
+    if (g_config.audio.levels_enabled) {
+        thread_result |= audio_levels_stage_init();
+    }
+
+    if ((g_config.audio.duty.mode != AUDIO_DUTY_CYCLE_OFF) && (shm_audio != NULL)) {
+        audio_duty_setup();
     }
 
+    audio_stats_init();
+
     // Open an output file to write data.
-    int data_file_exists = (access(AUDIO_STATUS_FILEPATH, F_OK) != -1);
-    audio_status_file = fopen(AUDIO_STATUS_FILEPATH, "at");
-    if (audio_status_file == NULL) {
+    if (s_audio_status_fd < 0) {
+        s_audio_status_fd = open(AUDIO_STATUS_FILEPATH, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    }
+    if (s_audio_status_fd < 0) {
         CETI_ERR("Failed to open/create an output data file: " AUDIO_STATUS_FILEPATH ": %s", strerror_r(errno, err_str, sizeof(err_str)));
         thread_result |= THREAD_ERR_DATA_FILE_FAILED;
-    } else {
+    } else if (lseek(s_audio_status_fd, 0, SEEK_END) == 0) {
         // Write headers if the file didn't already exist.
-        if (!data_file_exists) {
-            fprintf(audio_status_file, AUDIO_STATUS_CSV_HEADER "\n");
+        const char header[] = AUDIO_STATUS_CSV_HEADER "\n";
+        if (write(s_audio_status_fd, header, sizeof(header) - 1) != sizeof(header) - 1) {
+            CETI_WARN("Failed to write the header of " AUDIO_STATUS_FILEPATH);
         }
-        fclose(audio_status_file); // Close the file.
     }
     g_audio_overflow_detected = g_audio_status.overflow = 0;
     g_audio_status.overflow_location = -1;
@@ -422,158 +1004,1677 @@ int audio_thread_init(void) {
     return thread_result;
 }
 
-void *audio_thread_spi(void *paramPtr) {
-    // Get the thread ID, so the system monitor can check its CPU assignment.
-    g_audio_thread_spi_tid = gettid();
-
-    if ((shm_audio == NULL) || (sem_audio_block == SEM_FAILED) || (sem_audio_page == SEM_FAILED)) {
-        CETI_ERR("Thread started without neccesary memory resources");
-        // Stop FPGA audio capture and reset its buffer.
-        // stop_audio_acq();
-        usleep(100000);
-        reset_audio_fifo();
-        usleep(100000);
-        g_audio_overflow_detected = g_audio_status.overflow = 0;
-        g_audio_status.overflow_location = -1;
+//-----------------------------------------------------------------------------
+// Runtime reconfiguration - change the sample format without exiting
+//-----------------------------------------------------------------------------
+// The command thread requests a format and the launcher, which owns the audio
+// threads, stops them all with audio_restart_begin(), applies the format and
+// starts them again. The SPI thread stops reading first so the writer can
+// finish the file with every block acquired in the old format.
+
+/**
+ * @brief Asks for the audio threads to be restarted with a new sample format.
+ *
+ * @return 0 if the request was queued, -1 if the format can't be used or a
+ * change is already underway
+ */
+int audio_reconfigure_request(AudioSampleRate sample_rate, AudioBitDepth bit_depth) {
+    if ((sample_rate != AUDIO_SAMPLE_RATE_48KHZ) && (sample_rate != AUDIO_SAMPLE_RATE_96KHZ) && (sample_rate != AUDIO_SAMPLE_RATE_192KHZ)) {
+        CETI_ERR("Invalid sample rate %d kHz", sample_rate);
+        return -1;
+    }
+    if ((bit_depth != AUDIO_BIT_DEPTH_16) && (bit_depth != AUDIO_BIT_DEPTH_24)) {
+        CETI_ERR("Invalid bit depth %d", bit_depth);
+        return -1;
+    }
+#if !ENABLE_RUNTIME_AUDIO
+    // the FPGA bitstream loaded without runtime audio only streams 96 kHz 16-bit audio
+    if (s_audio_source != audio_source_simulator()) {
+        CETI_ERR("The %s audio source is fixed at %d kHz %d-bit", s_audio_source->name, g_config.audio.sample_rate, g_config.audio.bit_depth);
+        return -1;
+    }
+#endif
+    if (shm_audio == NULL) {
+        CETI_ERR("Audio acquisition is not set up");
+        return -1;
+    }
 
-        // Exit the thread.
-        g_audio_thread_spi_is_running = 0;
-        CETI_ERR("Thread terminated");
-        return NULL;
+    int state = atomic_load(&s_reconfigure_state);
+    if ((state == AUDIO_RECONFIGURE_PENDING) || (state == AUDIO_RECONFIGURE_RESTARTING)) {
+        CETI_ERR("An audio format change is already underway");
+        return -1;
     }
+    s_reconfigure_sample_rate = sample_rate;
+    s_reconfigure_bit_depth = bit_depth;
+    atomic_store(&s_reconfigure_state, AUDIO_RECONFIGURE_PENDING);
+    CETI_LOG("Audio format change to %d kHz %d-bit requested", sample_rate, bit_depth);
+    return 0;
+}
 
-    init_audio_buffers();
-    int spi_fd = spiOpen(SPI_CE, SPI_CLK_RATE, 1);
+/**
+ * @brief Whether the launcher should restart the audio threads to apply a
+ * requested format.
+ */
+int audio_reconfigure_pending(void) {
+    return atomic_load(&s_reconfigure_state) == AUDIO_RECONFIGURE_PENDING;
+}
 
-    if (spi_fd < 0) {
-        CETI_ERR("pigpio SPI initialisation failed");
-        return NULL;
+/**
+ * @brief Tells the audio threads to exit for a restart. The launcher waits
+ * for all of them to stop before calling audio_reconfigure_apply().
+ */
+void audio_restart_begin(void) {
+    CETI_LOG("Stopping the audio threads to change the audio format");
+    // without an SPI thread to stop first, the others can finish straight away
+    atomic_store(&s_audio_restart, g_audio_thread_spi_is_running ? AUDIO_RESTART_STOPPING : AUDIO_RESTART_DRAINING);
+}
+
+/**
+ * @brief Reprograms the source and resizes the shared memory for the
+ * requested format while the audio threads are stopped. The previous format
+ * is restored if the source rejects the new one.
+ *
+ * @return 0 on success, -1 if the previous format was kept
+ */
+int audio_reconfigure_apply(void) {
+    AudioConfig previous = g_config.audio;
+    int result = 0;
+
+    g_config.audio.sample_rate = s_reconfigure_sample_rate;
+    g_config.audio.bit_depth = s_reconfigure_bit_depth;
+    g_config.audio.decimated_rate_khz = s_audio_stage_config.decimated_rate_khz;
+    g_config.audio.clicks.enabled = s_audio_stage_config.clicks.enabled;
+    g_config.audio.levels_enabled = s_audio_stage_config.levels_enabled;
+    if (s_audio_source->configure(&g_config.audio) != 0) {
+        CETI_ERR("The %s audio source rejected %d kHz %d-bit audio, going back to %d kHz %d-bit", s_audio_source->name, g_config.audio.sample_rate, g_config.audio.bit_depth, previous.sample_rate, previous.bit_depth);
+        g_config.audio = previous;
+        if (s_audio_source->configure(&g_config.audio) != 0) {
+            CETI_ERR("Failed to restore the previous audio format");
+        }
+        result = -1;
     }
 
-    // Set the thread CPU affinity.
-    if (AUDIO_SPI_CPU >= 0) {
-        cpu_set_t cpuset;
-        CPU_ZERO(&cpuset);
-        CPU_SET(AUDIO_SPI_CPU, &cpuset);
-        if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) == 0)
-            CETI_LOG("Successfully set affinity to CPU %d", AUDIO_SPI_CPU);
-        else
-            CETI_WARN("Failed to set affinity to CPU %d", AUDIO_SPI_CPU);
+    if (audio_buffer_create() != THREAD_OK) {
+        result = -1;
+    }
+    if (g_config.audio.decimated_rate_khz != 0) {
+        audio_decimate_init();
+    }
+    if (g_config.audio.clicks.enabled) {
+        audio_clicks_init();
+    }
+    if (g_config.audio.levels_enabled) {
+        audio_levels_stage_init();
+    }
+    if ((g_config.audio.duty.mode != AUDIO_DUTY_CYCLE_OFF) && (shm_audio != NULL)) {
+        audio_duty_setup();
     }
 
-    // Set the thread priority.
-    struct sched_param sp;
-    memset(&sp, 0, sizeof(sp));
-    sp.sched_priority = sched_get_priority_max(SCHED_RR);
-    if (pthread_setschedparam(pthread_self(), SCHED_RR, &sp) == 0)
-        CETI_LOG("Successfully set priority");
-    else
-        CETI_WARN("Failed to set priority");
+    // the gap runs from the last block read to the first one in the new format
+    s_reconfigure_gap_start_us = (s_last_block_time_us != 0) ? s_last_block_time_us : get_global_time_us();
+    atomic_store(&s_reconfigure_state, (result == 0) ? AUDIO_RECONFIGURE_RESTARTING : AUDIO_RECONFIGURE_FAILED);
+    atomic_store(&s_audio_restart, AUDIO_RESTART_NONE);
+    return result;
+}
 
-    // Check if the audio is already overflowed.
-    audio_check_for_overflow(0);
+/**
+ * @brief Waits for a requested format change to take effect.
+ *
+ * @param gap_us audio lost between the two formats
+ * @return 0 once audio is acquired in the new format, -1 if the change
+ * failed or timed out
+ */
+int audio_reconfigure_wait(int64_t timeout_us, int64_t *gap_us) {
+    int64_t deadline_us = get_global_time_us() + timeout_us;
+    int state;
+    while (((state = atomic_load(&s_reconfigure_state)) == AUDIO_RECONFIGURE_PENDING) || (state == AUDIO_RECONFIGURE_RESTARTING)) {
+        if (get_global_time_us() > deadline_us) {
+            return -1;
+        }
+        usleep(AUDIO_RECONFIGURE_POLL_US);
+    }
+    *gap_us = atomic_load(&s_reconfigure_gap_us);
+    return (state == AUDIO_RECONFIGURE_IDLE) ? 0 : -1;
+}
 
-    // Main loop to acquire audio data.
-    g_audio_thread_spi_is_running = 1;
-    time_t expected_IQR_interval_us = AUDIO_BLOCK_FILL_SPEED_US(g_config.audio.sample_rate * 1000, g_config.audio.bit_depth);
-    time_t retry_sleep_us = expected_IQR_interval_us / 20;
+/**
+ * @brief Logs the audio lost to a format change once the first block in the
+ * new format has been read at `block_start_time_us`.
+ */
+static void audio_log_reconfigure_gap(int64_t block_start_time_us, time_t block_duration_us) {
+    // as with overflows, the new audio began a block before the read
+    int64_t gap_us = block_start_time_us - block_duration_us - s_reconfigure_gap_start_us;
+    if (gap_us < 0) {
+        gap_us = 0;
+    }
+    s_reconfigure_gap_start_us = 0;
+    atomic_store(&s_reconfigure_gap_us, gap_us);
+    CETI_LOG("Acquiring %d kHz %d-bit audio, %.1f ms of audio lost to the format change", g_config.audio.sample_rate, g_config.audio.bit_depth, gap_us / 1000.0);
+    if (atomic_load(&s_reconfigure_state) == AUDIO_RECONFIGURE_RESTARTING) {
+        atomic_store(&s_reconfigure_state, AUDIO_RECONFIGURE_IDLE);
+    }
+}
 
-    // Initialize state.
-    CETI_LOG("Starting loop to fetch data via SPI");
-    // Start the audio acquisition on the FPGA.
-    gettimeofday(&s_file_start_time, NULL);
+static void audio_data_ready_isr(int gpio, int level, uint32_t tick) {
+    if (level != 1) {
+        return;
+    }
+    atomic_store(&s_data_ready_tick, tick);
+    atomic_store(&s_data_ready_edge_pending, 1);
+    if (g_config.audio.acquisition_mode == AUDIO_ACQUISITION_EDGE) {
+        sem_post(&s_data_ready_sem);
+    }
+}
 
-    start_audio_acq();
+static void audio_attach_data_ready_isr(void) {
+    if (sem_init(&s_data_ready_sem, 0, 0) != 0) {
+        CETI_WARN("Failed to create data-ready semaphore, falling back to polling");
+        return;
+    }
+    int result = s_audio_source->set_data_ready_isr(audio_data_ready_isr);
+    if (result != 0) {
+        CETI_WARN("Failed to attach data-ready interrupt (%d), falling back to polling", result);
+        sem_destroy(&s_data_ready_sem);
+        return;
+    }
+    s_data_ready_isr_attached = 1;
+    CETI_LOG("Attached data-ready interrupt callback");
+}
 
-    // Discard the very first byte in the SPI stream.
-    char first_byte;
-    spiRead(spi_fd, &first_byte, 1);
-    while (!g_stopAcquisition && !g_audio_overflow_detected) {
-        // Wait for SPI data to be available.
-        while (!wt_audio_read_data_ready()) {
-            // Reduce the CPU load a bit.
+static void audio_detach_data_ready_isr(void) {
+    if (!s_data_ready_isr_attached) {
+        return;
+    }
+    s_audio_source->set_data_ready_isr(NULL);
+    sem_destroy(&s_data_ready_sem);
+    s_data_ready_isr_attached = 0;
+    CETI_LOG("Removed data-ready interrupt callback");
+}
+
+/**
+ * @brief Blocks until the data-ready edge fires or `timeout_us` elapses when
+ * edge acquisition is active, otherwise sleeps for `poll_interval_us`.
+ */
+static void audio_wait_for_data_ready(time_t poll_interval_us, time_t timeout_us) {
+    if (!s_data_ready_isr_attached || (g_config.audio.acquisition_mode != AUDIO_ACQUISITION_EDGE)) {
+        usleep(poll_interval_us);
+        return;
+    }
+
+    // monotonic, so the wait keeps its timeout when the system clock is set
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_us / 1000000;
+    deadline.tv_nsec += (timeout_us % 1000000) * 1000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    while ((sem_clockwait(&s_data_ready_sem, CLOCK_MONOTONIC, &deadline) != 0) && (errno == EINTR)) {
+        continue;
+    }
+}
+
+/**
+ * @brief Margin between the FPGA asserting data-ready and its FIFO
+ * overflowing.
+ */
+static double audio_fifo_margin_us(void) {
+    double bytes_per_us = (double)g_config.audio.channels * audio_sample_rate_to_hz(g_config.audio.sample_rate) * (g_config.audio.bit_depth / 8) / 1000000.0;
+    return (AUDIO_FIFO_SIZE_BYTES - SPI_BLOCK_SIZE) / bytes_per_us;
+}
+
+static void audio_log_spi_latency(void) {
+    CETI_LOG("SPI latency: n=%lu, mean=%.0fus, p50=%uus, p99=%uus, max=%uus, backlog reads=%lu (FIFO margin %.0fus)",
+             s_spi_latency_us.count,
+             histogram_mean(&s_spi_latency_us),
+             histogram_percentile(&s_spi_latency_us, 50.0),
+             histogram_percentile(&s_spi_latency_us, 99.0),
+             s_spi_latency_us.max,
+             s_spi_backlog_reads,
+             audio_fifo_margin_us());
+}
+
+void audio_print_spi_latency(FILE *pFile) {
+    fprintf(pFile, "Acquisition mode: %s\n", (s_data_ready_isr_attached && (g_config.audio.acquisition_mode == AUDIO_ACQUISITION_EDGE)) ? "edge" : "poll");
+    fprintf(pFile, "FIFO margin: %.0f us\n", audio_fifo_margin_us());
+    fprintf(pFile, "Samples: %lu, mean: %.0f us, min: %u us, max: %u us\n",
+            s_spi_latency_us.count, histogram_mean(&s_spi_latency_us),
+            (s_spi_latency_us.count != 0) ? s_spi_latency_us.min : 0, s_spi_latency_us.max);
+    fprintf(pFile, "Backlog reads: %lu\n", s_spi_backlog_reads);
+    fprintf(pFile, "FIFO overflow recoveries: %lu, last gap: %ld us, max gap: %ld us\n", s_overflow_recoveries, s_overflow_gap_last_us, s_overflow_gap_max_us);
+    for (int i = 0; i < HISTOGRAM_BUCKET_COUNT; i++) {
+        if (s_spi_latency_us.bucket[i] == 0) {
+            continue;
+        }
+        fprintf(pFile, "  <= %8u us: %lu\n", histogram_bucket_upper_bound(i), s_spi_latency_us.bucket[i]);
+    }
+}
+
+/**
+ * @brief Starts the FIFO streaming again after it was reset or stopped. The
+ * restarted stream begins on a whole sample, so the ring is first padded
+ * with silence up to the next group boundary. The padding blocks are
+ * flagged, as is the first block read after the restart.
+ *
+ * @return number of padding blocks, -1 if acquisition was stopped first
+ */
+static int audio_restart_stream(time_t retry_sleep_us) {
+    uint32_t padding_blocks = (AUDIO_BLOCKS_PER_GROUP - atomic_load(&shm_audio->ring.head) % AUDIO_BLOCKS_PER_GROUP) % AUDIO_BLOCKS_PER_GROUP;
+    for (uint32_t i = 0; i < padding_blocks; i++) {
+        uint32_t slot;
+        while (ring_reserve(&shm_audio->ring, &slot) != 0) {
+            if (g_stopAcquisition) {
+                return -1;
+            }
             usleep(retry_sleep_us);
-            // Check if the FPGA buffer overflowed.
+        }
+        CetiAudioBlockInfo *block_info = AUDIO_BUFFER_BLOCK_INFO(shm_audio, slot);
+        block_info->sys_time_us = get_global_time_us();
+        block_info->rtc_count = getRtcCount();
+        block_info->flags = AUDIO_BLOCK_FLAG_PADDING;
+        memset(AUDIO_BUFFER_BLOCK(shm_audio, slot), 0, SPI_BLOCK_SIZE);
+        ring_publish(&shm_audio->ring);
+        sem_post(sem_audio_block);
+    }
+    s_overrun_blocks_remaining = 0;
+    s_next_block_flags |= AUDIO_BLOCK_FLAG_DISCONTINUITY;
+
+    s_audio_source->start();
+    // Discard the very first byte in the SPI stream.
+    uint8_t first_byte;
+    s_audio_source->read(&first_byte, 1);
+    return (int)padding_blocks;
+}
+
+/**
+ * @brief Restarts the FPGA FIFO after it overflowed without stopping the
+ * audio threads, so the writer carries on with the same file.
+ *
+ * @return 0 on success, -1 if acquisition was stopped while recovering
+ */
+static int audio_recover_fifo_overflow(time_t retry_sleep_us) {
+    int64_t recovery_start_us = get_global_time_us();
+    s_audio_source->reset();
+    int padding_blocks = audio_restart_stream(retry_sleep_us);
+    if (padding_blocks < 0) {
+        return -1;
+    }
+
+    // The gap is measured when the first block after the restart is read.
+    s_overflow_gap_start_us = (s_last_block_time_us != 0) ? s_last_block_time_us : recovery_start_us;
+    g_audio_status.overflow = 0;
+    g_audio_status.overflow_location = -1;
+    CETI_LOG("Restarted the audio FIFO in %ld us, padded %d blocks", get_global_time_us() - recovery_start_us, padding_blocks);
+    return 0;
+}
+
+/**
+ * @brief Stops the FIFO while duty cycling is paused, then restarts it once
+ * recording resumes.
+ *
+ * @return 0 once streaming again, -1 if acquisition was stopped or the
+ * threads are restarting
+ */
+static int audio_pause_stream(time_t retry_sleep_us) {
+    CETI_LOG("Pausing audio streaming");
+    s_audio_source->stop();
+    while (atomic_load(&s_duty_state) == AUDIO_DUTY_PAUSED) {
+        if (g_stopAcquisition || (atomic_load(&s_audio_restart) != AUDIO_RESTART_NONE)) {
+            return -1;
+        }
+        usleep(AUDIO_DUTY_PAUSE_POLL_US);
+    }
+    s_audio_source->reset();
+    int padding_blocks = audio_restart_stream(retry_sleep_us);
+    if (padding_blocks < 0) {
+        return -1;
+    }
+    CETI_LOG("Resumed audio streaming, padded %d blocks", padding_blocks);
+    return 0;
+}
+
+/**
+ * @brief Logs the audio lost to the last recovered FIFO overflow once the
+ * first block after the restart has been read at `block_start_time_us`.
+ */
+static void audio_log_overflow_gap(int64_t block_start_time_us, time_t block_duration_us) {
+    // Block times are taken as the read starts, once the FIFO already holds
+    // a block, so the new audio began a block earlier.
+    int64_t gap_us = block_start_time_us - block_duration_us - s_overflow_gap_start_us;
+    if (gap_us < 0) {
+        gap_us = 0;
+    }
+    s_overflow_gap_start_us = 0;
+    s_overflow_recoveries++;
+    s_overflow_gap_last_us = gap_us;
+    if (gap_us > s_overflow_gap_max_us) {
+        s_overflow_gap_max_us = gap_us;
+    }
+    CETI_WARN("Audio FIFO overflow recovered in place, %.1f ms of audio lost (%lu recoveries)", gap_us / 1000.0, s_overflow_recoveries);
+    audio_status_record(AUDIO_STATUS_OVERFLOW_RECOVERED, 0);
+}
+
+void *audio_thread_spi(void *paramPtr) {
+    // Get the thread ID, so the system monitor can check its CPU assignment.
+    g_audio_thread_spi_tid = gettid();
+
+    if ((shm_audio == NULL) || (sem_audio_block == SEM_FAILED)) {
+        CETI_ERR("Thread started without neccesary memory resources");
+        // Stop FPGA audio capture and reset its buffer.
+        // stop_audio_acq();
+        usleep(100000);
+        reset_audio_fifo();
+        usleep(100000);
+        g_audio_overflow_detected = g_audio_status.overflow = 0;
+        g_audio_status.overflow_location = -1;
+
+        // Exit the thread.
+        g_audio_thread_spi_is_running = 0;
+        CETI_ERR("Thread terminated");
+        return NULL;
+    }
+
+    init_audio_buffers();
+    if (s_audio_source->open() != 0) {
+        CETI_ERR("%s audio source failed to open", s_audio_source->name);
+        // Nothing will be read, so the other threads empty the ring and exit
+        // rather than wait for this one to start.
+        atomic_store(&s_audio_restart, AUDIO_RESTART_DRAINING);
+        int restarting = AUDIO_RECONFIGURE_RESTARTING;
+        atomic_compare_exchange_strong(&s_reconfigure_state, &restarting, AUDIO_RECONFIGURE_FAILED);
+        g_audio_overflow_detected = g_audio_status.overflow = 0;
+        g_audio_status.overflow_location = -1;
+
+        // Exit the thread.
+        g_audio_thread_spi_is_running = 0;
+        CETI_ERR("Thread terminated");
+        return NULL;
+    }
+
+    // Set the thread CPU affinity.
+    if (AUDIO_SPI_CPU >= 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(AUDIO_SPI_CPU, &cpuset);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) == 0)
+            CETI_LOG("Successfully set affinity to CPU %d", AUDIO_SPI_CPU);
+        else
+            CETI_WARN("Failed to set affinity to CPU %d", AUDIO_SPI_CPU);
+    }
+
+    // Set the thread priority.
+    struct sched_param sp;
+    memset(&sp, 0, sizeof(sp));
+    sp.sched_priority = sched_get_priority_max(SCHED_RR);
+    if (pthread_setschedparam(pthread_self(), SCHED_RR, &sp) == 0)
+        CETI_LOG("Successfully set priority");
+    else
+        CETI_WARN("Failed to set priority");
+
+    // Check if the audio is already overflowed. Starting acquisition resets
+    // the FIFO, so this is only logged.
+    if (audio_check_for_overflow(0)) {
+        g_audio_status.overflow = 0;
+        g_audio_status.overflow_location = -1;
+    }
+
+    // Main loop to acquire audio data.
+    g_audio_thread_spi_is_running = 1;
+    time_t expected_IQR_interval_us = AUDIO_BLOCK_FILL_SPEED_US(g_config.audio.channels, audio_sample_rate_to_hz(g_config.audio.sample_rate), g_config.audio.bit_depth);
+    time_t retry_sleep_us = expected_IQR_interval_us / 20;
+    time_t edge_timeout_us = (expected_IQR_interval_us < AUDIO_DATA_READY_TIMEOUT_US) ? 2 * expected_IQR_interval_us : AUDIO_DATA_READY_TIMEOUT_US;
+    int64_t next_latency_log_us = get_global_time_us() + AUDIO_SPI_LATENCY_LOG_INTERVAL_US;
+    histogram_reset(&s_spi_latency_us);
+    s_spi_backlog_reads = 0;
+    s_last_block_time_us = 0;
+
+    // The edge interrupt timestamps data-ready in both modes so latency is
+    // comparable, but the thread only blocks on it in edge mode.
+    audio_attach_data_ready_isr();
+    CETI_LOG("Using %s acquisition", (s_data_ready_isr_attached && (g_config.audio.acquisition_mode == AUDIO_ACQUISITION_EDGE)) ? "edge" : "poll");
+
+    // Initialize state.
+    CETI_LOG("Starting loop to fetch data via SPI");
+    // Start the audio acquisition on the FPGA.
+    start_audio_acq();
+
+    // Discard the very first byte in the SPI stream.
+    uint8_t first_byte;
+    s_audio_source->read(&first_byte, 1);
+    int data_ready_after_read = 0;
+    while (!g_stopAcquisition && !g_audio_overflow_detected && (atomic_load(&s_audio_restart) == AUDIO_RESTART_NONE)) {
+        if (atomic_load(&s_duty_state) == AUDIO_DUTY_PAUSED) {
+            if (audio_pause_stream(retry_sleep_us) != 0) {
+                break;
+            }
+            data_ready_after_read = 0;
+            continue;
+        }
+
+        // Wait for SPI data to be available.
+        if (!s_audio_source->data_ready()) {
+            audio_wait_for_data_ready(retry_sleep_us, edge_timeout_us);
+            continue;
+        }
+
+        // Latency is measured from the data-ready edge when one was seen,
+        // otherwise from when the level was observed.
+        uint32_t ready_tick = atomic_exchange(&s_data_ready_edge_pending, 0) ? atomic_load(&s_data_ready_tick) : s_audio_source->tick();
+        if (data_ready_after_read) {
+            s_spi_backlog_reads++;
+        }
+
+// Cause an overflow for testing purposes if desired.
+#ifdef DEBUG
+        if (g_audio_force_overflow) {
+            usleep(100000);
+            g_audio_force_overflow = 0;
+        }
+#endif
+
+        // Read a block of data if an overflow has not occurred.
+        if (audio_check_for_overflow(2)) {
+            if (audio_recover_fifo_overflow(retry_sleep_us) != 0) {
+                break;
+            }
+            data_ready_after_read = 0;
+            continue;
+        }
+
+        int64_t block_start_time_us = get_global_time_us();
+        if (s_overflow_gap_start_us != 0) {
+            audio_log_overflow_gap(block_start_time_us, expected_IQR_interval_us);
+        }
+        if (s_reconfigure_gap_start_us != 0) {
+            audio_log_reconfigure_gap(block_start_time_us, expected_IQR_interval_us);
+        }
+        int64_t block_interval_us = (s_last_block_time_us != 0) ? block_start_time_us - s_last_block_time_us : -1;
+        s_last_block_time_us = block_start_time_us;
+        int64_t read_time_us;
+        uint32_t slot;
+        if ((s_overrun_blocks_remaining == 0) && (ring_reserve(&shm_audio->ring, &slot) == 0)) {
+            CetiAudioBlockInfo *block_info = AUDIO_BUFFER_BLOCK_INFO(shm_audio, slot);
+            block_info->sys_time_us = block_start_time_us;
+            block_info->rtc_count = getRtcCount();
+            block_info->flags = s_next_block_flags;
+            int64_t read_start_us = get_global_time_us();
+            s_audio_source->read(AUDIO_BUFFER_BLOCK(shm_audio, slot), SPI_BLOCK_SIZE);
+            read_time_us = get_global_time_us() - read_start_us;
+#if AUDIO_OVERFLOW_GPIO >= 0
+            if (s_audio_source->overflow()) {
+                block_info->flags |= AUDIO_BLOCK_FLAG_OVERFLOW;
+            }
+#endif
+            s_next_block_flags = 0;
+            ring_publish(&shm_audio->ring);
+            // signal new data for other processes working with live streamed data
+            sem_post(sem_audio_block);
+            audio_stats_spi_block(read_time_us, block_interval_us, 0);
+        } else {
+            // The writer has fallen a full ring behind. The FIFO still has to
+            // be drained, so the data is read and discarded. Whole groups are
+            // dropped so the samples that follow stay aligned in the ring.
+            if (s_overrun_blocks_remaining == 0) {
+                s_overrun_blocks_remaining = AUDIO_BLOCKS_PER_GROUP;
+                CETI_WARN("Audio ring buffer full, dropping %d blocks (%lu dropped in total)", AUDIO_BLOCKS_PER_GROUP, atomic_load(&shm_audio->ring.overruns) + AUDIO_BLOCKS_PER_GROUP);
+            }
+            int64_t read_start_us = get_global_time_us();
+            s_audio_source->read(s_overrun_block, SPI_BLOCK_SIZE);
+            read_time_us = get_global_time_us() - read_start_us;
+            ring_drop(&shm_audio->ring, 1);
+            audio_stats_spi_block(read_time_us, block_interval_us, 1);
+            s_next_block_flags |= AUDIO_BLOCK_FLAG_DISCONTINUITY;
+            s_overrun_blocks_remaining--;
+        }
+        histogram_add(&s_spi_latency_us, s_audio_source->tick() - ready_tick);
+
+        // don't wait if more data is ready
+        data_ready_after_read = s_audio_source->data_ready();
+        if (data_ready_after_read) {
+            continue;
+        }
+
+        // only perform checks/sleep if we have time to
+        // Check if the FPGA buffer overflowed.
+        if (audio_check_for_overflow(3)) {
+            if (audio_recover_fifo_overflow(retry_sleep_us) != 0) {
+                break;
+            }
+            continue;
+        }
+
+        if (block_start_time_us > next_latency_log_us) {
+            audio_log_spi_latency();
+            next_latency_log_us = block_start_time_us + AUDIO_SPI_LATENCY_LOG_INTERVAL_US;
+        }
+
+        // when polling, sleep until shortly before the next block is expected
+        if (g_config.audio.acquisition_mode != AUDIO_ACQUISITION_EDGE || !s_data_ready_isr_attached) {
+            time_t elapsed_time = get_global_time_us() - block_start_time_us;
+            if (elapsed_time + retry_sleep_us < expected_IQR_interval_us) {
+                usleep(expected_IQR_interval_us - elapsed_time - retry_sleep_us);
+            }
+        }
+    }
+    audio_detach_data_ready_isr();
+    audio_log_spi_latency();
+
+    // Close the SPI communication.
+    s_audio_source->close();
+
+    // Log that the thread is stopping.
+    if (g_audio_overflow_detected && !g_stopAcquisition)
+        CETI_LOG("*** Audio overflow detected at location %d", g_audio_status.overflow_location);
+    else
+        CETI_LOG("Done!");
+
+    // Nothing more will be read, so the other threads can empty the ring.
+    if (atomic_load(&s_audio_restart) == AUDIO_RESTART_STOPPING) {
+        atomic_store(&s_audio_restart, AUDIO_RESTART_DRAINING);
+    }
+
+    // Wait for the write-data thread to finish as well.
+    while (g_audio_thread_writeData_is_running)
+        usleep(100000);
+
+    // Stop FPGA audio capture and reset its buffer.
+    // stop_audio_acq();
+    usleep(100000);
+    reset_audio_fifo();
+    usleep(100000);
+    g_audio_overflow_detected = g_audio_status.overflow = 0;
+    g_audio_status.overflow_location = -1;
+
+    // Exit the thread.
+    g_audio_thread_spi_is_running = 0;
+    return NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Live stages - follow the full rate ring behind the SPI thread
+//-----------------------------------------------------------------------------
+// Live stages only read the ring and never hold back the writer, which owns
+// `tail`. Each one polls `head` at the block interval rather than waiting on
+// the block semaphore, whose posts belong to readers outside cetiTagApp (such
+// as cetiHWTest); no thread in this process may take them.
+typedef struct {
+    const char *name;   // for log messages
+    uint64_t index;          // next full rate block, UINT64_MAX until synchronized
+    int resynchronized;      // the last block returned follows a jump
+    int pending_resync;      // jumped, not yet reported with a block
+    uint32_t pending_flags;  // AUDIO_BLOCK_FLAG_* for the next block returned
+    size_t frame_size;
+    double sample_period_us;
+    const AudioUnpackKernel *unpack_kernel;
+    uint16_t channels;
+    uint8_t carry[AUDIO_MAX_CHANNELS * 3]; // start of a sample set split across blocks
+    size_t carry_length;
+    // one block unpacked, plus the sample set split across the previous block
+    int32_t samples[SPI_BLOCK_SIZE / 2 + AUDIO_MAX_CHANNELS];
+} AudioLiveReader;
+
+static void audio_live_reader_init(AudioLiveReader *reader, const char *name) {
+    memset(reader, 0, sizeof(*reader));
+    reader->name = name;
+    reader->index = UINT64_MAX;
+    reader->channels = g_config.audio.channels;
+    reader->frame_size = reader->channels * (g_config.audio.bit_depth / 8);
+    reader->sample_period_us = 1000000.0 / audio_sample_rate_to_hz(g_config.audio.sample_rate);
+    reader->unpack_kernel = audio_unpack_get_kernel(reader->channels, g_config.audio.bit_depth);
+}
+
+/**
+ * @brief Unpacks the next full rate block into reader->samples. Sample sets
+ * split across blocks are completed with the start of the next block.
+ *
+ * If the ring was reset or the writer released blocks not yet read, the
+ * reader starts over at a group boundary, where sample sets are aligned, and
+ * sets reader->resynchronized for the first block after the jump.
+ *
+ * @param first_sample_time_us time of reader->samples[0]
+ * @param flags AUDIO_BLOCK_FLAG_* of the block, with
+ * AUDIO_BLOCK_FLAG_DISCONTINUITY added after a jump or if the block may have
+ * been overwritten while it was read
+ * @return number of sample sets unpacked, 0 if no block is waiting
+ */
+static size_t audio_live_reader_next(AudioLiveReader *reader, int64_t *first_sample_time_us, uint32_t *flags) {
+    CetiRing *ring = &shm_audio->ring;
+    uint64_t head = atomic_load(&ring->head);
+    uint64_t tail = atomic_load(&ring->tail);
+    if ((reader->index > head) || (reader->index < tail)) {
+        if (reader->index != UINT64_MAX) {
+            CETI_WARN("%s lost track of the audio ring, resynchronizing", reader->name);
+            reader->pending_flags |= AUDIO_BLOCK_FLAG_DISCONTINUITY;
+        }
+        reader->index = ((head + AUDIO_BLOCKS_PER_GROUP - 1) / AUDIO_BLOCKS_PER_GROUP) * AUDIO_BLOCKS_PER_GROUP;
+        reader->carry_length = 0;
+        reader->pending_resync = 1;
+    }
+
+    uint32_t slot;
+    if (ring_peek_at(ring, reader->index, &slot) == 0) {
+        return 0;
+    }
+    const uint8_t *block = AUDIO_BUFFER_BLOCK(shm_audio, slot);
+    const CetiAudioBlockInfo *block_info = AUDIO_BUFFER_BLOCK_INFO(shm_audio, slot);
+    *flags = block_info->flags | reader->pending_flags;
+    reader->resynchronized = reader->pending_resync;
+    reader->pending_flags = 0;
+    reader->pending_resync = 0;
+
+    // the sample set started in the previous block is the first one unpacked
+    size_t offset = 0;
+    size_t n_samples = 0;
+    *first_sample_time_us = block_info->sys_time_us;
+    if (reader->carry_length != 0) {
+        offset = reader->frame_size - reader->carry_length;
+        memcpy(reader->carry + reader->carry_length, block, offset);
+        reader->unpack_kernel->unpack(reader->samples, reader->carry, 1);
+        n_samples = 1;
+        *first_sample_time_us -= (int64_t)reader->sample_period_us;
+    }
+    size_t n_whole = (SPI_BLOCK_SIZE - offset) / reader->frame_size;
+    reader->unpack_kernel->unpack(reader->samples + n_samples * reader->channels, block + offset, n_whole);
+    n_samples += n_whole;
+    reader->carry_length = SPI_BLOCK_SIZE - offset - n_whole * reader->frame_size;
+    memcpy(reader->carry, block + SPI_BLOCK_SIZE - reader->carry_length, reader->carry_length);
+
+    // Blocks can only be overwritten once the writer has released them, in
+    // which case what was read may be torn.
+    if (atomic_load(&ring->tail) > reader->index) {
+        *flags |= AUDIO_BLOCK_FLAG_DISCONTINUITY;
+    }
+    reader->index++;
+    return n_samples;
+}
+
+//-----------------------------------------------------------------------------
+// Decimate thread - publishes a low sample rate copy of the audio stream
+//-----------------------------------------------------------------------------
+static AudioLiveReader s_decimate_reader;
+static Decimator s_decimator;
+static int16_t s_decimate_output[SPI_BLOCK_SIZE / 2 + AUDIO_MAX_CHANNELS]; // at most one output per input sample set
+static uint32_t s_decimated_slot;
+static uint32_t s_decimated_fill; // sample sets written to the open block
+static uint32_t s_decimated_flags;
+
+/**
+ * @brief Copies decimated sample sets into the shared ring, opening blocks as
+ * needed and publishing each one once it is full.
+ */
+static void audio_decimate_publish(const int16_t *src, size_t n_samples, int64_t first_sample_time_us, double sample_period_us) {
+    CetiRing *ring = &shm_audio_decimated->ring;
+    size_t written = 0;
+    while (written < n_samples) {
+        if (s_decimated_fill == 0) {
+            // readers only follow head, so make room by dropping the oldest block
+            if (ring_reserve(ring, &s_decimated_slot) != 0) {
+                ring_release(ring, 1);
+                ring_reserve(ring, &s_decimated_slot);
+            }
+            CetiAudioBlockInfo *info = AUDIO_DECIMATED_BUFFER_BLOCK_INFO(shm_audio_decimated, s_decimated_slot);
+            info->sys_time_us = first_sample_time_us + (int64_t)(written * sample_period_us);
+            info->rtc_count = getRtcCount();
+            info->flags = 0;
+        }
+        AUDIO_DECIMATED_BUFFER_BLOCK_INFO(shm_audio_decimated, s_decimated_slot)->flags |= s_decimated_flags;
+        size_t n_copy = AUDIO_DECIMATED_BLOCK_SAMPLES - s_decimated_fill;
+        if (n_copy > n_samples - written) {
+            n_copy = n_samples - written;
+        }
+        int16_t *dst = AUDIO_DECIMATED_BUFFER_BLOCK(shm_audio_decimated, s_decimated_slot) + (size_t)s_decimated_fill * shm_audio_decimated->channels;
+        memcpy(dst, src + written * shm_audio_decimated->channels, n_copy * shm_audio_decimated->channels * sizeof(int16_t));
+        written += n_copy;
+        s_decimated_fill += n_copy;
+        if (s_decimated_fill == AUDIO_DECIMATED_BLOCK_SAMPLES) {
+            ring_publish(ring);
+            sem_post(sem_audio_decimated);
+            s_decimated_fill = 0;
+            s_decimated_flags = 0;
+        }
+    }
+}
+
+void *audio_thread_decimate(void *paramPtr) {
+    // Get the thread ID, so the system monitor can check its CPU assignment.
+    g_audio_thread_decimate_tid = gettid();
+
+    if ((shm_audio == NULL) || (shm_audio_decimated == NULL) || (sem_audio_decimated == SEM_FAILED)) {
+        CETI_ERR("Thread started without neccesary memory resources");
+        return NULL;
+    }
+
+    // Set the thread CPU affinity.
+    if (AUDIO_DECIMATE_CPU >= 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(AUDIO_DECIMATE_CPU, &cpuset);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) == 0)
+            CETI_LOG("Successfully set affinity to CPU %d", AUDIO_DECIMATE_CPU);
+        else
+            CETI_WARN("Failed to set affinity to CPU %d", AUDIO_DECIMATE_CPU);
+    }
+
+    uint32_t sample_rate_hz = audio_sample_rate_to_hz(g_config.audio.sample_rate);
+    if (decimator_init(&s_decimator, shm_audio_decimated->decimation, g_config.audio.channels, g_config.audio.bit_depth) != 0) {
+        CETI_ERR("Failed to set up decimation by %u", shm_audio_decimated->decimation);
+        return NULL;
+    }
+    audio_live_reader_init(&s_decimate_reader, "Decimation");
+    double input_period_us = s_decimate_reader.sample_period_us;
+    double output_delay_us = decimator_delay_samples(&s_decimator) * input_period_us;
+    time_t poll_interval_us = AUDIO_BLOCK_FILL_SPEED_US(g_config.audio.channels, sample_rate_hz, g_config.audio.bit_depth);
+    CETI_LOG("Decimating %u Hz audio by %u with %u taps", sample_rate_hz, s_decimator.factor, s_decimator.taps);
+    s_decimated_fill = 0;
+    s_decimated_flags = 0;
+
+    g_audio_thread_decimate_is_running = 1;
+    while (!g_stopAcquisition && (atomic_load(&s_audio_restart) == AUDIO_RESTART_NONE)) {
+        size_t n_samples;
+        int64_t first_sample_time_us;
+        uint32_t flags;
+        while (!g_stopAcquisition && ((n_samples = audio_live_reader_next(&s_decimate_reader, &first_sample_time_us, &flags)) != 0)) {
+            if (s_decimate_reader.resynchronized) {
+                decimator_reset(&s_decimator);
+            }
+            s_decimated_flags |= flags;
+
+            // time of the first output, less the filter delay
+            int64_t first_output_time_us = first_sample_time_us + (int64_t)((decimator_output_offset(&s_decimator) * input_period_us) - output_delay_us);
+            size_t n_out = decimator_process(&s_decimator, s_decimate_output, s_decimate_reader.samples, n_samples);
+            audio_decimate_publish(s_decimate_output, n_out, first_output_time_us, input_period_us * s_decimator.factor);
+        }
+        usleep(poll_interval_us);
+    }
+
+    // Exit the thread.
+    CETI_LOG("Done!");
+    g_audio_thread_decimate_is_running = 0;
+    return NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Click detection thread - indexes echolocation clicks in the live audio
+//-----------------------------------------------------------------------------
+static AudioLiveReader s_click_reader;
+static ClickEvent s_click_events[AUDIO_CLICK_MAX_PER_BLOCK];
+
+/**
+ * @brief Records a click in the shared ring and the click index file.
+ */
+static void audio_click_publish(const ClickEvent *event, int64_t time_us) {
+    CetiAudioClick click = {
+        .sys_time_us = time_us,
+        .ici_us = (uint32_t)(event->ici_samples * s_click_reader.sample_period_us),
+        .amplitude = (event->amplitude >= 1.0f) ? UINT16_MAX : (uint16_t)(event->amplitude * UINT16_MAX),
+        .channel = event->channel,
+        .snr_db = (event->snr_db >= UINT8_MAX) ? UINT8_MAX : (uint8_t)event->snr_db,
+    };
+
+    // readers only follow head, so make room by dropping the oldest click
+    CetiRing *ring = &shm_audio_clicks->ring;
+    uint32_t slot;
+    if (ring_reserve(ring, &slot) != 0) {
+        ring_release(ring, 1);
+        ring_reserve(ring, &slot);
+    }
+    *AUDIO_CLICK_BUFFER_CLICK(shm_audio_clicks, slot) = click;
+    ring_publish(ring);
+    sem_post(sem_audio_clicks);
+
+    if ((s_click_file != NULL) && (fwrite(&click, sizeof(click), 1, s_click_file) != 1)) {
+        CETI_ERR("Failed to write to " AUDIO_CLICK_FILEPATH ", clicks are only kept in shared memory");
+        fclose(s_click_file);
+        s_click_file = NULL;
+    }
+}
+
+void *audio_thread_detectClicks(void *paramPtr) {
+    // Get the thread ID, so the system monitor can check its CPU assignment.
+    g_audio_thread_detectClicks_tid = gettid();
+
+    if ((shm_audio == NULL) || (shm_audio_clicks == NULL) || (sem_audio_clicks == SEM_FAILED)) {
+        CETI_ERR("Thread started without neccesary memory resources");
+        return NULL;
+    }
+
+    // Set the thread CPU affinity.
+    if (AUDIO_CLICK_CPU >= 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(AUDIO_CLICK_CPU, &cpuset);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) == 0)
+            CETI_LOG("Successfully set affinity to CPU %d", AUDIO_CLICK_CPU);
+        else
+            CETI_WARN("Failed to set affinity to CPU %d", AUDIO_CLICK_CPU);
+    }
+
+    uint32_t sample_rate_hz = audio_sample_rate_to_hz(g_config.audio.sample_rate);
+    audio_live_reader_init(&s_click_reader, "Click detection");
+    time_t poll_interval_us = AUDIO_BLOCK_FILL_SPEED_US(g_config.audio.channels, sample_rate_hz, g_config.audio.bit_depth);
+    CETI_LOG("Detecting clicks between %u and %u Hz, %.1f dB over the noise floor", g_config.audio.clicks.band_low_hz, g_config.audio.clicks.band_high_hz, g_config.audio.clicks.threshold_db);
+
+    g_audio_thread_detectClicks_is_running = 1;
+    while (!g_stopAcquisition && (atomic_load(&s_audio_restart) == AUDIO_RESTART_NONE)) {
+        size_t n_samples;
+        int64_t first_sample_time_us;
+        uint32_t flags;
+        int found = 0;
+        while (!g_stopAcquisition && ((n_samples = audio_live_reader_next(&s_click_reader, &first_sample_time_us, &flags)) != 0)) {
+            if (s_click_reader.resynchronized) {
+                click_detector_reset(&s_click_detector);
+            }
+
+            // onsets are counted from the detector's last reset, and may fall in an earlier block
+            int64_t first_sample = (int64_t)s_click_detector.sample;
+            uint64_t dropped = s_click_detector.dropped_events;
+            size_t n_events = click_detector_process(&s_click_detector, s_click_reader.samples, n_samples, s_click_events, AUDIO_CLICK_MAX_PER_BLOCK);
+            for (size_t i = 0; i < n_events; i++) {
+                int64_t offset = (int64_t)s_click_events[i].sample - first_sample;
+                audio_click_publish(&s_click_events[i], first_sample_time_us + (int64_t)(offset * s_click_reader.sample_period_us));
+            }
+            if (s_click_detector.dropped_events != dropped) {
+                atomic_fetch_add(&shm_audio_clicks->dropped, s_click_detector.dropped_events - dropped);
+            }
+            found |= (n_events != 0);
+        }
+        if (found && (s_click_file != NULL)) {
+            fflush(s_click_file);
+        }
+        usleep(poll_interval_us);
+    }
+
+    if (s_click_file != NULL) {
+        fclose(s_click_file);
+        s_click_file = NULL;
+    }
+
+    // Exit the thread.
+    CETI_LOG("Done!");
+    g_audio_thread_detectClicks_is_running = 0;
+    return NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Levels thread - summarizes the live audio once a second
+//-----------------------------------------------------------------------------
+static AudioLiveReader s_levels_reader;
+static AudioLevels s_levels;
+static CetiAudioLevels s_levels_record;
+
+/**
+ * @brief Publishes a finished level record to the shared ring and appends it
+ * to the levels CSV file.
+ */
+static void audio_levels_publish(const CetiAudioLevels *record) {
+    // readers only follow head, so make room by dropping the oldest record
+    CetiRing *ring = &shm_audio_levels->ring;
+    uint32_t slot;
+    if (ring_reserve(ring, &slot) != 0) {
+        ring_release(ring, 1);
+        ring_reserve(ring, &slot);
+    }
+    *AUDIO_LEVELS_BUFFER_RECORD(shm_audio_levels, slot) = *record;
+    ring_publish(ring);
+    sem_post(sem_audio_levels);
+
+    if (s_levels_file == NULL) {
+        return;
+    }
+    fprintf(s_levels_file, "%lld,%u,", (long long)record->sys_time_us, record->rtc_count);
+    if (record->flags & AUDIO_BLOCK_FLAG_OVERFLOW) {
+        fprintf(s_levels_file, "OVERFLOW | ");
+    }
+    if (record->flags & AUDIO_BLOCK_FLAG_DISCONTINUITY) {
+        fprintf(s_levels_file, "DISCONTINUITY | ");
+    }
+    if (record->flags & AUDIO_BLOCK_FLAG_PADDING) {
+        fprintf(s_levels_file, "PADDING | ");
+    }
+    fprintf(s_levels_file, ",%u", record->samples);
+    for (int c = 0; c < record->channels; c++) {
+        fprintf(s_levels_file, ",%.2f,%.2f,%.6f", record->rms_dbfs[c], record->peak_dbfs[c], record->dc[c]);
+        for (int b = 0; b < AUDIO_LEVELS_BANDS; b++) {
+            fprintf(s_levels_file, ",%.2f", record->band_dbfs[c][b]);
+        }
+    }
+    fprintf(s_levels_file, "\n");
+    if (fflush(s_levels_file) != 0) {
+        CETI_ERR("Failed to write to " AUDIO_LEVELS_FILEPATH ", levels are only kept in shared memory");
+        fclose(s_levels_file);
+        s_levels_file = NULL;
+    }
+}
+
+void *audio_thread_levels(void *paramPtr) {
+    // Get the thread ID, so the system monitor can check its CPU assignment.
+    g_audio_thread_levels_tid = gettid();
+
+    if ((shm_audio == NULL) || (shm_audio_levels == NULL) || (sem_audio_levels == SEM_FAILED)) {
+        CETI_ERR("Thread started without neccesary memory resources");
+        return NULL;
+    }
+
+    // Set the thread CPU affinity.
+    if (AUDIO_LEVELS_CPU >= 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(AUDIO_LEVELS_CPU, &cpuset);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) == 0)
+            CETI_LOG("Successfully set affinity to CPU %d", AUDIO_LEVELS_CPU);
+        else
+            CETI_WARN("Failed to set affinity to CPU %d", AUDIO_LEVELS_CPU);
+    }
+
+    // spectra are taken at a fixed frame rate, so their cost doesn't grow with the sample rate
+    uint32_t sample_rate_hz = audio_sample_rate_to_hz(g_config.audio.sample_rate);
+    if (audio_levels_init(&s_levels, g_config.audio.channels, g_config.audio.bit_depth, sample_rate_hz / AUDIO_LEVELS_SPECTRA_PER_S) != 0) {
+        CETI_ERR("Failed to set up audio levels for %u Hz audio", sample_rate_hz);
+        return NULL;
+    }
+    audio_live_reader_init(&s_levels_reader, "Audio levels");
+    uint64_t interval_samples = (uint64_t)sample_rate_hz * AUDIO_LEVELS_INTERVAL_US / 1000000;
+    time_t poll_interval_us = AUDIO_BLOCK_FILL_SPEED_US(g_config.audio.channels, sample_rate_hz, g_config.audio.bit_depth);
+    CETI_LOG("Recording audio levels every %u ms with %u band spectra", AUDIO_LEVELS_INTERVAL_US / 1000, AUDIO_LEVELS_BANDS);
+
+    g_audio_thread_levels_is_running = 1;
+    while (!g_stopAcquisition && (atomic_load(&s_audio_restart) == AUDIO_RESTART_NONE)) {
+        size_t n_samples;
+        int64_t first_sample_time_us;
+        uint32_t flags;
+        while (!g_stopAcquisition && ((n_samples = audio_live_reader_next(&s_levels_reader, &first_sample_time_us, &flags)) != 0)) {
+            if (s_levels_reader.resynchronized) {
+                audio_levels_reset(&s_levels);
+            }
+
+            // blocks are split so each record covers exactly one interval
+            size_t done = 0;
+            while (done < n_samples) {
+                if (s_levels.samples == 0) {
+                    s_levels_record.sys_time_us = first_sample_time_us + (int64_t)(done * s_levels_reader.sample_period_us);
+                    s_levels_record.rtc_count = getRtcCount();
+                    s_levels_record.flags = 0;
+                }
+                s_levels_record.flags |= flags;
+                size_t n = n_samples - done;
+                if (n > interval_samples - s_levels.samples) {
+                    n = interval_samples - s_levels.samples;
+                }
+                audio_levels_process(&s_levels, s_levels_reader.samples + done * s_levels_reader.channels, n);
+                done += n;
+                if (s_levels.samples == interval_samples) {
+                    audio_levels_finish(&s_levels, &s_levels_record);
+                    audio_levels_publish(&s_levels_record);
+                }
+            }
+        }
+        usleep(poll_interval_us);
+    }
+
+    if (s_levels_file != NULL) {
+        fclose(s_levels_file);
+        s_levels_file = NULL;
+    }
+
+    // Exit the thread.
+    CETI_LOG("Done!");
+    g_audio_thread_levels_is_running = 0;
+    return NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Write Data Thread moves the RAM buffer to mass storage
+//-----------------------------------------------------------------------------
+/**
+ * @brief Most bytes of samples a file can hold. Files end on the clock, a
+ * group or two past the boundary, so this only limits them if the clock
+ * jumps back.
+ */
+size_t audio_get_file_size_bytes(const AudioConfig *config) {
+    return (size_t)AUDIO_FILE_DURATION_S * config->channels * audio_sample_rate_to_hz(config->sample_rate) * (config->bit_depth / 8) + 2 * AUDIO_LCM_BYTES;
+}
+
+/**
+ * @brief Starts timing a file beginning with the block captured at
+ * `start_time_us`.
+ *
+ * @return bytes of samples expected before the file ends
+ */
+static size_t audio_file_rotation_start(int64_t start_time_us) {
+    int64_t end_time_us = file_rotation_start(&s_file_rotation, start_time_us);
+    uint64_t bytes_per_second = (uint64_t)shm_audio->channels * shm_audio->sample_rate * (shm_audio->bit_depth / 8);
+    return (size_t)((end_time_us - start_time_us) * bytes_per_second / 1000000);
+}
+
+/**
+ * @brief Reserves `size` bytes of card space for the file open as `fd`, so
+ * it is laid out contiguously.
+ */
+static void audio_file_preallocate(int fd, size_t size) {
+    char err_str[512];
+    int error = file_rotation_preallocate(fd, 0, size);
+    if ((error != 0) && !s_file_preallocate_warned) {
+        CETI_WARN("Failed to preallocate audio files, they will grow as written: %s", strerror_r(error, err_str, sizeof(err_str)));
+        s_file_preallocate_warned = 1;
+    }
+}
+
+/**
+ * @brief Converts big-endian interleaved ADC samples to FLAC__int32.
+ *
+ * @return number of whole sample sets converted
+ */
+static size_t audio_unpack_samples(FLAC__int32 *dst, const uint8_t *src, size_t n_bytes) {
+    size_t n_samples = n_bytes / (g_config.audio.channels * (g_config.audio.bit_depth / 8));
+    audio_unpack_selection_run(&s_unpack, dst, src, n_samples);
+    return n_samples;
+}
+
+/**
+ * @brief Allocates a FLAC encoder set up for the configured audio stream.
+ *
+ * @return the encoder, or NULL on failure
+ */
+static FLAC__StreamEncoder *audio_flac_encoder_new(uint64_t total_samples_estimate) {
+    FLAC__bool ok = true;
+    uint32_t flac_bit_depth = g_config.audio.bit_depth;
+    uint32_t flac_sample_rate = audio_sample_rate_to_hz(g_config.audio.sample_rate);
+
+    FLAC__StreamEncoder *encoder = FLAC__stream_encoder_new();
+    if (encoder == NULL) {
+        CETI_ERR("Failed to allocate FLAC encoder");
+        return NULL;
+    }
+
+    CETI_DEBUG("Flac configured: channels: %d of %d", s_unpack.n_selected, g_config.audio.channels);
+    CETI_DEBUG("Flac configured: bit depth: %d bits", flac_bit_depth);
+    CETI_DEBUG("Flac configured: sample_rate: %d sps", flac_sample_rate);
+
+    ok &= FLAC__stream_encoder_set_channels(encoder, s_unpack.n_selected);
+    ok &= FLAC__stream_encoder_set_bits_per_sample(encoder, flac_bit_depth);
+    ok &= FLAC__stream_encoder_set_sample_rate(encoder, flac_sample_rate);
+    ok &= FLAC__stream_encoder_set_total_samples_estimate(encoder, total_samples_estimate);
+    ok &= (flac_tuning_apply(encoder, &g_config.audio.flac_tuning) == 0);
+
+    if (!ok) {
+        CETI_ERR("FLAC encoder failed to set parameters");
+        FLAC__stream_encoder_delete(encoder);
+        return NULL;
+    }
+    return encoder;
+}
+
+//-----------------------------------------------------------------------------
+// FLAC block index
+//-----------------------------------------------------------------------------
+// Every FLAC file carries a SEEKTABLE, a VORBIS_COMMENT with the capture time
+// of its first block and an APPLICATION block with the capture time, RTC
+// count and flags of every SPI block encoded into it (utils/flac_index.h).
+// The index is only complete once the file has been encoded, so its space is
+// reserved when the encoder starts and it is filled in after the encoder has
+// finished.
+
+typedef struct {
+    FLAC__StreamMetadata *metadata[3]; // APPLICATION, SEEKTABLE, VORBIS_COMMENT
+    FlacIndexHeader *header;           // index payload, followed by the entries
+    AudioFileIndexEntry *entries;
+} AudioFlacIndex;
+
+static AudioFlacIndex s_flac_index; // index of the file being encoded by the write thread
+
+static void audio_flac_index_release(AudioFlacIndex *index) {
+    for (size_t i = 0; i < sizeof(index->metadata) / sizeof(index->metadata[0]); i++) {
+        if (index->metadata[i] != NULL) {
+            FLAC__metadata_object_delete(index->metadata[i]);
+        }
+    }
+    free(index->header);
+    memset(index, 0, sizeof(*index));
+}
+
+static FLAC__bool audio_flac_index_comment(FLAC__StreamMetadata *comments, const char *name, const char *value) {
+    FLAC__StreamMetadata_VorbisComment_Entry entry;
+    return FLAC__metadata_object_vorbiscomment_entry_from_name_value_pair(&entry, name, value)
+           && FLAC__metadata_object_vorbiscomment_append_comment(comments, entry, false);
+}
+
+/**
+ * @brief Sets up the metadata of a FLAC file that holds at most
+ * `block_capacity` blocks. Must be called before the encoder is initialized,
+ * and the index released only once the encoder has finished.
+ *
+ * @return 0 on success, -1 if the file will be encoded without an index
+ */
+static int audio_flac_index_start(AudioFlacIndex *index, FLAC__StreamEncoder *encoder, uint32_t block_capacity, uint64_t total_samples, int64_t start_time_us, uint32_t start_rtc_count) {
+    FLAC__bool ok = true;
+    uint32_t sample_rate_hz = audio_sample_rate_to_hz(g_config.audio.sample_rate);
+    size_t payload_size = flac_index_payload_size(block_capacity);
+    char value[32];
+
+    memset(index, 0, sizeof(*index));
+    index->header = calloc(1, payload_size);
+    if (index->header == NULL) {
+        CETI_ERR("Failed to allocate a FLAC block index for %u blocks", block_capacity);
+        return -1;
+    }
+    index->entries = (AudioFileIndexEntry *)(index->header + 1);
+    flac_index_header_init(index->header, g_config.audio.channels * (g_config.audio.bit_depth / 8), sample_rate_hz, block_capacity);
+
+    // The block index is written first so readers find it without parsing
+    // the other metadata.
+    FLAC__StreamMetadata *application = index->metadata[0] = FLAC__metadata_object_new(FLAC__METADATA_TYPE_APPLICATION);
+    FLAC__StreamMetadata *seek_table = index->metadata[1] = FLAC__metadata_object_new(FLAC__METADATA_TYPE_SEEKTABLE);
+    FLAC__StreamMetadata *comments = index->metadata[2] = FLAC__metadata_object_new(FLAC__METADATA_TYPE_VORBIS_COMMENT);
+    ok = (application != NULL) && (seek_table != NULL) && (comments != NULL);
+    if (ok) {
+        memcpy(application->data.application.id, FLAC_INDEX_APPLICATION_ID, sizeof(application->data.application.id));
+        ok &= FLAC__metadata_object_application_set_data(application, (FLAC__byte *)index->header, payload_size, true);
+
+        // a seek point every second, the encoder fills them in
+        ok &= FLAC__metadata_object_seektable_template_append_spaced_points_by_samples(seek_table, sample_rate_hz, total_samples);
+        ok &= FLAC__metadata_object_seektable_template_sort(seek_table, true);
+
+        snprintf(value, sizeof(value), "%ld", start_time_us);
+        ok &= audio_flac_index_comment(comments, "CETI_START_TIME_US", value);
+        snprintf(value, sizeof(value), "%u", start_rtc_count);
+        ok &= audio_flac_index_comment(comments, "CETI_START_RTC_COUNT", value);
+        ok &= audio_flac_index_comment(comments, "CETI_FIRMWARE_VERSION", CETI_VERSION);
+        // hydrophone of each FLAC channel, numbered from 1
+        size_t length = 0;
+        for (int c = 0; c < s_unpack.n_selected; c++) {
+            length += snprintf(value + length, sizeof(value) - length, (c == 0) ? "%d" : ",%d", s_unpack.selected[c] + 1);
+        }
+        ok &= audio_flac_index_comment(comments, "CETI_CHANNELS", value);
+    }
+    if (!ok || !FLAC__stream_encoder_set_metadata(encoder, index->metadata, sizeof(index->metadata) / sizeof(index->metadata[0]))) {
+        CETI_WARN("Failed to set up the FLAC block index, encoding without it");
+        audio_flac_index_release(index);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Adds `n_blocks` contiguous ring blocks starting at `slot` to the
+ * index once they have been passed to the encoder.
+ */
+static void audio_flac_index_append(AudioFlacIndex *index, uint32_t slot, uint32_t n_blocks) {
+    if (index->header == NULL) {
+        return;
+    }
+    for (uint32_t i = 0; (i < n_blocks) && (index->header->block_count < index->header->block_capacity); i++) {
+        const CetiAudioBlockInfo *info = AUDIO_BUFFER_BLOCK_INFO(shm_audio, slot + i);
+        AudioFileIndexEntry *entry = &index->entries[index->header->block_count++];
+        entry->sys_time_us = info->sys_time_us;
+        entry->rtc_count = info->rtc_count;
+        entry->flags = info->flags;
+    }
+}
+
+/**
+ * @brief Finishes the file being encoded by the write thread and fills in
+ * its block index.
+ */
+static FLAC__bool audio_flac_close_file(void) {
+    FLAC__bool ok = FLAC__stream_encoder_finish(flac_encoder);
+    CETI_DEBUG("Deleting flac encoder...");
+    FLAC__stream_encoder_delete(flac_encoder);
+    flac_encoder = 0;
+
+    if (ok && (s_flac_index.header != NULL) && (flac_index_update_file(audio_acqDataFileName, s_flac_index.header, s_flac_index.entries) != 0)) {
+        CETI_WARN("Failed to write the block index of %s", audio_acqDataFileName);
+    }
+    audio_flac_index_release(&s_flac_index);
+
+    // hand back the space reserved but not used, and size the next file on this one
+    off_t file_size = 0;
+    if (file_rotation_trim_path(audio_acqDataFileName, &file_size) != 0) {
+        CETI_WARN("Failed to trim %s", audio_acqDataFileName);
+    }
+    file_rotation_update(&s_file_rotation, audio_acqDataFileLength, file_size);
+    audio_stats_writer_output(file_size, 1);
+    return ok;
+}
+
+/**
+ * @brief Encodes `n_blocks` (at most one group) contiguous ring blocks
+ * starting at `slot`, starting a new file first if required.
+ */
+static void audio_writeFlac_blocks(uint32_t slot, uint32_t n_blocks, size_t filesize_bytes) {
+    int64_t chunk_start_us = get_global_time_us();
+    // Create a new output file if this is the first flush, at each file
+    //  boundary, or if the file size limit has been reached.
+    if ((flac_encoder == 0) || file_rotation_due(&s_file_rotation, AUDIO_BUFFER_BLOCK_INFO(shm_audio, slot)->sys_time_us) || (audio_acqDataFileLength >= filesize_bytes)) {
+        s_file_start_time_us = AUDIO_BUFFER_BLOCK_INFO(shm_audio, slot)->sys_time_us;
+        s_file_start_rtc_count = AUDIO_BUFFER_BLOCK_INFO(shm_audio, slot)->rtc_count;
+        audio_createNewFlacFile();
+    }
+
+    size_t n_bytes = (size_t)n_blocks * SPI_BLOCK_SIZE;
+    size_t n_samples = audio_unpack_samples(buff, AUDIO_BUFFER_BLOCK(shm_audio, slot), n_bytes);
+    if (flac_encoder == 0) {
+        CETI_WARN("flac encoder is missing, skipping %lu samples", n_samples);
+    } else if (FLAC__stream_encoder_get_state(flac_encoder) != FLAC__STREAM_ENCODER_OK) {
+        CETI_WARN("flac encoder in state %s, skipping %lu samples", FLAC__stream_encoder_get_resolved_state_string(flac_encoder), n_samples);
+    } else {
+        FLAC__stream_encoder_process_interleaved(flac_encoder, buff, n_samples);
+        audio_flac_index_append(&s_flac_index, slot, n_blocks);
+    }
+    audio_acqDataFileLength += n_bytes;
+    audio_stats_writer_chunk(n_blocks, get_global_time_us() - chunk_start_us);
+    CETI_DEBUG("%lu of %lu bytes converted to flac", audio_acqDataFileLength, filesize_bytes);
+}
+
+/**
+ * @brief Write thread main loop when it does all FLAC encoding itself.
+ */
+static void audio_writeFlac_serial(time_t poll_interval_us, size_t filesize_bytes) {
+    while (!g_stopAcquisition && !g_audio_overflow_detected && (atomic_load(&s_audio_restart) != AUDIO_RESTART_DRAINING)) {
+        if (!audio_duty_poll()) {
+            if (flac_encoder != 0) {
+                audio_flac_close_file();
+                audio_status_record(AUDIO_STATUS_DONE_WRITING, 0);
+            }
+            audio_duty_discard();
+            usleep(poll_interval_us);
             continue;
         }
 
-// Cause an overflow for testing purposes if desired.
-#ifdef DEBUG
-        if (g_audio_force_overflow) {
-            usleep(100000);
-            g_audio_force_overflow = 0;
+        // Encode one whole group at a time as it arrives. Whole groups keep
+        // sample sets from being split between calls to the encoder, and a
+        // backlog is worked through without sleeping.
+        uint32_t slot;
+        uint32_t n_blocks = ring_peek(&shm_audio->ring, &slot);
+        if (n_blocks < AUDIO_BLOCKS_PER_GROUP) {
+            usleep(poll_interval_us);
+            continue;
         }
-#endif
 
-        // Read a block of data if an overflow has not occurred.
-        audio_check_for_overflow(2);
-        if (g_audio_overflow_detected) {
-            break;
+        if (!g_stopLogging) {
+            audio_writeFlac_blocks(slot, AUDIO_BLOCKS_PER_GROUP, filesize_bytes);
+        }
+        ring_release(&shm_audio->ring, AUDIO_BLOCKS_PER_GROUP);
+    }
+
+    // Flush remaining blocks, unless they were only kept as pre-trigger.
+    uint32_t slot;
+    uint32_t n_blocks;
+    while (!g_stopLogging && (s_duty.state == AUDIO_DUTY_RECORD) && ((n_blocks = ring_peek(&shm_audio->ring, &slot)) != 0)) {
+        if (n_blocks > AUDIO_BLOCKS_PER_GROUP) {
+            n_blocks = AUDIO_BLOCKS_PER_GROUP;
         }
+        audio_writeFlac_blocks(slot, n_blocks, filesize_bytes);
+        ring_release(&shm_audio->ring, n_blocks);
+    }
 
-        struct timeval current_timeval;
-        gettimeofday(&current_timeval, NULL);
-        spiRead(spi_fd, shm_audio->data[shm_audio->page].blocks[shm_audio->block], SPI_BLOCK_SIZE);
+    CETI_DEBUG("Waiting on flac encoding to end...");
+    // Finish current file
+    if (flac_encoder != 0) {
+        // All data flushed
+        audio_flac_close_file();
+        audio_status_record(AUDIO_STATUS_DONE_WRITING, 0);
+    }
+}
 
-        // When NUM_SPI_BLOCKS are in the ram buffer, switch to using the other buffer.
-        // This will also trigger the writeData thread to write the previous buffer to disk.
-        shm_audio->block = (shm_audio->block + 1);
-        if (shm_audio->block == AUDIO_BUFFER_SIZE_BLOCKS) {
-            shm_audio->block = 0;
-            s_block_start_time = current_timeval;
-            CETI_DEBUG("%d blocks read", AUDIO_BUFFER_SIZE_BLOCKS);
-            shm_audio->page ^= 1; // rotate to page
-            // signal buffer is half full event to other processes working with buffered data
-            sem_post(sem_audio_page);
+//-----------------------------------------------------------------------------
+// Parallel FLAC encoding
+//-----------------------------------------------------------------------------
+// A FLAC stream can only be produced by a single encoder, so to spread the
+// encoding over several cores the audio is cut into segments that are each
+// encoded as a separate file. Worker n encodes segments n, n + workers,
+// n + 2 * workers, ... straight out of the ring into memory as the blocks
+// arrive. The write thread collects the finished segments in order, writes
+// them out and only then releases their blocks back to the SPI thread.
+
+typedef enum {
+    AUDIO_FLAC_SEGMENT_IDLE = 0,
+    AUDIO_FLAC_SEGMENT_ENCODING = 1,
+    AUDIO_FLAC_SEGMENT_DONE = 2,
+} AudioFlacSegmentState;
+
+typedef struct {
+    pthread_t thread;
+    int index;
+    _Atomic int state;        // AudioFlacSegmentState, hands the segment between worker and write thread
+    uint64_t first_block;     // ring index of the first block in the segment
+    uint32_t n_blocks;        // blocks in a whole segment
+    uint32_t encoded_blocks;  // blocks encoded so far
+    int64_t start_time_us;    // system time of the first block
+    int64_t encode_time_us;   // time spent encoding the segment
+    Histogram chunk_us;       // time spent encoding each chunk of the segment
+    FLAC__StreamEncoder *encoder;
+    AudioFlacIndex block_index;
+    uint8_t *output;          // encoded segment
+    size_t output_length;
+    size_t output_capacity;
+    size_t output_position;   // encoder write position, moved back to update STREAMINFO
+    FLAC__int32 samples[AUDIO_LCM_BYTES / sizeof(int16_t)];
+} AudioFlacWorker;
+
+static AudioFlacWorker s_flac_workers[AUDIO_FLAC_MAX_WORKERS];
+static _Atomic int s_flac_workers_flush = 0; // finish segments with whatever has been acquired
+static _Atomic int s_flac_workers_cut = 0;   // finish segments at the next group boundary, recording is stopping
+static _Atomic int s_flac_workers_exit = 0;
+static time_t s_flac_poll_interval_us;
+
+static FLAC__StreamEncoderWriteStatus audio_flac_worker_write(const FLAC__StreamEncoder *encoder, const FLAC__byte buffer[], size_t bytes, uint32_t samples, uint32_t current_frame, void *client_data) {
+    AudioFlacWorker *worker = client_data;
+    size_t end = worker->output_position + bytes;
+    if (end > worker->output_capacity) {
+        size_t capacity = (worker->output_capacity != 0) ? worker->output_capacity : AUDIO_LCM_BYTES;
+        while (capacity < end) {
+            capacity *= 2;
         }
-        // signal new data for other processes working with live streamed data
-        sem_post(sem_audio_block);
+        uint8_t *output = realloc(worker->output, capacity);
+        if (output == NULL) {
+            CETI_ERR("FLAC worker %d failed to grow its output to %lu bytes", worker->index, capacity);
+            return FLAC__STREAM_ENCODER_WRITE_STATUS_FATAL_ERROR;
+        }
+        worker->output = output;
+        worker->output_capacity = capacity;
+    }
+    memcpy(worker->output + worker->output_position, buffer, bytes);
+    worker->output_position = end;
+    if (end > worker->output_length) {
+        worker->output_length = end;
+    }
+    return FLAC__STREAM_ENCODER_WRITE_STATUS_OK;
+}
 
-        // don't wait if more data is ready
-        if (!wt_audio_read_data_ready()) {
-            continue;
+static FLAC__StreamEncoderSeekStatus audio_flac_worker_seek(const FLAC__StreamEncoder *encoder, FLAC__uint64 absolute_byte_offset, void *client_data) {
+    AudioFlacWorker *worker = client_data;
+    if (absolute_byte_offset > worker->output_length) {
+        return FLAC__STREAM_ENCODER_SEEK_STATUS_ERROR;
+    }
+    worker->output_position = absolute_byte_offset;
+    return FLAC__STREAM_ENCODER_SEEK_STATUS_OK;
+}
+
+static FLAC__StreamEncoderTellStatus audio_flac_worker_tell(const FLAC__StreamEncoder *encoder, FLAC__uint64 *absolute_byte_offset, void *client_data) {
+    AudioFlacWorker *worker = client_data;
+    *absolute_byte_offset = worker->output_position;
+    return FLAC__STREAM_ENCODER_TELL_STATUS_OK;
+}
+
+/**
+ * @brief Encodes `n_blocks` (at most one group) contiguous ring blocks
+ * starting at `slot` into the worker's segment, starting the encoder first
+ * if they are the first blocks of the segment.
+ */
+static void audio_flac_worker_encode(AudioFlacWorker *worker, uint32_t slot, uint32_t n_blocks) {
+    int64_t encode_start_us = get_global_time_us();
+    if (worker->encoded_blocks == 0) {
+        const CetiAudioBlockInfo *first_info = AUDIO_BUFFER_BLOCK_INFO(shm_audio, slot);
+        worker->start_time_us = first_info->sys_time_us;
+        uint64_t samples_per_segment = (uint64_t)worker->n_blocks * SPI_BLOCK_SIZE / (g_config.audio.channels * (g_config.audio.bit_depth / 8));
+        worker->encoder = audio_flac_encoder_new(samples_per_segment);
+        if (worker->encoder != NULL) {
+            audio_flac_index_start(&worker->block_index, worker->encoder, worker->n_blocks, samples_per_segment, first_info->sys_time_us, first_info->rtc_count);
+            FLAC__StreamEncoderInitStatus init_status = FLAC__stream_encoder_init_stream(worker->encoder, audio_flac_worker_write, audio_flac_worker_seek, audio_flac_worker_tell, NULL, worker);
+            if (init_status != FLAC__STREAM_ENCODER_INIT_STATUS_OK) {
+                CETI_ERR("FLAC worker %d failed to initialize encoder: %s", worker->index, FLAC__StreamEncoderInitStatusString[init_status]);
+                FLAC__stream_encoder_delete(worker->encoder);
+                worker->encoder = NULL;
+                audio_flac_index_release(&worker->block_index);
+            }
         }
+    }
+    worker->encoded_blocks += n_blocks;
 
-        // only perform checks/sleep if we have time to
-        // Check if the FPGA buffer overflowed.
-        audio_check_for_overflow(3);
+    // Without an encoder the blocks are lost, but the segment still ends
+    // where expected so the following segments stay aligned.
+    if (worker->encoder == NULL) {
+        return;
+    }
+    size_t n_samples = audio_unpack_samples(worker->samples, AUDIO_BUFFER_BLOCK(shm_audio, slot), (size_t)n_blocks * SPI_BLOCK_SIZE);
+    if (FLAC__stream_encoder_get_state(worker->encoder) != FLAC__STREAM_ENCODER_OK) {
+        CETI_WARN("FLAC worker %d encoder in state %s, skipping %lu samples", worker->index, FLAC__stream_encoder_get_resolved_state_string(worker->encoder), n_samples);
+    } else {
+        FLAC__stream_encoder_process_interleaved(worker->encoder, worker->samples, n_samples);
+        audio_flac_index_append(&worker->block_index, slot, n_blocks);
+    }
+    int64_t chunk_us = get_global_time_us() - encode_start_us;
+    worker->encode_time_us += chunk_us;
+    histogram_add(&worker->chunk_us, chunk_us);
+}
 
-        // wait until expected next interrupt
-        time_t elapsed_time = get_global_time_us() - (int64_t)(current_timeval.tv_sec * 1000000LL) - (int64_t)(current_timeval.tv_usec);
-        if (elapsed_time < expected_IQR_interval_us) {
-            usleep(expected_IQR_interval_us - elapsed_time);
+static void audio_flac_worker_finish(AudioFlacWorker *worker) {
+    if (worker->encoder != NULL) {
+        if (!FLAC__stream_encoder_finish(worker->encoder)) {
+            CETI_WARN("FLAC worker %d encoder failed to finish segment", worker->index);
+        } else if ((worker->block_index.header != NULL) && (flac_index_update(worker->output, worker->output_length, worker->block_index.header, worker->block_index.entries) != 0)) {
+            CETI_WARN("FLAC worker %d failed to write the segment block index", worker->index);
         }
+        FLAC__stream_encoder_delete(worker->encoder);
+        worker->encoder = NULL;
     }
+    audio_flac_index_release(&worker->block_index);
+    atomic_store_explicit(&worker->state, AUDIO_FLAC_SEGMENT_DONE, memory_order_release);
+}
 
-    // Close the SPI communication.
-    spiClose(spi_fd);
+static void *audio_flac_worker_thread(void *paramPtr) {
+    AudioFlacWorker *worker = paramPtr;
 
-    // Log that the thread is stopping.
-    if (g_audio_overflow_detected && !g_stopAcquisition)
-        CETI_LOG("*** Audio overflow detected at location %d", g_audio_status.overflow_location);
+    // Set the thread CPU affinity.
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    for (int cpu = 0; cpu < 32; cpu++) {
+        if (g_config.audio.flac_cpu_mask & (1u << cpu)) {
+            CPU_SET(cpu, &cpuset);
+        }
+    }
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) == 0)
+        CETI_LOG("FLAC worker %d successfully set affinity to CPU mask 0x%02x", worker->index, g_config.audio.flac_cpu_mask);
     else
-        CETI_LOG("Done!");
+        CETI_WARN("FLAC worker %d failed to set affinity to CPU mask 0x%02x", worker->index, g_config.audio.flac_cpu_mask);
 
-    // Wait for the write-data thread to finish as well.
-    while (g_audio_thread_writeData_is_running)
-        usleep(100000);
+    // Set the thread to a low priority.
+    struct sched_param sp;
+    memset(&sp, 0, sizeof(sp));
+    sp.sched_priority = sched_get_priority_min(SCHED_RR);
+    if (pthread_setschedparam(pthread_self(), SCHED_RR, &sp) != 0)
+        CETI_WARN("FLAC worker %d failed to set priority", worker->index);
 
-    // Stop FPGA audio capture and reset its buffer.
-    // stop_audio_acq();
-    usleep(100000);
-    reset_audio_fifo();
-    usleep(100000);
-    g_audio_overflow_detected = g_audio_status.overflow = 0;
-    g_audio_status.overflow_location = -1;
+    while (!atomic_load(&s_flac_workers_exit)) {
+        if (atomic_load_explicit(&worker->state, memory_order_acquire) != AUDIO_FLAC_SEGMENT_ENCODING) {
+            usleep(s_flac_poll_interval_us);
+            continue;
+        }
 
-    // Exit the thread.
-    g_audio_thread_spi_is_running = 0;
+        // Segments start on a group boundary and the ring holds whole
+        // groups, so a group never wraps around the end of the ring.
+        uint32_t slot;
+        uint32_t remaining_blocks = worker->n_blocks - worker->encoded_blocks;
+        uint32_t n_blocks = ring_peek_at(&shm_audio->ring, worker->first_block + worker->encoded_blocks, &slot);
+        if (n_blocks > remaining_blocks) {
+            n_blocks = remaining_blocks;
+        }
+
+        if (n_blocks >= AUDIO_BLOCKS_PER_GROUP) {
+            audio_flac_worker_encode(worker, slot, AUDIO_BLOCKS_PER_GROUP);
+        } else if (remaining_blocks == 0) {
+            audio_flac_worker_finish(worker);
+        } else if (atomic_load(&s_flac_workers_flush)) {
+            if (n_blocks != 0) {
+                audio_flac_worker_encode(worker, slot, n_blocks);
+            } else {
+                audio_flac_worker_finish(worker);
+            }
+        } else if (atomic_load(&s_flac_workers_cut)) {
+            audio_flac_worker_finish(worker);
+        } else {
+            usleep(s_flac_poll_interval_us);
+        }
+    }
     return NULL;
 }
 
-//-----------------------------------------------------------------------------
-// Write Data Thread moves the RAM buffer to mass storage
-//-----------------------------------------------------------------------------
+/**
+ * @brief Hands the worker the segment starting at ring index `first_block`.
+ */
+static void audio_flac_worker_assign(AudioFlacWorker *worker, uint64_t first_block, uint32_t n_blocks) {
+    worker->first_block = first_block;
+    worker->n_blocks = n_blocks;
+    worker->encoded_blocks = 0;
+    worker->encode_time_us = 0;
+    histogram_reset(&worker->chunk_us);
+    worker->output_length = 0;
+    worker->output_position = 0;
+    atomic_store_explicit(&worker->state, AUDIO_FLAC_SEGMENT_ENCODING, memory_order_release);
+}
+
+/**
+ * @brief Writes a segment the worker has finished encoding to its own file.
+ */
+static void audio_flac_write_segment(AudioFlacWorker *worker) {
+    char err_str[512];
+    if (worker->output_length == 0) {
+        return;
+    }
+
+    // filename is the time in ms at the start of the segment
+    snprintf(audio_acqDataFileName, AUDIO_DATA_FILENAME_LEN, "/data/%ld.flac", worker->start_time_us / 1000);
+    FILE *segment_file = fopen(audio_acqDataFileName, "wb");
+    if (segment_file == NULL) {
+        CETI_ERR("Failed to open %s: %s", audio_acqDataFileName, strerror_r(errno, err_str, sizeof(err_str)));
+        return;
+    }
+    CETI_LOG("Saving hydrophone data to %s", audio_acqDataFileName);
+    audio_status_record(AUDIO_STATUS_START_WRITING, 0);
+
+    audio_file_preallocate(fileno(segment_file), worker->output_length);
+    size_t written = fwrite(worker->output, 1, worker->output_length, segment_file);
+    if (written != worker->output_length) {
+        CETI_ERR("Failed to write %s: %s", audio_acqDataFileName, strerror_r(errno, err_str, sizeof(err_str)));
+    }
+    fclose(segment_file);
+    audio_stats_writer_output(written, 1);
+    audio_status_record(AUDIO_STATUS_DONE_WRITING, 0);
+
+    CETI_DEBUG("FLAC worker %d encoded %.1f s of audio in %.1f s", worker->index,
+               (double)worker->encoded_blocks * AUDIO_BLOCK_FILL_SPEED_US(shm_audio->channels, shm_audio->sample_rate, shm_audio->bit_depth) / 1000000.0,
+               worker->encode_time_us / 1000000.0);
+}
+
+/**
+ * @brief Number of blocks in each segment encoded by a worker. All the
+ * workers' segments have to fit in the ring at once for them to encode in
+ * parallel.
+ */
+static uint32_t audio_flac_segment_blocks(uint32_t n_workers) {
+    uint32_t max_groups = shm_audio->ring.capacity / AUDIO_BLOCKS_PER_GROUP / n_workers;
+    if (max_groups == 0) {
+        max_groups = 1;
+    }
+    if (g_config.audio.flac_segment_s == 0) {
+        return max_groups * AUDIO_BLOCKS_PER_GROUP;
+    }
+
+    uint64_t bytes_per_second = (uint64_t)shm_audio->channels * shm_audio->sample_rate * (shm_audio->bit_depth / 8);
+    uint64_t blocks = (bytes_per_second * g_config.audio.flac_segment_s + SPI_BLOCK_SIZE - 1) / SPI_BLOCK_SIZE;
+    uint64_t groups = (blocks + AUDIO_BLOCKS_PER_GROUP - 1) / AUDIO_BLOCKS_PER_GROUP;
+    if (groups > max_groups) {
+        CETI_WARN("%u FLAC segments of %us do not fit in the audio buffer, shortening them", n_workers, g_config.audio.flac_segment_s);
+        groups = max_groups;
+    }
+    return (uint32_t)groups * AUDIO_BLOCKS_PER_GROUP;
+}
+
+/**
+ * @brief Write thread main loop when FLAC encoding is spread over worker
+ * threads.
+ *
+ * @return 0 on success, -1 if no worker could be started
+ */
+static int audio_writeFlac_parallel(time_t poll_interval_us) {
+    uint32_t n_workers = 0;
+    uint32_t segment_blocks = audio_flac_segment_blocks(g_config.audio.flac_workers);
+
+    s_flac_poll_interval_us = poll_interval_us;
+    atomic_store(&s_flac_workers_flush, 0);
+    atomic_store(&s_flac_workers_cut, 0);
+    atomic_store(&s_flac_workers_exit, 0);
+    for (; n_workers < g_config.audio.flac_workers; n_workers++) {
+        AudioFlacWorker *worker = &s_flac_workers[n_workers];
+        worker->index = n_workers;
+        atomic_store(&worker->state, AUDIO_FLAC_SEGMENT_IDLE);
+        if (pthread_create(&worker->thread, NULL, &audio_flac_worker_thread, worker) != 0) {
+            CETI_WARN("Failed to start FLAC worker %u", n_workers);
+            break;
+        }
+    }
+    if (n_workers == 0) {
+        return -1;
+    }
+    CETI_LOG("Encoding FLAC in %.1f s segments on %u workers", segment_blocks * AUDIO_BLOCK_FILL_SPEED_US(shm_audio->channels, shm_audio->sample_rate, shm_audio->bit_depth) / 1000000.0, n_workers);
+
+    // Give every worker a segment, then collect them in order. When duty
+    // cycling stops recording the segments are cut short, and handed out
+    // again from the oldest audio kept once it resumes.
+    uint64_t next_block = 0;
+    uint32_t outstanding = 0;
+    uint32_t oldest = 0;
+    while (1) {
+        int recording = audio_duty_poll();
+        if (g_stopAcquisition || g_audio_overflow_detected || (atomic_load(&s_audio_restart) == AUDIO_RESTART_DRAINING)) {
+            atomic_store(&s_flac_workers_flush, 1);
+        } else if (!recording) {
+            atomic_store(&s_flac_workers_cut, 1);
+        }
+
+        if (outstanding == 0) {
+            if (atomic_load(&s_flac_workers_flush)) {
+                break;
+            }
+            if (!recording) {
+                audio_duty_discard();
+                usleep(poll_interval_us);
+                continue;
+            }
+            atomic_store(&s_flac_workers_cut, 0);
+            next_block = ring_tail(&shm_audio->ring);
+            for (uint32_t i = 0; i < n_workers; i++) {
+                audio_flac_worker_assign(&s_flac_workers[i], next_block, segment_blocks);
+                next_block += segment_blocks;
+            }
+            outstanding = n_workers;
+            oldest = 0;
+        }
+
+        AudioFlacWorker *worker = &s_flac_workers[oldest];
+        if (atomic_load_explicit(&worker->state, memory_order_acquire) != AUDIO_FLAC_SEGMENT_DONE) {
+            usleep(poll_interval_us);
+            continue;
+        }
+
+        if (!g_stopLogging) {
+            audio_flac_write_segment(worker);
+        }
+        audio_stats_writer_segment(&worker->chunk_us, worker->encoded_blocks);
+        ring_release(&shm_audio->ring, worker->encoded_blocks);
+        outstanding--;
+
+        if (atomic_load(&s_flac_workers_flush) || atomic_load(&s_flac_workers_cut)) {
+            atomic_store(&worker->state, AUDIO_FLAC_SEGMENT_IDLE);
+        } else {
+            audio_flac_worker_assign(worker, next_block, segment_blocks);
+            next_block += segment_blocks;
+            outstanding++;
+        }
+        oldest = (oldest + 1) % n_workers;
+    }
+
+    atomic_store(&s_flac_workers_exit, 1);
+    for (uint32_t i = 0; i < n_workers; i++) {
+        pthread_join(s_flac_workers[i].thread, NULL);
+        free(s_flac_workers[i].output);
+        s_flac_workers[i].output = NULL;
+        s_flac_workers[i].output_capacity = 0;
+    }
+    return 0;
+}
+
 void *audio_thread_writeFlac(void *paramPtr) {
     // Get the thread ID, so the system monitor can check its CPU assignment.
     g_audio_thread_writeData_tid = gettid();
@@ -600,127 +2701,36 @@ void *audio_thread_writeFlac(void *paramPtr) {
         CETI_WARN("Failed to set priority");
 
     // Calculate expected file size for given configuration
-    size_t filesize_bytes = AUDIO_BUFFER_SIZE_BYTES * (g_config.audio.bit_depth / 8);
-    filesize_bytes *= (g_config.audio.sample_rate == AUDIO_SAMPLE_RATE_96KHZ)    ? 2
-                      : (g_config.audio.sample_rate == AUDIO_SAMPLE_RATE_192KHZ) ? 4
-                                                                                 : 1;
-    CETI_DEBUG("Audio file swapping every %lu bytes", filesize_bytes);
+    size_t filesize_bytes = audio_get_file_size_bytes(&g_config.audio);
+    file_rotation_init(&s_file_rotation, AUDIO_FILE_DURATION_S, AUDIO_FLAC_INITIAL_RATIO);
+    CETI_DEBUG("Audio file swapping every %d s, at most %lu bytes", AUDIO_FILE_DURATION_S, filesize_bytes);
+
+    audio_unpack_selection_init(&s_unpack, g_config.audio.channels, g_config.audio.bit_depth, g_config.audio.channel_mask);
+    if (s_unpack.n_selected == s_unpack.channels) {
+        CETI_LOG("Using %s sample unpacking", s_unpack.kernel->name);
+    } else {
+        CETI_LOG("Keeping %d of %d channels in FLAC files", s_unpack.n_selected, s_unpack.channels);
+    }
+
+    char tuning_str[256];
+    flac_tuning_describe(&g_config.audio.flac_tuning, tuning_str, sizeof(tuning_str));
+    CETI_LOG("FLAC encoding with %s", tuning_str);
+
+    // Poll the ring about twice per group of blocks
+    time_t poll_interval_us = AUDIO_BLOCKS_PER_GROUP * AUDIO_BLOCK_FILL_SPEED_US(g_config.audio.channels, audio_sample_rate_to_hz(g_config.audio.sample_rate), g_config.audio.bit_depth) / 2;
 
     // Wait for the SPI thread to finish initializing and start the main loop.
-    while (!g_audio_thread_spi_is_running && !g_stopAcquisition && !g_audio_overflow_detected)
+    while (!g_audio_thread_spi_is_running && !g_stopAcquisition && !g_audio_overflow_detected && (atomic_load(&s_audio_restart) == AUDIO_RESTART_NONE))
         usleep(1000);
 
     // Main loop.
     CETI_LOG("Starting loop to periodically write data");
     g_audio_thread_writeData_is_running = 1;
 
-    while (!g_stopAcquisition && !g_audio_overflow_detected) {
-        // Wait for the SPI thread to finish filling this buffer.
-        // Note that this can use a long delay to yield the CPU,
-        //  since the buffer will fill about once per minute and it only takes
-        //  about 2 seconds to write the buffer to a file.
-        if (audio_buffer_toWrite == shm_audio->page) {
-            usleep(1000000);
-            continue;
-        }
-
-        if ((audio_acqDataFileLength + AUDIO_BUFFER_SIZE_BYTES > (filesize_bytes - 1)) || (flac_encoder == 0)) {
-            s_file_start_time = s_block_start_time;
-        }
-
-        if (g_stopLogging) {
-            // Switch to waiting on the other buffer.
-            audio_buffer_toWrite = !audio_buffer_toWrite;
-            continue;
-        }
-
-        g_audio_status.start_writing = 1;
-        audio_status_record();
-
-        // Write the buffer to a file.
-        if (g_config.audio.bit_depth == AUDIO_BIT_DEPTH_24) {
-            for (size_t i_sample = 0; i_sample < AUDIO_BUFFER_SIZE_SAMPLE24; i_sample++) {
-                for (size_t i_channel = 0; i_channel < AUDIO_CHANNELS; i_channel++) {
-                    uint8_t *i_ptr = shm_audio->data[audio_buffer_toWrite].sample24[i_sample][i_channel];
-                    FLAC__int32 value = ((FLAC__int32)i_ptr[0] << 24) | ((FLAC__int32)i_ptr[1] << 16) | ((FLAC__int32)i_ptr[2] << 8);
-                    buff[i_sample][i_channel] = value / (1 << 8);
-                }
-            }
-            FLAC__stream_encoder_process_interleaved(flac_encoder, &buff[0][0], AUDIO_BUFFER_SIZE_SAMPLE24);
-        } else {
-            for (size_t i_sample = 0; i_sample < AUDIO_BUFFER_SIZE_SAMPLE16; i_sample++) {
-                for (size_t i_channel = 0; i_channel < AUDIO_CHANNELS; i_channel++) {
-                    uint8_t *i_ptr = shm_audio->data[audio_buffer_toWrite].sample16[i_sample][i_channel];
-                    FLAC__int32 value = ((FLAC__int32)i_ptr[0] << 24) | ((FLAC__int32)i_ptr[1] << 16);
-                    buff[i_sample][i_channel] = value / (1 << 16);
-                }
-            }
-            FLAC__stream_encoder_process_interleaved(flac_encoder, &buff[0][0], AUDIO_BUFFER_SIZE_SAMPLE16);
-        }
-        audio_acqDataFileLength += AUDIO_BUFFER_SIZE_BYTES;
-        CETI_DEBUG("%d of %lu bytes converted to flac", audio_acqDataFileLength, filesize_bytes);
-
-        // Create a new output file if this is the first flush
-        //  or if the file size limit has been reached.
-        if ((audio_acqDataFileLength > (filesize_bytes - 1)) || (flac_encoder == 0)) {
-            audio_createNewFlacFile();
-        }
-
-        // Switch to waiting on the other buffer.
-        audio_buffer_toWrite = !audio_buffer_toWrite;
-
-        g_audio_status.done_writing = 1;
-        audio_status_record();
-    }
-
-    // Flush remaining partial buffer.
-    if (shm_audio->block != 0) {
-        // Maybe create new file.
-        if ((audio_acqDataFileLength > (filesize_bytes - 1)) || (flac_encoder == 0)) {
-            audio_createNewFlacFile();
-        }
-
-        int bytes_to_flush = (shm_audio->block * SPI_BLOCK_SIZE);
-        if (g_config.audio.bit_depth == AUDIO_BIT_DEPTH_24) {
-            int samples_to_flush = bytes_to_flush / (AUDIO_CHANNELS * 3);
-            CETI_LOG("Flushing partial %d sample buffer.", samples_to_flush);
-            for (size_t i_sample = 0; i_sample < samples_to_flush; i_sample++) {
-                for (size_t i_channel = 0; i_channel < AUDIO_CHANNELS; i_channel++) {
-                    uint8_t *i_ptr = shm_audio->data[shm_audio->page].sample24[i_sample][i_channel];
-                    FLAC__int32 value = ((FLAC__int32)i_ptr[0] << 24) | ((FLAC__int32)i_ptr[1] << 16) | ((FLAC__int32)i_ptr[2] << 8);
-                    buff[i_sample][i_channel] = value / (1 << 8);
-                }
-            }
-            FLAC__stream_encoder_process_interleaved(flac_encoder, &buff[0][0], samples_to_flush);
-        } else {
-            int samples_to_flush = bytes_to_flush / (AUDIO_CHANNELS * sizeof(uint16_t));
-            CETI_LOG("Flushing partial %d sample buffer.", samples_to_flush);
-            for (size_t i_sample = 0; i_sample < samples_to_flush; i_sample++) {
-                for (size_t i_channel = 0; i_channel < AUDIO_CHANNELS; i_channel++) {
-                    uint8_t *i_ptr = shm_audio->data[shm_audio->page].sample16[i_sample][i_channel];
-                    FLAC__int32 value = ((FLAC__int32)i_ptr[0] << 24) | ((FLAC__int32)i_ptr[1] << 16);
-                    buff[i_sample][i_channel] = value / (1 << 16);
-                }
-            }
-            CETI_DEBUG("All samples moved to flac buffer");
-            if (flac_encoder == 0) {
-                CETI_WARN("flac encoder is missing,skipping flushing samples");
-            } else if (FLAC__stream_encoder_get_state(flac_encoder) != FLAC__STREAM_ENCODER_OK) {
-                CETI_WARN("flac encoder in state %s, skipping flushing samples", FLAC__stream_encoder_get_resolved_state_string(flac_encoder));
-            } else {
-                FLAC__stream_encoder_process_interleaved(flac_encoder, &buff[0][0], samples_to_flush);
-            }
-            CETI_DEBUG("Flac stream sent");
-        }
+    if ((g_config.audio.flac_workers <= 1) || (audio_writeFlac_parallel(poll_interval_us) != 0)) {
+        audio_writeFlac_serial(poll_interval_us, filesize_bytes);
     }
-    CETI_DEBUG("Waiting on flac encoding to end...");
-    // Finish current file
-    FLAC__stream_encoder_finish(flac_encoder);
 
-    // All data flushed
-    CETI_DEBUG("Deleting flac encoder...");
-    FLAC__stream_encoder_delete(flac_encoder);
-    flac_encoder = 0;
     // Exit the thread.
     if (g_audio_overflow_detected && !g_stopAcquisition)
         CETI_LOG("*** Audio overflow detected at location %d", g_audio_status.overflow_location);
@@ -733,48 +2743,26 @@ void *audio_thread_writeFlac(void *paramPtr) {
 void audio_createNewFlacFile() {
     FLAC__bool ok = true;
     FLAC__StreamEncoderInitStatus init_status;
-    uint32_t flac_bit_depth = g_config.audio.bit_depth;
-    uint32_t flac_sample_rate = (g_config.audio.sample_rate == AUDIO_SAMPLE_RATE_48KHZ)    ? 48000
-                                : (g_config.audio.sample_rate == AUDIO_SAMPLE_RATE_96KHZ)  ? 96000
-                                : (g_config.audio.sample_rate == AUDIO_SAMPLE_RATE_192KHZ) ? 192000
-                                                                                           : 750;
-    size_t samples_per_page = (g_config.audio.bit_depth == AUDIO_BIT_DEPTH_16) ? AUDIO_BUFFER_SIZE_SAMPLE16 : AUDIO_BUFFER_SIZE_SAMPLE24;
-
     if (flac_encoder) {
-        ok &= FLAC__stream_encoder_finish(flac_encoder);
-        CETI_DEBUG("Deleting flac encoder...");
-        FLAC__stream_encoder_delete(flac_encoder);
-        flac_encoder = 0;
+        ok &= audio_flac_close_file();
         if (!ok) {
             CETI_LOG("FLAC encoder failed to close for %s", audio_acqDataFileName);
         }
+        audio_status_record(AUDIO_STATUS_DONE_WRITING, 0);
     }
 
     // filename is the time in ms at the start of audio recording
-    snprintf(audio_acqDataFileName, AUDIO_DATA_FILENAME_LEN, "/data/%ld.flac", (int64_t)(s_file_start_time.tv_sec * 1000LL) + (int64_t)(s_file_start_time.tv_usec) / 1000);
+    snprintf(audio_acqDataFileName, AUDIO_DATA_FILENAME_LEN, "/data/%ld.flac", s_file_start_time_us / 1000);
     audio_acqDataFileLength = 0;
+    size_t expected_bytes = audio_file_rotation_start(s_file_start_time_us);
+    size_t samples_per_file = expected_bytes / (g_config.audio.channels * (g_config.audio.bit_depth / 8));
 
     /* allocate the encoder */
-    if ((flac_encoder = FLAC__stream_encoder_new()) == NULL) {
-        CETI_ERR("Failed to allocate FLAC encoder");
-        flac_encoder = 0;
-        return;
-    }
-
-    CETI_DEBUG("Flac configured: channels: %d", AUDIO_CHANNELS);
-    CETI_DEBUG("Flac configured: bit depth: %d bits", flac_bit_depth);
-    CETI_DEBUG("Flac configured: sample_rate: %d sps", flac_sample_rate);
-
-    ok &= FLAC__stream_encoder_set_channels(flac_encoder, AUDIO_CHANNELS);
-    ok &= FLAC__stream_encoder_set_bits_per_sample(flac_encoder, flac_bit_depth);
-    ok &= FLAC__stream_encoder_set_sample_rate(flac_encoder, flac_sample_rate);
-    ok &= FLAC__stream_encoder_set_total_samples_estimate(flac_encoder, samples_per_page);
-
-    if (!ok) {
-        CETI_ERR("FLAC encoder failed to set parameters for %s", audio_acqDataFileName);
-        flac_encoder = 0;
+    if ((flac_encoder = audio_flac_encoder_new(samples_per_file)) == NULL) {
+        CETI_ERR("FLAC encoder could not be created for %s", audio_acqDataFileName);
         return;
     }
+    audio_flac_index_start(&s_flac_index, flac_encoder, audio_file_index_capacity(audio_get_file_size_bytes(&g_config.audio)), samples_per_file, s_file_start_time_us, s_file_start_rtc_count);
 
     init_status = FLAC__stream_encoder_init_file(flac_encoder, audio_acqDataFileName, NULL, NULL);
     if (init_status != FLAC__STREAM_ENCODER_INIT_STATUS_OK) {
@@ -782,12 +2770,196 @@ void audio_createNewFlacFile() {
         CETI_DEBUG("Deleting flac encoder...");
         FLAC__stream_encoder_delete(flac_encoder);
         flac_encoder = 0;
+        audio_flac_index_release(&s_flac_index);
         return;
     }
+
+    // The encoder has created the file, reserve the space it is expected to
+    // need behind it.
+    int fd = open(audio_acqDataFileName, O_WRONLY);
+    if (fd >= 0) {
+        audio_file_preallocate(fd, file_rotation_estimate(&s_file_rotation, expected_bytes));
+        close(fd);
+    }
     CETI_LOG("Saving hydrophone data to %s", audio_acqDataFileName);
+    audio_status_record(AUDIO_STATUS_START_WRITING, 0);
+}
+
+//-----------------------------------------------------------------------------
+// Raw writer
+//-----------------------------------------------------------------------------
+// Blocks are written straight out of the shared memory ring with
+// asynchronous O_DIRECT writes, so the data neither goes through stdio nor
+// fills the page cache. Ring blocks are page aligned and a multiple of the
+// page size, as O_DIRECT requires. Each block is released back to the SPI
+// thread once its own write completes, oldest first.
+//
+// Files are in the self-describing format of utils/audio_file.h. The header
+// and block index are kept in memory and written to the front of the file
+// whenever it is synced, covering only blocks whose samples are written.
+static int s_raw_fd = -1; // file for audio recording
+static int s_raw_direct = 0;
+static struct aiocb s_raw_aio[AUDIO_RAW_MAX_INFLIGHT_BLOCKS]; // in flight writes, oldest at s_raw_aio_first
+static uint32_t s_raw_aio_first = 0;
+static uint32_t s_raw_aio_count = 0;
+static int64_t s_raw_last_sync_us = 0;
+static AudioFileHeader *s_raw_header = NULL; // header followed by the block index, up to the samples
+static uint32_t s_raw_blocks_queued = 0;     // blocks of the current file queued for writing
+static uint32_t s_raw_blocks_written = 0;    // blocks of the current file written
+static uint32_t s_raw_blocks_synced = 0;     // blocks of the current file with their index entry written
+
+/**
+ * @brief Releases the blocks of completed writes, oldest first, stopping at
+ * the first write still in progress.
+ *
+ * @return number of blocks released
+ */
+static uint32_t audio_writeRaw_reap(void) {
+    char err_str[512];
+    uint32_t n_released = 0;
+    while (s_raw_aio_count != 0) {
+        struct aiocb *request = &s_raw_aio[s_raw_aio_first];
+        int error = aio_error(request);
+        if (error == EINPROGRESS) {
+            break;
+        }
+        ssize_t written = aio_return(request);
+        if (error != 0) {
+            CETI_ERR("Failed to write block to %s: %s", audio_acqDataFileName, strerror_r(error, err_str, sizeof(err_str)));
+        } else if (written != request->aio_nbytes) {
+            CETI_ERR("Short write to %s: %ld of %lu bytes", audio_acqDataFileName, written, request->aio_nbytes);
+        }
+        audio_stats_writer_output((written > 0) ? written : 0, 0);
+        ring_release(&shm_audio->ring, 1);
+        s_raw_blocks_written++;
+        s_raw_aio_first = (s_raw_aio_first + 1) % AUDIO_RAW_MAX_INFLIGHT_BLOCKS;
+        s_raw_aio_count--;
+        n_released++;
+    }
+    return n_released;
+}
+
+/**
+ * @brief Blocks until every write in flight has completed.
+ */
+static void audio_writeRaw_drain(void) {
+    while (s_raw_aio_count != 0) {
+        const struct aiocb *oldest[1] = {&s_raw_aio[s_raw_aio_first]};
+        aio_suspend(oldest, 1, NULL);
+        audio_writeRaw_reap();
+    }
+}
+
+/**
+ * @brief Starts writing `n_blocks` contiguous ring blocks starting at `slot`
+ * to the end of the current file, one request per block, starting a new file
+ * first if required.
+ *
+ * @return number of blocks queued
+ */
+static uint32_t audio_writeRaw_submit(uint32_t slot, uint32_t n_blocks, size_t filesize_bytes) {
+    char err_str[512];
+
+    for (uint32_t i = 0; i < n_blocks; i++) {
+        // Create a new output file if this is the first block, if the file
+        //  size limit has been reached or if the file's index is full.
+        int64_t block_time_us = AUDIO_BUFFER_BLOCK_INFO(shm_audio, slot + i)->sys_time_us;
+        if ((s_raw_fd < 0) || ((i == 0) && (file_rotation_due(&s_file_rotation, block_time_us) || (audio_acqDataFileLength >= filesize_bytes))) || (s_raw_blocks_queued == s_raw_header->index_capacity)) {
+            audio_writeRaw_drain();
+            s_file_start_time_us = block_time_us;
+            audio_createNewRawFile();
+            if (s_raw_fd < 0) {
+                return i;
+            }
+        }
+
+        CetiAudioBlockInfo *info = AUDIO_BUFFER_BLOCK_INFO(shm_audio, slot + i);
+        AudioFileIndexEntry *entry = &((AudioFileIndexEntry *)((uint8_t *)s_raw_header + s_raw_header->index_offset))[s_raw_blocks_queued];
+        entry->sys_time_us = info->sys_time_us;
+        entry->rtc_count = info->rtc_count;
+        entry->flags = info->flags;
+
+        struct aiocb *request = &s_raw_aio[(s_raw_aio_first + s_raw_aio_count) % AUDIO_RAW_MAX_INFLIGHT_BLOCKS];
+        memset(request, 0, sizeof(*request));
+        request->aio_fildes = s_raw_fd;
+        request->aio_buf = AUDIO_BUFFER_BLOCK(shm_audio, slot + i);
+        request->aio_nbytes = SPI_BLOCK_SIZE;
+        request->aio_offset = s_raw_header->data_offset + audio_acqDataFileLength;
+        request->aio_sigevent.sigev_notify = SIGEV_NONE;
+        if (aio_write(request) != 0) {
+            CETI_ERR("Failed to queue write to %s: %s", audio_acqDataFileName, strerror_r(errno, err_str, sizeof(err_str)));
+            return i;
+        }
+        s_raw_aio_count++;
+        s_raw_blocks_queued++;
+        audio_acqDataFileLength += SPI_BLOCK_SIZE;
+    }
+    return n_blocks;
+}
+
+/**
+ * @brief Writes the header and any index entries added since the last call
+ * for the blocks written so far.
+ */
+static void audio_writeRaw_metadata(void) {
+    char err_str[512];
+
+    // O_DIRECT writes have to be whole, aligned pages
+    size_t first = AUDIO_FILE_INDEX_OFFSET + (size_t)s_raw_blocks_synced * sizeof(AudioFileIndexEntry);
+    size_t end = AUDIO_FILE_INDEX_OFFSET + (size_t)s_raw_blocks_written * sizeof(AudioFileIndexEntry);
+    first &= ~((size_t)AUDIO_FILE_ALIGNMENT - 1);
+    end = (end + AUDIO_FILE_ALIGNMENT - 1) & ~((size_t)AUDIO_FILE_ALIGNMENT - 1);
+
+    s_raw_header->block_count = s_raw_blocks_written;
+    if ((end > first) && (pwrite(s_raw_fd, (uint8_t *)s_raw_header + first, end - first, first) != (ssize_t)(end - first))) {
+        CETI_ERR("Failed to write block index to %s: %s", audio_acqDataFileName, strerror_r(errno, err_str, sizeof(err_str)));
+        return;
+    }
+    if (pwrite(s_raw_fd, s_raw_header, AUDIO_FILE_ALIGNMENT, 0) != AUDIO_FILE_ALIGNMENT) {
+        CETI_ERR("Failed to write header to %s: %s", audio_acqDataFileName, strerror_r(errno, err_str, sizeof(err_str)));
+        return;
+    }
+    s_raw_blocks_synced = s_raw_blocks_written;
+}
+
+/**
+ * @brief Flushes completed writes to the card every
+ * `g_config.audio.raw_fsync_s`, so a power loss only costs that much audio.
+ */
+static void audio_writeRaw_sync(int force) {
+    if (s_raw_fd < 0) {
+        return;
+    }
+    int64_t now_us = get_global_time_us();
+    if (!force && ((g_config.audio.raw_fsync_s == 0) || (now_us - s_raw_last_sync_us < (int64_t)g_config.audio.raw_fsync_s * 1000000))) {
+        return;
+    }
+    audio_writeRaw_metadata();
+    fdatasync(s_raw_fd);
+    if (!s_raw_direct) {
+        // written data will not be read back, keep it out of the page cache
+        posix_fadvise(s_raw_fd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+    s_raw_last_sync_us = now_us;
+}
+
+/**
+ * @brief Syncs and closes the current raw file, if any.
+ */
+static void audio_writeRaw_close(void) {
+    if (s_raw_fd < 0) {
+        return;
+    }
+    audio_writeRaw_sync(1);
+    if (file_rotation_trim(s_raw_fd) != 0) {
+        CETI_WARN("Failed to trim %s", audio_acqDataFileName);
+    }
+    close(s_raw_fd);
+    s_raw_fd = -1;
+    audio_stats_writer_output(0, 1);
+    audio_status_record(AUDIO_STATUS_DONE_WRITING, 0);
 }
 
-static FILE *acqData = NULL; // file for audio recording
 void *audio_thread_writeRaw(void *paramPtr) {
     // Get the thread ID, so the system monitor can check its CPU assignment.
     g_audio_thread_writeData_tid = gettid();
@@ -813,46 +2985,85 @@ void *audio_thread_writeRaw(void *paramPtr) {
     else
         CETI_WARN("Failed to set priority");
 
+    size_t filesize_bytes = audio_get_file_size_bytes(&g_config.audio);
+    file_rotation_init(&s_file_rotation, AUDIO_FILE_DURATION_S, 1.0);
+    time_t poll_interval_us = AUDIO_BLOCKS_PER_GROUP * AUDIO_BLOCK_FILL_SPEED_US(g_config.audio.channels, audio_sample_rate_to_hz(g_config.audio.sample_rate), g_config.audio.bit_depth) / 2;
+
+    // header and block index, aligned for O_DIRECT
+    uint32_t index_capacity = audio_file_index_capacity(filesize_bytes);
+    if (posix_memalign((void **)&s_raw_header, AUDIO_FILE_ALIGNMENT, AUDIO_FILE_DATA_OFFSET(index_capacity)) != 0) {
+        CETI_ERR("Failed to allocate raw audio file index");
+        s_raw_header = NULL;
+    } else {
+        audio_file_header_init(s_raw_header, &g_config.audio, audio_sample_rate_to_hz(g_config.audio.sample_rate), g_config.audio.channels, index_capacity);
+    }
+    struct timespec poll_interval = {.tv_sec = poll_interval_us / 1000000, .tv_nsec = (poll_interval_us % 1000000) * 1000};
+
     // Wait for the SPI thread to finish initializing and start the main loop.
-    while (!g_audio_thread_spi_is_running && !g_stopAcquisition && !g_audio_overflow_detected)
+    while (!g_audio_thread_spi_is_running && !g_stopAcquisition && !g_audio_overflow_detected && (atomic_load(&s_audio_restart) == AUDIO_RESTART_NONE))
         usleep(1000);
 
     // Main loop.
     CETI_LOG("Starting loop to periodically write data");
     g_audio_thread_writeData_is_running = 1;
-    int pageIndex = 0;
-    while (!g_stopAcquisition && !g_audio_overflow_detected) {
-        // Wait for the SPI thread to finish filling this buffer.
-        // Note that this can use a long delay to yield the CPU,
-        //  since the buffer will fill about once per minute and it only takes
-        //  about 2 seconds to write the buffer to a file.
-        while (audio_buffer_toWrite == shm_audio->page && !g_stopAcquisition && !g_audio_overflow_detected)
-            usleep(1000000);
-
-        if (!g_stopAcquisition && !g_audio_overflow_detected) {
-            g_audio_status.start_writing = 1;
-            audio_status_record();
-
-            // Create a new output file if this is the first flush
-            //  or if the file size limit has been reached.
-            size_t filesize_bytes = AUDIO_BUFFER_SIZE_BYTES * ((g_config.audio.bit_depth == AUDIO_BIT_DEPTH_16) ? 2 : 3);
-            filesize_bytes *= (g_config.audio.sample_rate == AUDIO_SAMPLE_RATE_96KHZ)    ? 2
-                              : (g_config.audio.sample_rate == AUDIO_SAMPLE_RATE_192KHZ) ? 4
-                                                                                         : 1;
-            if ((audio_acqDataFileLength > (filesize_bytes - 1)) || (acqData == NULL)) {
-                audio_createNewRawFile();
+    s_raw_aio_first = s_raw_aio_count = 0;
+    while (!g_stopAcquisition && !g_audio_overflow_detected && (atomic_load(&s_audio_restart) != AUDIO_RESTART_DRAINING) && (s_raw_header != NULL)) {
+        audio_writeRaw_reap();
+        audio_writeRaw_sync(0);
+
+        if (!audio_duty_poll()) {
+            audio_writeRaw_drain();
+            audio_writeRaw_close();
+            audio_duty_discard();
+            usleep(poll_interval_us);
+            continue;
+        }
+
+        // Queue whole groups, so files always hold whole sample sets.
+        uint32_t slot;
+        uint32_t n_blocks = ring_peek_at(&shm_audio->ring, ring_tail(&shm_audio->ring) + s_raw_aio_count, &slot);
+        int group_ready = (n_blocks >= AUDIO_BLOCKS_PER_GROUP) && (s_raw_aio_count + AUDIO_BLOCKS_PER_GROUP <= AUDIO_RAW_MAX_INFLIGHT_BLOCKS);
+        if (group_ready && !g_stopLogging) {
+            int64_t chunk_start_us = get_global_time_us();
+            uint32_t n_queued = audio_writeRaw_submit(slot, AUDIO_BLOCKS_PER_GROUP, filesize_bytes);
+            audio_stats_writer_chunk(AUDIO_BLOCKS_PER_GROUP, get_global_time_us() - chunk_start_us);
+            if (n_queued != AUDIO_BLOCKS_PER_GROUP) {
+                // drop the rest of the group to stay aligned
+                audio_writeRaw_drain();
+                ring_release(&shm_audio->ring, AUDIO_BLOCKS_PER_GROUP - n_queued);
             }
-            // Write the buffer to a file.
-            fwrite(shm_audio->data[pageIndex].raw, 1, AUDIO_BUFFER_SIZE_BYTES, acqData);
-            audio_acqDataFileLength += AUDIO_BUFFER_SIZE_BYTES;
-            fflush(acqData);
-            fsync(fileno(acqData));
+            continue;
+        }
+        if (group_ready && (s_raw_aio_count == 0)) {
+            // logging is stopped, drop the group unwritten
+            ring_release(&shm_audio->ring, AUDIO_BLOCKS_PER_GROUP);
+            continue;
+        }
+
+        // Nothing to queue, wait for the oldest write or for more data.
+        if (s_raw_aio_count != 0) {
+            const struct aiocb *oldest[1] = {&s_raw_aio[s_raw_aio_first]};
+            aio_suspend(oldest, 1, &poll_interval);
+        } else {
+            usleep(poll_interval_us);
+        }
+    }
 
-            // Switch to waiting on the other buffer.
-            g_audio_status.done_writing = 1;
-            audio_status_record();
+    // Flush remaining blocks, unless they were only kept as pre-trigger.
+    audio_writeRaw_drain();
+    uint32_t slot;
+    uint32_t n_blocks;
+    while (!g_stopLogging && (s_duty.state == AUDIO_DUTY_RECORD) && (s_raw_header != NULL) && ((n_blocks = ring_peek(&shm_audio->ring, &slot)) != 0)) {
+        if (n_blocks > AUDIO_RAW_MAX_INFLIGHT_BLOCKS) {
+            n_blocks = AUDIO_RAW_MAX_INFLIGHT_BLOCKS;
         }
+        uint32_t n_queued = audio_writeRaw_submit(slot, n_blocks, filesize_bytes);
+        audio_writeRaw_drain();
+        ring_release(&shm_audio->ring, n_blocks - n_queued);
     }
+    audio_writeRaw_close();
+    free(s_raw_header);
+    s_raw_header = NULL;
 
     // Exit the thread.
     if (g_audio_overflow_detected && !g_stopAcquisition)
@@ -864,34 +3075,67 @@ void *audio_thread_writeRaw(void *paramPtr) {
 }
 
 void audio_createNewRawFile() {
-    if (acqData != NULL) {
-        fclose(acqData);
-    }
+    char err_str[512];
 
-    // filename is the time in ms at the start of audio recording
-    snprintf(audio_acqDataFileName, AUDIO_DATA_FILENAME_LEN, "/data/%lu.raw", (uint64_t)(s_file_start_time.tv_sec * 1000LL) + (uint64_t)(s_file_start_time.tv_usec) / 1000);
-    acqData = fopen(audio_acqDataFileName, "wb");
+    audio_writeRaw_close();
+
+    // filename is the time in ms at the start of audio recording; .bin as the
+    // file is a container (utils/audio_file.h), unlike older headerless .raw files
+    snprintf(audio_acqDataFileName, AUDIO_DATA_FILENAME_LEN, "/data/%lu.bin", (uint64_t)s_file_start_time_us / 1000);
     audio_acqDataFileLength = 0;
-    if (!acqData) {
-        CETI_LOG("Failed to open %s", audio_acqDataFileName);
+    s_raw_direct = 1;
+    s_raw_fd = open(audio_acqDataFileName, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+    if ((s_raw_fd < 0) && (errno == EINVAL)) {
+        // filesystem does not support O_DIRECT
+        CETI_WARN("O_DIRECT not supported for %s, using buffered writes", audio_acqDataFileName);
+        s_raw_direct = 0;
+        s_raw_fd = open(audio_acqDataFileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    if (s_raw_fd < 0) {
+        CETI_LOG("Failed to open %s: %s", audio_acqDataFileName, strerror_r(errno, err_str, sizeof(err_str)));
         return;
     }
+
+    // Lay out the header and an empty index ahead of the samples.
+    s_raw_header->start_time_us = s_file_start_time_us;
+    s_raw_header->block_count = 0;
+    memset((uint8_t *)s_raw_header + s_raw_header->index_offset, 0, s_raw_header->data_offset - s_raw_header->index_offset);
+    s_raw_blocks_queued = s_raw_blocks_written = s_raw_blocks_synced = 0;
+    if (pwrite(s_raw_fd, s_raw_header, s_raw_header->data_offset, 0) != (ssize_t)s_raw_header->data_offset) {
+        CETI_ERR("Failed to write header to %s: %s", audio_acqDataFileName, strerror_r(errno, err_str, sizeof(err_str)));
+    }
+    // raw files grow a whole group at a time, by exactly the samples read
+    size_t expected_bytes = audio_file_rotation_start(s_file_start_time_us);
+    expected_bytes = (expected_bytes + AUDIO_LCM_BYTES - 1) / AUDIO_LCM_BYTES * AUDIO_LCM_BYTES + AUDIO_LCM_BYTES;
+    audio_file_preallocate(s_raw_fd, s_raw_header->data_offset + expected_bytes);
+
+    s_raw_last_sync_us = get_global_time_us();
     CETI_LOG("Saving hydrophone data to %s", audio_acqDataFileName);
+    audio_status_record(AUDIO_STATUS_START_WRITING, 0);
 }
 
 //-----------------------------------------------------------------------------
 // Various helpers
 //-----------------------------------------------------------------------------
-void audio_check_for_overflow(int location_index) {
+/**
+ * @brief Records a FIFO overflow in the audio status if the FPGA flags one.
+ * The SPI thread recovers from it in place; `g_audio_overflow_detected` is
+ * left for restarting the audio threads.
+ *
+ * @return 1 if the FIFO has overflowed, 0 otherwise
+ */
+int audio_check_for_overflow(int location_index) {
 #if AUDIO_OVERFLOW_GPIO >= 0
-    g_audio_overflow_detected = g_audio_overflow_detected || wt_audio_read_overflow();
-    g_audio_status.overflow = g_audio_overflow_detected;
-    if (!g_audio_overflow_detected) {
-        return;
+    if (!s_audio_source->overflow()) {
+        return 0;
     }
-    CETI_LOG("*** OVERFLOW detected at location %d, block %d***", location_index, shm_audio->block);
+    CETI_LOG("*** OVERFLOW detected at location %d, block %lu***", location_index, atomic_load(&shm_audio->ring.head));
+    g_audio_status.overflow = 1;
     g_audio_status.overflow_location = location_index;
-    audio_status_record();
+    audio_status_record(AUDIO_STATUS_OVERFLOW, location_index);
+    return 1;
+#else
+    return 0;
 #endif
 }
 
@@ -13,11 +13,16 @@
 //-----------------------------------------------------------------------------
 // Includes
 //-----------------------------------------------------------------------------
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 
 //-----------------------------------------------------------------------------
 // Definitions/Configurations
 //-----------------------------------------------------------------------------
 #define AUDIO_DATA_FILENAME_LEN (100)
+#define AUDIO_FILE_DURATION_S (5 * 60) // audio is split into files starting on multiples of this many seconds of wall-clock time
+#define AUDIO_FLAC_INITIAL_RATIO (0.75) // FLAC file size over sample size assumed until a file has been written
 
 // Data Acq SPI Settings and Audio Data Buffering
 #define SPI_CE (0)
@@ -31,6 +36,19 @@
 // is constructed. The margins are set in the FPGA Verilog code, not here.
 
 #define AUDIO_DATA_AVAILABLE (22)
+#define AUDIO_FIFO_SIZE_BYTES (32768)       // FPGA FIFO depth, data available is asserted at HWM (cetiTag.h)
+#define AUDIO_DATA_READY_TIMEOUT_US (100000) // longest wait for an edge before rechecking stop flags
+#define AUDIO_SPI_LATENCY_LOG_INTERVAL_US (5 * 60 * 1000000LL)
+
+#define AUDIO_FLAC_MAX_WORKERS (4) // upper limit on parallel FLAC encoder threads
+#define AUDIO_FLAC_APODIZATION_LEN (64)
+#define AUDIO_RAW_MAX_INFLIGHT_BLOCKS (36) // asynchronous raw block writes queued at once (4 groups)
+#define AUDIO_SIM_FILE_LEN (128)
+#define AUDIO_CLICK_MAX_PER_BLOCK (64) // clicks reported per SPI block, more are counted as dropped
+#define AUDIO_LEVELS_SPECTRA_PER_S (32) // FFT frames averaged into each level record per second
+#define AUDIO_DUTY_PAUSE_POLL_US (100000) // how often a paused SPI thread checks whether to resume
+#define AUDIO_RECONFIGURE_POLL_US (10000) // how often a format change is checked on while waiting for it
+#define AUDIO_RECONFIGURE_TIMEOUT_US (10000000) // longest a command waits for a format change to take effect
 
 // value assigned to kHz value for easy printing, but enum limit number of options
 
@@ -51,10 +69,77 @@ typedef enum audio_filter_type_e {
     AUDIO_FILTER_SINC5 = 1,
 } AudioFilterType;
 
+typedef enum audio_acquisition_mode_e {
+    AUDIO_ACQUISITION_POLL = 0, // sleep and poll the data available line
+    AUDIO_ACQUISITION_EDGE = 1, // block on the data available rising edge
+} AudioAcquisitionMode;
+
+typedef enum audio_source_type_e {
+    AUDIO_SOURCE_FPGA = 0,      // ADC samples streamed by the FPGA over SPI
+    AUDIO_SOURCE_SIMULATOR = 1, // generated or replayed samples, no hardware needed (sensors/audio_sim.h)
+} AudioSourceType;
+
+// Simulated audio source settings, the stream format follows the rest of
+// AudioConfig
+typedef struct audio_sim_config_t {
+    char file[AUDIO_SIM_FILE_LEN]; // raw audio to replay in a loop, "" generates tones
+    uint32_t tone_hz;              // channel n plays a tone at (n + 1) * tone_hz
+    uint32_t jitter_us;            // data-ready is asserted up to this late
+    uint32_t overflow_interval_s;  // a FIFO overflow is injected this often, 0 never
+} AudioSimConfig;
+
+// FLAC compression settings, fields left at -1/0/"" keep the choice made by
+// the compression level
+typedef struct audio_flac_tuning_t {
+    int compression_level; // 0 (fastest) - 8 (smallest)
+    uint32_t blocksize;    // samples per FLAC frame, 0 for the level's default
+    int mid_side;          // stereo decorrelation (2 channel audio only), -1 for the level's default
+    int loose_mid_side;    // adaptive mid-side switching, -1 for the level's default
+    char apodization[AUDIO_FLAC_APODIZATION_LEN];
+} AudioFlacTuning;
+
+// Live click detector settings (dsp/click_detect.h)
+typedef struct audio_click_config_t {
+    int enabled;
+    uint32_t band_low_hz;  // band-pass edges, the top is capped below the Nyquist frequency
+    uint32_t band_high_hz;
+    float threshold_db;    // energy over the noise floor that starts a click
+    uint32_t holdoff_ms;   // shortest time between clicks on one channel
+} AudioClickConfig;
+
+typedef enum audio_duty_cycle_mode_e {
+    AUDIO_DUTY_CYCLE_OFF = 0,     // record continuously
+    AUDIO_DUTY_CYCLE_STANDBY = 1, // stop writing when quiet, keep streaming for pre-trigger audio and click detection
+    AUDIO_DUTY_CYCLE_PAUSE = 2,   // also stop FIFO streaming when quiet, only dives restart recording
+} AudioDutyCycleMode;
+
+// Audio duty cycling settings (sensors/audio_duty.h)
+typedef struct audio_duty_config_t {
+    AudioDutyCycleMode mode;
+    uint32_t pretrigger_s; // audio kept from before each trigger in standby
+    uint32_t hold_s;       // recording carries on this long after the last trigger at the surface
+    uint32_t silence_s;    // while diving, triggers must come this often to keep recording, 0 records whole dives
+} AudioDutyConfig;
+
 typedef struct audio_config_t {
     AudioFilterType filter_type;
     AudioSampleRate sample_rate;
     AudioBitDepth bit_depth;
+    uint16_t channels;          // interleaved channels streamed by the FPGA, 3 or 4
+    uint32_t channel_mask;      // channels recorded (bit n is channel n), the others are in standby
+    uint32_t buffer_duration_s; // seconds of audio the shared memory ring can hold
+    AudioAcquisitionMode acquisition_mode;
+    uint32_t flac_workers;   // FLAC encoder threads, 1 encodes on the write thread itself
+    uint32_t flac_cpu_mask;  // CPUs the FLAC encoder threads may run on (bit n is CPU n)
+    uint32_t flac_segment_s; // length of each separately encoded file with multiple workers, 0 sizes to the buffer
+    AudioFlacTuning flac_tuning;
+    uint32_t raw_fsync_s; // seconds between flushing raw audio to the card, 0 only when a file is closed
+    AudioSourceType source;
+    AudioSimConfig sim;
+    uint32_t decimated_rate_khz; // sample rate of the decimated shared memory stream, 0 disables it
+    AudioClickConfig clicks;
+    int levels_enabled; // per second level and spectrum records (cetiTag.h CetiAudioLevels)
+    AudioDutyConfig duty;
 } AudioConfig;
 
 //-----------------------------------------------------------------------------
@@ -63,8 +148,11 @@ typedef struct audio_config_t {
 // Device Driver Methods
 int audio_setup(AudioConfig *config);
 int audio_set_bit_depth(AudioBitDepth bit_depth);
-int audio_set_filter_type(AudioFilterType filter_type);
+int audio_set_filter_type(AudioFilterType filter_type, uint16_t channels);
 int audio_set_sample_rate(AudioSampleRate sample_rate);
+uint32_t audio_sample_rate_to_hz(AudioSampleRate sample_rate);
+uint32_t audio_buffer_capacity_blocks(const AudioConfig *config);
+size_t audio_get_file_size_bytes(const AudioConfig *config);
 void init_audio_buffers();
 int setup_audio_default(void);
 int reset_audio_fifo(void);
@@ -80,13 +168,27 @@ void audio_createNewRawFile();
 void *audio_thread_spi(void *paramPtr);
 void *audio_thread_writeFlac(void *paramPtr);
 void *audio_thread_writeRaw(void *paramPtr);
-void audio_check_for_overflow(int location_index);
+void *audio_thread_decimate(void *paramPtr);
+void *audio_thread_detectClicks(void *paramPtr);
+void *audio_thread_levels(void *paramPtr);
+int audio_check_for_overflow(int location_index);
+void audio_print_spi_latency(FILE *pFile);
+void audio_print_stats(FILE *pFile);
+// Runtime Reconfiguration
+int audio_reconfigure_request(AudioSampleRate sample_rate, AudioBitDepth bit_depth);
+int audio_reconfigure_pending(void);
+void audio_restart_begin(void);
+int audio_reconfigure_apply(void);
+int audio_reconfigure_wait(int64_t timeout_us, int64_t *gap_us);
 
 //-----------------------------------------------------------------------------
 // Global variables
 //-----------------------------------------------------------------------------
 extern int g_audio_thread_spi_is_running;
 extern int g_audio_thread_writeData_is_running;
+extern int g_audio_thread_decimate_is_running;
+extern int g_audio_thread_detectClicks_is_running;
+extern int g_audio_thread_levels_is_running;
 extern int g_audio_overflow_detected;
 extern int g_audio_force_overflow;
 
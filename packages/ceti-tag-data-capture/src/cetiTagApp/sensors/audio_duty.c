@@ -0,0 +1,76 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+// Duty cycling policy for audio recording, see audio_duty.h
+//-----------------------------------------------------------------------------
+#include "audio_duty.h"
+
+/**
+ * @brief Starts the policy recording, as if triggered at `now_us`, so audio
+ * is kept for at least the hold time after start up.
+ *
+ * @param clicks current click detector count, only increases are triggers
+ */
+void audio_duty_init(AudioDuty *self, const AudioDutyConfig *config, int64_t now_us, uint64_t clicks) {
+    self->config = *config;
+    self->state = AUDIO_DUTY_RECORD;
+    self->diving = 0;
+    self->clicks = clicks;
+    self->trigger_us = now_us;
+    self->state_start_us = now_us;
+}
+
+/**
+ * @brief Updates the recording state from the latest dive state and click
+ * count.
+ *
+ * @return 1 if the state changed, 0 otherwise
+ */
+int audio_duty_update(AudioDuty *self, int64_t now_us, int diving, uint64_t clicks) {
+    diving = (diving != 0);
+    if (diving != self->diving) {
+        self->diving = diving;
+        self->trigger_us = now_us;
+    }
+    if (clicks != self->clicks) {
+        self->clicks = clicks;
+        self->trigger_us = now_us;
+    }
+
+    int64_t quiet_us = now_us - self->trigger_us;
+    int record;
+    if (self->config.mode == AUDIO_DUTY_CYCLE_OFF) {
+        record = 1;
+    } else if (diving) {
+        record = (self->config.silence_s == 0) || (self->config.mode == AUDIO_DUTY_CYCLE_PAUSE) || (quiet_us < (int64_t)self->config.silence_s * 1000000);
+    } else {
+        record = (quiet_us < (int64_t)self->config.hold_s * 1000000);
+    }
+
+    AudioDutyState next = AUDIO_DUTY_RECORD;
+    if (!record) {
+        next = (self->config.mode == AUDIO_DUTY_CYCLE_PAUSE) ? AUDIO_DUTY_PAUSED : AUDIO_DUTY_STANDBY;
+    }
+    if (next == self->state) {
+        return 0;
+    }
+    self->state = next;
+    self->state_start_us = now_us;
+    return 1;
+}
+
+const char *audio_duty_state_str(AudioDutyState state) {
+    switch (state) {
+        case AUDIO_DUTY_RECORD:
+            return "recording";
+        case AUDIO_DUTY_STANDBY:
+            return "standby";
+        case AUDIO_DUTY_PAUSED:
+            return "paused";
+    }
+    return "unknown";
+}
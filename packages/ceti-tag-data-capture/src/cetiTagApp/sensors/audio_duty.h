@@ -0,0 +1,47 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+#ifndef AUDIO_DUTY_H
+#define AUDIO_DUTY_H
+
+#include "audio.h" // for AudioDutyConfig
+
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Typedefs
+//-----------------------------------------------------------------------------
+typedef enum {
+    AUDIO_DUTY_RECORD = 0,  // audio is written to files
+    AUDIO_DUTY_STANDBY = 1, // audio streams into the ring, only the pre-trigger is kept
+    AUDIO_DUTY_PAUSED = 2,  // FIFO streaming is stopped
+} AudioDutyState;
+
+// Decides when audio is recorded from the dive state and click detector
+// activity. All times are passed in, so the policy runs on any clock.
+//
+// Dive starts, surfacing and clicks are triggers. Recording carries on for
+// `hold_s` after the last trigger at the surface, and for a whole dive unless
+// `silence_s` is set, in which case it needs a trigger at least that often.
+// While paused no clicks are heard, so dives are always recorded in whole.
+typedef struct {
+    AudioDutyConfig config;
+    AudioDutyState state;
+    int diving;
+    uint64_t clicks;        // click count at the last update
+    int64_t trigger_us;     // time of the last trigger
+    int64_t state_start_us; // time the current state was entered
+} AudioDuty;
+
+//-----------------------------------------------------------------------------
+// Methods
+//-----------------------------------------------------------------------------
+void audio_duty_init(AudioDuty *self, const AudioDutyConfig *config, int64_t now_us, uint64_t clicks);
+int audio_duty_update(AudioDuty *self, int64_t now_us, int diving, uint64_t clicks);
+const char *audio_duty_state_str(AudioDutyState state);
+
+#endif // AUDIO_DUTY_H
@@ -0,0 +1,235 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+// Simulated FPGA audio FIFO, so the acquisition pipeline can run without the
+// hardware. The FIFO fills at the configured byte rate from when streaming
+// starts and is drained by reads. The stream is either a tone per channel or
+// a raw file replayed in a loop, in the FPGA's interleaved big-endian format.
+//-----------------------------------------------------------------------------
+#include "audio_sim.h"
+
+#include "../cetiTag.h"
+#include "../utils/audio_file.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static uint32_t audio_sim_random(AudioSim *sim) {
+    // xorshift32
+    sim->random ^= sim->random << 13;
+    sim->random ^= sim->random >> 17;
+    sim->random ^= sim->random << 5;
+    return sim->random;
+}
+
+static void audio_sim_next_jitter(AudioSim *sim) {
+    sim->block_jitter_us = (sim->config.jitter_us != 0) ? audio_sim_random(sim) % (sim->config.jitter_us + 1) : 0;
+}
+
+static int audio_sim_open_replay(AudioSim *sim, const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat file_stat;
+    if ((fstat(fd, &file_stat) != 0) || (file_stat.st_size == 0)) {
+        close(fd);
+        return -1;
+    }
+    void *address = mmap(NULL, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) {
+        return -1;
+    }
+    sim->replay_map = address;
+    sim->replay_map_length = file_stat.st_size;
+
+    // Raw container files (utils/audio_file.h) replay their blocks, anything
+    // else is taken to be samples from the start.
+    const AudioFileHeader *header = address;
+    uint64_t data_length = sim->replay_map_length;
+    sim->replay_data = address;
+    if ((sim->replay_map_length >= sizeof(AudioFileHeader)) && (audio_file_header_validate(header, sim->replay_map_length) == 0)) {
+        if ((header->bit_depth != sim->bit_depth) || (header->channels != sim->channels)) {
+            return -1;
+        }
+        sim->replay_data += header->data_offset;
+        data_length = (uint64_t)header->block_count * header->block_size;
+        if (data_length > sim->replay_map_length - header->data_offset) {
+            data_length = sim->replay_map_length - header->data_offset;
+        }
+    }
+    sim->replay_frames = data_length / sim->frame_size;
+    return (sim->replay_frames != 0) ? 0 : -1;
+}
+
+/**
+ * @brief Sets up a simulated FIFO for the given stream format. Nothing is
+ * streamed until audio_sim_start().
+ *
+ * @return 0 on success, -1 if the format is unsupported or the replay file
+ * cannot be used
+ */
+int audio_sim_init(AudioSim *sim, const AudioSimConfig *config, uint32_t sample_rate_hz, uint16_t bit_depth, uint16_t channels, int64_t now_us) {
+    memset(sim, 0, sizeof(*sim));
+    if ((sample_rate_hz == 0) || ((bit_depth != 16) && (bit_depth != 24)) || (channels == 0) || (channels > AUDIO_SIM_MAX_CHANNELS)) {
+        return -1;
+    }
+    sim->config = *config;
+    sim->sample_rate_hz = sample_rate_hz;
+    sim->bit_depth = bit_depth;
+    sim->channels = channels;
+    sim->frame_size = channels * (bit_depth / 8);
+    sim->bytes_per_us = (double)sim->frame_size * sample_rate_hz / 1000000.0;
+    sim->epoch_us = now_us;
+    sim->random = 0x2545f491;
+
+    if ((config->file[0] != '\0') && (audio_sim_open_replay(sim, config->file) != 0)) {
+        audio_sim_deinit(sim);
+        return -1;
+    }
+    return 0;
+}
+
+void audio_sim_deinit(AudioSim *sim) {
+    if (sim->replay_map != NULL) {
+        munmap(sim->replay_map, sim->replay_map_length);
+    }
+    sim->replay_map = NULL;
+    sim->replay_data = NULL;
+    sim->replay_frames = 0;
+}
+
+/**
+ * @brief Flushes the FIFO and starts filling it. The stream picks up at the
+ * sample due at `now_us`, and the first byte read is junk, as with the FPGA.
+ */
+void audio_sim_start(AudioSim *sim, int64_t now_us) {
+    audio_sim_reset(sim);
+    sim->running = 1;
+    sim->start_us = now_us;
+    sim->junk_bytes = 1;
+    sim->frame = (uint64_t)(now_us - sim->epoch_us) * sim->sample_rate_hz / 1000000;
+    sim->frame_offset = 0;
+    audio_sim_next_jitter(sim);
+    if ((sim->config.overflow_interval_s != 0) && (sim->next_overflow_us == 0)) {
+        sim->next_overflow_us = now_us + (int64_t)sim->config.overflow_interval_s * 1000000;
+    }
+}
+
+void audio_sim_stop(AudioSim *sim, int64_t now_us) {
+    if (sim->running) {
+        sim->running = 0;
+        sim->stop_us = now_us;
+    }
+}
+
+void audio_sim_reset(AudioSim *sim) {
+    sim->running = 0;
+    sim->overflowed = 0;
+    sim->start_us = 0;
+    sim->stop_us = 0;
+    sim->bytes_read = 0;
+    sim->junk_bytes = 0;
+}
+
+static uint64_t audio_sim_bytes_unread(const AudioSim *sim, int64_t now_us) {
+    int64_t end_us = sim->running ? now_us : sim->stop_us;
+    if (end_us <= sim->start_us) {
+        return 0;
+    }
+    uint64_t produced = (uint64_t)((end_us - sim->start_us) * sim->bytes_per_us);
+    return (produced > sim->bytes_read) ? produced - sim->bytes_read : 0;
+}
+
+/**
+ * @brief Bytes waiting in the FIFO at `now_us`.
+ */
+size_t audio_sim_fifo_level(const AudioSim *sim, int64_t now_us) {
+    uint64_t unread = audio_sim_bytes_unread(sim, now_us);
+    return (unread > AUDIO_FIFO_SIZE_BYTES) ? AUDIO_FIFO_SIZE_BYTES : unread;
+}
+
+/**
+ * @brief Data-ready is asserted once a block is waiting, delayed by up to
+ * the configured jitter.
+ */
+int audio_sim_data_ready(AudioSim *sim, int64_t now_us) {
+    if (audio_sim_bytes_unread(sim, now_us) < SPI_BLOCK_SIZE) {
+        return 0;
+    }
+    int64_t block_filled_us = sim->start_us + (int64_t)ceil((sim->bytes_read + SPI_BLOCK_SIZE) / sim->bytes_per_us);
+    return now_us >= block_filled_us + sim->block_jitter_us;
+}
+
+/**
+ * @brief The overflow flag latches when the FIFO fills or an injected
+ * overflow is due, and stays set until the FIFO is reset.
+ */
+int audio_sim_overflow(AudioSim *sim, int64_t now_us) {
+    if (audio_sim_bytes_unread(sim, now_us) > AUDIO_FIFO_SIZE_BYTES) {
+        sim->overflowed = 1;
+    }
+    if (sim->running && (sim->next_overflow_us != 0) && (now_us >= sim->next_overflow_us)) {
+        sim->overflowed = 1;
+        sim->next_overflow_us = now_us + (int64_t)sim->config.overflow_interval_s * 1000000;
+    }
+    return sim->overflowed;
+}
+
+static void audio_sim_fill_frame(AudioSim *sim) {
+    if (sim->replay_data != NULL) {
+        memcpy(sim->frame_bytes, sim->replay_data + (sim->frame % sim->replay_frames) * sim->frame_size, sim->frame_size);
+        return;
+    }
+
+    // tones at -6 dBFS, the phase is kept exact with integer arithmetic
+    double amplitude = ((1 << (sim->bit_depth - 1)) - 1) / 2.0;
+    uint8_t *dst = sim->frame_bytes;
+    for (uint16_t channel = 0; channel < sim->channels; channel++) {
+        uint64_t phase = ((uint64_t)(channel + 1) * sim->config.tone_hz * sim->frame) % sim->sample_rate_hz;
+        int32_t value = (int32_t)lround(amplitude * sin(2.0 * M_PI * phase / sim->sample_rate_hz));
+        if (sim->bit_depth == 24) {
+            *dst++ = (value >> 16) & 0xff;
+        }
+        *dst++ = (value >> 8) & 0xff;
+        *dst++ = value & 0xff;
+    }
+}
+
+/**
+ * @brief Reads the next `n_bytes` of the stream out of the FIFO.
+ */
+void audio_sim_read(AudioSim *sim, uint8_t *dst, size_t n_bytes) {
+    size_t i = 0;
+    for (; (i < n_bytes) && (sim->junk_bytes != 0); i++) {
+        dst[i] = 0;
+        sim->junk_bytes--;
+    }
+    while (i < n_bytes) {
+        if (sim->frame_offset == 0) {
+            audio_sim_fill_frame(sim);
+        }
+        size_t chunk = sim->frame_size - sim->frame_offset;
+        if (chunk > n_bytes - i) {
+            chunk = n_bytes - i;
+        }
+        memcpy(dst + i, sim->frame_bytes + sim->frame_offset, chunk);
+        i += chunk;
+        sim->bytes_read += chunk;
+        sim->frame_offset += chunk;
+        if (sim->frame_offset == sim->frame_size) {
+            sim->frame_offset = 0;
+            sim->frame++;
+        }
+    }
+    audio_sim_next_jitter(sim);
+}
@@ -0,0 +1,70 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+#ifndef AUDIO_SIM_H
+#define AUDIO_SIM_H
+
+#include "audio.h" // for AudioSimConfig
+
+#include <stddef.h>
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Definitions/Configurations
+//-----------------------------------------------------------------------------
+#define AUDIO_SIM_MAX_CHANNELS (8)
+#define AUDIO_SIM_MAX_FRAME_SIZE (AUDIO_SIM_MAX_CHANNELS * 3)
+
+//-----------------------------------------------------------------------------
+// Typedefs
+//-----------------------------------------------------------------------------
+// Model of the FPGA FIFO filled at the audio byte rate. All times are
+// passed in, so the model runs on any clock.
+typedef struct {
+    AudioSimConfig config;
+    uint32_t sample_rate_hz;
+    uint16_t bit_depth;
+    uint16_t channels;
+    uint32_t frame_size; // bytes per sample of all channels
+    double bytes_per_us;
+
+    int64_t epoch_us;          // samples are numbered from here, so audio lost while stopped is skipped
+    int running;
+    int overflowed;            // latched until the FIFO is reset
+    int64_t start_us;          // streaming started
+    int64_t stop_us;           // streaming stopped, the FIFO stops filling
+    uint64_t bytes_read;       // stream bytes read since streaming started
+    uint32_t junk_bytes;       // bytes read ahead of the stream after a start
+    uint32_t block_jitter_us;  // how late data-ready is for the next block
+    int64_t next_overflow_us;  // next injected overflow, 0 for none
+    uint32_t random;           // jitter generator state
+
+    uint64_t frame;            // sample being read
+    uint32_t frame_offset;     // bytes of it already read
+    uint8_t frame_bytes[AUDIO_SIM_MAX_FRAME_SIZE];
+
+    // replayed file, samples start at replay_data
+    void *replay_map;
+    size_t replay_map_length;
+    const uint8_t *replay_data;
+    uint64_t replay_frames;
+} AudioSim;
+
+//-----------------------------------------------------------------------------
+// Methods
+//-----------------------------------------------------------------------------
+int audio_sim_init(AudioSim *sim, const AudioSimConfig *config, uint32_t sample_rate_hz, uint16_t bit_depth, uint16_t channels, int64_t now_us);
+void audio_sim_deinit(AudioSim *sim);
+void audio_sim_start(AudioSim *sim, int64_t now_us);
+void audio_sim_stop(AudioSim *sim, int64_t now_us);
+void audio_sim_reset(AudioSim *sim);
+size_t audio_sim_fifo_level(const AudioSim *sim, int64_t now_us);
+int audio_sim_data_ready(AudioSim *sim, int64_t now_us);
+int audio_sim_overflow(AudioSim *sim, int64_t now_us);
+void audio_sim_read(AudioSim *sim, uint8_t *dst, size_t n_bytes);
+
+#endif // AUDIO_SIM_H
@@ -0,0 +1,105 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+// Audio source selection and the simulator backend. The FPGA backend lives
+// with the rest of the hardware access in audio.c.
+//-----------------------------------------------------------------------------
+#include "audio_source.h"
+
+#include "../cetiTag.h"
+#include "../launcher.h" // for ENABLE_FPGA
+#include "../utils/logging.h"
+#include "audio_sim.h"
+
+#include <time.h>
+#include <unistd.h>
+
+//-----------------------------------------------------------------------------
+// Simulator backend
+//-----------------------------------------------------------------------------
+static AudioSim s_sim;
+
+static int64_t audio_source_sim_now_us(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static int audio_source_sim_init(AudioConfig *config) {
+    if (audio_sim_init(&s_sim, &config->sim, audio_sample_rate_to_hz(config->sample_rate), config->bit_depth, config->channels, audio_source_sim_now_us()) != 0) {
+        CETI_ERR("Failed to set up the audio simulator%s%s", (config->sim.file[0] != '\0') ? " replaying " : "", config->sim.file);
+        return -1;
+    }
+    if (config->sim.file[0] != '\0') {
+        CETI_LOG("Simulating audio from %s (%lu samples)", config->sim.file, s_sim.replay_frames);
+    } else {
+        CETI_LOG("Simulating audio with %u Hz tones", config->sim.tone_hz);
+    }
+    CETI_LOG("Simulated data-ready jitter up to %u us, overflow every %u s", config->sim.jitter_us, config->sim.overflow_interval_s);
+    return 0;
+}
+
+static int audio_source_sim_configure(AudioConfig *config) {
+    audio_sim_deinit(&s_sim);
+    return audio_source_sim_init(config);
+}
+
+static int audio_source_sim_open(void) { return 0; }
+static void audio_source_sim_close(void) {}
+static void audio_source_sim_start(void) { audio_sim_start(&s_sim, audio_source_sim_now_us()); }
+static void audio_source_sim_stop(void) { audio_sim_stop(&s_sim, audio_source_sim_now_us()); }
+static void audio_source_sim_reset(void) { audio_sim_reset(&s_sim); }
+static int audio_source_sim_data_ready(void) { return audio_sim_data_ready(&s_sim, audio_source_sim_now_us()); }
+static int audio_source_sim_overflow(void) { return audio_sim_overflow(&s_sim, audio_source_sim_now_us()); }
+static uint32_t audio_source_sim_tick(void) { return (uint32_t)audio_source_sim_now_us(); }
+
+static void audio_source_sim_read(uint8_t *dst, size_t n_bytes) {
+    // take as long as the SPI transfer would
+    int64_t transfer_us = (int64_t)n_bytes * 8 * 1000000 / SPI_CLK_RATE;
+    audio_sim_read(&s_sim, dst, n_bytes);
+    usleep(transfer_us);
+}
+
+// there is no data-ready edge, the SPI thread falls back to polling
+static int audio_source_sim_set_data_ready_isr(AudioSourceIsr isr) { return -1; }
+
+static const AudioSource s_audio_source_simulator = {
+    .name = "simulator",
+    .init = audio_source_sim_init,
+    .configure = audio_source_sim_configure,
+    .open = audio_source_sim_open,
+    .close = audio_source_sim_close,
+    .start = audio_source_sim_start,
+    .stop = audio_source_sim_stop,
+    .reset = audio_source_sim_reset,
+    .data_ready = audio_source_sim_data_ready,
+    .overflow = audio_source_sim_overflow,
+    .read = audio_source_sim_read,
+    .tick = audio_source_sim_tick,
+    .set_data_ready_isr = audio_source_sim_set_data_ready_isr,
+};
+
+const AudioSource *audio_source_simulator(void) {
+    return &s_audio_source_simulator;
+}
+
+//-----------------------------------------------------------------------------
+// Selection
+//-----------------------------------------------------------------------------
+const AudioSource *audio_source_get(AudioSourceType type) {
+    switch (type) {
+        case AUDIO_SOURCE_SIMULATOR:
+            return audio_source_simulator();
+        case AUDIO_SOURCE_FPGA:
+        default:
+#if ENABLE_FPGA
+            return audio_source_fpga();
+#else
+            return audio_source_simulator();
+#endif
+    }
+}
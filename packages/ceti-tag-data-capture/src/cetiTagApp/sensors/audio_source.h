@@ -0,0 +1,49 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+#ifndef AUDIO_SOURCE_H
+#define AUDIO_SOURCE_H
+
+#include "audio.h" // for AudioConfig, AudioSourceType
+
+#include <stddef.h>
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Typedefs
+//-----------------------------------------------------------------------------
+// Same signature as a pigpio ISR, `tick` is from the source's tick()
+typedef void (*AudioSourceIsr)(int gpio, int level, uint32_t tick);
+
+// Where the SPI thread gets its audio from. The stream is interleaved
+// big-endian samples in blocks of SPI_BLOCK_SIZE bytes, delivered through a
+// FIFO that flags data-ready once it holds a block and latches an overflow
+// once it is full.
+typedef struct {
+    const char *name;
+    int (*init)(AudioConfig *config);      // one-time setup, 0 on success
+    int (*configure)(AudioConfig *config); // change the sample format while stopped, 0 on success
+    int (*open)(void);                // get ready to read, 0 on success
+    void (*close)(void);
+    void (*start)(void); // flush the FIFO and start streaming, the first byte read after is junk
+    void (*stop)(void);  // stop streaming, the FIFO keeps its contents
+    void (*reset)(void); // stop streaming, flush the FIFO and clear an overflow
+    int (*data_ready)(void);
+    int (*overflow)(void);
+    void (*read)(uint8_t *dst, size_t n_bytes);
+    uint32_t (*tick)(void);                        // free running microsecond tick
+    int (*set_data_ready_isr)(AudioSourceIsr isr); // NULL removes it, 0 on success
+} AudioSource;
+
+//-----------------------------------------------------------------------------
+// Methods
+//-----------------------------------------------------------------------------
+const AudioSource *audio_source_fpga(void);
+const AudioSource *audio_source_simulator(void);
+const AudioSource *audio_source_get(AudioSourceType type);
+
+#endif // AUDIO_SOURCE_H
@@ -8,12 +8,17 @@
 
 #include "ecg.h"
 
+#include "../utils/config.h"
+#include "../utils/ecg_file.h"
 #include "../utils/memory.h"
 #include "../utils/thread_error.h"
+#include "ecg_helpers/ecg_drdy.h"
 
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <semaphore.h>
+#include <stdatomic.h>
 #include <sys/mman.h>
 
 //-----------------------------------------------------------------------------
@@ -24,26 +29,83 @@
 int g_ecg_thread_getData_is_running = 0;
 int g_ecg_thread_writeData_is_running = 0;
 static char ecg_data_filepath[100];
-static FILE *ecg_data_file = NULL;
-static const char *ecg_data_file_headers[] = {
-    "Sample Index",
-    "ECG",
-    "Leads-Off-P",
-    "Leads-Off-N",
-};
-static const int num_ecg_data_file_headers = sizeof(ecg_data_file_headers) / sizeof(*ecg_data_file_headers);
-
-static int ecg_buffer_select_toWrite = 0; // which buffer will be flushed to the output file
-static uint8_t ecg_restarted[ECG_NUM_BUFFERS][ECG_BUFFER_LENGTH] = {0};
-static uint8_t ecg_new_log[ECG_NUM_BUFFERS][ECG_BUFFER_LENGTH] = {0};
-static uint8_t ecg_zeros[ECG_NUM_BUFFERS][ECG_BUFFER_LENGTH] = {0};
-static uint8_t ecg_timeout[ECG_NUM_BUFFERS][ECG_BUFFER_LENGTH] = {0};
-static uint8_t ecg_maybe_invalid[ECG_NUM_BUFFERS][ECG_BUFFER_LENGTH] = {0};
+static int ecg_data_fd = -1;
+static long ecg_data_file_size_b = 0;
+static uint16_t ecg_block_flags[ECG_BUFFER_LENGTH];
+static uint8_t ecg_block[ECG_FILE_BLOCK_MAX_SIZE(ECG_BUFFER_LENGTH)];
+static uint32_t ecg_data_file_flags = 0; // flags for the first sample written to the current file
+static CetiEcgFormat ecg_data_file_format; // ADC settings of the samples in the current file
+
+static _Atomic int ecg_buffer_select_toWrite = 0; // which buffer will be flushed to the output file, stored with release once it has been
 
 static CetiEcgBuffer *shm_ecg; // share memory of other processes to directly access samples
 static sem_t *sem_ecg_sample;  // semaphore for other processes to sync with new sample becoming available
 static sem_t *sem_ecg_page;    // semaphore for other processes to sync with new pages becoming available
 
+static EcgDataReady s_data_ready;        // data-ready edges queued by the GPIO callback
+static int s_data_ready_isr_attached = 0; // 1 while acquiring on data-ready edges
+
+typedef enum {
+    ECG_RECONFIGURE_IDLE,
+    ECG_RECONFIGURE_PENDING,
+    ECG_RECONFIGURE_FAILED, // acquisition stopped before applying the request
+} EcgReconfigureState;
+
+static _Atomic int s_reconfigure_state = ECG_RECONFIGURE_IDLE; // EcgReconfigureState
+static EcgConfig s_reconfigure_config;
+
+// Apply the configured ADC settings and start continuous conversion.
+static void ecg_configure_adc(const EcgConfig *config) {
+    ecg_adc_set_voltage_reference((config->vref == ECG_VREF_INTERNAL) ? ECG_ADC_VREF_INTERNAL : ECG_ADC_VREF_EXTERNAL);
+    ecg_adc_set_gain((config->gain == 4) ? ECG_ADC_GAIN_FOUR : ECG_ADC_GAIN_ONE);
+    ecg_adc_set_data_rate(config->sample_rate);           // 20, 90, 330, or 1000
+    ecg_adc_set_conversion_mode(ECG_ADC_MODE_CONTINUOUS); // ECG_ADC_MODE_CONTINUOUS or ECG_ADC_MODE_SINGLE_SHOT
+    ecg_adc_set_channel(config->channel);
+    // Start continuous conversion (or a single reading).
+    ecg_adc_start();
+    CETI_LOG("ECG ADC at %u Hz, gain %u, %s reference, channel %u",
+             config->sample_rate, config->gain, (config->vref == ECG_VREF_INTERNAL) ? "internal" : "external", config->channel);
+}
+
+static void ecg_format_from_config(CetiEcgFormat *format, const EcgConfig *config) {
+    memset(format, 0, sizeof(*format));
+    format->sampling_period_us = ECG_SAMPLING_PERIOD_US(config->sample_rate);
+    format->gain = config->gain;
+    format->vref = config->vref;
+    format->channel = config->channel;
+}
+
+static int ecg_format_equal(const CetiEcgFormat *a, const CetiEcgFormat *b) {
+    return (a->sampling_period_us == b->sampling_period_us) && (a->gain == b->gain) && (a->vref == b->vref) && (a->channel == b->channel);
+}
+
+// Size the page being filled, and the ones after it, for `config`'s rate and
+//  note the settings its samples are acquired with.
+static void ecg_set_page_format(const EcgConfig *config) {
+    int page = atomic_load_explicit(&shm_ecg->page, memory_order_relaxed);
+    shm_ecg->sample_rate = config->sample_rate;
+    shm_ecg->page_length = ECG_PAGE_LENGTH(config->sample_rate);
+    shm_ecg->pages[page].sample_count = 0;
+    ecg_format_from_config(&shm_ecg->pages[page].format, config);
+}
+
+// Slow rates get longer than ECG_SAMPLE_TIMEOUT_US between samples, so allow a
+//  few sampling periods before deciding the electronics stalled.
+static long ecg_sample_timeout_us(long sampling_period_us) {
+    return (4 * sampling_period_us > ECG_SAMPLE_TIMEOUT_US) ? 4 * sampling_period_us : ECG_SAMPLE_TIMEOUT_US;
+}
+
+// Hand the page being filled to the writer and start filling the next one.
+static void ecg_finish_page(void) {
+    int page = atomic_load_explicit(&shm_ecg->page, memory_order_relaxed);
+    shm_ecg->pages[page].sample_count = shm_ecg->sample;
+    shm_ecg->sample = 0;
+    // the writer reads the finished page's info once it sees the new page
+    atomic_store_explicit(&shm_ecg->page, (page + 1) % ECG_NUM_BUFFERS, memory_order_release);
+    ecg_set_page_format(&g_config.ecg);
+    sem_post(sem_ecg_page);
+}
+
 int init_ecg() {
     char err_str[512];
     int t_result = THREAD_OK;
@@ -73,9 +135,14 @@ int init_ecg() {
         t_result |= THREAD_ERR_SEM_FAILED;
     }
 
-    shm_ecg->lod_enabled = ENABLE_ECG_LOD;
+    if (shm_ecg != NULL) {
+        shm_ecg->version = ECG_BUFFER_VERSION;
+        shm_ecg->lod_enabled = ENABLE_ECG_LOD;
+        ecg_set_page_format(&g_config.ecg);
+    }
 
     // Open an output file to write data.
+    ecg_format_from_config(&ecg_data_file_format, &g_config.ecg);
     if (init_ecg_data_file(1) < 0) {
         CETI_ERR("Failed to open/create an output data file: " AUDIO_STATUS_FILEPATH ": %s", strerror_r(errno, err_str, sizeof(err_str)));
         t_result |= THREAD_ERR_DATA_FILE_FAILED;
@@ -92,13 +159,7 @@ int init_ecg_electronics() {
     // Set up and configure the ADC.
     if (ecg_adc_setup(ECG_I2C_BUS) < 0)
         return -1;
-    ecg_adc_set_voltage_reference(ECG_ADC_VREF_EXTERNAL); // ECG_ADC_VREF_EXTERNAL or ECG_ADC_VREF_INTERNAL
-    ecg_adc_set_gain(ECG_ADC_GAIN_ONE);                   // ECG_ADC_GAIN_ONE or ECG_ADC_GAIN_FOUR
-    ecg_adc_set_data_rate(1000);                          // 20, 90, 330, or 1000
-    ecg_adc_set_conversion_mode(ECG_ADC_MODE_CONTINUOUS); // ECG_ADC_MODE_CONTINUOUS or ECG_ADC_MODE_SINGLE_SHOT
-    ecg_adc_set_channel(ECG_ADC_CHANNEL_ECG);
-    // Start continuous conversion (or a single reading).
-    ecg_adc_start();
+    ecg_configure_adc(&g_config.ecg);
 
     CETI_LOG("Successfully initialized the ECG electronics");
     CETI_LOG("ECG data-ready pin: %d", ECG_ADC_DATA_READY_PIN);
@@ -112,30 +173,155 @@ int init_ecg_electronics() {
 
 // Determine a new ECG data filename that does not already exist, and open a file for it.
 int init_ecg_data_file(int restarted_program) {
+    if (ecg_data_fd >= 0) {
+        close(ecg_data_fd);
+        ecg_data_fd = -1;
+    }
+
     // Append a number to the filename base until one is found that doesn't exist yet.
     int data_file_postfix_count = 0;
     int data_file_exists = 0;
     do {
-        sprintf(ecg_data_filepath, "%s_%02d.csv", ECG_DATA_FILEPATH_BASE, data_file_postfix_count);
+        sprintf(ecg_data_filepath, "%s_%02d.ecg", ECG_DATA_FILEPATH_BASE, data_file_postfix_count);
         data_file_exists = (access(ecg_data_filepath, F_OK) != -1);
         data_file_postfix_count++;
     } while (data_file_exists);
 
-    // Open the new file.
-    int init_data_file_success = init_data_file(ecg_data_file, ecg_data_filepath,
-                                                ecg_data_file_headers, num_ecg_data_file_headers,
-                                                NULL,
-                                                "init_ecg_data_file()");
-    ecg_restarted[shm_ecg->page][0] = 1;
-
-    // Change the note from restarted to new file if this is not the first initialization.
+    // Open the new file and write its header.
+    // The file stays open; each flushed buffer is appended as one block.
+    int init_data_file_success = -1;
+    ecg_data_fd = open(ecg_data_filepath, O_WRONLY | O_CREAT | O_EXCL | O_APPEND, 0644);
+    if (ecg_data_fd < 0) {
+        CETI_ERR("Failed to open/create an output data file: %s", ecg_data_filepath);
+    } else {
+        EcgFileHeader header;
+        ecg_file_header_init(&header, &ecg_data_file_format, ENABLE_ECG_LOD, get_global_time_us());
+        if (write(ecg_data_fd, &header, sizeof(header)) != sizeof(header)) {
+            CETI_ERR("Failed to write the header of %s", ecg_data_filepath);
+            close(ecg_data_fd);
+            ecg_data_fd = -1;
+        } else {
+            ecg_data_file_size_b = sizeof(header);
+            init_data_file_success = 0;
+            CETI_LOG("Created a new output data file: %s", ecg_data_filepath);
+        }
+    }
+    // Note the new file on the first sample written to it.
+    ecg_data_file_flags = ECG_SAMPLE_FLAG_RESTARTED;
     if (!restarted_program) {
-        ecg_new_log[shm_ecg->page][0] = 1;
+        ecg_data_file_flags |= ECG_SAMPLE_FLAG_NEW_LOG;
     }
 
     return init_data_file_success;
 }
 
+static void ecg_data_ready_isr(int gpio, int level, uint32_t tick) {
+    if (level != 0) {
+        return;
+    }
+    ecg_drdy_push(&s_data_ready, get_global_time_us(), tick);
+}
+
+static void ecg_attach_data_ready_isr(void) {
+    if (ecg_drdy_init(&s_data_ready) != 0) {
+        CETI_WARN("Failed to create data-ready semaphore, falling back to polling");
+        return;
+    }
+    int result = ecg_adc_set_data_ready_isr(ecg_data_ready_isr);
+    if (result != 0) {
+        CETI_WARN("Failed to attach data-ready interrupt (%d), falling back to polling", result);
+        ecg_drdy_destroy(&s_data_ready);
+        return;
+    }
+    s_data_ready_isr_attached = 1;
+    CETI_LOG("Attached data-ready interrupt callback");
+}
+
+static void ecg_detach_data_ready_isr(void) {
+    if (!s_data_ready_isr_attached) {
+        return;
+    }
+    ecg_adc_set_data_ready_isr(NULL);
+    CETI_LOG("Removed data-ready interrupt callback (%" PRIu64 " conversions missed)", s_data_ready.missed);
+    ecg_drdy_destroy(&s_data_ready);
+    s_data_ready_isr_attached = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Runtime reconfiguration - change the ADC settings without exiting
+//-----------------------------------------------------------------------------
+// The command thread requests settings and the acquisition thread, which owns
+// the ADC, applies them between samples and ends the page it was filling.
+
+/**
+ * @brief Fails a request the acquisition thread will no longer apply, so
+ * that later requests aren't refused as already underway.
+ */
+static void ecg_reconfigure_abandon(void) {
+    int pending = ECG_RECONFIGURE_PENDING;
+    if (atomic_compare_exchange_strong(&s_reconfigure_state, &pending, ECG_RECONFIGURE_FAILED)) {
+        CETI_WARN("ECG acquisition stopped before applying the requested settings");
+    }
+}
+
+/**
+ * @brief Asks the acquisition thread to apply new ADC settings.
+ *
+ * @return 0 if the request was queued, -1 if the settings can't be used or
+ * acquisition isn't running
+ */
+int ecg_reconfigure_request(const EcgConfig *config) {
+    if ((config->sample_rate != 20) && (config->sample_rate != 90) && (config->sample_rate != 330) && (config->sample_rate != 1000)) {
+        CETI_ERR("Invalid sample rate %u Hz", config->sample_rate);
+        return -1;
+    }
+    if ((config->gain != 1) && (config->gain != 4)) {
+        CETI_ERR("Invalid gain %u", config->gain);
+        return -1;
+    }
+    if (config->channel > 3) {
+        CETI_ERR("Invalid channel %u", config->channel);
+        return -1;
+    }
+    if ((shm_ecg == NULL) || !g_ecg_thread_getData_is_running) {
+        CETI_ERR("ECG acquisition is not running");
+        return -1;
+    }
+    if (atomic_load(&s_reconfigure_state) == ECG_RECONFIGURE_PENDING) {
+        CETI_ERR("An ECG settings change is already underway");
+        return -1;
+    }
+    s_reconfigure_config = *config;
+    atomic_store(&s_reconfigure_state, ECG_RECONFIGURE_PENDING);
+    // the thread may have stopped since it was checked, and won't apply it
+    if (!g_ecg_thread_getData_is_running) {
+        ecg_reconfigure_abandon();
+        CETI_ERR("ECG acquisition is not running");
+        return -1;
+    }
+    CETI_LOG("ECG change to %u Hz, gain %u, %s reference, channel %u requested",
+             config->sample_rate, config->gain, (config->vref == ECG_VREF_INTERNAL) ? "internal" : "external", config->channel);
+    return 0;
+}
+
+/**
+ * @brief Waits for a requested settings change to be applied.
+ *
+ * @return 0 once the settings are in use, -1 on timeout or if acquisition
+ * stopped first
+ */
+int ecg_reconfigure_wait(int64_t timeout_us) {
+    int64_t deadline_us = get_global_time_us() + timeout_us;
+    int state;
+    while ((state = atomic_load(&s_reconfigure_state)) == ECG_RECONFIGURE_PENDING) {
+        if (get_global_time_us() > deadline_us) {
+            return -1;
+        }
+        usleep(ECG_RECONFIGURE_POLL_US);
+    }
+    return (state == ECG_RECONFIGURE_IDLE) ? 0 : -1;
+}
+
 //-----------------------------------------------------------------------------
 // Thread to acquire data into a rolling buffer
 //-----------------------------------------------------------------------------
@@ -156,6 +342,7 @@ void *ecg_thread_getData(void *paramPtr) {
         sem_unlink(ECG_PAGE_SEM_NAME);
 
         g_ecg_thread_getData_is_running = 0;
+        ecg_reconfigure_abandon();
         CETI_LOG("Terminated!");
         return NULL;
     }
@@ -179,11 +366,16 @@ void *ecg_thread_getData(void *paramPtr) {
     else
         CETI_LOG("XXX Failed to set priority");
 
+    if (g_config.ecg.acquisition_mode == ECG_ACQUISITION_EDGE) {
+        ecg_attach_data_ready_isr();
+    }
+    CETI_LOG("Using %s acquisition", s_data_ready_isr_attached ? "edge" : "poll");
+
     // Main loop while application is running.
     CETI_LOG("Starting loop to periodically acquire data");
     g_ecg_thread_getData_is_running = 1;
 
-    // Continuously poll the ADC and the leads-off detection output.
+    // Continuously read the ADC and the leads-off detection output.
     long long prev_ecg_adc_latest_reading_global_time_us = 0;
     shm_ecg->sample = 0;
     long long sample_index = 0;
@@ -191,10 +383,45 @@ void *ecg_thread_getData(void *paramPtr) {
     long instantaneous_sampling_period_us = 0;
     int first_sample = 1;
     int should_reinitialize = 0;
+    long sampling_period_us = ECG_SAMPLING_PERIOD_US(shm_ecg->sample_rate);
+    long sample_timeout_us = ecg_sample_timeout_us(sampling_period_us);
     long long start_time_ms = get_global_time_ms();
     while (!g_stopAcquisition) {
+        // Apply a requested change of ADC settings between samples, once the
+        //  writer has flushed the other page, since a change finishes the
+        //  page being filled early.
+        if ((atomic_load(&s_reconfigure_state) == ECG_RECONFIGURE_PENDING) && (atomic_load_explicit(&ecg_buffer_select_toWrite, memory_order_acquire) == atomic_load_explicit(&shm_ecg->page, memory_order_relaxed))) {
+            g_config.ecg = s_reconfigure_config;
+            ecg_configure_adc(&g_config.ecg);
+            if (s_data_ready_isr_attached) {
+                ecg_drdy_flush(&s_data_ready); // edges of conversions at the old settings
+            }
+            // End the page early, so that every page holds samples at a
+            //  single rate and the writer can tell when the rate changed.
+            if (shm_ecg->sample > 0) {
+                ecg_finish_page();
+            } else {
+                ecg_set_page_format(&g_config.ecg);
+            }
+            sampling_period_us = ECG_SAMPLING_PERIOD_US(shm_ecg->sample_rate);
+            sample_timeout_us = ecg_sample_timeout_us(sampling_period_us);
+            consecutive_zero_ecg_count = 0;
+            first_sample = 1;
+            atomic_store(&s_reconfigure_state, ECG_RECONFIGURE_IDLE);
+        }
+
         // wait for data to be ready
-        if (ecg_adc_read_data_ready() != 0) {
+        EcgDataReadyEdge data_ready_edge = {.sys_time_us = 0};
+        if (s_data_ready_isr_attached) {
+            // Without an edge the ADC is read anyway, so the sampling period
+            //  check below notices the stall and reinitializes the ADC.
+            if (ecg_drdy_wait(&s_data_ready, &data_ready_edge, sample_timeout_us) == 0) {
+                if (g_stopAcquisition) {
+                    break;
+                }
+                data_ready_edge.sys_time_us = 0;
+            }
+        } else if (ecg_adc_read_data_ready() != 0) {
             // don't worry about sleeping;
             //  usleep(100);
 
@@ -203,9 +430,12 @@ void *ecg_thread_getData(void *paramPtr) {
         }
 
         // Store the new data sample and its timestamp.
-        CetiEcgSample *current_ecg_sample = &shm_ecg->data[shm_ecg->page][shm_ecg->sample];
+        // On an edge, the sample is timestamped with the conversion rather
+        //  than when the I2C read of it finished.
+        CetiEcgSample *current_ecg_sample = &shm_ecg->data[atomic_load_explicit(&shm_ecg->page, memory_order_relaxed)][shm_ecg->sample];
+        current_ecg_sample->flags = 0; // still holds the flags of this slot's sample from the last page
         WTResult adc_status = current_ecg_sample->error = ecg_adc_raw_read_data(&current_ecg_sample->ecg_reading);
-        current_ecg_sample->sys_time_us = get_global_time_us();
+        current_ecg_sample->sys_time_us = (data_ready_edge.sys_time_us != 0) ? data_ready_edge.sys_time_us : get_global_time_us();
 
         // Update the previous timestamp, for checking whether new data is available.
         instantaneous_sampling_period_us = current_ecg_sample->sys_time_us - prev_ecg_adc_latest_reading_global_time_us;
@@ -222,6 +452,7 @@ void *ecg_thread_getData(void *paramPtr) {
             current_ecg_sample->error = lod_status;
         }
 #endif
+        current_ecg_sample->flags = ecg_file_sample_flags(current_ecg_sample, ENABLE_ECG_LOD);
 
         // Read the RTC.
         current_ecg_sample->rtc_time_s = getRtcCount();
@@ -256,14 +487,14 @@ void *ecg_thread_getData(void *paramPtr) {
         }
 
         if (consecutive_zero_ecg_count > ECG_ZEROCOUNT_THRESHOLD) {
-            ecg_zeros[shm_ecg->page][shm_ecg->sample] = 1;
+            current_ecg_sample->flags |= ECG_SAMPLE_FLAG_ZEROS;
             should_reinitialize = 1;
             CETI_DEBUG("ADC returned %ld zero readings in a row", consecutive_zero_ecg_count);
         }
 
         // Check if it took longer than expected to receive the sample (from the ADC and the GPIO expander combined).
-        if (instantaneous_sampling_period_us > ECG_SAMPLE_TIMEOUT_US && !first_sample) {
-            ecg_timeout[shm_ecg->page][shm_ecg->sample] = 1;
+        if (instantaneous_sampling_period_us > sample_timeout_us && !first_sample) {
+            current_ecg_sample->flags |= ECG_SAMPLE_FLAG_TIMEOUT;
             should_reinitialize = 1;
             CETI_DEBUG("XXX Reading a sample took %ld us", instantaneous_sampling_period_us);
         }
@@ -271,9 +502,13 @@ void *ecg_thread_getData(void *paramPtr) {
         // If the ADC or the GPIO expander had an error,
         //  wait a bit and then try to reconnect to them.
         if (should_reinitialize && !g_stopAcquisition) {
-            ecg_maybe_invalid[shm_ecg->page][shm_ecg->sample] = 1;
+            current_ecg_sample->flags |= ECG_SAMPLE_FLAG_MAYBE_INVALID;
             usleep(1000000);
             init_ecg_electronics();
+            if (s_data_ready_isr_attached) {
+                // the edges queued while waiting are about a second old
+                ecg_drdy_flush(&s_data_ready);
+            }
             usleep(10000);
             consecutive_zero_ecg_count = 0;
             first_sample = 1;
@@ -284,18 +519,16 @@ void *ecg_thread_getData(void *paramPtr) {
         // If the buffer has filled, switch to the other buffer
         //   (this will also trigger the writeData thread to write the previous buffer to a file).
         shm_ecg->sample++;
-        if (shm_ecg->sample == ECG_BUFFER_LENGTH) {
-            shm_ecg->sample = 0;
-            shm_ecg->page++;
-            shm_ecg->page %= ECG_NUM_BUFFERS;
-            sem_post(sem_ecg_page);
+        if ((uint32_t)shm_ecg->sample >= shm_ecg->page_length) {
+            ecg_finish_page();
         }
         sem_post(sem_ecg_sample);
 
         // // sleep duration shortened to 75% of sample interval to ensure ADC config still dictates sampling interval
+        // (not needed on edges, where the next wait blocks until the next conversion)
         int64_t elapsed_time = (get_global_time_us() - prev_ecg_adc_latest_reading_global_time_us);
-        if ((ECG_SAMPLING_PERIOD_US * 75 / 100 - elapsed_time) > 0) {
-            usleep(ECG_SAMPLING_PERIOD_US * 75 / 100 - elapsed_time);
+        if (!s_data_ready_isr_attached && (sampling_period_us * 75 / 100 - elapsed_time) > 0) {
+            usleep(sampling_period_us * 75 / 100 - elapsed_time);
         }
     }
     // Print the duration and the sampling rate.
@@ -305,6 +538,7 @@ void *ecg_thread_getData(void *paramPtr) {
              sample_index, duration_ms);
 
     // Clean up.
+    ecg_detach_data_ready_isr();
     ecg_adc_cleanup();
     munmap(shm_ecg, sizeof(CetiEcgBuffer));
     sem_close(sem_ecg_sample);
@@ -315,6 +549,7 @@ void *ecg_thread_getData(void *paramPtr) {
     sem_unlink(ECG_PAGE_SEM_NAME);
 
     g_ecg_thread_getData_is_running = 0;
+    ecg_reconfigure_abandon();
     CETI_LOG("Done!");
     return NULL;
 }
@@ -354,98 +589,91 @@ void *ecg_thread_writeData(void *paramPtr) {
     // Continuously wait for new data and then write it to the file.
     while (!g_stopAcquisition) {
         // Wait for new data to be in the buffer.
-        while (shm_ecg->page == ecg_buffer_select_toWrite && !g_stopAcquisition)
+        while (atomic_load_explicit(&shm_ecg->page, memory_order_acquire) == ecg_buffer_select_toWrite && !g_stopAcquisition)
             usleep(250000);
 
         if (!g_stopLogging) {
             // Write the last buffer to a file.
-            long ecg_data_file_size_b = 0;
-            ecg_data_file = fopen(ecg_data_filepath, "at");
-            if (ecg_data_file == NULL) {
+            if (ecg_data_fd < 0) {
                 CETI_LOG("failed to open data output file: %s", ecg_data_filepath);
                 init_ecg_data_file(0);
             } else {
                 // Determine the last index to write.
-                // During normal operation, will want to write the entire buffer
-                //  since the acquisition thread has just finished filling it.
-                int ecg_buffer_last_index_toWrite = ECG_BUFFER_LENGTH - 1;
+                // During normal operation, will want to write as much of the
+                //  buffer as the acquisition thread filled before moving on,
+                //  which is less than a full page after a reconfiguration.
+                CetiEcgPageInfo *page_info = &shm_ecg->pages[ecg_buffer_select_toWrite];
+                int ecg_buffer_sample_count = page_info->sample_count;
                 // If the program exited though, will want to write only as much
                 //  as the acquisition thread has filled.
-                if (shm_ecg->page == ecg_buffer_select_toWrite) {
-                    ecg_buffer_last_index_toWrite = shm_ecg->sample - 1;
-                    if (ecg_buffer_last_index_toWrite < 0)
-                        ecg_buffer_last_index_toWrite = 0;
+                if (atomic_load_explicit(&shm_ecg->page, memory_order_acquire) == ecg_buffer_select_toWrite) {
+                    ecg_buffer_sample_count = shm_ecg->sample;
                 }
-                // Write the buffer data to the file.
-                for (int ecg_buffer_index_toWrite = 0; ecg_buffer_index_toWrite <= ecg_buffer_last_index_toWrite; ecg_buffer_index_toWrite++) {
-                    CetiEcgSample *current_sample = &shm_ecg->data[ecg_buffer_select_toWrite][ecg_buffer_index_toWrite];
-                    // Write timing information.
-                    fprintf(ecg_data_file, "%lu", current_sample->sys_time_us);
-                    fprintf(ecg_data_file, ",%u", current_sample->rtc_time_s);
-                    // Write any notes.
-                    fprintf(ecg_data_file, ",");
-                    if (ecg_restarted[ecg_buffer_select_toWrite][ecg_buffer_index_toWrite]) {
-                        fprintf(ecg_data_file, "Restarted! | ");
-                    }
-                    if (ecg_new_log[ecg_buffer_select_toWrite][ecg_buffer_index_toWrite]) {
-                        fprintf(ecg_data_file, "New log file! | ");
-                    }
-                    // Note if a device error occured
-                    if (current_sample->error != WT_OK) {
-                        char err_str[512];
-                        fprintf(ecg_data_file, "ERROR(%s) | ", wt_strerror_r(current_sample->error, err_str, sizeof(err_str)));
-                    }
 
-                    if (ecg_zeros[ecg_buffer_select_toWrite][ecg_buffer_index_toWrite]) {
-                        fprintf(ecg_data_file, "ADC ZEROS | ");
-                    }
+                // A file has a single set of ADC settings, which its header
+                //  records, so start a new one if any of them was changed.
+                if ((ecg_buffer_sample_count > 0) && !ecg_format_equal(&page_info->format, &ecg_data_file_format)) {
+                    CETI_LOG("ECG settings changed to %u us, gain %u, %s reference, channel %u, starting a new file",
+                             page_info->format.sampling_period_us, page_info->format.gain,
+                             (page_info->format.vref == ECG_VREF_INTERNAL) ? "internal" : "external", page_info->format.channel);
+                    ecg_data_file_format = page_info->format;
+                    init_ecg_data_file(0);
+                }
 
-                    if (ecg_timeout[ecg_buffer_select_toWrite][ecg_buffer_index_toWrite]) {
-                        fprintf(ecg_data_file, "TIMEOUT | ");
+                // Mark the first sample written to a new file.
+                // The acquisition thread has moved on to the other page, so
+                //  this page's samples can be changed.
+                CetiEcgSample *samples = shm_ecg->data[ecg_buffer_select_toWrite];
+                if ((ecg_buffer_sample_count > 0) && (ecg_data_file_flags != 0)) {
+                    samples[0].flags |= ecg_data_file_flags;
+                    ecg_data_file_flags = 0;
+                }
+                for (int i = 0; i < ecg_buffer_sample_count; i++) {
+                    ecg_block_flags[i] = samples[i].flags;
+                }
+
+                // Compress the buffer, and check that it decompresses before
+                //  trusting it with the only copy of the data.
+                if (ecg_buffer_sample_count > 0) {
+                    size_t block_size = ecg_file_encode_block(ecg_block, samples, ecg_block_flags, ecg_buffer_sample_count, ECG_FILE_CODEC_RICE);
+                    if (ecg_file_verify_block(ecg_block, block_size, samples, ecg_block_flags, ecg_buffer_sample_count) != 0) {
+                        CETI_ERR("Compressed block did not decompress to its samples, writing it uncompressed");
+                        block_size = ecg_file_encode_block(ecg_block, samples, ecg_block_flags, ecg_buffer_sample_count, ECG_FILE_CODEC_VARINT);
                     }
-                    if (ecg_maybe_invalid[ecg_buffer_select_toWrite][ecg_buffer_index_toWrite]) {
-                        fprintf(ecg_data_file, "INVALID? | ");
+                    CETI_LOG("Compressed %d samples to %zu bytes (%.2f bytes/sample, ratio %.1f)",
+                             ecg_buffer_sample_count, block_size,
+                             (double)block_size / ecg_buffer_sample_count,
+                             (double)ecg_buffer_sample_count * sizeof(CetiEcgSample) / block_size);
+
+                    // Write the buffer to the file as one block.
+                    ssize_t written = write(ecg_data_fd, ecg_block, block_size);
+                    if (written != (ssize_t)block_size) {
+                        char err_str[512];
+                        CETI_ERR("Failed to write to %s: %s", ecg_data_filepath, (written < 0) ? strerror_r(errno, err_str, sizeof(err_str)) : "short write");
+                        if (!g_stopAcquisition)
+                            init_ecg_data_file(0);
+                    } else {
+                        ecg_data_file_size_b += block_size;
                     }
-
-                    // Write the sensor data.
-                    fprintf(ecg_data_file, ",%lu", current_sample->sample_index);
-                    fprintf(ecg_data_file, ",%d", current_sample->ecg_reading);
-#if ENABLE_ECG_LOD
-                    fprintf(ecg_data_file, ",%u", current_sample->leadsOff_reading_p);
-                    fprintf(ecg_data_file, ",%u", current_sample->leadsOff_reading_n);
-#else
-                    fprintf(ecg_data_file, ",,");
-#endif
-                    // Finish the row of data.
-                    fprintf(ecg_data_file, "\n");
                 }
 
-                // clear these note files
-                memset(ecg_restarted[ecg_buffer_select_toWrite], 0, ECG_BUFFER_LENGTH);
-                memset(ecg_new_log[ecg_buffer_select_toWrite], 0, ECG_BUFFER_LENGTH);
-                memset(ecg_zeros[ecg_buffer_select_toWrite], 0, ECG_BUFFER_LENGTH);
-                memset(ecg_timeout[ecg_buffer_select_toWrite], 0, ECG_BUFFER_LENGTH);
-                memset(ecg_maybe_invalid[ecg_buffer_select_toWrite], 0, ECG_BUFFER_LENGTH);
-
-                // Check the file size and close the file.
-                fseek(ecg_data_file, 0L, SEEK_END);
-                ecg_data_file_size_b = ftell(ecg_data_file);
-                fclose(ecg_data_file);
-
                 // If the file size limit has been reached, start a new file.
-                if ((ecg_data_file_size_b >= (long)(ECG_MAX_FILE_SIZE_MB) * 1024L * 1024L || ecg_data_file_size_b < 0) && !g_stopAcquisition)
+                if (ecg_data_file_size_b >= (long)(ECG_MAX_FILE_SIZE_MB) * 1024L * 1024L && !g_stopAcquisition)
                     init_ecg_data_file(0);
-
-                // CETI_LOG("Wrote %d entries in %lld us", ECG_BUFFER_LENGTH, get_global_time_us() - start_time_us);
             }
         }
 
         // Advance to the next buffer.
-        ecg_buffer_select_toWrite++;
-        ecg_buffer_select_toWrite %= ECG_NUM_BUFFERS;
+        // the acquisition thread may end the next page early once it sees
+        //  this one has been flushed
+        atomic_store_explicit(&ecg_buffer_select_toWrite, (ecg_buffer_select_toWrite + 1) % ECG_NUM_BUFFERS, memory_order_release);
     }
 
     // Clean up.
+    if (ecg_data_fd >= 0) {
+        close(ecg_data_fd);
+        ecg_data_fd = -1;
+    }
     g_ecg_thread_writeData_is_running = 0;
     CETI_LOG("Done!");
     return NULL;
@@ -17,6 +17,7 @@
 #include "../utils/logging.h"
 #include "../utils/timing.h" // for timestamps
 #include "ecg_helpers/ecg_adc.h"
+#include "ecg_helpers/ecg_config.h"
 #if ENABLE_ECG_LOD
 #include "ecg_helpers/ecg_lod.h"
 #endif
@@ -30,7 +31,7 @@
 //-----------------------------------------------------------------------------
 // Definitions/Configuration
 //-----------------------------------------------------------------------------
-#define ECG_MAX_FILE_SIZE_MB 1024 // Seems to log about 1GiB every 6.5 hours. Note that 2GB is the file size maximum for 32-bit systems
+#define ECG_MAX_FILE_SIZE_MB 1024 // The binary format logs about 20MB an hour at 1 kHz. Note that 2GB is the file size maximum for 32-bit systems
 
 #define ECG_SAMPLE_TIMEOUT_US 100000               // Max time to wait for ADC or GPIO expander data to be ready before reconnecting the ECG electronics
 #define ECG_ZEROCOUNT_THRESHOLD 100                // Max number of samples to tolerate consecutive 0s before reconnecting the ECG electronics
@@ -38,6 +39,9 @@
 
 #define ECG_I2C_BUS 0x00
 
+#define ECG_RECONFIGURE_POLL_US (10000)       // how often a settings change is checked on while waiting for it
+#define ECG_RECONFIGURE_TIMEOUT_US (5000000)  // longest a command waits for a settings change to take effect
+
 //-----------------------------------------------------------------------------
 // Global variables
 //-----------------------------------------------------------------------------
@@ -52,5 +56,7 @@ int init_ecg_electronics();
 int init_ecg_data_file();
 void *ecg_thread_getData(void *paramPtr);
 void *ecg_thread_writeData(void *paramPtr);
+int ecg_reconfigure_request(const EcgConfig *config);
+int ecg_reconfigure_wait(int64_t timeout_us);
 
 #endif // ECG_H
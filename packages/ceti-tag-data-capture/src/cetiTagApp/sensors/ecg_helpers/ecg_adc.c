@@ -276,6 +276,22 @@ int ecg_adc_stop_data_acquisition_via_interrupt() {
 #endif
 }
 
+/**
+ * @brief Attaches `isr` to the falling edge of the data-ready pin, or
+ * detaches the current callback if `isr` is NULL. Unlike
+ * ecg_adc_start_data_acquisition_via_interrupt(), the callback is left to
+ * read the ADC from its own thread.
+ *
+ * @return 0 on success, otherwise the pigpio error code
+ */
+int ecg_adc_set_data_ready_isr(gpioISRFunc_t isr) {
+#if ECG_ADC_DATA_READY_PIN >= 0
+    return gpioSetISRFunc(ECG_ADC_DATA_READY_PIN, FALLING_EDGE, 0, isr);
+#else
+    return PI_BAD_GPIO;
+#endif
+}
+
 // Define a callback function that will trigger with the data-ready pin interrupt.
 void ecg_adc_data_ready_interrupt_fn(int gpio, int level, uint32_t tick) {
 #if ECG_ADC_DATA_READY_USE_INTERRUPT
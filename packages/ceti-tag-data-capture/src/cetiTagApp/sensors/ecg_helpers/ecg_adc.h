@@ -97,6 +97,7 @@ void ecg_adc_powerDown();
 int ecg_adc_start_data_acquisition_via_interrupt();
 int ecg_adc_start_data_acquisition_via_timer();
 int ecg_adc_stop_data_acquisition_via_interrupt();
+int ecg_adc_set_data_ready_isr(gpioISRFunc_t isr);
 // Configuration
 void ecg_adc_set_gain(uint8_t gain);
 void ecg_adc_set_data_rate(int rate);
@@ -0,0 +1,39 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+// Description:  ECG settings read from the tag configuration file; kept free
+//               of hardware includes so utils/config.h can use it
+//-----------------------------------------------------------------------------
+#ifndef ECG_CONFIG_H
+#define ECG_CONFIG_H
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Typedefs
+//-----------------------------------------------------------------------------
+typedef enum ecg_acquisition_mode_e {
+    ECG_ACQUISITION_POLL = 0, // spin on the ADC data-ready line
+    ECG_ACQUISITION_EDGE = 1, // block on the data-ready falling edge
+} EcgAcquisitionMode;
+
+typedef enum ecg_vref_e {
+    ECG_VREF_INTERNAL = 0, // the ADC's 2.048 V reference
+    ECG_VREF_EXTERNAL = 1, // the reference supplied by the ECG board
+} EcgVoltageReference;
+
+typedef struct ecg_config_t {
+    EcgAcquisitionMode acquisition_mode;
+    uint32_t sample_rate; // samples per second, one of the ADC data rates: 20, 90, 330 or 1000
+    uint32_t gain;        // ADC gain, 1 or 4
+    EcgVoltageReference vref;
+    uint32_t channel; // ADC input sampled, 0 to 3
+} EcgConfig;
+
+#endif // ECG_CONFIG_H
@@ -0,0 +1,117 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+// The ADS1219 only holds its latest conversion, so the acquisition thread
+// reads the ADC once per wake-up and keeps the newest edge for the sample's
+// timestamp. Any older edges collected in the same wake-up were conversions
+// that were overwritten before they could be read and are counted as missed.
+//-----------------------------------------------------------------------------
+#include "ecg_drdy.h"
+
+#include "../../utils/seqlock.h"
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * @brief Prepares an empty edge queue.
+ *
+ * @return 0 on success, -1 if the semaphore could not be created
+ */
+int ecg_drdy_init(EcgDataReady *self) {
+    atomic_init(&self->sequence, 0);
+    memset(&self->latest, 0, sizeof(self->latest));
+    self->taken = 0;
+    self->missed = 0;
+    return (sem_init(&self->sem, 0, 0) == 0) ? 0 : -1;
+}
+
+void ecg_drdy_destroy(EcgDataReady *self) {
+    sem_destroy(&self->sem);
+}
+
+/**
+ * @brief Producer: records a data-ready edge as the newest one and wakes the
+ * acquisition thread. Safe to call from the GPIO callback; it never waits on
+ * the consumer, however far behind it has fallen.
+ */
+void ecg_drdy_push(EcgDataReady *self, int64_t sys_time_us, uint32_t tick) {
+    seqlock_write_begin(&self->sequence);
+    self->latest.edge.sys_time_us = sys_time_us;
+    self->latest.edge.tick = tick;
+    self->latest.count++;
+    seqlock_write_end(&self->sequence);
+    sem_post(&self->sem);
+}
+
+// Consumer: copies the newest edge, returning how many edges arrived since
+// the last one taken.
+static uint64_t ecg_drdy_take(EcgDataReady *self, EcgDataReadyEdge *latest) {
+    EcgDataReadyLatest snapshot;
+    if (seqlock_read(&self->sequence, &snapshot, &self->latest, sizeof(snapshot)) != 0) {
+        return 0; // the callback kept updating it, there will be another post
+    }
+    uint64_t count = snapshot.count - self->taken;
+    if (count > 0) {
+        *latest = snapshot.edge;
+        self->taken = snapshot.count;
+    }
+    return count;
+}
+
+// The posts of edges taken together are stale; discard them so the next
+// wait blocks. Any edge whose post is discarded here is still counted by the
+// next take before blocking.
+static void ecg_drdy_discard_posts(EcgDataReady *self) {
+    while (sem_trywait(&self->sem) == 0) {
+        continue;
+    }
+}
+
+/**
+ * @brief Consumer: blocks until at least one edge has arrived since the last
+ * wait, then takes all of them.
+ *
+ * @param latest receives the newest edge
+ * @param timeout_us longest time to wait for an edge
+ * @return number of edges taken, 0 if none arrived before the timeout
+ */
+int ecg_drdy_wait(EcgDataReady *self, EcgDataReadyEdge *latest, int64_t timeout_us) {
+    struct timespec deadline;
+    // monotonic, so the wait keeps its timeout when the system clock is set
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_us / 1000000;
+    deadline.tv_nsec += (timeout_us % 1000000) * 1000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    while (1) {
+        uint64_t count = ecg_drdy_take(self, latest);
+        if (count > 0) {
+            ecg_drdy_discard_posts(self);
+            self->missed += count - 1;
+            return (int)count;
+        }
+        if ((sem_clockwait(&self->sem, CLOCK_MONOTONIC, &deadline) != 0) && (errno != EINTR)) {
+            return 0;
+        }
+    }
+}
+
+/**
+ * @brief Consumer: forgets the edges that arrived since the last wait, so the
+ * next wait returns the first edge after the flush. Used after the ADC is
+ * restarted, when the edges before it no longer match a conversion.
+ */
+void ecg_drdy_flush(EcgDataReady *self) {
+    EcgDataReadyEdge discarded;
+    ecg_drdy_take(self, &discarded);
+    ecg_drdy_discard_posts(self);
+}
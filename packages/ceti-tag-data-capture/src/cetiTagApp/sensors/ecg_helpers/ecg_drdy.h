@@ -0,0 +1,53 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+// Description:  Hand-off of ADC data-ready edges from the GPIO callback to
+//               the ECG acquisition thread
+//-----------------------------------------------------------------------------
+#ifndef ECG_DRDY_H
+#define ECG_DRDY_H
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Typedefs
+//-----------------------------------------------------------------------------
+typedef struct {
+    int64_t sys_time_us; // global time when the callback saw the edge
+    uint32_t tick;       // pigpio tick of the edge
+} EcgDataReadyEdge;
+
+typedef struct {
+    EcgDataReadyEdge edge;
+    uint64_t count; // edges pushed up to and including `edge`
+} EcgDataReadyLatest;
+
+// The callback is the only producer and the acquisition thread the only
+// consumer. Only the newest edge is kept, guarded by a sequence lock, with
+// the number of edges pushed so far. Every pushed edge posts `sem` once.
+typedef struct {
+    _Atomic uint32_t sequence;
+    EcgDataReadyLatest latest; // producer only writes, under `sequence`
+    uint64_t taken;            // `latest.count` when the consumer last took edges (consumer only)
+    sem_t sem;
+    uint64_t missed; // conversions replaced by a newer one before they were read (consumer only)
+} EcgDataReady;
+
+//-----------------------------------------------------------------------------
+// Methods
+//-----------------------------------------------------------------------------
+int ecg_drdy_init(EcgDataReady *self);
+void ecg_drdy_destroy(EcgDataReady *self);
+void ecg_drdy_push(EcgDataReady *self, int64_t sys_time_us, uint32_t tick);
+int ecg_drdy_wait(EcgDataReady *self, EcgDataReadyEdge *latest, int64_t timeout_us);
+void ecg_drdy_flush(EcgDataReady *self);
+
+#endif // ECG_DRDY_H
@@ -1,5 +1,6 @@
 #include "../commands_internal.h"
 #include "../sensors/audio.h"
+#include "../utils/config.h" // for the current audio format
 
 #include <stdint.h>
 #include <stdlib.h>
@@ -33,6 +34,34 @@ int audioCmd_sampleRate(const char *args) {
     return 0;
 }
 
+int audioCmd_config(const char *args) {
+    char *end_ptr;
+    uint32_t sample_rate = strtoul(args, &end_ptr, 0);
+    if (end_ptr == args) {
+        fprintf(g_rsp_pipe, "Audio is %d kHz %d-bit\n", g_config.audio.sample_rate, g_config.audio.bit_depth);
+        return 0;
+    }
+    // the bit depth is optional and kept if left out
+    const char *depth_str = end_ptr;
+    uint32_t bit_depth = strtoul(depth_str, &end_ptr, 0);
+    if (end_ptr == depth_str) {
+        bit_depth = g_config.audio.bit_depth;
+    }
+
+    if (audio_reconfigure_request((AudioSampleRate)sample_rate, (AudioBitDepth)bit_depth) != 0) {
+        fprintf(g_rsp_pipe, "Error can't change audio to %u kHz %u-bit.\n", sample_rate, bit_depth);
+        fprintf(g_rsp_pipe, "Usage: `audio config [(48 | 96 | 192) [(16 | 24)]]`\n");
+        return -1;
+    }
+    int64_t gap_us;
+    if (audio_reconfigure_wait(AUDIO_RECONFIGURE_TIMEOUT_US, &gap_us) != 0) {
+        fprintf(g_rsp_pipe, "Failed to change audio format, audio is %d kHz %d-bit\n", g_config.audio.sample_rate, g_config.audio.bit_depth);
+        return -1;
+    }
+    fprintf(g_rsp_pipe, "Audio set to %d kHz %d-bit, %.1f ms of audio lost\n", g_config.audio.sample_rate, g_config.audio.bit_depth, gap_us / 1000.0); // echo it
+    return 0;
+}
+
 int audioCmd_start(const char *args) {
     start_audio_acq();
     fprintf(g_rsp_pipe, "Audio acquisition Started\n"); // echo it
@@ -45,6 +74,16 @@ int audioCmd_stop(const char *args) {
     return 0;
 }
 
+int audioCmd_latency(const char *args) {
+    audio_print_spi_latency(g_rsp_pipe);
+    return 0;
+}
+
+int audioCmd_stats(const char *args) {
+    audio_print_stats(g_rsp_pipe);
+    return 0;
+}
+
 int audioCmd_simulate_overflow(const char *args) {
     g_audio_overflow_detected = 1;
     fprintf(g_rsp_pipe, "Simulated audio overflow\n"); // echo it
@@ -61,7 +100,10 @@ const CommandDescription audio_subcommand_list[] = {
     {.name = STR_FROM("start"), .description = "Start audio acquistion", .parse = audioCmd_start},
     {.name = STR_FROM("stop"), .description = "Stop audio acquistion", .parse = audioCmd_stop},
     {.name = STR_FROM("sampleRate"), .description = "Set audio sampling rate in kHz. Useage: `audio sampleRate (48 | 96 | 192)`", .parse = audioCmd_sampleRate},
+    {.name = STR_FROM("config"), .description = "Change the audio sample rate (kHz) and bit depth without restarting, or print them. Usage: `audio config [(48 | 96 | 192) [(16 | 24)]]`", .parse = audioCmd_config},
     {.name = STR_FROM("reset"), .description = "Reset audio HW FIFO", .parse = audioCmd_reset},
+    {.name = STR_FROM("latency"), .description = "Print histogram of data available to SPI read complete latency", .parse = audioCmd_latency},
+    {.name = STR_FROM("stats"), .description = "Print audio pipeline throughput, timing and backlog statistics", .parse = audioCmd_stats},
 #ifdef DEBUG
     {.name = STR_FROM("forceOverflow"), .description = "Simulate an audio overflow", .parse = audioCmd_simulate_overflow},
     {.name = STR_FROM("simulateOverflow"), .description = "Force an audio overflow", .parse = audioCmd_force_overflow},
@@ -0,0 +1,89 @@
+#include "../commands_internal.h"
+#include "../sensors/ecg.h"
+#include "../utils/config.h" // for the current ECG settings
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <strings.h>
+
+static void ecgCmd_print_config(void) {
+    fprintf(g_rsp_pipe, "ECG is %u Hz, gain %u, %s reference, channel %u\n",
+            g_config.ecg.sample_rate, g_config.ecg.gain,
+            (g_config.ecg.vref == ECG_VREF_INTERNAL) ? "internal" : "external",
+            g_config.ecg.channel);
+}
+
+// Hands `config` to the acquisition thread and reports how it went.
+static int ecgCmd_apply(const EcgConfig *config, const char *usage) {
+    if (ecg_reconfigure_request(config) != 0) {
+        fprintf(g_rsp_pipe, "Error can't change ECG settings.\n");
+        fprintf(g_rsp_pipe, "Usage: `%s`\n", usage);
+        return -1;
+    }
+    if (ecg_reconfigure_wait(ECG_RECONFIGURE_TIMEOUT_US) != 0) {
+        fprintf(g_rsp_pipe, "Failed to change ECG settings, ");
+        ecgCmd_print_config();
+        return -1;
+    }
+    fprintf(g_rsp_pipe, "ECG set to %u Hz, gain %u, %s reference, channel %u\n",
+            g_config.ecg.sample_rate, g_config.ecg.gain,
+            (g_config.ecg.vref == ECG_VREF_INTERNAL) ? "internal" : "external",
+            g_config.ecg.channel); // echo it
+    return 0;
+}
+
+int ecgCmd_config(const char *args) {
+    ecgCmd_print_config();
+    return 0;
+}
+
+int ecgCmd_sampleRate(const char *args) {
+    EcgConfig config = g_config.ecg;
+    config.sample_rate = strtoul(args, NULL, 0);
+    return ecgCmd_apply(&config, "ecg sampleRate (20 | 90 | 330 | 1000)");
+}
+
+int ecgCmd_gain(const char *args) {
+    EcgConfig config = g_config.ecg;
+    config.gain = strtoul(args, NULL, 0);
+    return ecgCmd_apply(&config, "ecg gain (1 | 4)");
+}
+
+int ecgCmd_vref(const char *args) {
+    EcgConfig config = g_config.ecg;
+    while (*args == ' ') {
+        args++;
+    }
+    if (strncasecmp(args, "internal", 8) == 0) {
+        config.vref = ECG_VREF_INTERNAL;
+    } else if (strncasecmp(args, "external", 8) == 0) {
+        config.vref = ECG_VREF_EXTERNAL;
+    } else {
+        fprintf(g_rsp_pipe, "Error invalid voltage reference.\n");
+        fprintf(g_rsp_pipe, "Usage: `ecg vref (internal | external)`\n");
+        return -1;
+    }
+    return ecgCmd_apply(&config, "ecg vref (internal | external)");
+}
+
+int ecgCmd_channel(const char *args) {
+    EcgConfig config = g_config.ecg;
+    char *end_ptr;
+    config.channel = strtoul(args, &end_ptr, 0);
+    if (end_ptr == args) {
+        fprintf(g_rsp_pipe, "Error invalid channel.\n");
+        fprintf(g_rsp_pipe, "Usage: `ecg channel (0 | 1 | 2 | 3)`\n");
+        return -1;
+    }
+    return ecgCmd_apply(&config, "ecg channel (0 | 1 | 2 | 3)");
+}
+
+const CommandDescription ecg_subcommand_list[] = {
+    {.name = STR_FROM("config"), .description = "Print the ECG sample rate, gain, voltage reference and channel", .parse = ecgCmd_config},
+    {.name = STR_FROM("sampleRate"), .description = "Set ECG sampling rate in Hz without restarting. Usage: `ecg sampleRate (20 | 90 | 330 | 1000)`", .parse = ecgCmd_sampleRate},
+    {.name = STR_FROM("gain"), .description = "Set ECG ADC gain. Usage: `ecg gain (1 | 4)`", .parse = ecgCmd_gain},
+    {.name = STR_FROM("vref"), .description = "Set ECG ADC voltage reference. Usage: `ecg vref (internal | external)`", .parse = ecgCmd_vref},
+    {.name = STR_FROM("channel"), .description = "Set ECG ADC input channel. Usage: `ecg channel (0 | 1 | 2 | 3)`", .parse = ecgCmd_channel},
+};
+
+const size_t ecg_subcommand_list_size = sizeof(ecg_subcommand_list) / sizeof(*ecg_subcommand_list);
@@ -7,16 +7,23 @@
 
 #include "systemMonitor.h"
 
+#include "cetiTag.h"   // for the audio stats page
 #include "launcher.h" // for g_stopAcquisition, sampling rate, data filepath, and CPU affinity
+#include "utils/histogram.h"
 #include "utils/logging.h"
+#include "utils/seqlock.h"
 #include "utils/timing.h"
 
+#include <fcntl.h>
 #include <pthread.h> // to set CPU affinity
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/sysinfo.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 //-----------------------------------------------------------------------------
 // Initialization
@@ -41,6 +48,9 @@ static int cetiApp_pid = -1;
 int g_systemMonitor_thread_tid = -1;
 int g_audio_thread_spi_tid = -1;
 int g_audio_thread_writeData_tid = -1;
+int g_audio_thread_decimate_tid = -1;
+int g_audio_thread_detectClicks_tid = -1;
+int g_audio_thread_levels_tid = -1;
 int g_ecg_thread_getData_tid = -1;
 int g_ecg_thread_writeData_tid = -1;
 int g_imu_thread_tid = -1;
@@ -53,6 +63,8 @@ int g_command_thread_tid = -1;
 int g_rtc_thread_tid = -1;
 int g_ecg_lod_thread_tid = -1;
 int g_stateMachine_thread_tid = -1;
+// Audio pipeline stats, sampled from shared memory like any other process would.
+static const CetiAudioStats *s_audio_stats = NULL;
 // Writing data to a log file.
 static FILE *systemMonitor_data_file = NULL;
 static char systemMonitor_data_file_notes[256] = "";
@@ -87,6 +99,12 @@ static const char *systemMonitor_data_file_headers[] = {
     "SysLog Size [KB]",
     "CPU Temperature [C]",
     "GPU Temperature [C]",
+    "Audio Blocks Read",
+    "Audio Blocks Dropped",
+    "Audio SPI Read p99 [us]",
+    "Audio Writer Lag p99 [blocks]",
+    "Audio Write Chunk p99 [us]",
+    "Audio Written [B]",
 };
 static const int num_systemMonitor_data_file_headers = sizeof(systemMonitor_data_file_headers) / sizeof(*systemMonitor_data_file_headers);
 
@@ -154,6 +172,9 @@ void *systemMonitor_thread(void *paramPtr) {
             CETI_LOG("Thread IDs:");
             CETI_LOG(" %6d: audio_thread_spi", g_audio_thread_spi_tid);
             CETI_LOG(" %6d: audio_thread_writeData", g_audio_thread_writeData_tid);
+            CETI_LOG(" %6d: audio_thread_decimate", g_audio_thread_decimate_tid);
+            CETI_LOG(" %6d: audio_thread_detectClicks", g_audio_thread_detectClicks_tid);
+            CETI_LOG(" %6d: audio_thread_levels", g_audio_thread_levels_tid);
             CETI_LOG(" %6d: ecg_thread_getData", g_ecg_thread_getData_tid);
             CETI_LOG(" %6d: ecg_thread_writeData", g_ecg_thread_writeData_tid);
             CETI_LOG(" %6d: imu_thread", g_imu_thread_tid);
@@ -221,6 +242,7 @@ void *systemMonitor_thread(void *paramPtr) {
                     fprintf(systemMonitor_data_file, ",%ld", get_syslog_size_kb());
                     fprintf(systemMonitor_data_file, ",%f", get_cpu_temperature_c());
                     fprintf(systemMonitor_data_file, ",%f", get_gpu_temperature_c());
+                    write_audio_stats(systemMonitor_data_file);
                     // Finish the row of data and close the file.
                     fprintf(systemMonitor_data_file, "\n");
                     fclose(systemMonitor_data_file);
@@ -245,6 +267,41 @@ void *systemMonitor_thread(void *paramPtr) {
 // Helpers
 //------------------------------------------
 
+// Audio
+//------------------------------------------
+/**
+ * @brief Writes the audio pipeline columns. The stats page is mapped once the
+ * audio threads have created it; the columns are left empty until then.
+ */
+void write_audio_stats(FILE *data_file) {
+    if (s_audio_stats == NULL) {
+        int shm_fd = shm_open(AUDIO_STATS_SHM_NAME, O_RDONLY, 0444);
+        struct stat shm_stat;
+        if ((shm_fd >= 0) && (fstat(shm_fd, &shm_stat) == 0) && (shm_stat.st_size >= sizeof(CetiAudioStats))) {
+            void *address = mmap(NULL, sizeof(CetiAudioStats), PROT_READ, MAP_SHARED, shm_fd, 0);
+            if (address != MAP_FAILED) {
+                s_audio_stats = address;
+            }
+        }
+        if (shm_fd >= 0) {
+            close(shm_fd);
+        }
+    }
+
+    CetiAudioSpiStats spi;
+    CetiAudioWriterStats writer;
+    if ((s_audio_stats == NULL) || (s_audio_stats->version != AUDIO_STATS_VERSION) || (seqlock_read(&s_audio_stats->spi.sequence, &spi, &s_audio_stats->spi, sizeof(spi)) != 0) || (seqlock_read(&s_audio_stats->writer.sequence, &writer, &s_audio_stats->writer, sizeof(writer)) != 0)) {
+        fprintf(data_file, ",,,,,,");
+        return;
+    }
+    fprintf(data_file, ",%lu", spi.blocks_read);
+    fprintf(data_file, ",%lu", spi.blocks_dropped);
+    fprintf(data_file, ",%u", histogram_percentile(&spi.read_us, 99.0));
+    fprintf(data_file, ",%u", histogram_percentile(&spi.lag_blocks, 99.0));
+    fprintf(data_file, ",%u", histogram_percentile(&writer.chunk_us, 99.0));
+    fprintf(data_file, ",%lu", writer.bytes_written);
+}
+
 // Memory
 //------------------------------------------
 
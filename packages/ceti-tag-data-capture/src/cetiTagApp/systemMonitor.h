@@ -11,6 +11,7 @@
 //-----------------------------------------------------------------------------
 // Includes
 //-----------------------------------------------------------------------------
+#include <stdio.h> // for FILE
 
 //-----------------------------------------------------------------------------
 // Definitions/Configuration
@@ -42,6 +43,7 @@ int get_cpu_id_for_tid(int tid);
 float get_cpu_temperature_c();
 float get_gpu_temperature_c();
 int system_call_with_output(char *cmd, char *result);
+void write_audio_stats(FILE *data_file);
 void *systemMonitor_thread(void *paramPtr);
 
 //-----------------------------------------------------------------------------
@@ -50,6 +52,9 @@ void *systemMonitor_thread(void *paramPtr);
 extern int g_systemMonitor_thread_is_running;
 extern int g_audio_thread_spi_tid;
 extern int g_audio_thread_writeData_tid;
+extern int g_audio_thread_decimate_tid;
+extern int g_audio_thread_detectClicks_tid;
+extern int g_audio_thread_levels_tid;
 extern int g_ecg_thread_getData_tid;
 extern int g_ecg_thread_writeData_tid;
 extern int g_imu_thread_tid;
@@ -0,0 +1,158 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+// Self-describing raw audio file format. The writer lives in
+// sensors/audio.c; the reader methods here only need the file, so they can be
+// used by post-processing tools as well as the tag.
+//-----------------------------------------------------------------------------
+#include "audio_file.h"
+
+#include "../_versioning.h"
+#include "../cetiTag.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+_Static_assert(sizeof(AudioFileHeader) == 136, "audio file header layout changed");
+_Static_assert(sizeof(AudioFileIndexEntry) == 16, "audio file index entry layout changed");
+
+/**
+ * @brief Index entries needed for a file that is closed once it holds at
+ * least `file_size_bytes` of samples. Files grow a whole group at a time.
+ */
+uint32_t audio_file_index_capacity(size_t file_size_bytes) {
+    size_t groups = (file_size_bytes + AUDIO_LCM_BYTES - 1) / AUDIO_LCM_BYTES;
+    return (uint32_t)(groups * AUDIO_BLOCKS_PER_GROUP);
+}
+
+void audio_file_header_init(AudioFileHeader *header, const AudioConfig *config, uint32_t sample_rate_hz, uint16_t channels, uint32_t index_capacity) {
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, AUDIO_FILE_MAGIC, sizeof(header->magic));
+    header->version = AUDIO_FILE_VERSION;
+    header->header_size = sizeof(AudioFileHeader);
+    header->index_offset = AUDIO_FILE_INDEX_OFFSET;
+    header->data_offset = AUDIO_FILE_DATA_OFFSET(index_capacity);
+    header->index_capacity = index_capacity;
+    header->block_count = 0;
+    header->block_size = SPI_BLOCK_SIZE;
+    header->sample_rate_hz = sample_rate_hz;
+    header->bit_depth = config->bit_depth;
+    header->channels = channels;
+    header->filter_type = config->filter_type;
+    header->acquisition_mode = config->acquisition_mode;
+    header->buffer_duration_s = config->buffer_duration_s;
+    strncpy(header->firmware_version, CETI_VERSION, sizeof(header->firmware_version) - 1);
+}
+
+/**
+ * @brief Checks that `header` describes a file of this format whose index
+ * fits in `file_length` bytes.
+ *
+ * @return 0 if valid, -1 otherwise
+ */
+int audio_file_header_validate(const AudioFileHeader *header, size_t file_length) {
+    if (file_length < AUDIO_FILE_INDEX_OFFSET) {
+        return -1;
+    }
+    if (memcmp(header->magic, AUDIO_FILE_MAGIC, sizeof(header->magic)) != 0) {
+        return -1;
+    }
+    if ((header->version != AUDIO_FILE_VERSION) || (header->header_size != sizeof(AudioFileHeader))) {
+        return -1;
+    }
+    if ((header->block_size == 0) || (header->block_count > header->index_capacity)) {
+        return -1;
+    }
+    if (header->index_offset + (uint64_t)header->index_capacity * sizeof(AudioFileIndexEntry) > header->data_offset) {
+        return -1;
+    }
+    if (header->data_offset > file_length) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Binary search of the index for the block holding `time_us`.
+ *
+ * @return index of the last block captured at or before `time_us`, or -1 if
+ * `time_us` is before the first block
+ */
+int64_t audio_file_find_block(const AudioFileIndexEntry *index, uint32_t block_count, int64_t time_us) {
+    int64_t low = 0;
+    int64_t high = (int64_t)block_count - 1;
+    int64_t found = -1;
+    while (low <= high) {
+        int64_t middle = low + (high - low) / 2;
+        if (index[middle].sys_time_us <= time_us) {
+            found = middle;
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief Memory maps a raw audio file read-only.
+ *
+ * @return 0 on success, -1 if the file could not be mapped or is not a raw
+ * audio file
+ */
+int audio_file_map(AudioFileMap *map, const char *path) {
+    memset(map, 0, sizeof(*map));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat file_stat;
+    if ((fstat(fd, &file_stat) != 0) || (file_stat.st_size < AUDIO_FILE_INDEX_OFFSET)) {
+        close(fd);
+        return -1;
+    }
+    void *address = mmap(NULL, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) {
+        return -1;
+    }
+
+    const AudioFileHeader *header = address;
+    if (audio_file_header_validate(header, file_stat.st_size) != 0) {
+        munmap(address, file_stat.st_size);
+        return -1;
+    }
+    map->address = address;
+    map->length = file_stat.st_size;
+    map->header = header;
+    map->index = (const AudioFileIndexEntry *)((const uint8_t *)address + header->index_offset);
+
+    // a file that was not closed cleanly may hold fewer blocks than recorded
+    uint64_t blocks_present = (map->length - header->data_offset) / header->block_size;
+    map->block_count = (blocks_present < header->block_count) ? (uint32_t)blocks_present : header->block_count;
+    return 0;
+}
+
+void audio_file_unmap(AudioFileMap *map) {
+    if (map->address != NULL) {
+        munmap(map->address, map->length);
+    }
+    memset(map, 0, sizeof(*map));
+}
+
+/**
+ * @brief Samples of block `block` of a mapped file, NULL if out of range.
+ */
+const uint8_t *audio_file_block(const AudioFileMap *map, uint32_t block) {
+    if (block >= map->block_count) {
+        return NULL;
+    }
+    return (const uint8_t *)map->address + map->header->data_offset + (size_t)block * map->header->block_size;
+}
@@ -0,0 +1,109 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+#ifndef UTILS_AUDIO_FILE_H
+#define UTILS_AUDIO_FILE_H
+
+#include "../sensors/audio.h" // for AudioConfig
+
+#include <stddef.h>
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Definitions/Configurations
+//-----------------------------------------------------------------------------
+// Raw audio file layout, all fields little-endian:
+//
+//   0                  AudioFileHeader, padded to AUDIO_FILE_ALIGNMENT
+//   index_offset       index_capacity AudioFileIndexEntry, one per block
+//   data_offset        blocks of block_size bytes of interleaved big-endian
+//                      samples, exactly as read from the FPGA
+//
+// Block n is at data_offset + n * block_size and was captured at
+// index[n].sys_time_us. Only the first block_count blocks and index entries
+// are valid; block_count is updated as the file is written.
+#define AUDIO_FILE_MAGIC "CETIAUD"
+#define AUDIO_FILE_VERSION (1)
+#define AUDIO_FILE_ALIGNMENT (4096) // keeps the samples aligned for O_DIRECT writes
+#define AUDIO_FILE_INDEX_OFFSET (AUDIO_FILE_ALIGNMENT)
+#define AUDIO_FILE_DATA_OFFSET(index_capacity) \
+    (((AUDIO_FILE_INDEX_OFFSET + (size_t)(index_capacity) * sizeof(AudioFileIndexEntry)) + AUDIO_FILE_ALIGNMENT - 1) & ~((size_t)AUDIO_FILE_ALIGNMENT - 1))
+
+// Click index file layout, all fields little-endian: an AudioClickFileHeader
+// followed by CetiAudioClick records (cetiTag.h) in detection order. Records
+// are appended for as long as the tag runs.
+#define AUDIO_CLICK_FILE_MAGIC "CETICLK"
+#define AUDIO_CLICK_FILE_VERSION (1)
+
+//-----------------------------------------------------------------------------
+// Typedefs
+//-----------------------------------------------------------------------------
+typedef struct {
+    char magic[8];              // AUDIO_FILE_MAGIC
+    uint32_t version;           // AUDIO_FILE_VERSION
+    uint32_t header_size;       // sizeof(AudioFileHeader)
+    uint64_t index_offset;      // byte offset of the block index
+    uint64_t data_offset;       // byte offset of the first block
+    int64_t start_time_us;      // capture time of the first block
+    uint32_t index_capacity;    // index entries reserved, the most blocks the file can hold
+    uint32_t block_count;       // blocks written
+    uint32_t block_size;        // bytes per block
+    uint32_t sample_rate_hz;
+    uint16_t bit_depth;
+    uint16_t channels;
+    uint8_t filter_type;        // AudioFilterType
+    uint8_t acquisition_mode;   // AudioAcquisitionMode
+    uint8_t reserved1[2];
+    uint32_t buffer_duration_s; // AudioConfig.buffer_duration_s
+    uint32_t reserved2;
+    char firmware_version[64];  // CETI_VERSION of the recording firmware
+} AudioFileHeader;
+
+typedef struct {
+    int64_t sys_time_us; // time the SPI read of the block started
+    uint32_t rtc_count;  // RTC seconds when the block was read
+    uint32_t flags;      // AUDIO_BLOCK_FLAG_* (cetiTag.h)
+} AudioFileIndexEntry;
+
+typedef struct {
+    char magic[8];          // AUDIO_CLICK_FILE_MAGIC
+    uint32_t version;       // AUDIO_CLICK_FILE_VERSION
+    uint32_t header_size;   // sizeof(AudioClickFileHeader)
+    uint32_t record_size;   // sizeof(CetiAudioClick)
+    uint32_t sample_rate_hz;
+    uint16_t channels;
+    uint16_t reserved1;
+    uint32_t band_low_hz;   // AudioClickConfig the clicks were detected with
+    uint32_t band_high_hz;
+    float threshold_db;
+    uint32_t holdoff_ms;
+    uint32_t reserved2;
+} AudioClickFileHeader;
+
+typedef struct {
+    void *address;
+    size_t length;
+    const AudioFileHeader *header;
+    const AudioFileIndexEntry *index;
+    uint32_t block_count; // blocks present, which may be fewer than header->block_count if the file was cut short
+} AudioFileMap;
+
+//-----------------------------------------------------------------------------
+// Methods
+//-----------------------------------------------------------------------------
+// writing
+uint32_t audio_file_index_capacity(size_t file_size_bytes);
+void audio_file_header_init(AudioFileHeader *header, const AudioConfig *config, uint32_t sample_rate_hz, uint16_t channels, uint32_t index_capacity);
+
+// reading
+int audio_file_header_validate(const AudioFileHeader *header, size_t file_length);
+int64_t audio_file_find_block(const AudioFileIndexEntry *index, uint32_t block_count, int64_t time_us);
+int audio_file_map(AudioFileMap *map, const char *path);
+void audio_file_unmap(AudioFileMap *map);
+const uint8_t *audio_file_block(const AudioFileMap *map, uint32_t block);
+
+#endif // UTILS_AUDIO_FILE_H
@@ -7,6 +7,7 @@
 //               Michael Salino-Hugg, [TODO: Add other contributors here]
 //-----------------------------------------------------------------------------
 #include "config.h"
+#include "../cetiTag.h" // for AUDIO_MAX_CHANNELS
 #include "../recovery.h"
 #include "logging.h"
 #include "str.h" // for str, strtoidentifier(), strtobool()
@@ -15,6 +16,7 @@
 #include <errno.h>  //for error detection for string conversion
 #include <stdio.h>  // for FILE
 #include <stdlib.h> // for atof, atol, etc
+#include <strings.h> // for strncasecmp
 #include <time.h>
 
 /**************************
@@ -24,7 +26,51 @@ TagConfig g_config = {
     .audio = {
         .filter_type = CONFIG_DEFAULT_AUDIO_FILTER_TYPE,
         .sample_rate = CONFIG_DEFAULT_AUDIO_SAMPLE_RATE,
-        .bit_depth = CONFIG_DEFAULT_AUDIO_SAMPLE_RATE,
+        .bit_depth = CONFIG_DEFAULT_AUDIO_BIT_DEPTH,
+        .channels = CONFIG_DEFAULT_AUDIO_CHANNELS,
+        .channel_mask = CONFIG_DEFAULT_AUDIO_CHANNEL_MASK,
+        .buffer_duration_s = CONFIG_DEFAULT_AUDIO_BUFFER_DURATION_S,
+        .acquisition_mode = CONFIG_DEFAULT_AUDIO_ACQUISITION_MODE,
+        .flac_workers = CONFIG_DEFAULT_AUDIO_FLAC_WORKERS,
+        .flac_cpu_mask = CONFIG_DEFAULT_AUDIO_FLAC_CPU_MASK,
+        .flac_segment_s = CONFIG_DEFAULT_AUDIO_FLAC_SEGMENT_S,
+        .flac_tuning = {
+            .compression_level = CONFIG_DEFAULT_AUDIO_FLAC_COMPRESSION_LEVEL,
+            .blocksize = CONFIG_DEFAULT_AUDIO_FLAC_BLOCKSIZE,
+            .mid_side = CONFIG_DEFAULT_AUDIO_FLAC_MID_SIDE,
+            .loose_mid_side = CONFIG_DEFAULT_AUDIO_FLAC_LOOSE_MID_SIDE,
+            .apodization = CONFIG_DEFAULT_AUDIO_FLAC_APODIZATION,
+        },
+        .raw_fsync_s = CONFIG_DEFAULT_AUDIO_RAW_FSYNC_S,
+        .source = CONFIG_DEFAULT_AUDIO_SOURCE,
+        .sim = {
+            .file = CONFIG_DEFAULT_AUDIO_SIM_FILE,
+            .tone_hz = CONFIG_DEFAULT_AUDIO_SIM_TONE_HZ,
+            .jitter_us = CONFIG_DEFAULT_AUDIO_SIM_JITTER_US,
+            .overflow_interval_s = CONFIG_DEFAULT_AUDIO_SIM_OVERFLOW_S,
+        },
+        .decimated_rate_khz = CONFIG_DEFAULT_AUDIO_DECIMATED_RATE_KHZ,
+        .clicks = {
+            .enabled = CONFIG_DEFAULT_AUDIO_CLICKS_ENABLED,
+            .band_low_hz = CONFIG_DEFAULT_AUDIO_CLICK_LOW_HZ,
+            .band_high_hz = CONFIG_DEFAULT_AUDIO_CLICK_HIGH_HZ,
+            .threshold_db = CONFIG_DEFAULT_AUDIO_CLICK_THRESHOLD_DB,
+            .holdoff_ms = CONFIG_DEFAULT_AUDIO_CLICK_HOLDOFF_MS,
+        },
+        .levels_enabled = CONFIG_DEFAULT_AUDIO_LEVELS_ENABLED,
+        .duty = {
+            .mode = CONFIG_DEFAULT_AUDIO_DUTY_CYCLE_MODE,
+            .pretrigger_s = CONFIG_DEFAULT_AUDIO_DUTY_PRETRIGGER_S,
+            .hold_s = CONFIG_DEFAULT_AUDIO_DUTY_HOLD_S,
+            .silence_s = CONFIG_DEFAULT_AUDIO_DUTY_SILENCE_S,
+        },
+    },
+    .ecg = {
+        .acquisition_mode = CONFIG_DEFAULT_ECG_ACQUISITION_MODE,
+        .sample_rate = CONFIG_DEFAULT_ECG_SAMPLE_RATE,
+        .gain = CONFIG_DEFAULT_ECG_GAIN,
+        .vref = CONFIG_DEFAULT_ECG_VREF,
+        .channel = CONFIG_DEFAULT_ECG_CHANNEL,
     },
     .surface_pressure = CONFIG_DEFAULT_SURFACE_PRESSURE_BAR, // depth_m is roughly 10*pressure_bar
     .dive_pressure = CONFIG_DEFAULT_DIVE_PRESSURE_BAR,       // depth_m is roughly 10*pressure_bar
@@ -55,6 +101,40 @@ typedef struct {
 static ConfigError __config_parse_audio_bitdepth(const char *_String);
 static ConfigError __config_parse_audio_filter_type(const char *_String);
 static ConfigError __config_parse_audio_sample_rate(const char *_String);
+static ConfigError __config_parse_audio_channels(const char *_String);
+static ConfigError __config_parse_audio_channel_mask(const char *_String);
+static ConfigError __config_parse_audio_buffer_duration(const char *_String);
+static ConfigError __config_parse_audio_acquisition_mode(const char *_String);
+static ConfigError __config_parse_audio_flac_workers(const char *_String);
+static ConfigError __config_parse_audio_flac_cpus(const char *_String);
+static ConfigError __config_parse_audio_flac_segment(const char *_String);
+static ConfigError __config_parse_audio_flac_level(const char *_String);
+static ConfigError __config_parse_audio_flac_blocksize(const char *_String);
+static ConfigError __config_parse_audio_flac_mid_side(const char *_String);
+static ConfigError __config_parse_audio_flac_loose_mid_side(const char *_String);
+static ConfigError __config_parse_audio_flac_apodization(const char *_String);
+static ConfigError __config_parse_audio_raw_fsync(const char *_String);
+static ConfigError __config_parse_audio_source(const char *_String);
+static ConfigError __config_parse_audio_sim_file(const char *_String);
+static ConfigError __config_parse_audio_sim_tone(const char *_String);
+static ConfigError __config_parse_audio_sim_jitter(const char *_String);
+static ConfigError __config_parse_audio_sim_overflow(const char *_String);
+static ConfigError __config_parse_audio_decimated_rate(const char *_String);
+static ConfigError __config_parse_audio_clicks(const char *_String);
+static ConfigError __config_parse_audio_click_low(const char *_String);
+static ConfigError __config_parse_audio_click_high(const char *_String);
+static ConfigError __config_parse_audio_click_threshold(const char *_String);
+static ConfigError __config_parse_audio_click_holdoff(const char *_String);
+static ConfigError __config_parse_audio_levels(const char *_String);
+static ConfigError __config_parse_audio_duty_cycle(const char *_String);
+static ConfigError __config_parse_audio_duty_pretrigger(const char *_String);
+static ConfigError __config_parse_audio_duty_hold(const char *_String);
+static ConfigError __config_parse_audio_duty_silence(const char *_String);
+static ConfigError __config_parse_ecg_acquisition_mode(const char *_String);
+static ConfigError __config_parse_ecg_sample_rate(const char *_String);
+static ConfigError __config_parse_ecg_gain(const char *_String);
+static ConfigError __config_parse_ecg_vref(const char *_String);
+static ConfigError __config_parse_ecg_channel(const char *_String);
 static ConfigError __config_parse_surface_pressure(const char *_String);
 static ConfigError __config_parse_dive_pressure(const char *_String);
 static ConfigError __config_parse_release_voltage(const char *_String);
@@ -88,6 +168,40 @@ const ConfigList config_keys[] = {
     {.key = STR_FROM("audio_filter"), .parse = __config_parse_audio_filter_type},
     {.key = STR_FROM("audio_bitdepth"), .parse = __config_parse_audio_bitdepth},
     {.key = STR_FROM("audio_sample_rate"), .parse = __config_parse_audio_sample_rate},
+    {.key = STR_FROM("audio_channels"), .parse = __config_parse_audio_channels},
+    {.key = STR_FROM("audio_channel_mask"), .parse = __config_parse_audio_channel_mask},
+    {.key = STR_FROM("audio_buffer"), .parse = __config_parse_audio_buffer_duration},
+    {.key = STR_FROM("audio_acquisition"), .parse = __config_parse_audio_acquisition_mode},
+    {.key = STR_FROM("audio_flac_workers"), .parse = __config_parse_audio_flac_workers},
+    {.key = STR_FROM("audio_flac_cpus"), .parse = __config_parse_audio_flac_cpus},
+    {.key = STR_FROM("audio_flac_segment"), .parse = __config_parse_audio_flac_segment},
+    {.key = STR_FROM("audio_flac_level"), .parse = __config_parse_audio_flac_level},
+    {.key = STR_FROM("audio_flac_blocksize"), .parse = __config_parse_audio_flac_blocksize},
+    {.key = STR_FROM("audio_flac_mid_side"), .parse = __config_parse_audio_flac_mid_side},
+    {.key = STR_FROM("audio_flac_loose_mid_side"), .parse = __config_parse_audio_flac_loose_mid_side},
+    {.key = STR_FROM("audio_flac_apodization"), .parse = __config_parse_audio_flac_apodization},
+    {.key = STR_FROM("audio_raw_fsync"), .parse = __config_parse_audio_raw_fsync},
+    {.key = STR_FROM("audio_source"), .parse = __config_parse_audio_source},
+    {.key = STR_FROM("audio_sim_file"), .parse = __config_parse_audio_sim_file},
+    {.key = STR_FROM("audio_sim_tone"), .parse = __config_parse_audio_sim_tone},
+    {.key = STR_FROM("audio_sim_jitter"), .parse = __config_parse_audio_sim_jitter},
+    {.key = STR_FROM("audio_sim_overflow"), .parse = __config_parse_audio_sim_overflow},
+    {.key = STR_FROM("audio_decimated_rate"), .parse = __config_parse_audio_decimated_rate},
+    {.key = STR_FROM("audio_clicks"), .parse = __config_parse_audio_clicks},
+    {.key = STR_FROM("audio_click_low"), .parse = __config_parse_audio_click_low},
+    {.key = STR_FROM("audio_click_high"), .parse = __config_parse_audio_click_high},
+    {.key = STR_FROM("audio_click_threshold"), .parse = __config_parse_audio_click_threshold},
+    {.key = STR_FROM("audio_click_holdoff"), .parse = __config_parse_audio_click_holdoff},
+    {.key = STR_FROM("audio_levels"), .parse = __config_parse_audio_levels},
+    {.key = STR_FROM("audio_duty_cycle"), .parse = __config_parse_audio_duty_cycle},
+    {.key = STR_FROM("audio_duty_pretrigger"), .parse = __config_parse_audio_duty_pretrigger},
+    {.key = STR_FROM("audio_duty_hold"), .parse = __config_parse_audio_duty_hold},
+    {.key = STR_FROM("audio_duty_silence"), .parse = __config_parse_audio_duty_silence},
+    {.key = STR_FROM("ecg_acquisition"), .parse = __config_parse_ecg_acquisition_mode},
+    {.key = STR_FROM("ecg_sample_rate"), .parse = __config_parse_ecg_sample_rate},
+    {.key = STR_FROM("ecg_gain"), .parse = __config_parse_ecg_gain},
+    {.key = STR_FROM("ecg_vref"), .parse = __config_parse_ecg_vref},
+    {.key = STR_FROM("ecg_channel"), .parse = __config_parse_ecg_channel},
     {.key = STR_FROM("rec_enabled"), .parse = __config_parse_recovery_enable_value},
     {.key = STR_FROM("rec_callsign"), .parse = __config_parse_recovery_callsign_value},
     {.key = STR_FROM("rec_recipient"), .parse = __config_parse_recovery_recipient_value},
@@ -142,6 +256,51 @@ static ConfigError __config_parse_audio_bitdepth(const char *_String) {
     return CONFIG_OK;
 }
 
+static ConfigError __config_parse_audio_channels(const char *_String) {
+    char *end_ptr;
+    unsigned long channels = strtoul(_String, &end_ptr, 0);
+    if (end_ptr == _String) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    // the ADC has 4 channels, the 3 channel layout leaves the last in standby
+    if ((channels != 3) && (channels != 4)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    g_config.audio.channels = channels;
+    CETI_DEBUG("Audio channels set to %lu", channels);
+    return CONFIG_OK;
+}
+
+static ConfigError __config_parse_audio_channel_mask(const char *_String) {
+    const char *str_ptr = _String;
+    char *end_ptr;
+    uint32_t channel_mask = 0;
+
+    // comma separated list of channel numbers from 1 e.g. "1, 3"
+    while (1) {
+        errno = 0;
+        long channel = strtol(str_ptr, &end_ptr, 10);
+        if ((str_ptr == end_ptr) || (errno == ERANGE) || (channel < 1) || (channel > AUDIO_MAX_CHANNELS)) {
+            return CONFIG_ERR_INVALID_VALUE;
+        }
+        channel_mask |= (1u << (channel - 1));
+
+        while (isspace(*end_ptr)) {
+            end_ptr++;
+        }
+        if (*end_ptr != ',') {
+            break;
+        }
+        str_ptr = end_ptr + 1;
+    }
+
+    g_config.audio.channel_mask = channel_mask;
+    CETI_DEBUG("audio channel mask set to 0x%02x", channel_mask);
+    return CONFIG_OK;
+}
+
 static ConfigError __config_parse_audio_filter_type(const char *_String) {
     const char *end_ptr = NULL;
     char case_insensitive[12] = "";
@@ -177,6 +336,613 @@ static ConfigError __config_parse_audio_filter_type(const char *_String) {
     return CONFIG_ERR_INVALID_VALUE;
 }
 
+static ConfigError __config_parse_audio_buffer_duration(const char *_String) {
+    char *end_ptr;
+    time_t parsed_value;
+
+    errno = 0;
+    parsed_value = strtotime_s(_String, &end_ptr);
+    if ((_String == end_ptr) || (errno == ERANGE)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    // Check acceptable range
+    if (parsed_value < 1) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+    if (parsed_value > 5 * 60) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    g_config.audio.buffer_duration_s = parsed_value;
+    CETI_DEBUG("audio buffer set to %ld seconds", parsed_value);
+    return CONFIG_OK;
+}
+
+static ConfigError __config_parse_audio_acquisition_mode(const char *_String) {
+    const char *end_ptr = NULL;
+    char case_insensitive[5] = "";
+    const char *value_str = strtoidentifier(_String, &end_ptr);
+    size_t value_len = 0;
+    if (value_str == NULL) {
+        CETI_DEBUG("No value found");
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+    value_len = (end_ptr - value_str);
+
+    // only 2 options, both 4 characters long
+    if (value_len != 4) {
+        CETI_DEBUG("Unknown length %d", value_len);
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    // case insensitive
+    for (int i = 0; i < value_len; i++) {
+        case_insensitive[i] = tolower(value_str[i]);
+    }
+
+    if (memcmp("poll", case_insensitive, 4) == 0) {
+        g_config.audio.acquisition_mode = AUDIO_ACQUISITION_POLL;
+        CETI_DEBUG("audio acquisition set to poll");
+        return CONFIG_OK;
+    } else if (memcmp("edge", case_insensitive, 4) == 0) {
+        g_config.audio.acquisition_mode = AUDIO_ACQUISITION_EDGE;
+        CETI_DEBUG("audio acquisition set to edge");
+        return CONFIG_OK;
+    }
+    CETI_DEBUG("Unknown value %s", case_insensitive);
+    return CONFIG_ERR_INVALID_VALUE;
+}
+
+static ConfigError __config_parse_audio_flac_workers(const char *_String) {
+    char *end_ptr;
+    long parsed_value;
+
+    errno = 0;
+    parsed_value = strtol(_String, &end_ptr, 0);
+    if ((_String == end_ptr) || (errno == ERANGE)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    // Check acceptable range
+    if ((parsed_value < 1) || (parsed_value > AUDIO_FLAC_MAX_WORKERS)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    g_config.audio.flac_workers = parsed_value;
+    CETI_DEBUG("audio flac workers set to %ld", parsed_value);
+    return CONFIG_OK;
+}
+
+static ConfigError __config_parse_audio_flac_cpus(const char *_String) {
+    const char *str_ptr = _String;
+    char *end_ptr;
+    uint32_t cpu_mask = 0;
+
+    // comma separated list of CPU numbers e.g. "0, 1, 2"
+    while (1) {
+        errno = 0;
+        long cpu = strtol(str_ptr, &end_ptr, 10);
+        if ((str_ptr == end_ptr) || (errno == ERANGE) || (cpu < 0) || (cpu >= 32)) {
+            return CONFIG_ERR_INVALID_VALUE;
+        }
+        cpu_mask |= (1u << cpu);
+
+        while (isspace(*end_ptr)) {
+            end_ptr++;
+        }
+        if (*end_ptr != ',') {
+            break;
+        }
+        str_ptr = end_ptr + 1;
+    }
+
+    g_config.audio.flac_cpu_mask = cpu_mask;
+    CETI_DEBUG("audio flac cpu mask set to 0x%02x", cpu_mask);
+    return CONFIG_OK;
+}
+
+static ConfigError __config_parse_audio_flac_segment(const char *_String) {
+    char *end_ptr;
+    time_t parsed_value;
+
+    errno = 0;
+    parsed_value = strtotime_s(_String, &end_ptr);
+    if ((_String == end_ptr) || (errno == ERANGE)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    // Check acceptable range, 0 lets the segment length follow the buffer
+    if ((parsed_value < 0) || (parsed_value > AUDIO_FILE_DURATION_S)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    g_config.audio.flac_segment_s = parsed_value;
+    CETI_DEBUG("audio flac segment set to %ld seconds", parsed_value);
+    return CONFIG_OK;
+}
+
+static ConfigError __config_parse_audio_flac_level(const char *_String) {
+    char *end_ptr;
+    long parsed_value;
+
+    errno = 0;
+    parsed_value = strtol(_String, &end_ptr, 0);
+    if ((_String == end_ptr) || (errno == ERANGE)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    // Check acceptable range
+    if ((parsed_value < 0) || (parsed_value > 8)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    g_config.audio.flac_tuning.compression_level = parsed_value;
+    CETI_DEBUG("audio flac compression level set to %ld", parsed_value);
+    return CONFIG_OK;
+}
+
+static ConfigError __config_parse_audio_flac_blocksize(const char *_String) {
+    char *end_ptr;
+    long parsed_value;
+
+    errno = 0;
+    parsed_value = strtol(_String, &end_ptr, 0);
+    if ((_String == end_ptr) || (errno == ERANGE)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    // Check acceptable range, 0 keeps the compression level's block size
+    if ((parsed_value != 0) && ((parsed_value < 16) || (parsed_value > 65535))) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    g_config.audio.flac_tuning.blocksize = parsed_value;
+    CETI_DEBUG("audio flac blocksize set to %ld", parsed_value);
+    return CONFIG_OK;
+}
+
+/**
+ * @brief Parses "true", "false" or "default" (-1).
+ */
+static ConfigError __config_parse_bool_or_default(const char *_String, int *value) {
+    const char *end_ptr = NULL;
+    const char *value_str = strtoidentifier(_String, &end_ptr);
+    if (value_str == NULL) {
+        CETI_DEBUG("No value found");
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    if (((end_ptr - value_str) == 7) && (strncasecmp(value_str, "default", 7) == 0)) {
+        *value = -1;
+    } else {
+        *value = strtobool(value_str, NULL);
+    }
+    return CONFIG_OK;
+}
+
+static ConfigError __config_parse_audio_flac_mid_side(const char *_String) {
+    ConfigError result = __config_parse_bool_or_default(_String, &g_config.audio.flac_tuning.mid_side);
+    CETI_DEBUG("audio flac mid-side set to %d", g_config.audio.flac_tuning.mid_side);
+    return result;
+}
+
+static ConfigError __config_parse_audio_flac_loose_mid_side(const char *_String) {
+    ConfigError result = __config_parse_bool_or_default(_String, &g_config.audio.flac_tuning.loose_mid_side);
+    CETI_DEBUG("audio flac loose mid-side set to %d", g_config.audio.flac_tuning.loose_mid_side);
+    return result;
+}
+
+static ConfigError __config_parse_audio_flac_apodization(const char *_String) {
+    const char *end_ptr = NULL;
+    const char *value_str = strtoquotedstring(_String, &end_ptr);
+    if (value_str == NULL) {
+        CETI_DEBUG("No quoted value found");
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    // strip the quotes
+    size_t value_len = (end_ptr - value_str) - 2;
+    if (value_len >= AUDIO_FLAC_APODIZATION_LEN) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+    memcpy(g_config.audio.flac_tuning.apodization, value_str + 1, value_len);
+    g_config.audio.flac_tuning.apodization[value_len] = '\0';
+    CETI_DEBUG("audio flac apodization set to \"%s\"", g_config.audio.flac_tuning.apodization);
+    return CONFIG_OK;
+}
+
+static ConfigError __config_parse_audio_raw_fsync(const char *_String) {
+    char *end_ptr;
+    time_t parsed_value;
+
+    errno = 0;
+    parsed_value = strtotime_s(_String, &end_ptr);
+    if ((_String == end_ptr) || (errno == ERANGE)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    // Check acceptable range, 0 only syncs when a file is closed
+    if ((parsed_value < 0) || (parsed_value > AUDIO_FILE_DURATION_S)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    g_config.audio.raw_fsync_s = parsed_value;
+    CETI_DEBUG("audio raw fsync interval set to %ld seconds", parsed_value);
+    return CONFIG_OK;
+}
+
+static ConfigError __config_parse_audio_source(const char *_String) {
+    const char *end_ptr = NULL;
+    const char *value_str = strtoidentifier(_String, &end_ptr);
+    if (value_str == NULL) {
+        CETI_DEBUG("No value found");
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+    size_t value_len = (end_ptr - value_str);
+
+    if ((value_len == 4) && (strncasecmp(value_str, "fpga", 4) == 0)) {
+        g_config.audio.source = AUDIO_SOURCE_FPGA;
+    } else if ((value_len == 9) && (strncasecmp(value_str, "simulator", 9) == 0)) {
+        g_config.audio.source = AUDIO_SOURCE_SIMULATOR;
+    } else {
+        CETI_DEBUG("Unknown audio source");
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+    CETI_DEBUG("audio source set to %s", (g_config.audio.source == AUDIO_SOURCE_SIMULATOR) ? "simulator" : "fpga");
+    return CONFIG_OK;
+}
+
+static ConfigError __config_parse_audio_sim_file(const char *_String) {
+    const char *end_ptr = NULL;
+    const char *value_str = strtoquotedstring(_String, &end_ptr);
+    if (value_str == NULL) {
+        CETI_DEBUG("No quoted value found");
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    // strip the quotes
+    size_t value_len = (end_ptr - value_str) - 2;
+    if (value_len >= AUDIO_SIM_FILE_LEN) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+    memcpy(g_config.audio.sim.file, value_str + 1, value_len);
+    g_config.audio.sim.file[value_len] = '\0';
+    CETI_DEBUG("audio simulator file set to \"%s\"", g_config.audio.sim.file);
+    return CONFIG_OK;
+}
+
+static ConfigError __config_parse_audio_sim_tone(const char *_String) {
+    char *end_ptr;
+    long parsed_value;
+
+    errno = 0;
+    parsed_value = strtol(_String, &end_ptr, 0);
+    if ((_String == end_ptr) || (errno == ERANGE)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    // Check acceptable range, the highest channel's tone must stay below
+    // Nyquist at the lowest sample rate
+    if ((parsed_value < 1) || (parsed_value * AUDIO_MAX_CHANNELS >= 24000)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    g_config.audio.sim.tone_hz = parsed_value;
+    CETI_DEBUG("audio simulator tone set to %ld Hz", parsed_value);
+    return CONFIG_OK;
+}
+
+static ConfigError __config_parse_audio_sim_jitter(const char *_String) {
+    char *end_ptr;
+    long parsed_value;
+
+    errno = 0;
+    parsed_value = strtol(_String, &end_ptr, 0);
+    if ((_String == end_ptr) || (errno == ERANGE)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    // Check acceptable range, no later than a whole FIFO
+    if ((parsed_value < 0) || (parsed_value > 1000000)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    g_config.audio.sim.jitter_us = parsed_value;
+    CETI_DEBUG("audio simulator jitter set to %ld us", parsed_value);
+    return CONFIG_OK;
+}
+
+static ConfigError __config_parse_audio_sim_overflow(const char *_String) {
+    char *end_ptr;
+    time_t parsed_value;
+
+    errno = 0;
+    parsed_value = strtotime_s(_String, &end_ptr);
+    if ((_String == end_ptr) || (errno == ERANGE)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    // Check acceptable range, 0 never injects one
+    if (parsed_value < 0) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    g_config.audio.sim.overflow_interval_s = parsed_value;
+    CETI_DEBUG("audio simulator overflow interval set to %ld seconds", parsed_value);
+    return CONFIG_OK;
+}
+
+static ConfigError __config_parse_audio_decimated_rate(const char *_String) {
+    char *end_ptr;
+    long parsed_value;
+
+    errno = 0;
+    parsed_value = strtol(_String, &end_ptr, 0);
+    if ((_String == end_ptr) || (errno == ERANGE)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    // Check acceptable range, 0 disables the stream. Whether the rate
+    // divides the audio sample rate is checked when audio starts.
+    if ((parsed_value < 0) || (parsed_value > AUDIO_SAMPLE_RATE_192KHZ / 2)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    g_config.audio.decimated_rate_khz = parsed_value;
+    CETI_DEBUG("audio decimated rate set to %ld kHz", parsed_value);
+    return CONFIG_OK;
+}
+
+static ConfigError __config_parse_audio_clicks(const char *_String) {
+    g_config.audio.clicks.enabled = strtobool(_String, NULL);
+    CETI_DEBUG("audio click detection %s", g_config.audio.clicks.enabled ? "enabled" : "disabled");
+    return CONFIG_OK;
+}
+
+static ConfigError __config_parse_audio_click_band_edge(const char *_String, uint32_t *edge_hz) {
+    char *end_ptr;
+    long parsed_value;
+
+    errno = 0;
+    parsed_value = strtol(_String, &end_ptr, 0);
+    if ((_String == end_ptr) || (errno == ERANGE)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    // Check acceptable range, whether the band fits under the Nyquist
+    // frequency is checked when audio starts
+    if ((parsed_value < 1) || (parsed_value > AUDIO_SAMPLE_RATE_192KHZ * 1000 / 2)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    *edge_hz = parsed_value;
+    return CONFIG_OK;
+}
+
+static ConfigError __config_parse_audio_click_low(const char *_String) {
+    ConfigError result = __config_parse_audio_click_band_edge(_String, &g_config.audio.clicks.band_low_hz);
+    CETI_DEBUG("audio click band low edge set to %u Hz", g_config.audio.clicks.band_low_hz);
+    return result;
+}
+
+static ConfigError __config_parse_audio_click_high(const char *_String) {
+    ConfigError result = __config_parse_audio_click_band_edge(_String, &g_config.audio.clicks.band_high_hz);
+    CETI_DEBUG("audio click band high edge set to %u Hz", g_config.audio.clicks.band_high_hz);
+    return result;
+}
+
+static ConfigError __config_parse_audio_click_threshold(const char *_String) {
+    char *end_ptr;
+    float parsed_value;
+
+    errno = 0;
+    parsed_value = strtof(_String, &end_ptr);
+    if ((_String == end_ptr) || (errno == ERANGE)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    // Check acceptable range, clicks end 6 dB below the threshold
+    if ((parsed_value <= 6.0f) || (parsed_value > 60.0f)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    g_config.audio.clicks.threshold_db = parsed_value;
+    CETI_DEBUG("audio click threshold set to %.1f dB", parsed_value);
+    return CONFIG_OK;
+}
+
+static ConfigError __config_parse_audio_click_holdoff(const char *_String) {
+    char *end_ptr;
+    long parsed_value;
+
+    errno = 0;
+    parsed_value = strtol(_String, &end_ptr, 0);
+    if ((_String == end_ptr) || (errno == ERANGE)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    // Check acceptable range
+    if ((parsed_value < 0) || (parsed_value > 1000)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    g_config.audio.clicks.holdoff_ms = parsed_value;
+    CETI_DEBUG("audio click holdoff set to %ld ms", parsed_value);
+    return CONFIG_OK;
+}
+
+static ConfigError __config_parse_audio_levels(const char *_String) {
+    g_config.audio.levels_enabled = strtobool(_String, NULL);
+    CETI_DEBUG("audio level records %s", g_config.audio.levels_enabled ? "enabled" : "disabled");
+    return CONFIG_OK;
+}
+
+static ConfigError __config_parse_audio_duty_cycle(const char *_String) {
+    const char *end_ptr = NULL;
+    const char *value_str = strtoidentifier(_String, &end_ptr);
+    if (value_str == NULL) {
+        CETI_DEBUG("No value found");
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+    size_t value_len = (end_ptr - value_str);
+
+    if ((value_len == 3) && (strncasecmp(value_str, "off", 3) == 0)) {
+        g_config.audio.duty.mode = AUDIO_DUTY_CYCLE_OFF;
+    } else if ((value_len == 7) && (strncasecmp(value_str, "standby", 7) == 0)) {
+        g_config.audio.duty.mode = AUDIO_DUTY_CYCLE_STANDBY;
+    } else if ((value_len == 5) && (strncasecmp(value_str, "pause", 5) == 0)) {
+        g_config.audio.duty.mode = AUDIO_DUTY_CYCLE_PAUSE;
+    } else {
+        CETI_DEBUG("Unknown audio duty cycle mode");
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+    CETI_DEBUG("audio duty cycle set to %.*s", (int)value_len, value_str);
+    return CONFIG_OK;
+}
+
+// durations in seconds, minutes by default
+static ConfigError __config_parse_audio_duty_duration(const char *_String, time_t max_s, uint32_t *dst) {
+    char *end_ptr;
+    time_t parsed_value;
+
+    errno = 0;
+    parsed_value = strtotime_s(_String, &end_ptr);
+    if ((_String == end_ptr) || (errno == ERANGE)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    // Check acceptable range
+    if ((parsed_value < 0) || (parsed_value > max_s)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+    *dst = parsed_value;
+    return CONFIG_OK;
+}
+
+static ConfigError __config_parse_audio_duty_pretrigger(const char *_String) {
+    ConfigError result = __config_parse_audio_duty_duration(_String, 5 * 60, &g_config.audio.duty.pretrigger_s);
+    CETI_DEBUG("audio duty cycle pre-trigger set to %u seconds", g_config.audio.duty.pretrigger_s);
+    return result;
+}
+
+static ConfigError __config_parse_audio_duty_hold(const char *_String) {
+    ConfigError result = __config_parse_audio_duty_duration(_String, 60 * 60, &g_config.audio.duty.hold_s);
+    CETI_DEBUG("audio duty cycle hold set to %u seconds", g_config.audio.duty.hold_s);
+    return result;
+}
+
+static ConfigError __config_parse_audio_duty_silence(const char *_String) {
+    ConfigError result = __config_parse_audio_duty_duration(_String, 60 * 60, &g_config.audio.duty.silence_s);
+    CETI_DEBUG("audio duty cycle dive silence set to %u seconds", g_config.audio.duty.silence_s);
+    return result;
+}
+
+static ConfigError __config_parse_ecg_acquisition_mode(const char *_String) {
+    const char *end_ptr = NULL;
+    char case_insensitive[5] = "";
+    const char *value_str = strtoidentifier(_String, &end_ptr);
+    size_t value_len = 0;
+    if (value_str == NULL) {
+        CETI_DEBUG("No value found");
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+    value_len = (end_ptr - value_str);
+
+    // only 2 options, both 4 characters long
+    if (value_len != 4) {
+        CETI_DEBUG("Unknown length %d", value_len);
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    // case insensitive
+    for (int i = 0; i < value_len; i++) {
+        case_insensitive[i] = tolower(value_str[i]);
+    }
+
+    if (memcmp("poll", case_insensitive, 4) == 0) {
+        g_config.ecg.acquisition_mode = ECG_ACQUISITION_POLL;
+        CETI_DEBUG("ecg acquisition set to poll");
+        return CONFIG_OK;
+    } else if (memcmp("edge", case_insensitive, 4) == 0) {
+        g_config.ecg.acquisition_mode = ECG_ACQUISITION_EDGE;
+        CETI_DEBUG("ecg acquisition set to edge");
+        return CONFIG_OK;
+    }
+    CETI_DEBUG("Unknown value %s", case_insensitive);
+    return CONFIG_ERR_INVALID_VALUE;
+}
+
+static ConfigError __config_parse_ecg_sample_rate(const char *_String) {
+    char *end_ptr;
+    unsigned long sample_rate = strtoul(_String, &end_ptr, 0);
+    if (end_ptr == _String) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    // the ADC's continuous conversion data rates
+    if ((sample_rate != 20) && (sample_rate != 90) && (sample_rate != 330) && (sample_rate != 1000)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    g_config.ecg.sample_rate = sample_rate;
+    CETI_DEBUG("ECG sample rate set to %lu Hz", sample_rate);
+    return CONFIG_OK;
+}
+
+static ConfigError __config_parse_ecg_gain(const char *_String) {
+    char *end_ptr;
+    unsigned long gain = strtoul(_String, &end_ptr, 0);
+    if (end_ptr == _String) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    if ((gain != 1) && (gain != 4)) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    g_config.ecg.gain = gain;
+    CETI_DEBUG("ECG gain set to %lu", gain);
+    return CONFIG_OK;
+}
+
+static ConfigError __config_parse_ecg_vref(const char *_String) {
+    const char *end_ptr = NULL;
+    const char *value_str = strtoidentifier(_String, &end_ptr);
+    if (value_str == NULL) {
+        CETI_DEBUG("No value found");
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+    size_t value_len = (end_ptr - value_str);
+
+    if ((value_len == 8) && (strncasecmp(value_str, "internal", 8) == 0)) {
+        g_config.ecg.vref = ECG_VREF_INTERNAL;
+    } else if ((value_len == 8) && (strncasecmp(value_str, "external", 8) == 0)) {
+        g_config.ecg.vref = ECG_VREF_EXTERNAL;
+    } else {
+        CETI_DEBUG("Unknown ECG voltage reference");
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+    CETI_DEBUG("ECG voltage reference set to %s", (g_config.ecg.vref == ECG_VREF_INTERNAL) ? "internal" : "external");
+    return CONFIG_OK;
+}
+
+static ConfigError __config_parse_ecg_channel(const char *_String) {
+    char *end_ptr;
+    unsigned long channel = strtoul(_String, &end_ptr, 0);
+    if (end_ptr == _String) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    if (channel > 3) {
+        return CONFIG_ERR_INVALID_VALUE;
+    }
+
+    g_config.ecg.channel = channel;
+    CETI_DEBUG("ECG channel set to %lu", channel);
+    return CONFIG_OK;
+}
+
 static ConfigError __config_parse_dive_pressure(const char *_String) {
     char *end_ptr;
     float parsed_value;
@@ -523,6 +1289,54 @@ void config_log(uint64_t timestamp) {
     }
     fprintf(fConfig, "audio_bitdepth =: %d\n", (int)g_config.audio.bit_depth);
     fprintf(fConfig, "audio_sample_rate = %d # KHz\n", (int)g_config.audio.sample_rate);
+    fprintf(fConfig, "audio_channels = %u\n", g_config.audio.channels);
+    fprintf(fConfig, "audio_channel_mask =");
+    for (int channel = 0, first = 1; channel < AUDIO_MAX_CHANNELS; channel++) {
+        if (g_config.audio.channel_mask & (1u << channel)) {
+            fprintf(fConfig, first ? " %d" : ", %d", channel + 1);
+            first = 0;
+        }
+    }
+    fprintf(fConfig, "\n");
+    fprintf(fConfig, "audio_buffer = %us # Seconds\n", g_config.audio.buffer_duration_s);
+    fprintf(fConfig, "audio_acquisition = %s\n", (g_config.audio.acquisition_mode == AUDIO_ACQUISITION_EDGE) ? "edge" : "poll");
+    fprintf(fConfig, "audio_flac_workers = %u\n", g_config.audio.flac_workers);
+    fprintf(fConfig, "audio_flac_cpus =");
+    for (int cpu = 0, first = 1; cpu < 32; cpu++) {
+        if (g_config.audio.flac_cpu_mask & (1u << cpu)) {
+            fprintf(fConfig, first ? " %d" : ", %d", cpu);
+            first = 0;
+        }
+    }
+    fprintf(fConfig, "\n");
+    fprintf(fConfig, "audio_flac_segment = %us # Seconds\n", g_config.audio.flac_segment_s);
+    fprintf(fConfig, "audio_flac_level = %d\n", g_config.audio.flac_tuning.compression_level);
+    fprintf(fConfig, "audio_flac_blocksize = %u\n", g_config.audio.flac_tuning.blocksize);
+    fprintf(fConfig, "audio_flac_mid_side = %s\n", (g_config.audio.flac_tuning.mid_side < 0) ? "default" : (g_config.audio.flac_tuning.mid_side ? "true" : "false"));
+    fprintf(fConfig, "audio_flac_loose_mid_side = %s\n", (g_config.audio.flac_tuning.loose_mid_side < 0) ? "default" : (g_config.audio.flac_tuning.loose_mid_side ? "true" : "false"));
+    fprintf(fConfig, "audio_flac_apodization = \"%s\"\n", g_config.audio.flac_tuning.apodization);
+    fprintf(fConfig, "audio_raw_fsync = %us # Seconds\n", g_config.audio.raw_fsync_s);
+    fprintf(fConfig, "audio_source = %s\n", (g_config.audio.source == AUDIO_SOURCE_SIMULATOR) ? "simulator" : "fpga");
+    fprintf(fConfig, "audio_sim_file = \"%s\"\n", g_config.audio.sim.file);
+    fprintf(fConfig, "audio_sim_tone = %u # Hz\n", g_config.audio.sim.tone_hz);
+    fprintf(fConfig, "audio_sim_jitter = %u # us\n", g_config.audio.sim.jitter_us);
+    fprintf(fConfig, "audio_sim_overflow = %us # Seconds\n", g_config.audio.sim.overflow_interval_s);
+    fprintf(fConfig, "audio_decimated_rate = %u # kHz\n", g_config.audio.decimated_rate_khz);
+    fprintf(fConfig, "audio_clicks = %s\n", g_config.audio.clicks.enabled ? "true" : "false");
+    fprintf(fConfig, "audio_click_low = %u # Hz\n", g_config.audio.clicks.band_low_hz);
+    fprintf(fConfig, "audio_click_high = %u # Hz\n", g_config.audio.clicks.band_high_hz);
+    fprintf(fConfig, "audio_click_threshold = %.1f # dB\n", g_config.audio.clicks.threshold_db);
+    fprintf(fConfig, "audio_click_holdoff = %u # ms\n", g_config.audio.clicks.holdoff_ms);
+    fprintf(fConfig, "audio_levels = %s\n", g_config.audio.levels_enabled ? "true" : "false");
+    fprintf(fConfig, "audio_duty_cycle = %s\n", (g_config.audio.duty.mode == AUDIO_DUTY_CYCLE_PAUSE) ? "pause" : ((g_config.audio.duty.mode == AUDIO_DUTY_CYCLE_STANDBY) ? "standby" : "off"));
+    fprintf(fConfig, "audio_duty_pretrigger = %us # Seconds\n", g_config.audio.duty.pretrigger_s);
+    fprintf(fConfig, "audio_duty_hold = %us # Seconds\n", g_config.audio.duty.hold_s);
+    fprintf(fConfig, "audio_duty_silence = %us # Seconds\n", g_config.audio.duty.silence_s);
+    fprintf(fConfig, "ecg_acquisition = %s\n", (g_config.ecg.acquisition_mode == ECG_ACQUISITION_EDGE) ? "edge" : "poll");
+    fprintf(fConfig, "ecg_sample_rate = %u # Hz\n", g_config.ecg.sample_rate);
+    fprintf(fConfig, "ecg_gain = %u\n", g_config.ecg.gain);
+    fprintf(fConfig, "ecg_vref = %s\n", (g_config.ecg.vref == ECG_VREF_INTERNAL) ? "internal" : "external");
+    fprintf(fConfig, "ecg_channel = %u\n", g_config.ecg.channel);
     fprintf(fConfig, "rec_enabled = %s\n", (g_config.recovery.enabled) ? "true" : "false");
     char cs[15];
     callsign_to_str(&g_config.recovery.callsign, cs);
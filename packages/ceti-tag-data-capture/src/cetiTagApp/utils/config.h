@@ -11,12 +11,47 @@
 
 #include "../aprs.h"
 #include "../sensors/audio.h"
+#include "../sensors/ecg_helpers/ecg_config.h"
 #include <stdint.h>
 #include <time.h>
 
 #define CONFIG_DEFAULT_AUDIO_SAMPLE_RATE AUDIO_SAMPLE_RATE_96KHZ
 #define CONFIG_DEFAULT_AUDIO_BIT_DEPTH AUDIO_BIT_DEPTH_16
+#define CONFIG_DEFAULT_AUDIO_CHANNELS (3)
+#define CONFIG_DEFAULT_AUDIO_CHANNEL_MASK (0x0F) // every channel streamed
 #define CONFIG_DEFAULT_AUDIO_FILTER_TYPE AUDIO_FILTER_WIDEBAND
+#define CONFIG_DEFAULT_AUDIO_BUFFER_DURATION_S (20)
+#define CONFIG_DEFAULT_AUDIO_ACQUISITION_MODE AUDIO_ACQUISITION_EDGE
+#define CONFIG_DEFAULT_AUDIO_FLAC_WORKERS (1)
+#define CONFIG_DEFAULT_AUDIO_FLAC_CPU_MASK ((1 << 0) | (1 << 1) | (1 << 2)) // leave CPU 3 to audio SPI
+#define CONFIG_DEFAULT_AUDIO_FLAC_SEGMENT_S (0)
+#define CONFIG_DEFAULT_AUDIO_FLAC_COMPRESSION_LEVEL (5) // libFLAC's default
+#define CONFIG_DEFAULT_AUDIO_FLAC_BLOCKSIZE (0)
+#define CONFIG_DEFAULT_AUDIO_FLAC_MID_SIDE (-1)
+#define CONFIG_DEFAULT_AUDIO_FLAC_LOOSE_MID_SIDE (-1)
+#define CONFIG_DEFAULT_AUDIO_FLAC_APODIZATION ""
+#define CONFIG_DEFAULT_AUDIO_RAW_FSYNC_S (10)
+#define CONFIG_DEFAULT_AUDIO_SOURCE AUDIO_SOURCE_FPGA
+#define CONFIG_DEFAULT_AUDIO_SIM_FILE ""
+#define CONFIG_DEFAULT_AUDIO_SIM_TONE_HZ (1000)
+#define CONFIG_DEFAULT_AUDIO_SIM_JITTER_US (0)
+#define CONFIG_DEFAULT_AUDIO_SIM_OVERFLOW_S (0)
+#define CONFIG_DEFAULT_AUDIO_DECIMATED_RATE_KHZ (8)
+#define CONFIG_DEFAULT_AUDIO_CLICKS_ENABLED (0)
+#define CONFIG_DEFAULT_AUDIO_CLICK_LOW_HZ (5000)
+#define CONFIG_DEFAULT_AUDIO_CLICK_HIGH_HZ (25000)
+#define CONFIG_DEFAULT_AUDIO_CLICK_THRESHOLD_DB (15.0)
+#define CONFIG_DEFAULT_AUDIO_CLICK_HOLDOFF_MS (5)
+#define CONFIG_DEFAULT_AUDIO_LEVELS_ENABLED (1)
+#define CONFIG_DEFAULT_AUDIO_DUTY_CYCLE_MODE AUDIO_DUTY_CYCLE_OFF
+#define CONFIG_DEFAULT_AUDIO_DUTY_PRETRIGGER_S (10)
+#define CONFIG_DEFAULT_AUDIO_DUTY_HOLD_S (60)
+#define CONFIG_DEFAULT_AUDIO_DUTY_SILENCE_S (0)
+#define CONFIG_DEFAULT_ECG_ACQUISITION_MODE ECG_ACQUISITION_EDGE
+#define CONFIG_DEFAULT_ECG_SAMPLE_RATE (1000)
+#define CONFIG_DEFAULT_ECG_GAIN (1)
+#define CONFIG_DEFAULT_ECG_VREF ECG_VREF_EXTERNAL
+#define CONFIG_DEFAULT_ECG_CHANNEL (0) // the ECG signal, 2 and 3 are the electrodes
 #define CONFIG_DEFAULT_SURFACE_PRESSURE_BAR (0.3) // depth_m is roughly 10*pressure_bar
 #define CONFIG_DEFAULT_DIVE_PRESSURE_BAR (0.5)    // depth_m is roughly 10*pressure_bar
 #define CONFIG_DEFAULT_RELEASE_VOLTAGE_V (6.4 / 2.0)
@@ -39,6 +74,7 @@ typedef enum config_error_e {
 
 typedef struct tag_configuration {
     AudioConfig audio;
+    EcgConfig ecg;
     float surface_pressure;
     float dive_pressure;
     float release_voltage_v;
@@ -0,0 +1,755 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+// Binary columnar ECG file format. The writer lives in sensors/ecg.c; the
+// reader methods here only need the file, so they can be used by shore-side
+// tools (see tools/ecg_to_csv.c) as well as the tag.
+//-----------------------------------------------------------------------------
+#include "ecg_file.h"
+
+#include "../_versioning.h"
+#include "error.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+_Static_assert(sizeof(EcgFileHeader) == 104, "ecg file header layout changed");
+_Static_assert(sizeof(EcgFileBlockHeader) == 48, "ecg file block header layout changed");
+
+// ECG_LEADSOFF_INVALID_PLACEHOLDER as stored in the uint16_t leads-off readings
+#define ECG_FILE_LEADS_OFF_INVALID ((uint16_t)(-1))
+
+// Row layout of the CSV files the tag wrote before this format existed.
+#define ECG_FILE_CSV_HEADER "Timestamp [us],RTC Count,Notes,Sample Index,ECG,Leads-Off-P,Leads-Off-N\n"
+#define ECG_FILE_CSV_ROW_MAX (512)
+
+//-----------------------------------------------------------------------------
+// Varints
+//-----------------------------------------------------------------------------
+static inline uint64_t zigzag_encode(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static inline int64_t zigzag_decode(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static inline size_t varint_put(uint8_t *dst, uint64_t value) {
+    size_t length = 0;
+    while (value >= 0x80) {
+        dst[length++] = (uint8_t)value | 0x80;
+        value >>= 7;
+    }
+    dst[length++] = (uint8_t)value;
+    return length;
+}
+
+/**
+ * @brief Reads a varint from `*src`, advancing it.
+ *
+ * @return 0 on success, -1 if the varint runs past `end` or is too long
+ */
+static inline int varint_get(const uint8_t **src, const uint8_t *end, uint64_t *value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 7 * ECG_FILE_VARINT_MAX_BYTES; shift += 7) {
+        if (*src >= end) {
+            return -1;
+        }
+        uint8_t byte = *(*src)++;
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+//-----------------------------------------------------------------------------
+// Rice codes
+//-----------------------------------------------------------------------------
+typedef struct {
+    uint8_t *out;
+    uint64_t bits;
+    int bit_count;
+} BitWriter;
+
+typedef struct {
+    const uint8_t *in;
+    const uint8_t *end;
+    uint64_t bits;
+    int bit_count;
+} BitReader;
+
+// `count` <= 32, and `value` must fit in it
+static inline void bits_put(BitWriter *writer, uint64_t value, int count) {
+    writer->bits |= value << writer->bit_count;
+    writer->bit_count += count;
+    while (writer->bit_count >= 8) {
+        *writer->out++ = (uint8_t)writer->bits;
+        writer->bits >>= 8;
+        writer->bit_count -= 8;
+    }
+}
+
+static inline void bits_flush(BitWriter *writer) {
+    if (writer->bit_count > 0) {
+        *writer->out++ = (uint8_t)writer->bits;
+    }
+    writer->bits = 0;
+    writer->bit_count = 0;
+}
+
+static inline void bits_refill(BitReader *reader) {
+    while ((reader->bit_count <= 56) && (reader->in < reader->end)) {
+        reader->bits |= (uint64_t)(*reader->in++) << reader->bit_count;
+        reader->bit_count += 8;
+    }
+}
+
+// `count` <= 32
+static inline int bits_get(BitReader *reader, int count, uint64_t *value) {
+    if (reader->bit_count < count) {
+        bits_refill(reader);
+        if (reader->bit_count < count) {
+            return -1;
+        }
+    }
+    *value = reader->bits & ((1ULL << count) - 1);
+    reader->bits >>= count;
+    reader->bit_count -= count;
+    return 0;
+}
+
+/**
+ * @brief Drops the padding at the end of a column.
+ *
+ * @return where the next column starts
+ */
+static inline const uint8_t *bits_align(BitReader *reader) {
+    return reader->in - reader->bit_count / 8;
+}
+
+static inline void rice_put(BitWriter *writer, uint64_t value, int k) {
+    uint64_t quotient = value >> k;
+    if (quotient >= ECG_FILE_RICE_ESCAPE) {
+        bits_put(writer, 0xFFFFFFFF, 32); // ECG_FILE_RICE_ESCAPE ones
+        bits_put(writer, 0, 1);
+        bits_put(writer, value & 0xFFFFFFFF, 32);
+        bits_put(writer, value >> 32, 32);
+        return;
+    }
+    bits_put(writer, (1ULL << quotient) - 1, quotient + 1);
+    bits_put(writer, value & ((1ULL << k) - 1), k);
+}
+
+static inline int rice_get(BitReader *reader, int k, uint64_t *value) {
+    // unary quotient
+    uint64_t quotient = 0;
+    for (;;) {
+        if (reader->bit_count == 0) {
+            bits_refill(reader);
+            if (reader->bit_count == 0) {
+                return -1;
+            }
+        }
+        int ones = __builtin_ctzll(~reader->bits);
+        if (ones < reader->bit_count) {
+            quotient += ones;
+            reader->bits >>= ones + 1;
+            reader->bit_count -= ones + 1;
+            break;
+        }
+        quotient += reader->bit_count;
+        reader->bits = 0;
+        reader->bit_count = 0;
+        if (quotient > ECG_FILE_RICE_ESCAPE) {
+            return -1;
+        }
+    }
+
+    if (quotient == ECG_FILE_RICE_ESCAPE) {
+        uint64_t low;
+        uint64_t high;
+        if ((bits_get(reader, 32, &low) != 0) || (bits_get(reader, 32, &high) != 0)) {
+            return -1;
+        }
+        *value = low | (high << 32);
+        return 0;
+    }
+    if (quotient > ECG_FILE_RICE_ESCAPE) {
+        return -1;
+    }
+    uint64_t remainder;
+    if (bits_get(reader, k, &remainder) != 0) {
+        return -1;
+    }
+    *value = (quotient << k) | remainder;
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Columns
+//-----------------------------------------------------------------------------
+// Order of the difference each column is Rice coded with. Timestamps and
+// indexes advance by a near constant step, so their second difference is
+// near zero; the others only change slowly.
+static const uint8_t ecg_file_rice_order[ECG_FILE_COLUMN_COUNT] = {2, 1, 2, 1};
+
+// Column values widened to unsigned 64 bits, so that differences wrap
+// instead of overflowing.
+static inline uint64_t ecg_file_column_value(const CetiEcgSample *sample, int column) {
+    switch (column) {
+        case 0:
+            return sample->sys_time_us;
+        case 1:
+            return sample->rtc_time_s;
+        case 2:
+            return sample->sample_index;
+        default:
+            return (uint64_t)(int64_t)sample->ecg_reading;
+    }
+}
+
+static inline uint64_t ecg_file_column_first(const EcgFileBlockHeader *header, int column) {
+    switch (column) {
+        case 0:
+            return header->sys_time_us;
+        case 1:
+            return header->rtc_time_s;
+        case 2:
+            return header->sample_index;
+        default:
+            return (uint64_t)(int64_t)header->ecg_reading;
+    }
+}
+
+static inline void ecg_file_column_store(CetiEcgSample *sample, int column, uint64_t value) {
+    switch (column) {
+        case 0:
+            sample->sys_time_us = value;
+            break;
+        case 1:
+            sample->rtc_time_s = (uint32_t)value;
+            break;
+        case 2:
+            sample->sample_index = value;
+            break;
+        default:
+            sample->ecg_reading = (int32_t)(int64_t)value;
+            break;
+    }
+}
+
+/**
+ * @brief Zigzag coded `order` difference of sample `i` (> 0) of a column.
+ * The second sample only has a first difference.
+ */
+static inline uint64_t ecg_file_residual(const CetiEcgSample *samples, uint32_t i, int column, int order) {
+    uint64_t value = ecg_file_column_value(&samples[i], column);
+    uint64_t previous = ecg_file_column_value(&samples[i - 1], column);
+    if ((order == 1) || (i == 1)) {
+        return zigzag_encode((int64_t)(value - previous));
+    }
+    uint64_t before = ecg_file_column_value(&samples[i - 2], column);
+    return zigzag_encode((int64_t)(value - 2 * previous + before));
+}
+
+/**
+ * @brief Inverse of ecg_file_residual(), given the column's values before
+ * sample `i`.
+ */
+static inline uint64_t ecg_file_reconstruct(const uint64_t *values, uint32_t i, int order, uint64_t residual) {
+    int64_t difference = zigzag_decode(residual);
+    if ((order == 1) || (i == 1)) {
+        return values[i - 1] + difference;
+    }
+    return 2 * values[i - 1] - values[i - 2] + difference;
+}
+
+static inline uint64_t rice_size_bits(uint64_t residual, int k) {
+    uint64_t quotient = residual >> k;
+    return (quotient >= ECG_FILE_RICE_ESCAPE) ? (ECG_FILE_RICE_ESCAPE + 1 + 64) : (quotient + 1 + k);
+}
+
+/**
+ * @brief Rice parameter that codes a column in the fewest bits.
+ *
+ * Starts from log2 of the mean residual, which is within one of the best
+ * parameter for the geometric-like residual distributions of ECG signals,
+ * and checks its neighbours exactly.
+ */
+static uint8_t ecg_file_rice_parameter(const CetiEcgSample *samples, uint32_t sample_count, int column, int order) {
+    uint64_t sum = 0;
+    for (uint32_t i = 1; i < sample_count; i++) {
+        uint64_t residual = ecg_file_residual(samples, i, column, order);
+        sum += (residual < (1ULL << 40)) ? residual : (1ULL << 40);
+    }
+    uint64_t count = sample_count - 1;
+    int estimate = 0;
+    while ((estimate < ECG_FILE_RICE_MAX_K) && ((count << (estimate + 1)) <= sum)) {
+        estimate++;
+    }
+
+    int best_k = estimate;
+    uint64_t best_size = UINT64_MAX;
+    for (int k = (estimate > 0) ? estimate - 1 : 0; (k <= estimate + 1) && (k <= ECG_FILE_RICE_MAX_K); k++) {
+        uint64_t size = 0;
+        for (uint32_t i = 1; i < sample_count; i++) {
+            size += rice_size_bits(ecg_file_residual(samples, i, column, order), k);
+        }
+        if (size < best_size) {
+            best_size = size;
+            best_k = k;
+        }
+    }
+    return (uint8_t)best_k;
+}
+
+//-----------------------------------------------------------------------------
+// Writing
+//-----------------------------------------------------------------------------
+void ecg_file_header_init(EcgFileHeader *header, const CetiEcgFormat *format, int lod_enabled, int64_t start_time_us) {
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, ECG_FILE_MAGIC, sizeof(header->magic));
+    header->version = ECG_FILE_VERSION;
+    header->header_size = sizeof(EcgFileHeader);
+    header->block_header_size = sizeof(EcgFileBlockHeader);
+    header->sampling_period_us = format->sampling_period_us;
+    header->start_time_us = start_time_us;
+    header->lod_enabled = (lod_enabled != 0);
+    header->adc_gain = format->gain;
+    header->adc_vref = format->vref;
+    header->adc_channel = format->channel;
+    strncpy(header->firmware_version, CETI_VERSION, sizeof(header->firmware_version) - 1);
+}
+
+/**
+ * @brief The sample's flags, with the error and leads-off flags brought up
+ * to date with its error and leads-off readings.
+ */
+uint16_t ecg_file_sample_flags(const CetiEcgSample *sample, int lod_enabled) {
+    uint16_t flags = sample->flags & ((1 << ECG_FILE_FLAG_COUNT) - 1)
+                     & ~(ECG_FILE_FLAG_ERROR | ECG_FILE_FLAG_LEADS_OFF_INVALID | ECG_FILE_FLAG_LEADS_OFF_P | ECG_FILE_FLAG_LEADS_OFF_N);
+    if (sample->error != WT_OK) {
+        flags |= ECG_FILE_FLAG_ERROR;
+    }
+    if (lod_enabled) {
+        if ((sample->leadsOff_reading_p == ECG_FILE_LEADS_OFF_INVALID) || (sample->leadsOff_reading_n == ECG_FILE_LEADS_OFF_INVALID)) {
+            flags |= ECG_FILE_FLAG_LEADS_OFF_INVALID;
+        } else {
+            flags |= (sample->leadsOff_reading_p ? ECG_FILE_FLAG_LEADS_OFF_P : 0);
+            flags |= (sample->leadsOff_reading_n ? ECG_FILE_FLAG_LEADS_OFF_N : 0);
+        }
+    }
+    return flags;
+}
+
+/**
+ * @brief Encodes `sample_count` samples and their ECG_FILE_FLAG_* `flags` as
+ * one block. `dst` must hold ECG_FILE_BLOCK_MAX_SIZE(sample_count) bytes.
+ *
+ * @return bytes written to `dst`
+ */
+size_t ecg_file_encode_block(uint8_t *dst, const CetiEcgSample *samples, const uint16_t *flags, uint32_t sample_count, EcgFileCodec codec) {
+    EcgFileBlockHeader header = {
+        .magic = ECG_FILE_BLOCK_MAGIC,
+        .sample_count = sample_count,
+        .codec = codec,
+    };
+    if (sample_count > 0) {
+        header.sys_time_us = samples[0].sys_time_us;
+        header.rtc_time_s = samples[0].rtc_time_s;
+        header.sample_index = samples[0].sample_index;
+        header.ecg_reading = samples[0].ecg_reading;
+    }
+
+    uint8_t *out = dst + sizeof(header);
+    for (int column = 0; column < ECG_FILE_COLUMN_COUNT; column++) {
+        if (codec == ECG_FILE_CODEC_RICE) {
+            int order = ecg_file_rice_order[column];
+            int k = (sample_count > 1) ? ecg_file_rice_parameter(samples, sample_count, column, order) : 0;
+            BitWriter writer = {.out = out};
+            for (uint32_t i = 1; i < sample_count; i++) {
+                rice_put(&writer, ecg_file_residual(samples, i, column, order), k);
+            }
+            bits_flush(&writer);
+            out = writer.out;
+            header.rice_k[column] = k;
+        } else {
+            for (uint32_t i = 1; i < sample_count; i++) {
+                out += varint_put(out, ecg_file_residual(samples, i, column, 1));
+            }
+        }
+    }
+
+    // one bit plane per flag that is set anywhere in the block
+    for (uint32_t i = 0; i < sample_count; i++) {
+        header.flag_planes |= flags[i];
+    }
+    size_t plane_size = ((size_t)sample_count + 7) / 8;
+    for (int flag = 0; flag < ECG_FILE_FLAG_COUNT; flag++) {
+        if (!(header.flag_planes & (1 << flag))) {
+            continue;
+        }
+        memset(out, 0, plane_size);
+        for (uint32_t i = 0; i < sample_count; i++) {
+            out[i / 8] |= ((flags[i] >> flag) & 1) << (i % 8);
+        }
+        out += plane_size;
+    }
+
+    for (uint32_t i = 0; i < sample_count; i++) {
+        if (flags[i] & ECG_FILE_FLAG_ERROR) {
+            out += varint_put(out, i);
+            out += varint_put(out, (uint32_t)samples[i].error);
+            header.error_count++;
+        }
+    }
+
+    header.payload_size = (uint32_t)(out - dst - sizeof(header));
+    memcpy(dst, &header, sizeof(header));
+    return out - dst;
+}
+
+/**
+ * @brief Decodes an encoded block and checks that it reproduces `samples`
+ * and `flags` exactly. Leads-off readings are checked through their flags.
+ *
+ * @return 0 if it does, -1 otherwise
+ */
+int ecg_file_verify_block(const uint8_t *src, size_t length, const CetiEcgSample *samples, const uint16_t *flags, uint32_t sample_count) {
+    CetiEcgSample *decoded = malloc(((size_t)sample_count + 1) * sizeof(*decoded));
+    uint16_t *decoded_flags = malloc(((size_t)sample_count + 1) * sizeof(*decoded_flags));
+    int result = -1;
+    if ((decoded == NULL) || (decoded_flags == NULL)) {
+        goto done;
+    }
+    size_t consumed;
+    if ((ecg_file_decode_block(src, length, decoded, decoded_flags, sample_count, &consumed) != (int)sample_count) || (consumed != length)) {
+        goto done;
+    }
+    for (uint32_t i = 0; i < sample_count; i++) {
+        if ((decoded[i].sys_time_us != samples[i].sys_time_us)
+            || (decoded[i].rtc_time_s != samples[i].rtc_time_s)
+            || (decoded[i].sample_index != samples[i].sample_index)
+            || (decoded[i].ecg_reading != samples[i].ecg_reading)
+            || (decoded[i].error != samples[i].error)
+            || (decoded_flags[i] != flags[i])) {
+            goto done;
+        }
+    }
+    result = 0;
+
+done:
+    free(decoded);
+    free(decoded_flags);
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// Reading
+//-----------------------------------------------------------------------------
+/**
+ * @brief Checks that `header` describes a file of this format.
+ *
+ * @return 0 if valid, -1 otherwise
+ */
+int ecg_file_header_validate(const EcgFileHeader *header) {
+    if (memcmp(header->magic, ECG_FILE_MAGIC, sizeof(header->magic)) != 0) {
+        return -1;
+    }
+    if ((header->version < 1) || (header->version > ECG_FILE_VERSION) || (header->header_size != sizeof(EcgFileHeader)) || (header->block_header_size != sizeof(EcgFileBlockHeader))) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Decodes one column of `header`'s block from `*src` into `values`,
+ * advancing `*src` past it.
+ *
+ * @return 0 on success, -1 if the column runs past `end`
+ */
+static int ecg_file_decode_column(const uint8_t **src, const uint8_t *end, const EcgFileBlockHeader *header, int column, uint64_t *values) {
+    uint32_t sample_count = header->sample_count;
+    if (sample_count == 0) {
+        return 0;
+    }
+    values[0] = ecg_file_column_first(header, column);
+    if (header->codec == ECG_FILE_CODEC_RICE) {
+        int order = ecg_file_rice_order[column];
+        int k = header->rice_k[column];
+        BitReader reader = {.in = *src, .end = end};
+        for (uint32_t i = 1; i < sample_count; i++) {
+            uint64_t residual;
+            if (rice_get(&reader, k, &residual) != 0) {
+                return -1;
+            }
+            values[i] = ecg_file_reconstruct(values, i, order, residual);
+        }
+        *src = bits_align(&reader);
+        return 0;
+    }
+    for (uint32_t i = 1; i < sample_count; i++) {
+        uint64_t residual;
+        if (varint_get(src, end, &residual) != 0) {
+            return -1;
+        }
+        values[i] = ecg_file_reconstruct(values, i, 1, residual);
+    }
+    return 0;
+}
+
+/**
+ * @brief Decodes the block at the start of `src` into `samples` and their
+ * ECG_FILE_FLAG_* `flags`, either of which may be NULL.
+ *
+ * @param consumed set to the encoded size of the block, header included
+ * @return samples decoded, or -1 if `src` does not start with a whole valid
+ * block or it holds more than `capacity` samples
+ */
+int ecg_file_decode_block(const uint8_t *src, size_t length, CetiEcgSample *samples, uint16_t *flags, uint32_t capacity, size_t *consumed) {
+    EcgFileBlockHeader header;
+    if (length < sizeof(header)) {
+        return -1;
+    }
+    memcpy(&header, src, sizeof(header));
+    if ((header.magic != ECG_FILE_BLOCK_MAGIC) || (header.sample_count > capacity) || (header.payload_size > length - sizeof(header))) {
+        return -1;
+    }
+    if ((header.codec != ECG_FILE_CODEC_VARINT) && (header.codec != ECG_FILE_CODEC_RICE)) {
+        return -1;
+    }
+    for (int column = 0; column < ECG_FILE_COLUMN_COUNT; column++) {
+        if (header.rice_k[column] > ECG_FILE_RICE_MAX_K) {
+            return -1;
+        }
+    }
+    const uint8_t *in = src + sizeof(header);
+    const uint8_t *end = in + header.payload_size;
+    uint32_t sample_count = header.sample_count;
+
+    uint64_t *values = malloc(((size_t)sample_count + 1) * sizeof(*values));
+    if (values == NULL) {
+        return -1;
+    }
+    int result = -1;
+    for (uint32_t i = 0; (samples != NULL) && (i < sample_count); i++) {
+        memset(&samples[i], 0, sizeof(samples[i]));
+    }
+    for (int column = 0; column < ECG_FILE_COLUMN_COUNT; column++) {
+        if (ecg_file_decode_column(&in, end, &header, column, values) != 0) {
+            goto done;
+        }
+        for (uint32_t i = 0; (samples != NULL) && (i < sample_count); i++) {
+            ecg_file_column_store(&samples[i], column, values[i]);
+        }
+    }
+
+    if (flags != NULL) {
+        memset(flags, 0, sample_count * sizeof(*flags));
+    }
+    size_t plane_size = ((size_t)sample_count + 7) / 8;
+    for (int flag = 0; flag < ECG_FILE_FLAG_COUNT; flag++) {
+        if (!(header.flag_planes & (1 << flag))) {
+            continue;
+        }
+        if ((size_t)(end - in) < plane_size) {
+            goto done;
+        }
+        for (uint32_t i = 0; (flags != NULL) && (i < sample_count); i++) {
+            flags[i] |= ((in[i / 8] >> (i % 8)) & 1) << flag;
+        }
+        in += plane_size;
+    }
+
+    for (uint32_t e = 0; e < header.error_count; e++) {
+        uint64_t i;
+        uint64_t error;
+        if ((varint_get(&in, end, &i) != 0) || (varint_get(&in, end, &error) != 0) || (i >= sample_count)) {
+            goto done;
+        }
+        if (samples != NULL) {
+            samples[i].error = (int32_t)(uint32_t)error;
+        }
+    }
+
+    // leads-off readings are carried by the flags
+    for (uint32_t i = 0; (samples != NULL) && (flags != NULL) && (i < sample_count); i++) {
+        samples[i].flags = flags[i];
+        if (flags[i] & ECG_FILE_FLAG_LEADS_OFF_INVALID) {
+            samples[i].leadsOff_reading_p = ECG_FILE_LEADS_OFF_INVALID;
+            samples[i].leadsOff_reading_n = ECG_FILE_LEADS_OFF_INVALID;
+        } else {
+            samples[i].leadsOff_reading_p = (flags[i] & ECG_FILE_FLAG_LEADS_OFF_P) ? 1 : 0;
+            samples[i].leadsOff_reading_n = (flags[i] & ECG_FILE_FLAG_LEADS_OFF_N) ? 1 : 0;
+        }
+    }
+
+    if (consumed != NULL) {
+        *consumed = sizeof(header) + header.payload_size;
+    }
+    result = (int)sample_count;
+
+done:
+    free(values);
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// CSV conversion
+//-----------------------------------------------------------------------------
+static inline char *csv_put_u64(char *out, uint64_t value) {
+    char digits[20];
+    int length = 0;
+    do {
+        digits[length++] = '0' + (value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (length > 0) {
+        *out++ = digits[--length];
+    }
+    return out;
+}
+
+static inline char *csv_put_i64(char *out, int64_t value) {
+    if (value < 0) {
+        *out++ = '-';
+        return csv_put_u64(out, -(uint64_t)value);
+    }
+    return csv_put_u64(out, value);
+}
+
+static inline char *csv_put_str(char *out, const char *str) {
+    size_t length = strlen(str);
+    memcpy(out, str, length);
+    return out + length;
+}
+
+/**
+ * @brief Formats one sample as the row the tag's CSV writer produced.
+ *
+ * @return length of the row written to `row`, which must hold
+ * ECG_FILE_CSV_ROW_MAX bytes
+ */
+static size_t ecg_file_csv_row(char *row, const CetiEcgSample *sample, uint16_t flags, int lod_enabled) {
+    char *out = row;
+    out = csv_put_u64(out, sample->sys_time_us);
+    *out++ = ',';
+    out = csv_put_u64(out, sample->rtc_time_s);
+    *out++ = ',';
+    if (flags & ECG_FILE_FLAG_RESTARTED) {
+        out = csv_put_str(out, "Restarted! | ");
+    }
+    if (flags & ECG_FILE_FLAG_NEW_LOG) {
+        out = csv_put_str(out, "New log file! | ");
+    }
+    if (flags & ECG_FILE_FLAG_ERROR) {
+        char err_str[256];
+        wt_strerror_r(sample->error, err_str, sizeof(err_str));
+        err_str[sizeof(err_str) - 1] = '\0';
+        out = csv_put_str(out, "ERROR(");
+        out = csv_put_str(out, err_str);
+        out = csv_put_str(out, ") | ");
+    }
+    if (flags & ECG_FILE_FLAG_ZEROS) {
+        out = csv_put_str(out, "ADC ZEROS | ");
+    }
+    if (flags & ECG_FILE_FLAG_TIMEOUT) {
+        out = csv_put_str(out, "TIMEOUT | ");
+    }
+    if (flags & ECG_FILE_FLAG_MAYBE_INVALID) {
+        out = csv_put_str(out, "INVALID? | ");
+    }
+    *out++ = ',';
+    out = csv_put_u64(out, sample->sample_index);
+    *out++ = ',';
+    out = csv_put_i64(out, sample->ecg_reading);
+    *out++ = ',';
+    if (lod_enabled) {
+        out = csv_put_u64(out, sample->leadsOff_reading_p);
+        *out++ = ',';
+        out = csv_put_u64(out, sample->leadsOff_reading_n);
+    } else {
+        *out++ = ',';
+    }
+    *out++ = '\n';
+    return out - row;
+}
+
+/**
+ * @brief Converts an ECG file to the CSV layout the tag used to write.
+ *
+ * Conversion stops at the first block that is cut short or corrupt, as the
+ * last block of a file can be if the tag lost power while writing it.
+ *
+ * @return samples converted, or -1 if `in` is not an ECG file
+ */
+int ecg_file_to_csv(FILE *in, FILE *out) {
+    EcgFileHeader file_header;
+    if ((fread(&file_header, sizeof(file_header), 1, in) != 1) || (ecg_file_header_validate(&file_header) != 0)) {
+        return -1;
+    }
+    fputs(ECG_FILE_CSV_HEADER, out);
+
+    uint8_t *block = NULL;
+    size_t block_capacity = 0;
+    CetiEcgSample *samples = NULL;
+    uint16_t *flags = NULL;
+    uint32_t sample_capacity = 0;
+    char row[ECG_FILE_CSV_ROW_MAX];
+    long sample_total = 0;
+
+    EcgFileBlockHeader header;
+    while (fread(&header, sizeof(header), 1, in) == 1) {
+        if (header.magic != ECG_FILE_BLOCK_MAGIC) {
+            break;
+        }
+        size_t block_size = sizeof(header) + (size_t)header.payload_size;
+        if (block_size > block_capacity) {
+            uint8_t *grown = realloc(block, block_size);
+            if (grown == NULL) {
+                break;
+            }
+            block = grown;
+            block_capacity = block_size;
+        }
+        if (header.sample_count > sample_capacity) {
+            CetiEcgSample *grown_samples = realloc(samples, header.sample_count * sizeof(*samples));
+            if (grown_samples != NULL) {
+                samples = grown_samples;
+            }
+            uint16_t *grown_flags = realloc(flags, header.sample_count * sizeof(*flags));
+            if (grown_flags != NULL) {
+                flags = grown_flags;
+            }
+            if ((grown_samples == NULL) || (grown_flags == NULL)) {
+                break;
+            }
+            sample_capacity = header.sample_count;
+        }
+        memcpy(block, &header, sizeof(header));
+        if (fread(block + sizeof(header), 1, header.payload_size, in) != header.payload_size) {
+            break;
+        }
+
+        int sample_count = ecg_file_decode_block(block, block_size, samples, flags, sample_capacity, NULL);
+        if (sample_count < 0) {
+            break;
+        }
+        for (int i = 0; i < sample_count; i++) {
+            fwrite(row, 1, ecg_file_csv_row(row, &samples[i], flags[i], file_header.lod_enabled), out);
+        }
+        sample_total += sample_count;
+    }
+
+    free(block);
+    free(samples);
+    free(flags);
+    return (int)sample_total;
+}
@@ -0,0 +1,135 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+#ifndef UTILS_ECG_FILE_H
+#define UTILS_ECG_FILE_H
+
+#include "../cetiTag.h" // for CetiEcgSample
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+//-----------------------------------------------------------------------------
+// Definitions/Configurations
+//-----------------------------------------------------------------------------
+// ECG file layout, all fields little-endian:
+//
+//   0      EcgFileHeader
+//   ...    blocks, one per flushed acquisition page, each an EcgFileBlockHeader
+//          followed by payload_size bytes holding one column after another:
+//
+//            sys_time_us    sample_count - 1 residuals
+//            rtc_time_s     sample_count - 1 residuals
+//            sample_index   sample_count - 1 residuals
+//            ecg_reading    sample_count - 1 residuals
+//            flags          for each bit set in flag_planes, in bit order,
+//                           ceil(sample_count / 8) bytes with bit (i % 8) of
+//                           byte (i / 8) set if sample i has that flag
+//            errors         error_count pairs of varint sample offset and
+//                           varint WTResult, for samples with ECG_FILE_FLAG_ERROR
+//
+// The first sample of each column is stored in the block header, so a block
+// can be decoded, or its time found, without reading anything before it.
+//
+// How the residuals are coded depends on the block's codec:
+//
+//   ECG_FILE_CODEC_VARINT  zigzag varints of the differences between
+//                          consecutive samples
+//   ECG_FILE_CODEC_RICE    zigzag Rice codes with parameter rice_k[column]
+//                          of the first (rtc_time_s, ecg_reading) or second
+//                          (sys_time_us, sample_index) order difference, bits
+//                          packed least significant first and each column
+//                          padded to a whole byte. A quotient of
+//                          ECG_FILE_RICE_ESCAPE is followed by the residual
+//                          in 64 bits instead of its low rice_k bits.
+//
+// Version 1 files only hold ECG_FILE_CODEC_VARINT blocks. Versions before 3
+// leave the ADC settings in the header 0; they were always recorded at gain
+// 1 with the external reference on channel 0.
+#define ECG_FILE_MAGIC "CETIECG"
+#define ECG_FILE_VERSION (3)
+#define ECG_FILE_BLOCK_MAGIC (0x4B4C4245) // "EBLK"
+#define ECG_FILE_VARINT_MAX_BYTES (10)
+#define ECG_FILE_RICE_ESCAPE (32)
+#define ECG_FILE_RICE_MAX_K (31)
+#define ECG_FILE_COLUMN_COUNT (4)
+#define ECG_FILE_RESIDUAL_MAX_BYTES (13) // an escaped Rice code is 97 bits
+
+// upper bound on the encoded size of a block, header included; each Rice
+// column may end in a byte of padding
+#define ECG_FILE_BLOCK_MAX_SIZE(sample_count)                                                   \
+    (sizeof(EcgFileBlockHeader)                                                                 \
+     + ECG_FILE_COLUMN_COUNT * ((size_t)(sample_count) * ECG_FILE_RESIDUAL_MAX_BYTES + 1)       \
+     + ECG_FILE_FLAG_COUNT * (((size_t)(sample_count) + 7) / 8)                                 \
+     + 2 * (size_t)(sample_count) * ECG_FILE_VARINT_MAX_BYTES)
+
+// per sample flags, the same bits as CetiEcgSample flags
+#define ECG_FILE_FLAG_LEADS_OFF_P ECG_SAMPLE_FLAG_LEADS_OFF_P
+#define ECG_FILE_FLAG_LEADS_OFF_N ECG_SAMPLE_FLAG_LEADS_OFF_N
+#define ECG_FILE_FLAG_LEADS_OFF_INVALID ECG_SAMPLE_FLAG_LEADS_OFF_INVALID
+#define ECG_FILE_FLAG_ERROR ECG_SAMPLE_FLAG_ERROR
+#define ECG_FILE_FLAG_RESTARTED ECG_SAMPLE_FLAG_RESTARTED
+#define ECG_FILE_FLAG_NEW_LOG ECG_SAMPLE_FLAG_NEW_LOG
+#define ECG_FILE_FLAG_ZEROS ECG_SAMPLE_FLAG_ZEROS
+#define ECG_FILE_FLAG_TIMEOUT ECG_SAMPLE_FLAG_TIMEOUT
+#define ECG_FILE_FLAG_MAYBE_INVALID ECG_SAMPLE_FLAG_MAYBE_INVALID
+#define ECG_FILE_FLAG_COUNT (9)
+
+//-----------------------------------------------------------------------------
+// Typedefs
+//-----------------------------------------------------------------------------
+typedef enum {
+    ECG_FILE_CODEC_VARINT = 0,
+    ECG_FILE_CODEC_RICE = 1,
+} EcgFileCodec;
+
+typedef struct {
+    char magic[8];              // ECG_FILE_MAGIC
+    uint32_t version;           // ECG_FILE_VERSION
+    uint32_t header_size;       // sizeof(EcgFileHeader)
+    uint32_t block_header_size; // sizeof(EcgFileBlockHeader)
+    uint32_t sampling_period_us;
+    int64_t start_time_us;      // time the file was created
+    uint8_t lod_enabled;        // leads-off detection was recorded
+    uint8_t adc_gain;           // 1 or 4, from version 3
+    uint8_t adc_vref;           // EcgVoltageReference, from version 3
+    uint8_t adc_channel;        // ADC input sampled, from version 3
+    uint8_t reserved1[4];
+    char firmware_version[64];  // CETI_VERSION of the recording firmware
+} EcgFileHeader;
+
+typedef struct {
+    uint32_t magic;        // ECG_FILE_BLOCK_MAGIC
+    uint32_t sample_count;
+    uint32_t payload_size; // bytes following this header
+    uint16_t flag_planes;  // ECG_FILE_FLAG_* with a plane in the payload
+    uint8_t codec;         // EcgFileCodec of the residuals
+    uint8_t reserved;
+    uint32_t error_count;
+    uint32_t rtc_time_s;   // first sample
+    int32_t ecg_reading;   // first sample
+    uint8_t rice_k[ECG_FILE_COLUMN_COUNT]; // Rice parameter of each column, in payload order
+    uint64_t sys_time_us;  // first sample
+    uint64_t sample_index; // first sample
+} EcgFileBlockHeader;
+
+//-----------------------------------------------------------------------------
+// Methods
+//-----------------------------------------------------------------------------
+// writing
+void ecg_file_header_init(EcgFileHeader *header, const CetiEcgFormat *format, int lod_enabled, int64_t start_time_us);
+uint16_t ecg_file_sample_flags(const CetiEcgSample *sample, int lod_enabled);
+size_t ecg_file_encode_block(uint8_t *dst, const CetiEcgSample *samples, const uint16_t *flags, uint32_t sample_count, EcgFileCodec codec);
+int ecg_file_verify_block(const uint8_t *src, size_t length, const CetiEcgSample *samples, const uint16_t *flags, uint32_t sample_count);
+
+// reading
+int ecg_file_header_validate(const EcgFileHeader *header);
+int ecg_file_decode_block(const uint8_t *src, size_t length, CetiEcgSample *samples, uint16_t *flags, uint32_t capacity, size_t *consumed);
+int ecg_file_to_csv(FILE *in, FILE *out);
+
+#endif // UTILS_ECG_FILE_H
@@ -0,0 +1,128 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+// Recording files grow a little at a time alongside every other sensor's
+// files, so left to itself the filesystem scatters them across the card and
+// later offloads turn into many short reads. Reserving a file's expected size
+// as soon as it is created keeps it in as few extents as the free space
+// allows. The reservation is made past the end of the file, so readers and
+// writers see the same size as without it, and whatever was not used is
+// handed back when the file is closed.
+//-----------------------------------------------------------------------------
+#include "file_rotation.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+void file_rotation_init(FileRotation *self, uint32_t period_s, double initial_ratio) {
+    self->period_s = (period_s != 0) ? period_s : 1;
+    self->next_boundary_us = 0;
+    self->ratio = initial_ratio;
+}
+
+/**
+ * @brief First multiple of `period_s` seconds of wall-clock time after
+ * `time_us`. Periods that are a whole number of minutes start files on the
+ * minute.
+ */
+int64_t file_rotation_boundary_after(int64_t time_us, uint32_t period_s) {
+    int64_t period_us = (int64_t)period_s * 1000000;
+    int64_t boundary_us = (time_us / period_us) * period_us;
+    if (boundary_us > time_us) {
+        boundary_us -= period_us; // time_us before 1970
+    }
+    return boundary_us + period_us;
+}
+
+/**
+ * @brief Whether audio captured at `time_us` belongs in a new file.
+ */
+int file_rotation_due(const FileRotation *self, int64_t time_us) {
+    return (self->next_boundary_us == 0) || (time_us >= self->next_boundary_us);
+}
+
+/**
+ * @brief Starts a file with audio captured at `time_us`.
+ *
+ * @return time the file should end
+ */
+int64_t file_rotation_start(FileRotation *self, int64_t time_us) {
+    self->next_boundary_us = file_rotation_boundary_after(time_us, self->period_s);
+    return self->next_boundary_us;
+}
+
+/**
+ * @brief Bytes to reserve for a file expected to hold `input_bytes` of
+ * samples, never less than the samples themselves would take uncompressed.
+ */
+size_t file_rotation_estimate(const FileRotation *self, size_t input_bytes) {
+    double estimate = input_bytes * self->ratio * (1.0 + FILE_ROTATION_HEADROOM);
+    if (estimate > input_bytes * (1.0 + FILE_ROTATION_HEADROOM)) {
+        estimate = input_bytes * (1.0 + FILE_ROTATION_HEADROOM);
+    }
+    return (size_t)estimate;
+}
+
+/**
+ * @brief Learns the size of the next file from one that held `input_bytes`
+ * of samples in `output_bytes`.
+ */
+void file_rotation_update(FileRotation *self, size_t input_bytes, size_t output_bytes) {
+    if (input_bytes == 0) {
+        return;
+    }
+    double ratio = (double)output_bytes / input_bytes;
+    self->ratio = (ratio > FILE_ROTATION_MIN_RATIO) ? ratio : FILE_ROTATION_MIN_RATIO;
+}
+
+/**
+ * @brief Reserves `size` bytes from `offset` without changing the file size.
+ *
+ * @return 0 on success, otherwise an errno value (EOPNOTSUPP if the
+ * filesystem can't reserve space)
+ */
+int file_rotation_preallocate(int fd, off_t offset, size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+    if (fallocate(fd, FALLOC_FL_KEEP_SIZE, offset, size) != 0) {
+        return errno;
+    }
+    return 0;
+}
+
+/**
+ * @brief Releases space reserved past the end of the file.
+ *
+ * @return 0 on success, otherwise an errno value
+ */
+int file_rotation_trim(int fd) {
+    struct stat file_stat;
+    if ((fstat(fd, &file_stat) != 0) || (ftruncate(fd, file_stat.st_size) != 0)) {
+        return errno;
+    }
+    return 0;
+}
+
+/**
+ * @brief Releases space reserved past the end of a closed file.
+ *
+ * @param size if not NULL, set to the size of the file
+ * @return 0 on success, otherwise an errno value
+ */
+int file_rotation_trim_path(const char *path, off_t *size) {
+    struct stat file_stat;
+    if ((stat(path, &file_stat) != 0) || (truncate(path, file_stat.st_size) != 0)) {
+        return errno;
+    }
+    if (size != NULL) {
+        *size = file_stat.st_size;
+    }
+    return 0;
+}
@@ -0,0 +1,48 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+#ifndef UTILS_FILE_ROTATION_H
+#define UTILS_FILE_ROTATION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+//-----------------------------------------------------------------------------
+// Definitions/Configurations
+//-----------------------------------------------------------------------------
+#define FILE_ROTATION_HEADROOM (0.10) // extra space preallocated over the estimate
+#define FILE_ROTATION_MIN_RATIO (0.05)
+
+//-----------------------------------------------------------------------------
+// Typedefs
+//-----------------------------------------------------------------------------
+// Files that start on wall-clock boundaries every `period_s` seconds, with
+// their expected size reserved on the card when they are created. The
+// output/input ratio of the files written so far sizes the next one.
+typedef struct {
+    uint32_t period_s;
+    int64_t next_boundary_us; // the current file ends here, 0 before the first file
+    double ratio;             // expected output bytes per input byte
+} FileRotation;
+
+//-----------------------------------------------------------------------------
+// Methods
+//-----------------------------------------------------------------------------
+void file_rotation_init(FileRotation *self, uint32_t period_s, double initial_ratio);
+int64_t file_rotation_boundary_after(int64_t time_us, uint32_t period_s);
+int file_rotation_due(const FileRotation *self, int64_t time_us);
+int64_t file_rotation_start(FileRotation *self, int64_t time_us);
+size_t file_rotation_estimate(const FileRotation *self, size_t input_bytes);
+void file_rotation_update(FileRotation *self, size_t input_bytes, size_t output_bytes);
+
+// card allocation
+int file_rotation_preallocate(int fd, off_t offset, size_t size);
+int file_rotation_trim(int fd);
+int file_rotation_trim_path(const char *path, off_t *size);
+
+#endif // UTILS_FILE_ROTATION_H
@@ -0,0 +1,186 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+// Block index embedded in FLAC files. The encoder writes the reserved
+// APPLICATION block with the rest of the metadata (see sensors/audio.c);
+// these methods find it again in the encoded stream to fill it in or read it
+// back, so they work on the file bytes alone.
+//-----------------------------------------------------------------------------
+#include "flac_index.h"
+
+#include "../cetiTag.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define FLAC_STREAM_MARKER "fLaC"
+#define FLAC_METADATA_HEADER_SIZE (4)
+#define FLAC_METADATA_LAST (0x80)
+#define FLAC_METADATA_TYPE_MASK (0x7f)
+#define FLAC_METADATA_TYPE_APPLICATION (2)
+#define FLAC_APPLICATION_ID_SIZE (4)
+
+_Static_assert(sizeof(FlacIndexHeader) == 24, "FLAC index header layout changed");
+
+size_t flac_index_payload_size(uint32_t block_capacity) {
+    return sizeof(FlacIndexHeader) + (size_t)block_capacity * sizeof(AudioFileIndexEntry);
+}
+
+void flac_index_header_init(FlacIndexHeader *header, uint32_t frame_size, uint32_t sample_rate_hz, uint32_t block_capacity) {
+    memset(header, 0, sizeof(*header));
+    header->version = FLAC_INDEX_VERSION;
+    header->block_size = SPI_BLOCK_SIZE;
+    header->frame_size = frame_size;
+    header->sample_rate_hz = sample_rate_hz;
+    header->block_capacity = block_capacity;
+    header->block_count = 0;
+}
+
+/**
+ * @brief Walks the metadata blocks at the start of a FLAC stream for the
+ * block index.
+ *
+ * @param payload_offset set to the byte offset of the index payload
+ * @param payload_length set to the bytes reserved for the payload
+ * @return 0 if found, -1 otherwise
+ */
+int flac_index_locate(const uint8_t *flac, size_t length, size_t *payload_offset, size_t *payload_length) {
+    if ((length < sizeof(FLAC_STREAM_MARKER) - 1) || (memcmp(flac, FLAC_STREAM_MARKER, sizeof(FLAC_STREAM_MARKER) - 1) != 0)) {
+        return -1;
+    }
+
+    size_t position = sizeof(FLAC_STREAM_MARKER) - 1;
+    while (position + FLAC_METADATA_HEADER_SIZE <= length) {
+        const uint8_t *block = flac + position;
+        size_t block_length = ((size_t)block[1] << 16) | ((size_t)block[2] << 8) | block[3];
+        size_t body = position + FLAC_METADATA_HEADER_SIZE;
+        if (body + block_length > length) {
+            return -1;
+        }
+        if (((block[0] & FLAC_METADATA_TYPE_MASK) == FLAC_METADATA_TYPE_APPLICATION)
+            && (block_length >= FLAC_APPLICATION_ID_SIZE)
+            && (memcmp(flac + body, FLAC_INDEX_APPLICATION_ID, FLAC_APPLICATION_ID_SIZE) == 0)) {
+            *payload_offset = body + FLAC_APPLICATION_ID_SIZE;
+            *payload_length = block_length - FLAC_APPLICATION_ID_SIZE;
+            return 0;
+        }
+        if (block[0] & FLAC_METADATA_LAST) {
+            break;
+        }
+        position = body + block_length;
+    }
+    return -1;
+}
+
+/**
+ * @brief Fills in the block index reserved in an encoded FLAC stream.
+ *
+ * @return 0 on success, -1 if the stream has no index or it is too small
+ */
+int flac_index_update(uint8_t *flac, size_t length, const FlacIndexHeader *header, const AudioFileIndexEntry *entries) {
+    size_t offset;
+    size_t reserved;
+    if (flac_index_locate(flac, length, &offset, &reserved) != 0) {
+        return -1;
+    }
+    if ((header->block_count > header->block_capacity) || (flac_index_payload_size(header->block_count) > reserved)) {
+        return -1;
+    }
+    memcpy(flac + offset, header, sizeof(*header));
+    memcpy(flac + offset + sizeof(*header), entries, (size_t)header->block_count * sizeof(*entries));
+    return 0;
+}
+
+/**
+ * @brief Fills in the block index reserved in a FLAC file.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int flac_index_update_file(const char *path, const FlacIndexHeader *header, const AudioFileIndexEntry *entries) {
+    int fd = open(path, O_RDWR);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat file_stat;
+    if ((fstat(fd, &file_stat) != 0) || (file_stat.st_size == 0)) {
+        close(fd);
+        return -1;
+    }
+    void *address = mmap(NULL, file_stat.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) {
+        return -1;
+    }
+    int result = flac_index_update(address, file_stat.st_size, header, entries);
+    munmap(address, file_stat.st_size);
+    return result;
+}
+
+/**
+ * @brief Copies the block index out of a FLAC stream. The payload is not
+ * aligned within the stream, so the entries are copied to an allocation the
+ * caller frees.
+ *
+ * @return 0 on success, -1 if the stream has no valid index
+ */
+int flac_index_read(const uint8_t *flac, size_t length, FlacIndexHeader *header, AudioFileIndexEntry **entries) {
+    size_t offset;
+    size_t reserved;
+    *entries = NULL;
+    if (flac_index_locate(flac, length, &offset, &reserved) != 0) {
+        return -1;
+    }
+    if (reserved < sizeof(*header)) {
+        return -1;
+    }
+    memcpy(header, flac + offset, sizeof(*header));
+    if ((header->version != FLAC_INDEX_VERSION)
+        || (header->block_size == 0) || (header->frame_size == 0)
+        || (header->block_count > header->block_capacity)
+        || (flac_index_payload_size(header->block_count) > reserved)) {
+        return -1;
+    }
+
+    *entries = malloc(flac_index_payload_size(header->block_count) - sizeof(*header) + 1);
+    if (*entries == NULL) {
+        return -1;
+    }
+    memcpy(*entries, flac + offset + sizeof(*header), (size_t)header->block_count * sizeof(**entries));
+    return 0;
+}
+
+/**
+ * @brief Sample of the stream in which block `block` starts.
+ */
+uint64_t flac_index_block_sample(const FlacIndexHeader *header, uint32_t block) {
+    return (uint64_t)block * header->block_size / header->frame_size;
+}
+
+/**
+ * @brief Binary search of the index for the sample captured at `time_us`,
+ * interpolated from the start of its block at the sample rate. A time in a
+ * gap between blocks maps to the last sample before the gap.
+ *
+ * @return sample number, or -1 if `time_us` is before the first block
+ */
+int64_t flac_index_find_sample(const FlacIndexHeader *header, const AudioFileIndexEntry *entries, int64_t time_us) {
+    int64_t block = audio_file_find_block(entries, header->block_count, time_us);
+    if (block < 0) {
+        return -1;
+    }
+    uint64_t first = flac_index_block_sample(header, block);
+    uint64_t next = flac_index_block_sample(header, block + 1);
+    uint64_t offset = (uint64_t)(time_us - entries[block].sys_time_us) * header->sample_rate_hz / 1000000;
+    if (first + offset >= next) {
+        return next - 1;
+    }
+    return first + offset;
+}
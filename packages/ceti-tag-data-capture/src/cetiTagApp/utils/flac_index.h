@@ -0,0 +1,57 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+#ifndef UTILS_FLAC_INDEX_H
+#define UTILS_FLAC_INDEX_H
+
+#include "audio_file.h" // for AudioFileIndexEntry
+
+#include <stddef.h>
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Definitions/Configurations
+//-----------------------------------------------------------------------------
+// Block index carried in a FLAC APPLICATION metadata block with id
+// FLAC_INDEX_APPLICATION_ID. The payload, all fields little-endian, is a
+// FlacIndexHeader followed by block_capacity AudioFileIndexEntry, one per
+// SPI block encoded into the file. Only the first block_count are valid.
+//
+// Block n starts in sample n * block_size / frame_size of the stream. The
+// space is reserved when the encoder starts and filled in once the file has
+// been encoded.
+#define FLAC_INDEX_APPLICATION_ID "CETI"
+#define FLAC_INDEX_VERSION (1)
+
+//-----------------------------------------------------------------------------
+// Typedefs
+//-----------------------------------------------------------------------------
+typedef struct {
+    uint32_t version;        // FLAC_INDEX_VERSION
+    uint32_t block_size;     // bytes of interleaved samples per block
+    uint32_t frame_size;     // bytes per sample of all channels
+    uint32_t sample_rate_hz;
+    uint32_t block_capacity; // entries reserved
+    uint32_t block_count;    // entries valid
+} FlacIndexHeader;
+
+//-----------------------------------------------------------------------------
+// Methods
+//-----------------------------------------------------------------------------
+// writing
+size_t flac_index_payload_size(uint32_t block_capacity);
+void flac_index_header_init(FlacIndexHeader *header, uint32_t frame_size, uint32_t sample_rate_hz, uint32_t block_capacity);
+int flac_index_update(uint8_t *flac, size_t length, const FlacIndexHeader *header, const AudioFileIndexEntry *entries);
+int flac_index_update_file(const char *path, const FlacIndexHeader *header, const AudioFileIndexEntry *entries);
+
+// reading
+int flac_index_locate(const uint8_t *flac, size_t length, size_t *payload_offset, size_t *payload_length);
+int flac_index_read(const uint8_t *flac, size_t length, FlacIndexHeader *header, AudioFileIndexEntry **entries);
+uint64_t flac_index_block_sample(const FlacIndexHeader *header, uint32_t block);
+int64_t flac_index_find_sample(const FlacIndexHeader *header, const AudioFileIndexEntry *entries, int64_t time_us);
+
+#endif // UTILS_FLAC_INDEX_H
@@ -0,0 +1,105 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+// Fixed size log2 histogram. Cheap enough to update from time-critical
+// threads: no allocation, no locks, one count-leading-zeros per sample.
+//-----------------------------------------------------------------------------
+#include "histogram.h"
+
+#include <string.h> // for memset()
+
+void histogram_reset(Histogram *self) {
+    memset(self, 0, sizeof(*self));
+    self->min = UINT32_MAX;
+}
+
+int histogram_bucket_index(uint32_t value) {
+    if (value == 0) {
+        return 0;
+    }
+    int index = 32 - __builtin_clz(value);
+    return (index < HISTOGRAM_BUCKET_COUNT) ? index : (HISTOGRAM_BUCKET_COUNT - 1);
+}
+
+/**
+ * @brief Largest value counted by a bucket (ignoring the overflow bucket).
+ */
+uint32_t histogram_bucket_upper_bound(int index) {
+    if (index <= 0) {
+        return 0;
+    }
+    return (uint32_t)((1ULL << index) - 1);
+}
+
+void histogram_add(Histogram *self, uint32_t value) {
+    self->bucket[histogram_bucket_index(value)]++;
+    self->count++;
+    self->sum += value;
+    if (value < self->min) {
+        self->min = value;
+    }
+    if (value > self->max) {
+        self->max = value;
+    }
+}
+
+/**
+ * @brief Adds every value counted by `other` to `self`.
+ */
+void histogram_merge(Histogram *self, const Histogram *other) {
+    if (other->count == 0) {
+        return;
+    }
+    for (int i = 0; i < HISTOGRAM_BUCKET_COUNT; i++) {
+        self->bucket[i] += other->bucket[i];
+    }
+    self->count += other->count;
+    self->sum += other->sum;
+    if (other->min < self->min) {
+        self->min = other->min;
+    }
+    if (other->max > self->max) {
+        self->max = other->max;
+    }
+}
+
+/**
+ * @brief Estimates a percentile as the upper bound of the bucket it falls in,
+ * clamped to the largest value seen.
+ *
+ * @param percentile value between 0.0 and 100.0
+ */
+uint32_t histogram_percentile(const Histogram *self, double percentile) {
+    if (self->count == 0) {
+        return 0;
+    }
+
+    uint64_t target = (uint64_t)((percentile / 100.0) * self->count + 0.5);
+    if (target == 0) {
+        target = 1;
+    }
+
+    uint64_t cumulative = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKET_COUNT; i++) {
+        cumulative += self->bucket[i];
+        if (cumulative >= target) {
+            uint32_t bound = histogram_bucket_upper_bound(i);
+            if ((i == HISTOGRAM_BUCKET_COUNT - 1) || (bound > self->max)) {
+                return self->max;
+            }
+            return (bound < self->min) ? self->min : bound;
+        }
+    }
+    return self->max;
+}
+
+double histogram_mean(const Histogram *self) {
+    if (self->count == 0) {
+        return 0.0;
+    }
+    return (double)self->sum / (double)self->count;
+}
@@ -0,0 +1,38 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+#ifndef UTILS_HISTOGRAM_H
+#define UTILS_HISTOGRAM_H
+
+#include "../cetiTag.h" // for CetiHistogram
+
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Definitions/Configurations
+//-----------------------------------------------------------------------------
+#define HISTOGRAM_BUCKET_COUNT CETI_HISTOGRAM_BUCKET_COUNT
+
+//-----------------------------------------------------------------------------
+// Typedefs
+//-----------------------------------------------------------------------------
+// Same layout as published in shared memory, so histograms can be updated in
+// place for other processes to sample.
+typedef CetiHistogram Histogram;
+
+//-----------------------------------------------------------------------------
+// Methods
+//-----------------------------------------------------------------------------
+void histogram_reset(Histogram *self);
+void histogram_add(Histogram *self, uint32_t value);
+void histogram_merge(Histogram *self, const Histogram *other);
+int histogram_bucket_index(uint32_t value);
+uint32_t histogram_bucket_upper_bound(int index);
+uint32_t histogram_percentile(const Histogram *self, double percentile);
+double histogram_mean(const Histogram *self);
+
+#endif // UTILS_HISTOGRAM_H
@@ -37,7 +37,7 @@ int init_data_file(FILE *data_file, const char *data_filepath,
     }
     // Write headers if the file didn't already exist.
     if (!data_file_exists) {
-        char header[500] =
+        char header[1024] =
             "Timestamp [us]"
             ",RTC Count"
             ",Notes";
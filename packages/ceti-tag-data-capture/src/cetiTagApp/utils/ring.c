@@ -0,0 +1,141 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+// Single-producer/single-consumer ring bookkeeping.
+//
+// The producer only ever writes `head` and the consumer only ever writes
+// `tail`, so no locks are required. Each side loads the other's counter with
+// acquire semantics and publishes its own with release semantics so element
+// contents are visible before the counter that hands them over.
+//
+// Rings that keep only the most recent data (e.g. the decimated audio, click
+// and levels rings) have no consumer: the producer calls ring_release() itself
+// to drop the oldest element when ring_reserve() fails, and is then the only
+// thread that may release. Readers of such rings follow `head`, and because
+// the element they are copying can be overwritten meanwhile, they must load
+// `tail` again after copying and discard anything older than it.
+//-----------------------------------------------------------------------------
+#include "ring.h"
+
+void ring_init(CetiRing *self, uint32_t capacity, uint32_t element_size) {
+    self->capacity = capacity;
+    self->element_size = element_size;
+    ring_reset(self);
+}
+
+/**
+ * @brief Discards all elements and clears the overrun counter. Only safe
+ * while neither the producer nor the consumer is running.
+ */
+void ring_reset(CetiRing *self) {
+    atomic_store(&self->head, 0);
+    atomic_store(&self->tail, 0);
+    atomic_store(&self->overruns, 0);
+}
+
+/**
+ * @brief Number of elements published but not yet released.
+ */
+uint64_t ring_count(const CetiRing *self) {
+    uint64_t tail = atomic_load_explicit(&self->tail, memory_order_acquire);
+    uint64_t head = atomic_load_explicit(&self->head, memory_order_acquire);
+    return head - tail;
+}
+
+/**
+ * @brief Number of free elements available to the producer.
+ */
+uint64_t ring_space(const CetiRing *self) {
+    return self->capacity - ring_count(self);
+}
+
+/**
+ * @brief Producer: get the slot of the next free element.
+ *
+ * @param slot receives the index of the element to fill
+ * @return 0 on success, -1 if the ring is full
+ */
+int ring_reserve(CetiRing *self, uint32_t *slot) {
+    uint64_t head = atomic_load_explicit(&self->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&self->tail, memory_order_acquire);
+    if (head - tail >= self->capacity) {
+        return -1;
+    }
+    *slot = head % self->capacity;
+    return 0;
+}
+
+/**
+ * @brief Producer: hand the element filled after ring_reserve() to the
+ * consumer.
+ */
+void ring_publish(CetiRing *self) {
+    uint64_t head = atomic_load_explicit(&self->head, memory_order_relaxed);
+    atomic_store_explicit(&self->head, head + 1, memory_order_release);
+}
+
+/**
+ * @brief Producer: record elements lost because the ring was full.
+ */
+void ring_drop(CetiRing *self, uint32_t count) {
+    atomic_fetch_add_explicit(&self->overruns, count, memory_order_relaxed);
+}
+
+/**
+ * @brief Consumer: get the oldest unreleased elements.
+ *
+ * @param slot receives the index of the oldest unreleased element
+ * @return number of unreleased elements stored contiguously from `slot`
+ * (i.e. stopping at the end of the ring)
+ */
+uint32_t ring_peek(const CetiRing *self, uint32_t *slot) {
+    uint64_t tail = atomic_load_explicit(&self->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&self->head, memory_order_acquire);
+    uint64_t count = head - tail;
+    uint32_t first = tail % self->capacity;
+    uint32_t contiguous = self->capacity - first;
+    *slot = first;
+    return (count < contiguous) ? (uint32_t)count : contiguous;
+}
+
+/**
+ * @brief Consumer: return elements to the producer once they are no longer
+ * needed. On rings that keep only the most recent data the producer calls
+ * this itself to drop the oldest element (see the file header).
+ */
+void ring_release(CetiRing *self, uint32_t count) {
+    uint64_t tail = atomic_load_explicit(&self->tail, memory_order_relaxed);
+    atomic_store_explicit(&self->tail, tail + count, memory_order_release);
+}
+
+/**
+ * @brief Consumer: index of the oldest unreleased element.
+ */
+uint64_t ring_tail(const CetiRing *self) {
+    return atomic_load_explicit(&self->tail, memory_order_relaxed);
+}
+
+/**
+ * @brief Consumer: get published elements starting from the absolute
+ * element `index` rather than the tail. Lets helpers of the consumer work
+ * on different parts of the unreleased data at the same time, while the
+ * consumer alone decides when to release it.
+ *
+ * @param index absolute element index, must not be older than the tail
+ * @param slot receives the slot of element `index`
+ * @return number of published elements stored contiguously from `slot`
+ */
+uint32_t ring_peek_at(const CetiRing *self, uint64_t index, uint32_t *slot) {
+    uint64_t head = atomic_load_explicit(&self->head, memory_order_acquire);
+    uint32_t first = index % self->capacity;
+    uint32_t contiguous = self->capacity - first;
+    *slot = first;
+    if (head <= index) {
+        return 0;
+    }
+    return ((head - index) < contiguous) ? (uint32_t)(head - index) : contiguous;
+}
@@ -0,0 +1,36 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+#ifndef UTILS_RING_H
+#define UTILS_RING_H
+
+#include "../cetiTag.h" // for CetiRing
+
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Methods
+//-----------------------------------------------------------------------------
+void ring_init(CetiRing *self, uint32_t capacity, uint32_t element_size);
+void ring_reset(CetiRing *self);
+uint64_t ring_count(const CetiRing *self);
+uint64_t ring_space(const CetiRing *self);
+
+// producer
+int ring_reserve(CetiRing *self, uint32_t *slot);
+void ring_publish(CetiRing *self);
+void ring_drop(CetiRing *self, uint32_t count);
+
+// consumer
+uint32_t ring_peek(const CetiRing *self, uint32_t *slot);
+// also called by the producer to drop the oldest element on rings without a
+// consumer; readers following `head` must then re-check `tail` after copying
+void ring_release(CetiRing *self, uint32_t count);
+uint64_t ring_tail(const CetiRing *self);
+uint32_t ring_peek_at(const CetiRing *self, uint64_t index, uint32_t *slot);
+
+#endif // UTILS_RING_H
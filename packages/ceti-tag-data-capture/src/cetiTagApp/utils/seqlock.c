@@ -0,0 +1,47 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+// Sequence lock for data with a single writer that other threads and
+// processes sample. The writer never waits: it makes the sequence odd, updates
+// the data in place and makes it even again. Readers copy the data and retry
+// if the sequence was odd or moved while they copied, so a copy is never torn.
+//-----------------------------------------------------------------------------
+#include "seqlock.h"
+
+#include <string.h> // for memcpy()
+
+void seqlock_write_begin(_Atomic uint32_t *sequence) {
+    uint32_t value = atomic_load_explicit(sequence, memory_order_relaxed);
+    atomic_store_explicit(sequence, value + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+void seqlock_write_end(_Atomic uint32_t *sequence) {
+    uint32_t value = atomic_load_explicit(sequence, memory_order_relaxed);
+    atomic_store_explicit(sequence, value + 1, memory_order_release);
+}
+
+/**
+ * @brief Copies `size` bytes of data guarded by `sequence` from `src` to
+ * `dst`, retrying while the writer is updating it.
+ *
+ * @return 0 on success, -1 if every attempt overlapped an update
+ */
+int seqlock_read(const _Atomic uint32_t *sequence, void *dst, const void *src, size_t size) {
+    for (int attempt = 0; attempt < SEQLOCK_READ_ATTEMPTS; attempt++) {
+        uint32_t before = atomic_load_explicit(sequence, memory_order_acquire);
+        if (before & 1) {
+            continue;
+        }
+        memcpy(dst, src, size);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(sequence, memory_order_relaxed) == before) {
+            return 0;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,30 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+#ifndef UTILS_SEQLOCK_H
+#define UTILS_SEQLOCK_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Definitions/Configurations
+//-----------------------------------------------------------------------------
+#define SEQLOCK_READ_ATTEMPTS (100) // copies tried before a reader gives up
+
+//-----------------------------------------------------------------------------
+// Methods
+//-----------------------------------------------------------------------------
+// writer, only one thread may update the data guarded by a sequence
+void seqlock_write_begin(_Atomic uint32_t *sequence);
+void seqlock_write_end(_Atomic uint32_t *sequence);
+
+// reader, any thread or process
+int seqlock_read(const _Atomic uint32_t *sequence, void *dst, const void *src, size_t size);
+
+#endif // UTILS_SEQLOCK_H
@@ -0,0 +1,88 @@
+//-----------------------------------------------------------------------------
+// Microbenchmark for the audio unpack kernels.
+// Reports throughput of every available kernel in millions of sample sets
+// and millions of values (sample set * channels) per second.
+//
+// usage: audio_unpack [seconds of 192 kHz audio per pass (default 10)]
+//-----------------------------------------------------------------------------
+#include "cetiTagApp/dsp/audio_unpack.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_PASSES (5)
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench_kernel(const AudioUnpackKernel *kernel, const uint8_t *src, int32_t *dst, size_t n_samples) {
+    if (kernel == NULL) {
+        return;
+    }
+    double best_s = 1e9;
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        double start = now_s();
+        kernel->unpack(dst, src, n_samples);
+        double elapsed = now_s() - start;
+        if (elapsed < best_s) {
+            best_s = elapsed;
+        }
+    }
+    printf("%-20s %8.1f Msamples/s %8.1f Mvalues/s\n",
+           kernel->name,
+           n_samples / best_s / 1e6,
+           n_samples * kernel->channels / best_s / 1e6);
+}
+
+static void bench_selection(int channels, int bit_depth, uint32_t channel_mask, const uint8_t *src, int32_t *dst, size_t n_samples) {
+    AudioUnpackSelection selection;
+    if (audio_unpack_selection_init(&selection, channels, bit_depth, channel_mask) != 0) {
+        return;
+    }
+    double best_s = 1e9;
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        double start = now_s();
+        audio_unpack_selection_run(&selection, dst, src, n_samples);
+        double elapsed = now_s() - start;
+        if (elapsed < best_s) {
+            best_s = elapsed;
+        }
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "select %d of %dch %d-bit", selection.n_selected, channels, bit_depth);
+    printf("%-20s %8.1f Msamples/s %8.1f Mvalues/s\n",
+           name,
+           n_samples / best_s / 1e6,
+           n_samples * selection.n_selected / best_s / 1e6);
+}
+
+int main(int argc, char **argv) {
+    double seconds = (argc > 1) ? atof(argv[1]) : 10.0;
+    size_t n_samples = (size_t)(seconds * 192000);
+    uint8_t *src = malloc(n_samples * 4 * 3);
+    int32_t *dst = malloc(n_samples * 4 * sizeof(int32_t));
+    if ((src == NULL) || (dst == NULL)) {
+        fprintf(stderr, "failed to allocate buffers\n");
+        return 1;
+    }
+    for (size_t i = 0; i < n_samples * 4 * 3; i++) {
+        src[i] = rand() & 0xFF;
+    }
+
+    printf("audio unpack: %zu sample sets per pass, best of %d, NEON %s\n", n_samples, BENCH_PASSES, audio_unpack_neon_available() ? "available" : "unavailable");
+    const int layouts[][2] = {{3, 16}, {4, 16}, {3, 24}, {4, 24}};
+    for (size_t i = 0; i < sizeof(layouts) / sizeof(*layouts); i++) {
+        bench_kernel(audio_unpack_get_scalar_kernel(layouts[i][0], layouts[i][1]), src, dst, n_samples);
+        bench_kernel(audio_unpack_get_neon_kernel(layouts[i][0], layouts[i][1]), src, dst, n_samples);
+        bench_selection(layouts[i][0], layouts[i][1], 0x1, src, dst, n_samples);
+        bench_selection(layouts[i][0], layouts[i][1], 0x3, src, dst, n_samples);
+    }
+
+    free(src);
+    free(dst);
+    return 0;
+}
@@ -0,0 +1,69 @@
+//-----------------------------------------------------------------------------
+// Microbenchmark for the decimated audio stream.
+// Reports how much of one CPU decimating 3 channels of live audio takes for
+// each supported sample rate and output rate.
+//
+// usage: decimate [seconds of audio per pass (default 10)]
+//-----------------------------------------------------------------------------
+#include "cetiTagApp/dsp/decimate.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_PASSES (3)
+#define BENCH_CHANNELS (3)
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static Decimator decimator;
+
+static void bench_rate(const int32_t *src, int16_t *dst, double seconds, uint32_t sample_rate_hz, uint32_t output_rate_hz) {
+    if (decimator_init(&decimator, sample_rate_hz / output_rate_hz, BENCH_CHANNELS, 16) != 0) {
+        return;
+    }
+    size_t n_samples = (size_t)(seconds * sample_rate_hz);
+    double best_s = 1e9;
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        decimator_reset(&decimator);
+        double start = now_s();
+        decimator_process(&decimator, dst, src, n_samples);
+        double elapsed = now_s() - start;
+        if (elapsed < best_s) {
+            best_s = elapsed;
+        }
+    }
+    printf("%3u kHz -> %2u kHz %8.1f Msamples/s %6.2f%% of a CPU\n",
+           sample_rate_hz / 1000,
+           output_rate_hz / 1000,
+           n_samples / best_s / 1e6,
+           100.0 * best_s / seconds);
+}
+
+int main(int argc, char **argv) {
+    double seconds = (argc > 1) ? atof(argv[1]) : 10.0;
+    size_t max_samples = (size_t)(seconds * 192000);
+    int32_t *src = malloc(max_samples * BENCH_CHANNELS * sizeof(int32_t));
+    int16_t *dst = malloc(max_samples * BENCH_CHANNELS * sizeof(int16_t) / 2 + BENCH_CHANNELS * sizeof(int16_t));
+    if ((src == NULL) || (dst == NULL)) {
+        fprintf(stderr, "failed to allocate buffers\n");
+        return 1;
+    }
+    for (size_t i = 0; i < max_samples * BENCH_CHANNELS; i++) {
+        src[i] = (int16_t)rand();
+    }
+
+    printf("decimate: %d channels, %d multiply-adds per input sample, best of %d\n", BENCH_CHANNELS, DECIMATOR_TAPS_PER_PHASE, BENCH_PASSES);
+    const uint32_t rates[][2] = {{96000, 8000}, {96000, 24000}, {192000, 8000}, {192000, 24000}};
+    for (size_t i = 0; i < sizeof(rates) / sizeof(*rates); i++) {
+        bench_rate(src, dst, seconds, rates[i][0], rates[i][1]);
+    }
+
+    free(src);
+    free(dst);
+    return 0;
+}
@@ -0,0 +1,206 @@
+//-----------------------------------------------------------------------------
+// Offline FLAC tuning benchmark.
+// Runs a recording through a sweep of FLAC compression settings and reports
+// encode time per sample set, how much faster than real time that is, and
+// the compression ratio (encoded size / raw size, smaller is better).
+//
+// usage: flac_tuning [file [channels (default 3) [bit depth (default 16)
+//                    [sample rate (default 96000) [max seconds (default 60)]]]]]
+//
+// `file` is a hydrophone recording, either a .bin container written by the
+// raw audio writer, whose header gives the format, or a headerless .raw file
+// of interleaved big-endian samples from older firmware. Without a file, a
+// synthetic signal is used so the sweep still runs, but its compression
+// ratios mean little.
+//-----------------------------------------------------------------------------
+#include "cetiTagApp/dsp/audio_unpack.h"
+#include "cetiTagApp/dsp/flac_tuning.h"
+#include "cetiTagApp/utils/audio_file.h"
+
+#include <FLAC/stream_encoder.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_CHUNK_SAMPLES (16384) // sample sets handed to the encoder per call
+
+typedef struct {
+    int channels;
+    int bit_depth;
+    uint32_t sample_rate;
+    size_t n_samples;
+    int32_t *samples; // unpacked, interleaved
+} BenchAudio;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static FLAC__StreamEncoderWriteStatus count_bytes(const FLAC__StreamEncoder *encoder, const FLAC__byte buffer[], size_t bytes, uint32_t samples, uint32_t current_frame, void *client_data) {
+    *(size_t *)client_data += bytes;
+    return FLAC__STREAM_ENCODER_WRITE_STATUS_OK;
+}
+
+static int load_recording(BenchAudio *audio, const char *path, double max_seconds) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        perror(path);
+        return -1;
+    }
+    // a container describes its own format, a headerless file is all samples
+    AudioFileHeader header;
+    size_t data_bytes = SIZE_MAX;
+    if ((fread(&header, sizeof(header), 1, file) == 1) && (memcmp(header.magic, AUDIO_FILE_MAGIC, sizeof(header.magic)) == 0)) {
+        audio->channels = header.channels;
+        audio->bit_depth = header.bit_depth;
+        audio->sample_rate = header.sample_rate_hz;
+        data_bytes = (size_t)header.block_count * header.block_size;
+        fseek(file, (long)header.data_offset, SEEK_SET);
+    } else {
+        rewind(file);
+    }
+    const AudioUnpackKernel *kernel = audio_unpack_get_kernel(audio->channels, audio->bit_depth);
+    if (kernel == NULL) {
+        fclose(file);
+        fprintf(stderr, "no unpack kernel for %d channels at %d bits\n", audio->channels, audio->bit_depth);
+        return -1;
+    }
+    size_t sample_set_bytes = audio->channels * (audio->bit_depth / 8);
+    size_t max_bytes = (size_t)(max_seconds * audio->sample_rate) * sample_set_bytes;
+    if (max_bytes > data_bytes) {
+        max_bytes = data_bytes;
+    }
+    uint8_t *raw = malloc(max_bytes);
+    if (raw == NULL) {
+        fclose(file);
+        fprintf(stderr, "failed to allocate buffers\n");
+        return -1;
+    }
+    size_t n_bytes = fread(raw, 1, max_bytes, file);
+    fclose(file);
+
+    audio->n_samples = n_bytes / sample_set_bytes;
+    audio->samples = malloc(audio->n_samples * audio->channels * sizeof(int32_t));
+    if (audio->samples == NULL) {
+        free(raw);
+        fprintf(stderr, "failed to allocate buffers\n");
+        return -1;
+    }
+    kernel->unpack(audio->samples, raw, audio->n_samples);
+    free(raw);
+    return 0;
+}
+
+static int synthesize_recording(BenchAudio *audio, double seconds) {
+    audio->n_samples = (size_t)(seconds * audio->sample_rate);
+    audio->samples = malloc(audio->n_samples * audio->channels * sizeof(int32_t));
+    if (audio->samples == NULL) {
+        fprintf(stderr, "failed to allocate buffers\n");
+        return -1;
+    }
+    // low frequency tones, a little noise and a click every 0.5 s
+    double full_scale = (double)(1 << (audio->bit_depth - 1)) - 1;
+    for (size_t i = 0; i < audio->n_samples; i++) {
+        double t = (double)i / audio->sample_rate;
+        double click = ((i % (audio->sample_rate / 2)) < 64) ? 0.3 * sin(2 * M_PI * 12000 * t) : 0.0;
+        for (int c = 0; c < audio->channels; c++) {
+            double value = 0.1 * sin(2 * M_PI * (200 + 50 * c) * t) + click + 0.01 * ((double)rand() / RAND_MAX - 0.5);
+            audio->samples[i * audio->channels + c] = (int32_t)(value * full_scale);
+        }
+    }
+    return 0;
+}
+
+static void bench_setting(const BenchAudio *audio, const AudioFlacTuning *tuning) {
+    char description[256];
+    flac_tuning_describe(tuning, description, sizeof(description));
+
+    FLAC__StreamEncoder *encoder = FLAC__stream_encoder_new();
+    size_t encoded_bytes = 0;
+    FLAC__bool ok = (encoder != NULL);
+    ok = ok && FLAC__stream_encoder_set_channels(encoder, audio->channels);
+    ok = ok && FLAC__stream_encoder_set_bits_per_sample(encoder, audio->bit_depth);
+    ok = ok && FLAC__stream_encoder_set_sample_rate(encoder, audio->sample_rate);
+    ok = ok && FLAC__stream_encoder_set_total_samples_estimate(encoder, audio->n_samples);
+    ok = ok && (flac_tuning_apply(encoder, tuning) == 0);
+    ok = ok && (FLAC__stream_encoder_init_stream(encoder, count_bytes, NULL, NULL, NULL, &encoded_bytes) == FLAC__STREAM_ENCODER_INIT_STATUS_OK);
+    if (!ok) {
+        printf("%-90s  rejected by encoder\n", description);
+        if (encoder != NULL) {
+            FLAC__stream_encoder_delete(encoder);
+        }
+        return;
+    }
+
+    double start = now_s();
+    for (size_t i = 0; ok && (i < audio->n_samples); i += BENCH_CHUNK_SAMPLES) {
+        size_t n = (audio->n_samples - i < BENCH_CHUNK_SAMPLES) ? audio->n_samples - i : BENCH_CHUNK_SAMPLES;
+        ok = FLAC__stream_encoder_process_interleaved(encoder, &audio->samples[i * audio->channels], n);
+    }
+    ok = FLAC__stream_encoder_finish(encoder) && ok;
+    double elapsed = now_s() - start;
+    FLAC__stream_encoder_delete(encoder);
+    if (!ok) {
+        printf("%-90s  encoding failed\n", description);
+        return;
+    }
+
+    double raw_bytes = (double)audio->n_samples * audio->channels * (audio->bit_depth / 8);
+    printf("%-90s %8.3f us/sample %7.1fx real time %7.4f ratio\n",
+           description,
+           elapsed * 1e6 / audio->n_samples,
+           ((double)audio->n_samples / audio->sample_rate) / elapsed,
+           encoded_bytes / raw_bytes);
+}
+
+int main(int argc, char **argv) {
+    BenchAudio audio = {
+        .channels = (argc > 2) ? atoi(argv[2]) : 3,
+        .bit_depth = (argc > 3) ? atoi(argv[3]) : 16,
+        .sample_rate = (argc > 4) ? strtoul(argv[4], NULL, 0) : 96000,
+    };
+    double max_seconds = (argc > 5) ? atof(argv[5]) : 60.0;
+    int result = (argc > 1) ? load_recording(&audio, argv[1], max_seconds) : synthesize_recording(&audio, 10.0);
+    if (result != 0) {
+        return 1;
+    }
+    printf("flac tuning: %s, %zu sample sets, %d channels, %d bit, %u Hz\n",
+           (argc > 1) ? argv[1] : "synthetic signal", audio.n_samples, audio.channels, audio.bit_depth, audio.sample_rate);
+
+    // every compression level with its own defaults
+    for (int level = 0; level <= 8; level++) {
+        AudioFlacTuning tuning = {.compression_level = level, .mid_side = -1, .loose_mid_side = -1};
+        bench_setting(&audio, &tuning);
+    }
+
+    // block sizes and apodizations around the default level
+    const uint32_t blocksizes[] = {1152, 2304, 4096, 4608, 8192, 16384};
+    for (size_t i = 0; i < sizeof(blocksizes) / sizeof(*blocksizes); i++) {
+        AudioFlacTuning tuning = {.compression_level = 5, .blocksize = blocksizes[i], .mid_side = -1, .loose_mid_side = -1};
+        bench_setting(&audio, &tuning);
+    }
+    const char *apodizations[] = {"tukey(5e-1)", "hann", "welch", "tukey(5e-1);partial_tukey(2)", "tukey(5e-1);partial_tukey(2);punchout_tukey(3)"};
+    for (size_t i = 0; i < sizeof(apodizations) / sizeof(*apodizations); i++) {
+        AudioFlacTuning tuning = {.compression_level = 5, .mid_side = -1, .loose_mid_side = -1};
+        strncpy(tuning.apodization, apodizations[i], sizeof(tuning.apodization) - 1);
+        bench_setting(&audio, &tuning);
+    }
+
+    // mid-side only changes anything for stereo recordings
+    if (audio.channels == 2) {
+        for (int mid_side = 0; mid_side <= 1; mid_side++) {
+            for (int loose = 0; loose <= mid_side; loose++) {
+                AudioFlacTuning tuning = {.compression_level = 5, .mid_side = mid_side, .loose_mid_side = loose};
+                bench_setting(&audio, &tuning);
+            }
+        }
+    }
+
+    free(audio.samples);
+    return 0;
+}
@@ -0,0 +1,168 @@
+//-----------------------------------------------------------------------------
+// Benchmark for ECG acquisition on data-ready edges.
+// A simulated ADC thread finishes a conversion every millisecond and pulls
+// its data-ready line low. The acquisition loop either spins on the line the
+// way ecg_thread_getData() polls, or blocks in ecg_drdy_wait() with the
+// simulated ADC pushing each edge the way the GPIO callback does. Each
+// sample costs a simulated I2C read that sleeps in the kernel.
+//
+// Reports the acquisition thread's CPU use, the jitter of the recorded
+// sample periods, and how late the recorded timestamps are compared to the
+// conversions. The simulated edge is delivered without pigpio's own
+// latency, so run it on the tag to see realistic figures.
+//
+// usage: ecg_drdy [samples (default 5000)]
+//-----------------------------------------------------------------------------
+#include "cetiTagApp/sensors/ecg_helpers/ecg_drdy.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_PERIOD_US (1000) // ECG_SAMPLING_PERIOD_US
+#define BENCH_I2C_READ_US (150) // 3 bytes at 400 kHz plus the transfer overhead
+#define BENCH_TIMEOUT_US (100000)
+
+typedef struct {
+    int edge;
+    int samples;
+    _Atomic int stop;
+    _Atomic int data_ready_n;         // simulated data-ready line, 0 when a conversion is ready
+    _Atomic int64_t conversion_us;    // time of the latest conversion
+    EcgDataReady data_ready;
+    int64_t *timestamps_us;           // recorded by the acquisition loop
+    int64_t *latency_us;              // recorded timestamp minus conversion time
+    int64_t cpu_us;                   // CPU time used by the acquisition loop
+} Bench;
+
+static int64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int64_t thread_cpu_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void *adc_thread(void *arg) {
+    Bench *bench = arg;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (!atomic_load(&bench->stop)) {
+        next.tv_nsec += BENCH_PERIOD_US * 1000;
+        if (next.tv_nsec >= 1000000000) {
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        int64_t conversion_us = now_us();
+        atomic_store(&bench->conversion_us, conversion_us);
+        atomic_store(&bench->data_ready_n, 0);
+        if (bench->edge) {
+            ecg_drdy_push(&bench->data_ready, conversion_us, (uint32_t)conversion_us);
+        }
+    }
+    return NULL;
+}
+
+static void read_adc(Bench *bench) {
+    usleep(BENCH_I2C_READ_US);
+    atomic_store(&bench->data_ready_n, 1);
+}
+
+static void *acquisition_thread(void *arg) {
+    Bench *bench = arg;
+    int64_t start_cpu_us = thread_cpu_us();
+    for (int i = 0; i < bench->samples; i++) {
+        int64_t timestamp_us;
+        if (bench->edge) {
+            EcgDataReadyEdge edge;
+            if (ecg_drdy_wait(&bench->data_ready, &edge, BENCH_TIMEOUT_US) == 0) {
+                edge.sys_time_us = now_us();
+            }
+            read_adc(bench);
+            timestamp_us = edge.sys_time_us;
+        } else {
+            while (atomic_load(&bench->data_ready_n) != 0) {
+                continue;
+            }
+            read_adc(bench);
+            timestamp_us = now_us();
+        }
+        bench->timestamps_us[i] = timestamp_us;
+        bench->latency_us[i] = timestamp_us - atomic_load(&bench->conversion_us);
+
+        if (!bench->edge) {
+            // same early wake-up as ecg_thread_getData()
+            int64_t elapsed_us = now_us() - timestamp_us;
+            if ((BENCH_PERIOD_US * 75 / 100 - elapsed_us) > 0) {
+                usleep(BENCH_PERIOD_US * 75 / 100 - elapsed_us);
+            }
+        }
+    }
+    bench->cpu_us = thread_cpu_us() - start_cpu_us;
+    return NULL;
+}
+
+static void run(int edge, int samples) {
+    Bench bench = {.edge = edge, .samples = samples, .data_ready_n = 1};
+    bench.timestamps_us = calloc(samples, sizeof(int64_t));
+    bench.latency_us = calloc(samples, sizeof(int64_t));
+    ecg_drdy_init(&bench.data_ready);
+
+    pthread_t adc;
+    pthread_t acquisition;
+    int64_t start_us = now_us();
+    pthread_create(&adc, NULL, adc_thread, &bench);
+    pthread_create(&acquisition, NULL, acquisition_thread, &bench);
+    pthread_join(acquisition, NULL);
+    int64_t wall_us = now_us() - start_us;
+    atomic_store(&bench.stop, 1);
+    pthread_join(adc, NULL);
+
+    // skip the first samples while the two threads line up
+    int first = 10;
+    double sum = 0;
+    double sum_sq = 0;
+    int64_t worst = 0;
+    double latency_sum = 0;
+    int64_t latency_worst = 0;
+    for (int i = first + 1; i < samples; i++) {
+        int64_t deviation = (bench.timestamps_us[i] - bench.timestamps_us[i - 1]) - BENCH_PERIOD_US;
+        sum += deviation;
+        sum_sq += (double)deviation * deviation;
+        worst = (llabs(deviation) > worst) ? llabs(deviation) : worst;
+        latency_sum += bench.latency_us[i];
+        latency_worst = (bench.latency_us[i] > latency_worst) ? bench.latency_us[i] : latency_worst;
+    }
+    int count = samples - first - 1;
+    double mean = sum / count;
+    printf("%-5s cpu %5.1f%% (%6.1f us/sample)  period jitter sd %6.1f us max %5lld us  timestamp late mean %6.1f us max %5lld us  missed %llu\n",
+           edge ? "edge" : "poll",
+           100.0 * bench.cpu_us / wall_us, (double)bench.cpu_us / samples,
+           sqrt(sum_sq / count - mean * mean), (long long)worst,
+           latency_sum / count, (long long)latency_worst,
+           (unsigned long long)bench.data_ready.missed);
+
+    ecg_drdy_destroy(&bench.data_ready);
+    free(bench.timestamps_us);
+    free(bench.latency_us);
+}
+
+int main(int argc, char **argv) {
+    int samples = (argc > 1) ? atoi(argv[1]) : 5000;
+    if (samples < 100) {
+        samples = 100;
+    }
+    printf("%d samples at %d us\n", samples, BENCH_PERIOD_US);
+    run(0, samples);
+    run(1, samples);
+    return 0;
+}
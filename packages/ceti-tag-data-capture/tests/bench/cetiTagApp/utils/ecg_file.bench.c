@@ -0,0 +1,147 @@
+//-----------------------------------------------------------------------------
+// Benchmark for the binary ECG file format.
+// Writes the same synthetic 1 kHz recording the way the ECG writer used to,
+// as CSV rows with fprintf reopening the file for every buffer, and as
+// encoded blocks appended to an open file with each codec. Reports bytes and
+// CPU time per sample for each, the Rice blocks including the check that
+// they decode, and how fast the binary file converts back to CSV.
+//
+// usage: ecg_file [directory (default .)] [buffers (default 60)]
+//-----------------------------------------------------------------------------
+#include "cetiTagApp/sensors/ecg_helpers/ecg_config.h"
+#include "cetiTagApp/utils/ecg_file.h"
+#include "cetiTagApp/utils/error.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_BUFFER_LENGTH (10000) // ECG_BUFFER_LENGTH
+
+static CetiEcgSample samples[BENCH_BUFFER_LENGTH];
+static uint16_t flags[BENCH_BUFFER_LENGTH];
+static uint8_t block[ECG_FILE_BLOCK_MAX_SIZE(BENCH_BUFFER_LENGTH)];
+
+static double cpu_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// a noisy ~1 Hz heartbeat around mid-scale, with a leads-off episode
+static void fill_buffer(int buffer) {
+    static int32_t noise = 0;
+    for (int i = 0; i < BENCH_BUFFER_LENGTH; i++) {
+        uint64_t n = (uint64_t)buffer * BENCH_BUFFER_LENGTH + i;
+        noise += (rand() % 201) - 100;
+        noise -= noise / 64;
+        int32_t beat = ((n % 1000) < 40) ? (int32_t)(200000 * (1.0 - (n % 1000) / 40.0)) : 0;
+        samples[i] = (CetiEcgSample){
+            .sys_time_us = 1718000000000000ULL + n * 1000 + (rand() % 30),
+            .sample_index = n,
+            .rtc_time_s = 1718000000 + n / 1000,
+            .ecg_reading = 4000000 + beat + noise,
+            .leadsOff_reading_p = ((n % 50000) < 2000),
+        };
+        flags[i] = ecg_file_sample_flags(&samples[i], 1);
+    }
+}
+
+// the ECG writer's loop before the binary format
+static void write_csv_buffer(const char *path) {
+    FILE *file = fopen(path, "at");
+    for (int i = 0; i < BENCH_BUFFER_LENGTH; i++) {
+        CetiEcgSample *sample = &samples[i];
+        fprintf(file, "%lu", sample->sys_time_us);
+        fprintf(file, ",%u", sample->rtc_time_s);
+        fprintf(file, ",");
+        if (sample->error != WT_OK) {
+            char err_str[512];
+            fprintf(file, "ERROR(%s) | ", wt_strerror_r(sample->error, err_str, sizeof(err_str)));
+        }
+        fprintf(file, ",%lu", sample->sample_index);
+        fprintf(file, ",%d", sample->ecg_reading);
+        fprintf(file, ",%u", sample->leadsOff_reading_p);
+        fprintf(file, ",%u", sample->leadsOff_reading_n);
+        fprintf(file, "\n");
+    }
+    fclose(file);
+}
+
+static void report(const char *name, long size, double cpu, long sample_count) {
+    printf("%-8s %8.2f bytes/sample %8.3f us/sample\n", name, (double)size / sample_count, cpu * 1e6 / sample_count);
+}
+
+int main(int argc, char **argv) {
+    const char *directory = (argc > 1) ? argv[1] : ".";
+    int buffers = (argc > 2) ? atoi(argv[2]) : 60;
+    long sample_count = (long)buffers * BENCH_BUFFER_LENGTH;
+    char csv_path[512];
+    char ecg_path[512];
+    char converted_path[512];
+    snprintf(csv_path, sizeof(csv_path), "%s/ecg_file_bench.csv", directory);
+    snprintf(ecg_path, sizeof(ecg_path), "%s/ecg_file_bench.ecg", directory);
+    snprintf(converted_path, sizeof(converted_path), "%s/ecg_file_bench.converted.csv", directory);
+    unlink(csv_path);
+    unlink(ecg_path);
+
+    printf("ecg file: %ld samples in %d buffers\n", sample_count, buffers);
+
+    // generate outside of the timed sections
+    double csv_cpu = 0;
+    double varint_cpu = 0;
+    long varint_size = sizeof(EcgFileHeader);
+    double rice_cpu = 0;
+    long ecg_size = 0;
+    int fd = open(ecg_path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    EcgFileHeader header;
+    CetiEcgFormat format = {.sampling_period_us = 1000, .gain = 1, .vref = ECG_VREF_EXTERNAL, .channel = 0};
+    ecg_file_header_init(&header, &format, 1, 0);
+    ecg_size += write(fd, &header, sizeof(header));
+    srand(1);
+    for (int buffer = 0; buffer < buffers; buffer++) {
+        fill_buffer(buffer);
+
+        double start = cpu_s();
+        write_csv_buffer(csv_path);
+        csv_cpu += cpu_s() - start;
+
+        start = cpu_s();
+        varint_size += ecg_file_encode_block(block, samples, flags, BENCH_BUFFER_LENGTH, ECG_FILE_CODEC_VARINT);
+        varint_cpu += cpu_s() - start;
+
+        start = cpu_s();
+        size_t size = ecg_file_encode_block(block, samples, flags, BENCH_BUFFER_LENGTH, ECG_FILE_CODEC_RICE);
+        if (ecg_file_verify_block(block, size, samples, flags, BENCH_BUFFER_LENGTH) != 0) {
+            printf("block %d did not decode\n", buffer);
+        }
+        ecg_size += write(fd, block, size);
+        rice_cpu += cpu_s() - start;
+    }
+    close(fd);
+
+    FILE *csv = fopen(csv_path, "r");
+    fseek(csv, 0, SEEK_END);
+    long csv_size = ftell(csv);
+    fclose(csv);
+    report("csv", csv_size, csv_cpu, sample_count);
+    report("varint", varint_size, varint_cpu, sample_count);
+    report("rice", ecg_size, rice_cpu, sample_count);
+
+    FILE *in = fopen(ecg_path, "rb");
+    FILE *out = fopen(converted_path, "w");
+    double start = cpu_s();
+    int converted = ecg_file_to_csv(in, out);
+    double convert_cpu = cpu_s() - start;
+    fclose(in);
+    fclose(out);
+    printf("to csv   %8.1f Msamples/s (%d samples)\n", converted / convert_cpu / 1e6, converted);
+
+    unlink(csv_path);
+    unlink(ecg_path);
+    unlink(converted_path);
+    return 0;
+}
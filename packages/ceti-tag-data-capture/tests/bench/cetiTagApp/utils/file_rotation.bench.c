@@ -0,0 +1,119 @@
+//-----------------------------------------------------------------------------
+// Benchmark for preallocated audio files.
+// Writes an audio file interleaved with a second, slowly growing file the way
+// the tag's other sensor logs grow alongside it, once letting the audio file
+// grow as written and once with its size reserved up front. Reports how many
+// extents the audio file ended up in and how fast it reads back
+// sequentially with a cold cache. Run it on the card to be measured.
+//
+// usage: file_rotation [directory (default .)] [MiB of audio (default 256)]
+//-----------------------------------------------------------------------------
+#include "cetiTagApp/utils/file_rotation.h"
+
+#include <fcntl.h>
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_CHUNK_SIZE (16384) // one SPI block
+#define BENCH_OTHER_SIZE (512)   // written to the other file per audio chunk
+#define BENCH_READ_SIZE (1 << 20)
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long count_extents(int fd) {
+    struct fiemap fiemap;
+    memset(&fiemap, 0, sizeof(fiemap));
+    fiemap.fm_length = FIEMAP_MAX_OFFSET;
+    fiemap.fm_flags = FIEMAP_FLAG_SYNC;
+    if (ioctl(fd, FS_IOC_FIEMAP, &fiemap) != 0) {
+        return -1;
+    }
+    return fiemap.fm_mapped_extents;
+}
+
+static void bench_file(const char *directory, size_t audio_bytes, int preallocate) {
+    char audio_path[512];
+    char other_path[512];
+    snprintf(audio_path, sizeof(audio_path), "%s/file_rotation_bench.audio", directory);
+    snprintf(other_path, sizeof(other_path), "%s/file_rotation_bench.other", directory);
+    int audio_fd = open(audio_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    int other_fd = open(other_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if ((audio_fd < 0) || (other_fd < 0)) {
+        perror("open");
+        exit(1);
+    }
+
+    static uint8_t chunk[BENCH_CHUNK_SIZE];
+    for (size_t i = 0; i < sizeof(chunk); i++) {
+        chunk[i] = rand();
+    }
+
+    double write_start_s = now_s();
+    if (preallocate) {
+        int error = file_rotation_preallocate(audio_fd, 0, audio_bytes + audio_bytes / 10);
+        if (error != 0) {
+            printf("%-14s preallocation not supported: %s\n", "preallocated", strerror(error));
+            goto cleanup;
+        }
+    }
+    for (size_t written = 0; written < audio_bytes; written += sizeof(chunk)) {
+        if ((write(audio_fd, chunk, sizeof(chunk)) != sizeof(chunk)) || (write(other_fd, chunk, BENCH_OTHER_SIZE) != BENCH_OTHER_SIZE)) {
+            perror("write");
+            exit(1);
+        }
+        // the tag's writers flush as they go, which is what interleaves the allocations
+        if ((written / sizeof(chunk)) % 64 == 63) {
+            fdatasync(audio_fd);
+            fdatasync(other_fd);
+        }
+    }
+    file_rotation_trim(audio_fd);
+    fsync(audio_fd);
+    double write_s = now_s() - write_start_s;
+    long extents = count_extents(audio_fd);
+
+    // read back with a cold cache
+    posix_fadvise(audio_fd, 0, 0, POSIX_FADV_DONTNEED);
+    static uint8_t buffer[BENCH_READ_SIZE];
+    lseek(audio_fd, 0, SEEK_SET);
+    double read_start_s = now_s();
+    size_t read_bytes = 0;
+    ssize_t n;
+    while ((n = read(audio_fd, buffer, sizeof(buffer))) > 0) {
+        read_bytes += n;
+    }
+    double read_s = now_s() - read_start_s;
+
+    printf("%-14s %6ld extents, write %7.1f MiB/s, read %7.1f MiB/s\n",
+           preallocate ? "preallocated" : "grown",
+           extents,
+           audio_bytes / write_s / (1 << 20),
+           read_bytes / read_s / (1 << 20));
+
+cleanup:
+    close(audio_fd);
+    close(other_fd);
+    unlink(audio_path);
+    unlink(other_path);
+}
+
+int main(int argc, char **argv) {
+    const char *directory = (argc > 1) ? argv[1] : ".";
+    size_t audio_mib = (argc > 2) ? strtoul(argv[2], NULL, 10) : 256;
+    size_t audio_bytes = audio_mib << 20;
+
+    printf("file rotation: %lu MiB of audio in %s\n", audio_mib, directory);
+    bench_file(directory, audio_bytes, 0);
+    bench_file(directory, audio_bytes, 1);
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+#include "cetiTagApp/dsp/audio_levels.h"
+
+#define TEST_RATE_HZ (96000)
+#define TEST_CHANNELS (3)
+#define TEST_SAMPLES (TEST_RATE_HZ)
+#define TEST_FRAME_INTERVAL (TEST_RATE_HZ / 32)
+#define TEST_BAND_HZ (TEST_RATE_HZ / 2 / AUDIO_LEVELS_BANDS)
+
+static AudioLevels levels;
+static CetiAudioLevels record;
+static int32_t input[TEST_SAMPLES * TEST_CHANNELS];
+
+static void fill(int bit_depth) {
+    double full_scale = ldexp(1.0, bit_depth - 1);
+    for (size_t i = 0; i < TEST_SAMPLES; i++) {
+        // a half scale 13.5 kHz tone, a quarter scale offset, silence
+        input[i * TEST_CHANNELS] = (int32_t)lround(0.5 * full_scale * sin(2.0 * M_PI * 13500.0 * i / TEST_RATE_HZ));
+        input[i * TEST_CHANNELS + 1] = (int32_t)lround(0.25 * full_scale);
+        input[i * TEST_CHANNELS + 2] = 0;
+    }
+}
+
+void test_audio_levels_init(void) {
+    TEST_ASSERT_EQUAL_INT(-1, audio_levels_init(&levels, 0, 16, TEST_FRAME_INTERVAL));
+    TEST_ASSERT_EQUAL_INT(-1, audio_levels_init(&levels, AUDIO_MAX_CHANNELS + 1, 16, TEST_FRAME_INTERVAL));
+    TEST_ASSERT_EQUAL_INT(-1, audio_levels_init(&levels, TEST_CHANNELS, 12, TEST_FRAME_INTERVAL));
+    TEST_ASSERT_EQUAL_INT(-1, audio_levels_init(&levels, TEST_CHANNELS, 16, AUDIO_LEVELS_FFT_SIZE - 1));
+    TEST_ASSERT_EQUAL_INT(0, audio_levels_init(&levels, TEST_CHANNELS, 16, AUDIO_LEVELS_FFT_SIZE));
+}
+
+void test_audio_levels_statistics(void) {
+    const int bit_depths[] = {16, 24};
+    for (int b = 0; b < 2; b++) {
+        fill(bit_depths[b]);
+        audio_levels_init(&levels, TEST_CHANNELS, bit_depths[b], TEST_FRAME_INTERVAL);
+        audio_levels_process(&levels, input, TEST_SAMPLES);
+        audio_levels_finish(&levels, &record);
+
+        TEST_ASSERT_EQUAL_UINT32(TEST_SAMPLES, record.samples);
+        TEST_ASSERT_EQUAL_UINT16(TEST_CHANNELS, record.channels);
+        TEST_ASSERT_EQUAL_UINT16(32, record.spectra);
+        TEST_ASSERT_FLOAT_WITHIN(0.05f, -9.03f, record.rms_dbfs[0]);
+        TEST_ASSERT_FLOAT_WITHIN(0.05f, -6.02f, record.peak_dbfs[0]);
+        TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f, record.dc[0]);
+        TEST_ASSERT_FLOAT_WITHIN(0.05f, -12.04f, record.rms_dbfs[1]);
+        TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.25f, record.dc[1]);
+        TEST_ASSERT_EQUAL_FLOAT(AUDIO_LEVELS_FLOOR_DBFS, record.rms_dbfs[2]);
+        TEST_ASSERT_EQUAL_FLOAT(AUDIO_LEVELS_FLOOR_DBFS, record.peak_dbfs[2]);
+    }
+}
+
+void test_audio_levels_bands(void) {
+    fill(16);
+    // a 34.5 kHz tone on channel 1, which shares an FFT with channel 0
+    for (size_t i = 0; i < TEST_SAMPLES; i++) {
+        input[i * TEST_CHANNELS + 1] += (int32_t)lround(3000.0 * sin(2.0 * M_PI * 34500.0 * i / TEST_RATE_HZ));
+    }
+    audio_levels_init(&levels, TEST_CHANNELS, 16, TEST_FRAME_INTERVAL);
+    audio_levels_process(&levels, input, TEST_SAMPLES);
+    audio_levels_finish(&levels, &record);
+
+    // all of the tone's power lands in its band, and none in the other channel
+    int band_0 = 13500 / TEST_BAND_HZ;
+    int band_1 = 34500 / TEST_BAND_HZ;
+    TEST_ASSERT_FLOAT_WITHIN(0.2f, -9.03f, record.band_dbfs[0][band_0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.2f, (float)(10.0 * log10(0.5 * pow(3000.0 / 32768.0, 2))), record.band_dbfs[1][band_1]);
+    for (int b = 0; b < AUDIO_LEVELS_BANDS; b++) {
+        if (b != band_0) {
+            TEST_ASSERT_TRUE(record.band_dbfs[0][b] < -80.0f);
+        }
+        if (b != band_1) {
+            // the offset is removed before the FFT
+            TEST_ASSERT_TRUE(record.band_dbfs[1][b] < -80.0f);
+        }
+        TEST_ASSERT_EQUAL_FLOAT(AUDIO_LEVELS_FLOOR_DBFS, record.band_dbfs[2][b]);
+    }
+}
+
+void test_audio_levels_intervals(void) {
+    // frames and totals carry across calls, totals restart with each interval
+    fill(16);
+    audio_levels_init(&levels, TEST_CHANNELS, 16, TEST_FRAME_INTERVAL);
+    audio_levels_process(&levels, input, 1000);
+    audio_levels_process(&levels, input + 1000 * TEST_CHANNELS, TEST_SAMPLES / 2 - 1000);
+    audio_levels_finish(&levels, &record);
+    TEST_ASSERT_EQUAL_UINT32(TEST_SAMPLES / 2, record.samples);
+    TEST_ASSERT_EQUAL_UINT16(16, record.spectra);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, -9.03f, record.rms_dbfs[0]);
+
+    audio_levels_finish(&levels, &record);
+    TEST_ASSERT_EQUAL_UINT32(0, record.samples);
+    TEST_ASSERT_EQUAL_FLOAT(AUDIO_LEVELS_FLOOR_DBFS, record.rms_dbfs[0]);
+    TEST_ASSERT_EQUAL_FLOAT(AUDIO_LEVELS_FLOOR_DBFS, record.band_dbfs[0][13500 / TEST_BAND_HZ]);
+}
+
+void setUp(void) {
+    // set stuff up here
+}
+
+void tearDown(void) {
+    // clean stuff up here
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_audio_levels_init);
+    RUN_TEST(test_audio_levels_statistics);
+    RUN_TEST(test_audio_levels_bands);
+    RUN_TEST(test_audio_levels_intervals);
+    return UNITY_END();
+}
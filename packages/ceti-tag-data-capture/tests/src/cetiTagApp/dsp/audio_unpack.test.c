@@ -0,0 +1,167 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unity.h>
+
+#include "cetiTagApp/dsp/audio_unpack.h"
+
+// long enough to exercise the vector loop and leave a scalar tail
+#define TEST_SAMPLES (103)
+
+static uint8_t src[TEST_SAMPLES * 4 * 3];
+static int32_t expected[TEST_SAMPLES * 4];
+static int32_t actual[TEST_SAMPLES * 4];
+
+static const int layouts[][2] = {{3, 16}, {4, 16}, {3, 24}, {4, 24}};
+
+static int32_t reference_unpack(const uint8_t *value, int bit_depth) {
+    if (bit_depth == 16) {
+        int32_t result = ((int32_t)value[0] << 8) | value[1];
+        return (result >= 0x8000) ? (result - 0x10000) : result;
+    }
+    int32_t result = ((int32_t)value[0] << 16) | ((int32_t)value[1] << 8) | value[2];
+    return (result >= 0x800000) ? (result - 0x1000000) : result;
+}
+
+static void fill_random(size_t n_bytes) {
+    for (size_t i = 0; i < n_bytes; i++) {
+        src[i] = rand() & 0xFF;
+    }
+}
+
+void test_unpack_known_values_16(void) {
+    const uint8_t values[][2] = {{0x00, 0x00}, {0x00, 0x01}, {0x7F, 0xFF}, {0x80, 0x00}, {0xFF, 0xFF}, {0x12, 0x34}};
+    const int32_t results[] = {0, 1, 32767, -32768, -1, 0x1234};
+    const AudioUnpackKernel *kernel = audio_unpack_get_scalar_kernel(3, 16);
+    TEST_ASSERT_NOT_NULL(kernel);
+
+    memcpy(src, values, sizeof(values));
+    kernel->unpack(actual, src, 2);
+    TEST_ASSERT_EQUAL_INT32_ARRAY(results, actual, 6);
+}
+
+void test_unpack_known_values_24(void) {
+    const uint8_t values[][3] = {{0x00, 0x00, 0x00}, {0x00, 0x00, 0x01}, {0x7F, 0xFF, 0xFF}, {0x80, 0x00, 0x00}, {0xFF, 0xFF, 0xFF}, {0x12, 0x34, 0x56}};
+    const int32_t results[] = {0, 1, 8388607, -8388608, -1, 0x123456};
+    const AudioUnpackKernel *kernel = audio_unpack_get_scalar_kernel(3, 24);
+    TEST_ASSERT_NOT_NULL(kernel);
+
+    memcpy(src, values, sizeof(values));
+    kernel->unpack(actual, src, 2);
+    TEST_ASSERT_EQUAL_INT32_ARRAY(results, actual, 6);
+}
+
+void test_unpack_all_layouts_match_reference(void) {
+    for (size_t i_layout = 0; i_layout < sizeof(layouts) / sizeof(*layouts); i_layout++) {
+        int channels = layouts[i_layout][0];
+        int bit_depth = layouts[i_layout][1];
+        int bytes_per_value = bit_depth / 8;
+        size_t n_values = TEST_SAMPLES * channels;
+
+        fill_random(n_values * bytes_per_value);
+        for (size_t i = 0; i < n_values; i++) {
+            expected[i] = reference_unpack(&src[i * bytes_per_value], bit_depth);
+        }
+
+        // both the selected kernel and scalar kernel must match the reference
+        const AudioUnpackKernel *kernels[] = {
+            audio_unpack_get_kernel(channels, bit_depth),
+            audio_unpack_get_scalar_kernel(channels, bit_depth),
+            audio_unpack_get_neon_kernel(channels, bit_depth),
+        };
+        for (size_t i_kernel = 0; i_kernel < 3; i_kernel++) {
+            if (kernels[i_kernel] == NULL) {
+                TEST_ASSERT_TRUE(i_kernel == 2); // only NEON may be unavailable
+                TEST_ASSERT_FALSE(audio_unpack_neon_available());
+                continue;
+            }
+            TEST_ASSERT_EQUAL_INT(channels, kernels[i_kernel]->channels);
+            TEST_ASSERT_EQUAL_INT(bit_depth, kernels[i_kernel]->bit_depth);
+
+            // guard value after the output checks for overruns
+            memset(actual, 0x5A, sizeof(actual));
+            kernels[i_kernel]->unpack(actual, src, TEST_SAMPLES);
+            TEST_ASSERT_EQUAL_INT32_ARRAY_MESSAGE(expected, actual, n_values, kernels[i_kernel]->name);
+            if (n_values < sizeof(actual) / sizeof(*actual)) {
+                TEST_ASSERT_EQUAL_HEX32(0x5A5A5A5A, actual[n_values]);
+            }
+        }
+    }
+}
+
+void test_unpack_selection_matches_reference(void) {
+    const uint32_t masks[] = {0x1, 0x2, 0x5, 0x6, 0x8, 0xB, 0xF};
+    for (size_t i_layout = 0; i_layout < sizeof(layouts) / sizeof(*layouts); i_layout++) {
+        int channels = layouts[i_layout][0];
+        int bit_depth = layouts[i_layout][1];
+        int bytes_per_value = bit_depth / 8;
+        fill_random(TEST_SAMPLES * channels * bytes_per_value);
+
+        for (size_t i_mask = 0; i_mask < sizeof(masks) / sizeof(*masks); i_mask++) {
+            uint32_t mask = masks[i_mask] & ((1u << channels) - 1);
+            AudioUnpackSelection selection;
+            if (mask == 0) {
+                TEST_ASSERT_EQUAL_INT(-1, audio_unpack_selection_init(&selection, channels, bit_depth, masks[i_mask]));
+                continue;
+            }
+            TEST_ASSERT_EQUAL_INT(0, audio_unpack_selection_init(&selection, channels, bit_depth, masks[i_mask]));
+
+            size_t n_values = 0;
+            for (size_t i = 0; i < TEST_SAMPLES; i++) {
+                for (int c = 0; c < channels; c++) {
+                    if (mask & (1u << c)) {
+                        expected[n_values++] = reference_unpack(&src[(i * channels + c) * bytes_per_value], bit_depth);
+                    }
+                }
+            }
+            TEST_ASSERT_EQUAL_INT(n_values, TEST_SAMPLES * selection.n_selected);
+
+            memset(actual, 0x5A, sizeof(actual));
+            audio_unpack_selection_run(&selection, actual, src, TEST_SAMPLES);
+            TEST_ASSERT_EQUAL_INT32_ARRAY(expected, actual, n_values);
+            if (n_values < sizeof(actual) / sizeof(*actual)) {
+                TEST_ASSERT_EQUAL_HEX32(0x5A5A5A5A, actual[n_values]);
+            }
+        }
+    }
+}
+
+void test_unpack_selection_keeps_stream_order(void) {
+    AudioUnpackSelection selection;
+    TEST_ASSERT_EQUAL_INT(0, audio_unpack_selection_init(&selection, 4, 16, 0xA));
+    TEST_ASSERT_EQUAL_INT(2, selection.n_selected);
+    TEST_ASSERT_EQUAL_UINT8(1, selection.selected[0]);
+    TEST_ASSERT_EQUAL_UINT8(3, selection.selected[1]);
+
+    // bits beyond the stream's channels are ignored
+    TEST_ASSERT_EQUAL_INT(0, audio_unpack_selection_init(&selection, 3, 24, 0xF));
+    TEST_ASSERT_EQUAL_INT(3, selection.n_selected);
+    TEST_ASSERT_TRUE(selection.kernel == audio_unpack_get_kernel(3, 24));
+
+    TEST_ASSERT_EQUAL_INT(-1, audio_unpack_selection_init(&selection, 2, 16, 0x3));
+}
+
+void test_unpack_unsupported_layout(void) {
+    TEST_ASSERT_NULL(audio_unpack_get_kernel(2, 16));
+    TEST_ASSERT_NULL(audio_unpack_get_kernel(3, 32));
+}
+
+void setUp(void) {
+    srand(time(NULL));
+}
+
+void tearDown(void) {
+    // clean stuff up here
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_unpack_known_values_16);
+    RUN_TEST(test_unpack_known_values_24);
+    RUN_TEST(test_unpack_all_layouts_match_reference);
+    RUN_TEST(test_unpack_selection_matches_reference);
+    RUN_TEST(test_unpack_selection_keeps_stream_order);
+    RUN_TEST(test_unpack_unsupported_layout);
+    return UNITY_END();
+}
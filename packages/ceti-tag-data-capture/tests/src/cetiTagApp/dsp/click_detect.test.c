@@ -0,0 +1,163 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+#include "cetiTagApp/dsp/click_detect.h"
+
+#define TEST_RATE_HZ (96000)
+#define TEST_CHANNELS (3)
+#define TEST_SAMPLES (3 * TEST_RATE_HZ / 2)
+#define TEST_CLICK_CHANNEL (1)
+#define TEST_CLICK_START (20000)
+#define TEST_CLICK_INTERVAL (TEST_RATE_HZ / 2)
+#define TEST_CLICK_COUNT (3)
+#define TEST_CLICK_LENGTH (48) // 0.5 ms
+
+static const AudioClickConfig config = {
+    .enabled = 1,
+    .band_low_hz = 5000,
+    .band_high_hz = 25000,
+    .threshold_db = 15.0f,
+    .holdoff_ms = 5,
+};
+
+static ClickDetector detector;
+static int32_t input[TEST_SAMPLES * TEST_CHANNELS];
+static ClickEvent events[16];
+static ClickEvent events_chunked[16];
+
+// low level white noise on every channel
+static void fill_noise(int32_t amplitude) {
+    uint32_t state = 12345;
+    for (size_t i = 0; i < TEST_SAMPLES * TEST_CHANNELS; i++) {
+        state = state * 1664525u + 1013904223u;
+        input[i] = (int32_t)(state >> 16) % (2 * amplitude + 1) - amplitude;
+    }
+}
+
+// Hann windowed 15 kHz bursts on one channel
+static void add_clicks(double amplitude) {
+    for (int k = 0; k < TEST_CLICK_COUNT; k++) {
+        size_t start = TEST_CLICK_START + k * TEST_CLICK_INTERVAL;
+        for (size_t n = 0; n < TEST_CLICK_LENGTH; n++) {
+            double window = 0.5 - 0.5 * cos(2.0 * M_PI * n / (TEST_CLICK_LENGTH - 1));
+            double value = amplitude * window * sin(2.0 * M_PI * 15000.0 * n / TEST_RATE_HZ);
+            input[(start + n) * TEST_CHANNELS + TEST_CLICK_CHANNEL] += (int32_t)lround(value);
+        }
+    }
+}
+
+void test_click_detect_init(void) {
+    AudioClickConfig bad = config;
+    TEST_ASSERT_EQUAL_INT(-1, click_detector_init(&detector, &config, TEST_RATE_HZ, CLICK_DETECTOR_MAX_CHANNELS + 1, 16));
+    TEST_ASSERT_EQUAL_INT(-1, click_detector_init(&detector, &config, TEST_RATE_HZ, TEST_CHANNELS, 8));
+    bad.band_low_hz = 30000;
+    TEST_ASSERT_EQUAL_INT(-1, click_detector_init(&detector, &bad, TEST_RATE_HZ, TEST_CHANNELS, 16));
+    bad.band_low_hz = 5000;
+    bad.threshold_db = 3.0f;
+    TEST_ASSERT_EQUAL_INT(-1, click_detector_init(&detector, &bad, TEST_RATE_HZ, TEST_CHANNELS, 16));
+
+    // the top of the band is capped below Nyquist rather than rejected
+    bad = config;
+    bad.band_high_hz = 90000;
+    TEST_ASSERT_EQUAL_INT(0, click_detector_init(&detector, &bad, TEST_RATE_HZ, TEST_CHANNELS, 16));
+    TEST_ASSERT_EQUAL_INT(0, click_detector_init(&detector, &config, TEST_RATE_HZ, TEST_CHANNELS, 24));
+    TEST_ASSERT_EQUAL_UINT32(480, detector.holdoff_samples);
+}
+
+void test_click_detect_clicks(void) {
+    fill_noise(30);
+    add_clicks(8000.0);
+    click_detector_init(&detector, &config, TEST_RATE_HZ, TEST_CHANNELS, 16);
+    size_t n_events = click_detector_process(&detector, input, TEST_SAMPLES, events, 16);
+    TEST_ASSERT_EQUAL_size_t(TEST_CLICK_COUNT, n_events);
+    for (size_t k = 0; k < n_events; k++) {
+        TEST_ASSERT_EQUAL_UINT8(TEST_CLICK_CHANNEL, events[k].channel);
+        TEST_ASSERT_UINT64_WITHIN(TEST_CLICK_LENGTH / 2, TEST_CLICK_START + k * TEST_CLICK_INTERVAL + TEST_CLICK_LENGTH / 4, events[k].sample);
+        TEST_ASSERT_TRUE(events[k].duration_samples < 4 * TEST_CLICK_LENGTH);
+        TEST_ASSERT_FLOAT_WITHIN(0.1f, 8000.0f / 32768.0f, events[k].amplitude);
+        TEST_ASSERT_TRUE(events[k].snr_db > config.threshold_db);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, events[0].ici_samples);
+    TEST_ASSERT_UINT32_WITHIN(4, TEST_CLICK_INTERVAL, events[1].ici_samples);
+    TEST_ASSERT_UINT32_WITHIN(4, TEST_CLICK_INTERVAL, events[2].ici_samples);
+}
+
+void test_click_detect_noise_only(void) {
+    fill_noise(3000);
+    click_detector_init(&detector, &config, TEST_RATE_HZ, TEST_CHANNELS, 16);
+    TEST_ASSERT_EQUAL_size_t(0, click_detector_process(&detector, input, TEST_SAMPLES, events, 16));
+    TEST_ASSERT_EQUAL_UINT64(0, detector.dropped_events);
+}
+
+void test_click_detect_rejects_low_tone(void) {
+    // a loud 500 Hz tone faded in on channel 0 is outside the band
+    fill_noise(30);
+    for (size_t i = 0; i < TEST_SAMPLES; i++) {
+        double fade = fmin(1.0, (double)i / (TEST_RATE_HZ / 10));
+        input[i * TEST_CHANNELS] += (int32_t)lround(20000.0 * fade * sin(2.0 * M_PI * 500.0 * i / TEST_RATE_HZ));
+    }
+    click_detector_init(&detector, &config, TEST_RATE_HZ, TEST_CHANNELS, 16);
+    TEST_ASSERT_EQUAL_size_t(0, click_detector_process(&detector, input, TEST_SAMPLES, events, 16));
+}
+
+void test_click_detect_event_limit(void) {
+    fill_noise(30);
+    add_clicks(8000.0);
+    click_detector_init(&detector, &config, TEST_RATE_HZ, TEST_CHANNELS, 16);
+    TEST_ASSERT_EQUAL_size_t(1, click_detector_process(&detector, input, TEST_SAMPLES, events, 1));
+    TEST_ASSERT_EQUAL_UINT64(TEST_CLICK_COUNT - 1, detector.dropped_events);
+
+    // dropped clicks still count towards the next interval
+    click_detector_reset(&detector);
+    size_t n_events = click_detector_process(&detector, input, TEST_CLICK_START + TEST_CLICK_INTERVAL, events, 0);
+    n_events = click_detector_process(&detector, input + (TEST_CLICK_START + TEST_CLICK_INTERVAL) * TEST_CHANNELS, TEST_SAMPLES - (TEST_CLICK_START + TEST_CLICK_INTERVAL), events, 16);
+    TEST_ASSERT_EQUAL_size_t(2, n_events);
+    TEST_ASSERT_UINT32_WITHIN(4, TEST_CLICK_INTERVAL, events[0].ici_samples);
+}
+
+void test_click_detect_chunked(void) {
+    // splitting the input anywhere gives the same events
+    fill_noise(30);
+    add_clicks(8000.0);
+    click_detector_init(&detector, &config, TEST_RATE_HZ, TEST_CHANNELS, 16);
+    size_t n_events = click_detector_process(&detector, input, TEST_SAMPLES, events, 16);
+
+    click_detector_init(&detector, &config, TEST_RATE_HZ, TEST_CHANNELS, 16);
+    size_t n_chunked = 0;
+    size_t position = 0;
+    size_t chunk = 1;
+    while (position < TEST_SAMPLES) {
+        size_t n = (chunk < TEST_SAMPLES - position) ? chunk : TEST_SAMPLES - position;
+        n_chunked += click_detector_process(&detector, input + position * TEST_CHANNELS, n, events_chunked + n_chunked, 16 - n_chunked);
+        position += n;
+        chunk = (chunk * 7 + 3) % 4999 + 1;
+    }
+    TEST_ASSERT_EQUAL_size_t(n_events, n_chunked);
+    for (size_t k = 0; k < n_events; k++) {
+        TEST_ASSERT_EQUAL_UINT64(events[k].sample, events_chunked[k].sample);
+        TEST_ASSERT_EQUAL_UINT32(events[k].ici_samples, events_chunked[k].ici_samples);
+        TEST_ASSERT_EQUAL_FLOAT(events[k].amplitude, events_chunked[k].amplitude);
+    }
+}
+
+void setUp(void) {
+    // set stuff up here
+}
+
+void tearDown(void) {
+    // clean stuff up here
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_click_detect_init);
+    RUN_TEST(test_click_detect_clicks);
+    RUN_TEST(test_click_detect_noise_only);
+    RUN_TEST(test_click_detect_rejects_low_tone);
+    RUN_TEST(test_click_detect_event_limit);
+    RUN_TEST(test_click_detect_chunked);
+    return UNITY_END();
+}
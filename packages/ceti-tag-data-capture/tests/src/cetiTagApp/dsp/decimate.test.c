@@ -0,0 +1,136 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+#include "cetiTagApp/dsp/decimate.h"
+
+#define TEST_RATE_HZ (96000)
+#define TEST_FACTOR (12)
+#define TEST_CHANNELS (3)
+#define TEST_SAMPLES (TEST_RATE_HZ / 4)
+
+static Decimator decimator;
+static int32_t input[TEST_SAMPLES * TEST_CHANNELS];
+static int16_t output[TEST_SAMPLES * TEST_CHANNELS];
+static int16_t output_chunked[TEST_SAMPLES * TEST_CHANNELS];
+
+// channel 0 carries the tone, the others stay silent
+static void fill_tone(double frequency_hz, double amplitude) {
+    memset(input, 0, sizeof(input));
+    for (size_t i = 0; i < TEST_SAMPLES; i++) {
+        input[i * TEST_CHANNELS] = (int32_t)lround(amplitude * sin(2.0 * M_PI * frequency_hz * i / TEST_RATE_HZ));
+    }
+}
+
+// peak output of a channel once the filter has settled
+static double settled_peak(const int16_t *samples, size_t n_samples, int channel) {
+    double peak = 0.0;
+    for (size_t i = DECIMATOR_TAPS_PER_PHASE; i < n_samples; i++) {
+        peak = fmax(peak, fabs(samples[i * TEST_CHANNELS + channel]));
+    }
+    return peak;
+}
+
+void test_decimate_init(void) {
+    TEST_ASSERT_EQUAL_INT(-1, decimator_init(&decimator, 1, TEST_CHANNELS, 16));
+    TEST_ASSERT_EQUAL_INT(-1, decimator_init(&decimator, DECIMATOR_MAX_FACTOR + 1, TEST_CHANNELS, 16));
+    TEST_ASSERT_EQUAL_INT(-1, decimator_init(&decimator, TEST_FACTOR, DECIMATOR_MAX_CHANNELS + 1, 16));
+    TEST_ASSERT_EQUAL_INT(-1, decimator_init(&decimator, TEST_FACTOR, TEST_CHANNELS, 8));
+    TEST_ASSERT_EQUAL_INT(0, decimator_init(&decimator, TEST_FACTOR, TEST_CHANNELS, 16));
+    TEST_ASSERT_EQUAL_UINT32(DECIMATOR_TAPS_PER_PHASE * TEST_FACTOR, decimator.taps);
+    TEST_ASSERT_EQUAL_size_t(TEST_FACTOR - 1, decimator_output_offset(&decimator));
+}
+
+void test_decimate_dc_gain(void) {
+    // 24-bit input comes out scaled to 16 bits
+    const int bit_depths[] = {16, 24};
+    for (int b = 0; b < 2; b++) {
+        decimator_init(&decimator, TEST_FACTOR, TEST_CHANNELS, bit_depths[b]);
+        for (size_t i = 0; i < TEST_SAMPLES * TEST_CHANNELS; i++) {
+            input[i] = ((i % TEST_CHANNELS) == 0 ? 1000 : -20000) * (1 << (bit_depths[b] - 16));
+        }
+        size_t n_out = decimator_process(&decimator, output, input, TEST_SAMPLES);
+        TEST_ASSERT_EQUAL_size_t(TEST_SAMPLES / TEST_FACTOR, n_out);
+        TEST_ASSERT_INT_WITHIN(1, 1000, output[(n_out - 1) * TEST_CHANNELS]);
+        TEST_ASSERT_INT_WITHIN(1, -20000, output[(n_out - 1) * TEST_CHANNELS + 1]);
+    }
+}
+
+void test_decimate_passband_and_stopband(void) {
+    decimator_init(&decimator, TEST_FACTOR, TEST_CHANNELS, 16);
+    fill_tone(1000.0, 16000.0);
+    size_t n_out = decimator_process(&decimator, output, input, TEST_SAMPLES);
+    TEST_ASSERT_FLOAT_WITHIN(160.0f, 16000.0f, (float)settled_peak(output, n_out, 0));
+    TEST_ASSERT_EQUAL_INT(0, (int)settled_peak(output, n_out, 1));
+
+    // 6 kHz would alias to 2 kHz, it must be at least 70 dB down
+    decimator_reset(&decimator);
+    fill_tone(6000.0, 16000.0);
+    n_out = decimator_process(&decimator, output, input, TEST_SAMPLES);
+    TEST_ASSERT_TRUE(settled_peak(output, n_out, 0) < 16000.0 * pow(10.0, -70.0 / 20.0));
+}
+
+void test_decimate_chunked(void) {
+    // splitting the input anywhere gives the same output
+    fill_tone(1500.0, 30000.0);
+    decimator_init(&decimator, TEST_FACTOR, TEST_CHANNELS, 16);
+    size_t n_out = decimator_process(&decimator, output, input, TEST_SAMPLES);
+
+    decimator_init(&decimator, TEST_FACTOR, TEST_CHANNELS, 16);
+    size_t n_chunked = 0;
+    size_t position = 0;
+    size_t chunk = 1;
+    while (position < TEST_SAMPLES) {
+        size_t n = (chunk < TEST_SAMPLES - position) ? chunk : TEST_SAMPLES - position;
+        TEST_ASSERT_TRUE(decimator_max_output(&decimator, n) >= (decimator.phase + n) / TEST_FACTOR);
+        n_chunked += decimator_process(&decimator, output_chunked + n_chunked * TEST_CHANNELS, input + position * TEST_CHANNELS, n);
+        position += n;
+        chunk = (chunk * 7 + 3) % 997 + 1;
+    }
+    TEST_ASSERT_EQUAL_size_t(n_out, n_chunked);
+    TEST_ASSERT_EQUAL_INT16_ARRAY(output, output_chunked, n_out * TEST_CHANNELS);
+}
+
+void test_decimate_saturates(void) {
+    decimator_init(&decimator, 2, 1, 24);
+    for (size_t i = 0; i < TEST_SAMPLES; i++) {
+        input[i] = (i & 1) ? 0x7fffff : -0x800000; // full scale at the input Nyquist frequency, removed
+    }
+    size_t n_out = decimator_process(&decimator, output, input, TEST_SAMPLES);
+    TEST_ASSERT_INT_WITHIN(4, 0, output[n_out - 1]);
+
+    for (size_t i = 0; i < TEST_SAMPLES; i++) {
+        input[i] = (i < TEST_SAMPLES / 2) ? 0x7fffff : -0x800000;
+    }
+    decimator_reset(&decimator);
+    n_out = decimator_process(&decimator, output, input, TEST_SAMPLES);
+    // full scale stays in range rather than wrapping
+    int16_t min = 0;
+    int16_t max = 0;
+    for (size_t i = 0; i < n_out; i++) {
+        min = (output[i] < min) ? output[i] : min;
+        max = (output[i] > max) ? output[i] : max;
+    }
+    TEST_ASSERT_EQUAL_INT16(32767, max);
+    TEST_ASSERT_EQUAL_INT16(-32768, min);
+}
+
+void setUp(void) {
+    // set stuff up here
+}
+
+void tearDown(void) {
+    // clean stuff up here
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_decimate_init);
+    RUN_TEST(test_decimate_dc_gain);
+    RUN_TEST(test_decimate_passband_and_stopband);
+    RUN_TEST(test_decimate_chunked);
+    RUN_TEST(test_decimate_saturates);
+    return UNITY_END();
+}
@@ -0,0 +1,109 @@
+#include <stdint.h>
+#include <unity.h>
+
+#include "cetiTagApp/sensors/audio_duty.h"
+
+#define S (1000000LL)
+
+static AudioDuty duty;
+
+static const AudioDutyConfig standby = {
+    .mode = AUDIO_DUTY_CYCLE_STANDBY,
+    .pretrigger_s = 10,
+    .hold_s = 60,
+    .silence_s = 0,
+};
+
+void test_audio_duty_off(void) {
+    AudioDutyConfig config = standby;
+    config.mode = AUDIO_DUTY_CYCLE_OFF;
+    audio_duty_init(&duty, &config, 0, 0);
+    TEST_ASSERT_EQUAL_INT(0, audio_duty_update(&duty, 3600 * S, 0, 0));
+    TEST_ASSERT_EQUAL_INT(AUDIO_DUTY_RECORD, duty.state);
+}
+
+void test_audio_duty_surface_hold(void) {
+    // recording carries on for the hold after start up, then stands by
+    audio_duty_init(&duty, &standby, 0, 0);
+    TEST_ASSERT_EQUAL_INT(0, audio_duty_update(&duty, 59 * S, 0, 0));
+    TEST_ASSERT_EQUAL_INT(AUDIO_DUTY_RECORD, duty.state);
+    TEST_ASSERT_EQUAL_INT(1, audio_duty_update(&duty, 60 * S, 0, 0));
+    TEST_ASSERT_EQUAL_INT(AUDIO_DUTY_STANDBY, duty.state);
+
+    // a click at the surface records for another hold
+    TEST_ASSERT_EQUAL_INT(1, audio_duty_update(&duty, 100 * S, 0, 1));
+    TEST_ASSERT_EQUAL_INT(AUDIO_DUTY_RECORD, duty.state);
+    audio_duty_update(&duty, 159 * S, 0, 1);
+    TEST_ASSERT_EQUAL_INT(AUDIO_DUTY_RECORD, duty.state);
+    audio_duty_update(&duty, 160 * S, 0, 1);
+    TEST_ASSERT_EQUAL_INT(AUDIO_DUTY_STANDBY, duty.state);
+    TEST_ASSERT_EQUAL_INT64(160 * S, duty.state_start_us);
+}
+
+void test_audio_duty_whole_dive(void) {
+    audio_duty_init(&duty, &standby, 0, 0);
+    audio_duty_update(&duty, 100 * S, 0, 0);
+    TEST_ASSERT_EQUAL_INT(AUDIO_DUTY_STANDBY, duty.state);
+
+    // without a silence limit the whole dive is recorded, then the hold
+    TEST_ASSERT_EQUAL_INT(1, audio_duty_update(&duty, 200 * S, 1, 0));
+    TEST_ASSERT_EQUAL_INT(AUDIO_DUTY_RECORD, duty.state);
+    audio_duty_update(&duty, 2000 * S, 1, 0);
+    TEST_ASSERT_EQUAL_INT(AUDIO_DUTY_RECORD, duty.state);
+    audio_duty_update(&duty, 2100 * S, 0, 0);
+    TEST_ASSERT_EQUAL_INT(AUDIO_DUTY_RECORD, duty.state);
+    audio_duty_update(&duty, 2160 * S, 0, 0);
+    TEST_ASSERT_EQUAL_INT(AUDIO_DUTY_STANDBY, duty.state);
+}
+
+void test_audio_duty_dive_silence(void) {
+    AudioDutyConfig config = standby;
+    config.silence_s = 120;
+    audio_duty_init(&duty, &config, 0, 0);
+    audio_duty_update(&duty, 100 * S, 1, 0);
+    audio_duty_update(&duty, 219 * S, 1, 0);
+    TEST_ASSERT_EQUAL_INT(AUDIO_DUTY_RECORD, duty.state);
+    audio_duty_update(&duty, 220 * S, 1, 0);
+    TEST_ASSERT_EQUAL_INT(AUDIO_DUTY_STANDBY, duty.state);
+
+    // clicks during the dive restart recording
+    audio_duty_update(&duty, 500 * S, 1, 3);
+    TEST_ASSERT_EQUAL_INT(AUDIO_DUTY_RECORD, duty.state);
+    audio_duty_update(&duty, 600 * S, 1, 4);
+    audio_duty_update(&duty, 719 * S, 1, 4);
+    TEST_ASSERT_EQUAL_INT(AUDIO_DUTY_RECORD, duty.state);
+    audio_duty_update(&duty, 720 * S, 1, 4);
+    TEST_ASSERT_EQUAL_INT(AUDIO_DUTY_STANDBY, duty.state);
+}
+
+void test_audio_duty_pause(void) {
+    // clicks can't be heard while paused, so the silence limit is ignored
+    AudioDutyConfig config = standby;
+    config.mode = AUDIO_DUTY_CYCLE_PAUSE;
+    config.silence_s = 120;
+    audio_duty_init(&duty, &config, 0, 7);
+    audio_duty_update(&duty, 60 * S, 0, 7);
+    TEST_ASSERT_EQUAL_INT(AUDIO_DUTY_PAUSED, duty.state);
+    audio_duty_update(&duty, 100 * S, 1, 7);
+    TEST_ASSERT_EQUAL_INT(AUDIO_DUTY_RECORD, duty.state);
+    audio_duty_update(&duty, 1000 * S, 1, 7);
+    TEST_ASSERT_EQUAL_INT(AUDIO_DUTY_RECORD, duty.state);
+}
+
+void setUp(void) {
+    // set stuff up here
+}
+
+void tearDown(void) {
+    // clean stuff up here
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_audio_duty_off);
+    RUN_TEST(test_audio_duty_surface_hold);
+    RUN_TEST(test_audio_duty_whole_dive);
+    RUN_TEST(test_audio_duty_dive_silence);
+    RUN_TEST(test_audio_duty_pause);
+    return UNITY_END();
+}
@@ -0,0 +1,210 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <unity.h>
+
+#include "cetiTagApp/cetiTag.h"
+#include "cetiTagApp/sensors/audio_sim.h"
+#include "cetiTagApp/utils/audio_file.h"
+
+// 96 kHz, 16-bit, 3 channels: 0.576 bytes/us, a block every 28444.4 us
+#define TEST_RATE_HZ (96000)
+#define TEST_FRAME_SIZE (6)
+
+static AudioSim sim;
+static uint8_t buffer[AUDIO_FIFO_SIZE_BYTES];
+
+static void write_file(const char *path, const void *data, size_t length) {
+    FILE *file = fopen(path, "wb");
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_EQUAL_size_t(length, fwrite(data, 1, length, file));
+    fclose(file);
+}
+
+void test_audio_sim_tone(void) {
+    AudioSimConfig config = {.tone_hz = 1000};
+    TEST_ASSERT_EQUAL_INT(0, audio_sim_init(&sim, &config, TEST_RATE_HZ, 16, 3, 0));
+    audio_sim_start(&sim, 0);
+
+    // junk byte after starting, then silence at phase 0
+    uint8_t frame[TEST_FRAME_SIZE];
+    audio_sim_read(&sim, frame, 1);
+    audio_sim_read(&sim, frame, TEST_FRAME_SIZE);
+    TEST_ASSERT_EACH_EQUAL_HEX8(0, frame, TEST_FRAME_SIZE);
+
+    // a quarter period of channel 0 in: 1, 2 and 3 kHz at +peak, 0, -peak
+    audio_sim_read(&sim, buffer, 23 * TEST_FRAME_SIZE);
+    audio_sim_read(&sim, frame, TEST_FRAME_SIZE);
+    uint8_t expected[TEST_FRAME_SIZE] = {0x40, 0x00, 0x00, 0x00, 0xc0, 0x00};
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, frame, TEST_FRAME_SIZE);
+    audio_sim_deinit(&sim);
+
+    // unsupported formats
+    TEST_ASSERT_EQUAL_INT(-1, audio_sim_init(&sim, &config, TEST_RATE_HZ, 20, 3, 0));
+    TEST_ASSERT_EQUAL_INT(-1, audio_sim_init(&sim, &config, TEST_RATE_HZ, 16, AUDIO_SIM_MAX_CHANNELS + 1, 0));
+}
+
+void test_audio_sim_data_ready(void) {
+    AudioSimConfig config = {.tone_hz = 1000};
+    audio_sim_init(&sim, &config, TEST_RATE_HZ, 16, 3, 0);
+    TEST_ASSERT_FALSE(audio_sim_data_ready(&sim, 100000)); // not started
+
+    audio_sim_start(&sim, 1000);
+    TEST_ASSERT_FALSE(audio_sim_data_ready(&sim, 1000 + 28444));
+    TEST_ASSERT_TRUE(audio_sim_data_ready(&sim, 1000 + 28445));
+    TEST_ASSERT_EQUAL_size_t(16384, audio_sim_fifo_level(&sim, 1000 + 28445));
+
+    // reading the block clears it until the next one fills
+    audio_sim_read(&sim, buffer, SPI_BLOCK_SIZE);
+    TEST_ASSERT_FALSE(audio_sim_data_ready(&sim, 1000 + 28445));
+    TEST_ASSERT_TRUE(audio_sim_data_ready(&sim, 1000 + 56889));
+
+    // stopping freezes the FIFO
+    audio_sim_stop(&sim, 1000 + 40000);
+    TEST_ASSERT_FALSE(audio_sim_data_ready(&sim, 1000 + 100000));
+    audio_sim_deinit(&sim);
+}
+
+void test_audio_sim_jitter(void) {
+    AudioSimConfig config = {.tone_hz = 1000, .jitter_us = 500};
+    audio_sim_init(&sim, &config, TEST_RATE_HZ, 16, 3, 0);
+    audio_sim_start(&sim, 0);
+    int64_t block_filled_us = 28445;
+    int late = 0;
+    for (int block = 0; block < 32; block++) {
+        TEST_ASSERT_FALSE(audio_sim_data_ready(&sim, block_filled_us - 1));
+        TEST_ASSERT_TRUE(audio_sim_data_ready(&sim, block_filled_us + 500));
+        late |= !audio_sim_data_ready(&sim, block_filled_us);
+        audio_sim_read(&sim, buffer, SPI_BLOCK_SIZE);
+        block_filled_us = (int64_t)ceil((sim.bytes_read + SPI_BLOCK_SIZE) / sim.bytes_per_us);
+    }
+    TEST_ASSERT_TRUE(late);
+    audio_sim_deinit(&sim);
+}
+
+void test_audio_sim_overflow(void) {
+    AudioSimConfig config = {.tone_hz = 1000};
+    audio_sim_init(&sim, &config, TEST_RATE_HZ, 16, 3, 0);
+    audio_sim_start(&sim, 0);
+    TEST_ASSERT_FALSE(audio_sim_overflow(&sim, 56889)); // exactly full
+    TEST_ASSERT_TRUE(audio_sim_overflow(&sim, 60000));
+    TEST_ASSERT_EQUAL_size_t(AUDIO_FIFO_SIZE_BYTES, audio_sim_fifo_level(&sim, 60000));
+
+    // latched until reset, even once drained
+    audio_sim_read(&sim, buffer, AUDIO_FIFO_SIZE_BYTES);
+    TEST_ASSERT_TRUE(audio_sim_overflow(&sim, 60000));
+    audio_sim_reset(&sim);
+    TEST_ASSERT_FALSE(audio_sim_overflow(&sim, 60000));
+    audio_sim_deinit(&sim);
+}
+
+void test_audio_sim_injected_overflow(void) {
+    AudioSimConfig config = {.tone_hz = 1000, .overflow_interval_s = 1};
+    audio_sim_init(&sim, &config, TEST_RATE_HZ, 16, 3, 0);
+    audio_sim_start(&sim, 0);
+
+    // kept drained, so only the injected overflow fires
+    int64_t now_us;
+    for (now_us = 0; now_us < 1000000; now_us += 10000) {
+        audio_sim_read(&sim, buffer, audio_sim_fifo_level(&sim, now_us));
+        TEST_ASSERT_FALSE(audio_sim_overflow(&sim, now_us));
+    }
+    TEST_ASSERT_TRUE(audio_sim_overflow(&sim, 1000000));
+
+    // restarting after recovery keeps the schedule
+    audio_sim_start(&sim, 1010000);
+    for (now_us = 1010000; now_us < 2000000; now_us += 10000) {
+        audio_sim_read(&sim, buffer, audio_sim_fifo_level(&sim, now_us));
+        TEST_ASSERT_FALSE(audio_sim_overflow(&sim, now_us));
+    }
+    TEST_ASSERT_TRUE(audio_sim_overflow(&sim, 2000000));
+    audio_sim_deinit(&sim);
+}
+
+void test_audio_sim_replay_raw(void) {
+    char path[] = "/tmp/audio_sim_test_XXXXXX";
+    close(mkstemp(path));
+    uint8_t samples[4 * TEST_FRAME_SIZE];
+    for (size_t i = 0; i < sizeof(samples); i++) {
+        samples[i] = i;
+    }
+    write_file(path, samples, sizeof(samples));
+
+    AudioSimConfig config = {0};
+    strcpy(config.file, path);
+    TEST_ASSERT_EQUAL_INT(0, audio_sim_init(&sim, &config, TEST_RATE_HZ, 16, 3, 0));
+    TEST_ASSERT_EQUAL_UINT64(4, sim.replay_frames);
+    audio_sim_start(&sim, 0);
+    audio_sim_read(&sim, buffer, 1);
+
+    // loops, and reads need not be frame aligned
+    audio_sim_read(&sim, buffer, 5);
+    audio_sim_read(&sim, buffer + 5, sizeof(samples) + 7);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(samples, buffer, sizeof(samples));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(samples, buffer + sizeof(samples), 12);
+    audio_sim_deinit(&sim);
+
+    // not a whole sample
+    write_file(path, samples, TEST_FRAME_SIZE - 1);
+    TEST_ASSERT_EQUAL_INT(-1, audio_sim_init(&sim, &config, TEST_RATE_HZ, 16, 3, 0));
+
+    strcpy(config.file, "/nonexistent/audio.raw");
+    TEST_ASSERT_EQUAL_INT(-1, audio_sim_init(&sim, &config, TEST_RATE_HZ, 16, 3, 0));
+    unlink(path);
+}
+
+void test_audio_sim_replay_container(void) {
+    char path[] = "/tmp/audio_sim_test_XXXXXX";
+    close(mkstemp(path));
+    AudioConfig audio_config = {.bit_depth = AUDIO_BIT_DEPTH_16, .sample_rate = AUDIO_SAMPLE_RATE_96KHZ};
+    AudioFileHeader header;
+    audio_file_header_init(&header, &audio_config, TEST_RATE_HZ, 3, 1);
+    header.block_count = 1;
+
+    // a block cut short after two samples
+    size_t length = header.data_offset + 2 * TEST_FRAME_SIZE;
+    uint8_t *file = calloc(1, length);
+    memcpy(file, &header, sizeof(header));
+    memset(file + header.data_offset, 0x11, TEST_FRAME_SIZE);
+    memset(file + header.data_offset + TEST_FRAME_SIZE, 0x22, TEST_FRAME_SIZE);
+    write_file(path, file, length);
+
+    AudioSimConfig config = {0};
+    strcpy(config.file, path);
+    TEST_ASSERT_EQUAL_INT(0, audio_sim_init(&sim, &config, TEST_RATE_HZ, 16, 3, 0));
+    TEST_ASSERT_EQUAL_UINT64(2, sim.replay_frames);
+    audio_sim_start(&sim, 0);
+    audio_sim_read(&sim, buffer, 1 + 3 * TEST_FRAME_SIZE);
+    TEST_ASSERT_EACH_EQUAL_HEX8(0x11, buffer + 1, TEST_FRAME_SIZE);
+    TEST_ASSERT_EACH_EQUAL_HEX8(0x22, buffer + 1 + TEST_FRAME_SIZE, TEST_FRAME_SIZE);
+    TEST_ASSERT_EACH_EQUAL_HEX8(0x11, buffer + 1 + 2 * TEST_FRAME_SIZE, TEST_FRAME_SIZE);
+    audio_sim_deinit(&sim);
+
+    // recorded with a different format
+    TEST_ASSERT_EQUAL_INT(-1, audio_sim_init(&sim, &config, TEST_RATE_HZ, 16, 2, 0));
+    free(file);
+    unlink(path);
+}
+
+void setUp(void) {
+    // set stuff up here
+}
+
+void tearDown(void) {
+    // clean stuff up here
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_audio_sim_tone);
+    RUN_TEST(test_audio_sim_data_ready);
+    RUN_TEST(test_audio_sim_jitter);
+    RUN_TEST(test_audio_sim_overflow);
+    RUN_TEST(test_audio_sim_injected_overflow);
+    RUN_TEST(test_audio_sim_replay_raw);
+    RUN_TEST(test_audio_sim_replay_container);
+    return UNITY_END();
+}
@@ -0,0 +1,108 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <unity.h>
+
+#include "cetiTagApp/sensors/ecg_helpers/ecg_drdy.h"
+
+static EcgDataReady data_ready;
+
+static int64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void test_ecg_drdy_takes_latest_edge(void) {
+    EcgDataReadyEdge edge;
+    ecg_drdy_push(&data_ready, 1000, 10);
+    TEST_ASSERT_EQUAL_INT(1, ecg_drdy_wait(&data_ready, &edge, 1000));
+    TEST_ASSERT_EQUAL_INT64(1000, edge.sys_time_us);
+    TEST_ASSERT_EQUAL_UINT32(10, edge.tick);
+    TEST_ASSERT_EQUAL_UINT64(0, data_ready.missed);
+
+    // conversions that arrived together: only the newest can still be read
+    ecg_drdy_push(&data_ready, 2000, 20);
+    ecg_drdy_push(&data_ready, 3000, 30);
+    ecg_drdy_push(&data_ready, 4000, 40);
+    TEST_ASSERT_EQUAL_INT(3, ecg_drdy_wait(&data_ready, &edge, 1000));
+    TEST_ASSERT_EQUAL_INT64(4000, edge.sys_time_us);
+    TEST_ASSERT_EQUAL_UINT32(40, edge.tick);
+    TEST_ASSERT_EQUAL_UINT64(2, data_ready.missed);
+}
+
+void test_ecg_drdy_times_out(void) {
+    EcgDataReadyEdge edge;
+    int64_t start_us = now_us();
+    TEST_ASSERT_EQUAL_INT(0, ecg_drdy_wait(&data_ready, &edge, 20000));
+    TEST_ASSERT_TRUE(now_us() - start_us >= 15000);
+
+    // the posts of edges taken in one wait do not wake the next one
+    ecg_drdy_push(&data_ready, 1000, 10);
+    ecg_drdy_push(&data_ready, 2000, 20);
+    TEST_ASSERT_EQUAL_INT(2, ecg_drdy_wait(&data_ready, &edge, 1000));
+    TEST_ASSERT_EQUAL_INT(0, ecg_drdy_wait(&data_ready, &edge, 1000));
+}
+
+void test_ecg_drdy_keeps_newest_when_behind(void) {
+    EcgDataReadyEdge edge;
+    for (int i = 0; i < 1000; i++) {
+        ecg_drdy_push(&data_ready, 1000 * (i + 1), i);
+    }
+    TEST_ASSERT_EQUAL_INT(1000, ecg_drdy_wait(&data_ready, &edge, 1000));
+    TEST_ASSERT_EQUAL_INT64(1000000, edge.sys_time_us);
+    TEST_ASSERT_EQUAL_UINT32(999, edge.tick);
+    TEST_ASSERT_EQUAL_UINT64(999, data_ready.missed);
+
+    ecg_drdy_push(&data_ready, 2000000, 2000);
+    TEST_ASSERT_EQUAL_INT(1, ecg_drdy_wait(&data_ready, &edge, 1000));
+    TEST_ASSERT_EQUAL_UINT32(2000, edge.tick);
+}
+
+void test_ecg_drdy_flush_discards_edges(void) {
+    EcgDataReadyEdge edge;
+    ecg_drdy_push(&data_ready, 1000, 10);
+    ecg_drdy_push(&data_ready, 2000, 20);
+    ecg_drdy_flush(&data_ready);
+    TEST_ASSERT_EQUAL_INT(0, ecg_drdy_wait(&data_ready, &edge, 1000));
+    TEST_ASSERT_EQUAL_UINT64(0, data_ready.missed);
+
+    ecg_drdy_push(&data_ready, 3000, 30);
+    TEST_ASSERT_EQUAL_INT(1, ecg_drdy_wait(&data_ready, &edge, 1000));
+    TEST_ASSERT_EQUAL_INT64(3000, edge.sys_time_us);
+    TEST_ASSERT_EQUAL_UINT32(30, edge.tick);
+}
+
+static void *push_later(void *arg) {
+    usleep(10000);
+    ecg_drdy_push(&data_ready, 5000, 50);
+    return NULL;
+}
+
+void test_ecg_drdy_wakes_on_push(void) {
+    EcgDataReadyEdge edge;
+    pthread_t producer;
+    pthread_create(&producer, NULL, push_later, NULL);
+    TEST_ASSERT_EQUAL_INT(1, ecg_drdy_wait(&data_ready, &edge, 1000000));
+    TEST_ASSERT_EQUAL_UINT32(50, edge.tick);
+    pthread_join(producer, NULL);
+}
+
+void setUp(void) {
+    ecg_drdy_init(&data_ready);
+}
+
+void tearDown(void) {
+    ecg_drdy_destroy(&data_ready);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_ecg_drdy_takes_latest_edge);
+    RUN_TEST(test_ecg_drdy_times_out);
+    RUN_TEST(test_ecg_drdy_keeps_newest_when_behind);
+    RUN_TEST(test_ecg_drdy_flush_discards_edges);
+    RUN_TEST(test_ecg_drdy_wakes_on_push);
+    return UNITY_END();
+}
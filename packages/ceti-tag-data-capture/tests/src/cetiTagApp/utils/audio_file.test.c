@@ -0,0 +1,134 @@
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <unity.h>
+
+#include "cetiTagApp/cetiTag.h"
+#include "cetiTagApp/utils/audio_file.h"
+
+static const AudioConfig config = {
+    .filter_type = AUDIO_FILTER_SINC5,
+    .sample_rate = AUDIO_SAMPLE_RATE_96KHZ,
+    .bit_depth = AUDIO_BIT_DEPTH_16,
+    .buffer_duration_s = 20,
+    .acquisition_mode = AUDIO_ACQUISITION_EDGE,
+};
+
+void test_audio_file_index_capacity(void) {
+    TEST_ASSERT_EQUAL_UINT32(0, audio_file_index_capacity(0));
+    TEST_ASSERT_EQUAL_UINT32(AUDIO_BLOCKS_PER_GROUP, audio_file_index_capacity(1));
+    TEST_ASSERT_EQUAL_UINT32(AUDIO_BLOCKS_PER_GROUP, audio_file_index_capacity(AUDIO_LCM_BYTES));
+    TEST_ASSERT_EQUAL_UINT32(2 * AUDIO_BLOCKS_PER_GROUP, audio_file_index_capacity(AUDIO_LCM_BYTES + 1));
+}
+
+void test_audio_file_header(void) {
+    AudioFileHeader header;
+    audio_file_header_init(&header, &config, 96000, 3, 27);
+    TEST_ASSERT_EQUAL_STRING(AUDIO_FILE_MAGIC, header.magic);
+    TEST_ASSERT_EQUAL_UINT32(96000, header.sample_rate_hz);
+    TEST_ASSERT_EQUAL_UINT16(16, header.bit_depth);
+    TEST_ASSERT_EQUAL_UINT16(3, header.channels);
+    TEST_ASSERT_EQUAL_UINT8(AUDIO_FILTER_SINC5, header.filter_type);
+    TEST_ASSERT_EQUAL_UINT32(SPI_BLOCK_SIZE, header.block_size);
+
+    // samples start page aligned after the index
+    TEST_ASSERT_EQUAL_UINT64(AUDIO_FILE_INDEX_OFFSET, header.index_offset);
+    TEST_ASSERT_EQUAL_UINT64(0, header.data_offset % AUDIO_FILE_ALIGNMENT);
+    TEST_ASSERT_TRUE(header.data_offset >= header.index_offset + 27 * sizeof(AudioFileIndexEntry));
+
+    TEST_ASSERT_EQUAL_INT(0, audio_file_header_validate(&header, header.data_offset));
+    TEST_ASSERT_EQUAL_INT(-1, audio_file_header_validate(&header, header.data_offset - 1));
+    header.block_count = 28;
+    TEST_ASSERT_EQUAL_INT(-1, audio_file_header_validate(&header, header.data_offset));
+    header.block_count = 0;
+    header.magic[0] = 'X';
+    TEST_ASSERT_EQUAL_INT(-1, audio_file_header_validate(&header, header.data_offset));
+}
+
+void test_audio_file_find_block(void) {
+    AudioFileIndexEntry index[5] = {
+        {.sys_time_us = 1000},
+        {.sys_time_us = 2000},
+        {.sys_time_us = 3000},
+        {.sys_time_us = 4500},
+        {.sys_time_us = 5000},
+    };
+    TEST_ASSERT_EQUAL_INT64(-1, audio_file_find_block(index, 5, 999));
+    TEST_ASSERT_EQUAL_INT64(0, audio_file_find_block(index, 5, 1000));
+    TEST_ASSERT_EQUAL_INT64(0, audio_file_find_block(index, 5, 1999));
+    TEST_ASSERT_EQUAL_INT64(2, audio_file_find_block(index, 5, 4499));
+    TEST_ASSERT_EQUAL_INT64(3, audio_file_find_block(index, 5, 4500));
+    TEST_ASSERT_EQUAL_INT64(4, audio_file_find_block(index, 5, 1000000));
+
+    // only valid entries are searched
+    TEST_ASSERT_EQUAL_INT64(1, audio_file_find_block(index, 2, 1000000));
+    TEST_ASSERT_EQUAL_INT64(-1, audio_file_find_block(index, 0, 1000000));
+}
+
+void test_audio_file_map(void) {
+    char path[] = "/tmp/audio_file_test_XXXXXX";
+    int fd = mkstemp(path);
+    TEST_ASSERT_TRUE(fd >= 0);
+
+    // a file with room for 9 blocks that was cut short after writing 3,
+    // although the header claims 4
+    AudioFileHeader header;
+    audio_file_header_init(&header, &config, 96000, 3, 9);
+    header.block_count = 4;
+    header.start_time_us = 1000;
+    size_t length = header.data_offset + 3 * SPI_BLOCK_SIZE;
+    uint8_t *contents = calloc(1, length);
+    memcpy(contents, &header, sizeof(header));
+    AudioFileIndexEntry *index = (AudioFileIndexEntry *)(contents + header.index_offset);
+    for (int i = 0; i < 4; i++) {
+        index[i].sys_time_us = 1000 + i * 100;
+        index[i].rtc_count = 7;
+        index[i].flags = (i == 2) ? AUDIO_BLOCK_FLAG_DISCONTINUITY : 0;
+    }
+    for (int i = 0; i < 3; i++) {
+        memset(contents + header.data_offset + i * SPI_BLOCK_SIZE, 0xA0 + i, SPI_BLOCK_SIZE);
+    }
+    TEST_ASSERT_EQUAL_size_t(length, write(fd, contents, length));
+    close(fd);
+    free(contents);
+
+    AudioFileMap map;
+    TEST_ASSERT_EQUAL_INT(0, audio_file_map(&map, path));
+    TEST_ASSERT_EQUAL_UINT32(3, map.block_count);
+    TEST_ASSERT_EQUAL_INT64(1000, map.header->start_time_us);
+    TEST_ASSERT_EQUAL_UINT32(AUDIO_BLOCK_FLAG_DISCONTINUITY, map.index[2].flags);
+
+    int64_t block = audio_file_find_block(map.index, map.block_count, 1250);
+    TEST_ASSERT_EQUAL_INT64(2, block);
+    TEST_ASSERT_EQUAL_HEX8(0xA2, audio_file_block(&map, block)[SPI_BLOCK_SIZE - 1]);
+    TEST_ASSERT_NULL(audio_file_block(&map, 3));
+    audio_file_unmap(&map);
+    TEST_ASSERT_NULL(map.address);
+
+    // not a raw audio file
+    fd = open(path, O_WRONLY | O_TRUNC);
+    TEST_ASSERT_EQUAL_INT(8, write(fd, "RIFF----", 8));
+    close(fd);
+    TEST_ASSERT_EQUAL_INT(-1, audio_file_map(&map, path));
+    unlink(path);
+}
+
+void setUp(void) {
+    // set stuff up here
+}
+
+void tearDown(void) {
+    // clean stuff up here
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_audio_file_index_capacity);
+    RUN_TEST(test_audio_file_header);
+    RUN_TEST(test_audio_file_find_block);
+    RUN_TEST(test_audio_file_map);
+    return UNITY_END();
+}
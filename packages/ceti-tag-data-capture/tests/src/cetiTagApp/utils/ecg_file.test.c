@@ -0,0 +1,240 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+#include "cetiTagApp/cetiTag.h"
+#include "cetiTagApp/sensors/ecg_helpers/ecg_config.h"
+#include "cetiTagApp/utils/ecg_file.h"
+#include "cetiTagApp/utils/error.h"
+
+#define TEST_SAMPLE_COUNT (1000)
+
+static CetiEcgSample samples[TEST_SAMPLE_COUNT];
+static uint16_t flags[TEST_SAMPLE_COUNT];
+static CetiEcgSample decoded[TEST_SAMPLE_COUNT];
+static uint16_t decoded_flags[TEST_SAMPLE_COUNT];
+static uint8_t block[ECG_FILE_BLOCK_MAX_SIZE(TEST_SAMPLE_COUNT)];
+
+static void fill_samples(uint32_t count) {
+    srand(1);
+    int32_t reading = 4000000;
+    for (uint32_t i = 0; i < count; i++) {
+        reading += (rand() % 2001) - 1000;
+        samples[i] = (CetiEcgSample){
+            .sys_time_us = 1718000000000000ULL + i * 1000 + (rand() % 50),
+            .sample_index = 123456 + i,
+            .rtc_time_s = 1718000000 + i / 1000,
+            .ecg_reading = reading,
+            .leadsOff_reading_p = (i / 100) % 2,
+            .leadsOff_reading_n = 0,
+        };
+        flags[i] = ecg_file_sample_flags(&samples[i], 1);
+    }
+}
+
+static void assert_samples_equal(const CetiEcgSample *expected, const CetiEcgSample *actual, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL_UINT64(expected[i].sys_time_us, actual[i].sys_time_us);
+        TEST_ASSERT_EQUAL_UINT64(expected[i].sample_index, actual[i].sample_index);
+        TEST_ASSERT_EQUAL_UINT32(expected[i].rtc_time_s, actual[i].rtc_time_s);
+        TEST_ASSERT_EQUAL_INT32(expected[i].ecg_reading, actual[i].ecg_reading);
+        TEST_ASSERT_EQUAL_INT32(expected[i].error, actual[i].error);
+        TEST_ASSERT_EQUAL_UINT16(expected[i].leadsOff_reading_p, actual[i].leadsOff_reading_p);
+        TEST_ASSERT_EQUAL_UINT16(expected[i].leadsOff_reading_n, actual[i].leadsOff_reading_n);
+    }
+}
+
+void test_ecg_file_header(void) {
+    EcgFileHeader header;
+    CetiEcgFormat format = {.sampling_period_us = 11111, .gain = 4, .vref = ECG_VREF_INTERNAL, .channel = 2};
+    ecg_file_header_init(&header, &format, 1, 1718000000000000LL);
+    TEST_ASSERT_EQUAL_STRING(ECG_FILE_MAGIC, header.magic);
+    TEST_ASSERT_EQUAL_UINT32(11111, header.sampling_period_us);
+    TEST_ASSERT_EQUAL_UINT8(1, header.lod_enabled);
+    TEST_ASSERT_EQUAL_UINT8(4, header.adc_gain);
+    TEST_ASSERT_EQUAL_UINT8(ECG_VREF_INTERNAL, header.adc_vref);
+    TEST_ASSERT_EQUAL_UINT8(2, header.adc_channel);
+    TEST_ASSERT_EQUAL_INT(0, ecg_file_header_validate(&header));
+    header.version++;
+    TEST_ASSERT_EQUAL_INT(-1, ecg_file_header_validate(&header));
+    header.version--;
+    header.magic[0] = 'X';
+    TEST_ASSERT_EQUAL_INT(-1, ecg_file_header_validate(&header));
+}
+
+static void round_trip(EcgFileCodec codec, size_t *encoded_size) {
+    size_t size = ecg_file_encode_block(block, samples, flags, TEST_SAMPLE_COUNT, codec);
+    TEST_ASSERT_TRUE(size <= ECG_FILE_BLOCK_MAX_SIZE(TEST_SAMPLE_COUNT));
+
+    size_t consumed = 0;
+    TEST_ASSERT_EQUAL_INT(TEST_SAMPLE_COUNT, ecg_file_decode_block(block, size, decoded, decoded_flags, TEST_SAMPLE_COUNT, &consumed));
+    TEST_ASSERT_EQUAL_size_t(size, consumed);
+    assert_samples_equal(samples, decoded, TEST_SAMPLE_COUNT);
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(flags, decoded_flags, TEST_SAMPLE_COUNT);
+    TEST_ASSERT_EQUAL_INT(0, ecg_file_verify_block(block, size, samples, flags, TEST_SAMPLE_COUNT));
+    if (encoded_size != NULL) {
+        *encoded_size = size;
+    }
+}
+
+void test_ecg_file_round_trip(void) {
+    fill_samples(TEST_SAMPLE_COUNT);
+    // 2 byte time deltas, 1 byte rtc and index deltas, 2 byte readings, and a leads-off plane
+    size_t varint_size = 0;
+    round_trip(ECG_FILE_CODEC_VARINT, &varint_size);
+    TEST_ASSERT_TRUE(varint_size < sizeof(EcgFileBlockHeader) + 7 * TEST_SAMPLE_COUNT);
+    // ~7 bit time residuals, 1 bit rtc and index residuals, ~11 bit readings
+    size_t rice_size = 0;
+    round_trip(ECG_FILE_CODEC_RICE, &rice_size);
+    TEST_ASSERT_TRUE(rice_size < sizeof(EcgFileBlockHeader) + 3 * TEST_SAMPLE_COUNT);
+}
+
+void test_ecg_file_rice_escapes(void) {
+    fill_samples(TEST_SAMPLE_COUNT);
+    // residuals far beyond what the block's Rice parameters expect
+    samples[100].ecg_reading = INT32_MAX;
+    samples[101].ecg_reading = INT32_MIN;
+    samples[500].sys_time_us = UINT64_MAX;
+    samples[501].sys_time_us = 0;
+    samples[700].sample_index = 0;
+    samples[998].rtc_time_s = UINT32_MAX;
+    round_trip(ECG_FILE_CODEC_RICE, NULL);
+    round_trip(ECG_FILE_CODEC_VARINT, NULL);
+
+    // a constant signal codes each residual in one bit
+    for (uint32_t i = 0; i < TEST_SAMPLE_COUNT; i++) {
+        samples[i].ecg_reading = -7;
+    }
+    round_trip(ECG_FILE_CODEC_RICE, NULL);
+}
+
+void test_ecg_file_verify_detects_corruption(void) {
+    fill_samples(TEST_SAMPLE_COUNT);
+    size_t size = ecg_file_encode_block(block, samples, flags, TEST_SAMPLE_COUNT, ECG_FILE_CODEC_RICE);
+    TEST_ASSERT_EQUAL_INT(0, ecg_file_verify_block(block, size, samples, flags, TEST_SAMPLE_COUNT));
+    block[sizeof(EcgFileBlockHeader) + size / 2] ^= 0x10;
+    TEST_ASSERT_EQUAL_INT(-1, ecg_file_verify_block(block, size, samples, flags, TEST_SAMPLE_COUNT));
+    block[sizeof(EcgFileBlockHeader) + size / 2] ^= 0x10;
+    flags[3] ^= ECG_FILE_FLAG_TIMEOUT;
+    TEST_ASSERT_EQUAL_INT(-1, ecg_file_verify_block(block, size, samples, flags, TEST_SAMPLE_COUNT));
+}
+
+void test_ecg_file_flags_and_errors(void) {
+    fill_samples(TEST_SAMPLE_COUNT);
+    samples[10].error = WT_RESULT(WT_DEV_ECG_ADC, WT_ERR_BAD_ECG_DATA_RATE);
+    samples[11].error = -1;
+    samples[500].leadsOff_reading_p = (uint16_t)-1;
+    samples[500].leadsOff_reading_n = (uint16_t)-1;
+    samples[999].ecg_reading = INT32_MIN; // largest possible delta
+    for (uint32_t i = 0; i < TEST_SAMPLE_COUNT; i++) {
+        flags[i] = ecg_file_sample_flags(&samples[i], 1);
+    }
+    TEST_ASSERT_EQUAL_HEX16(ECG_FILE_FLAG_ERROR, flags[10] & ECG_FILE_FLAG_ERROR);
+    TEST_ASSERT_EQUAL_HEX16(ECG_FILE_FLAG_LEADS_OFF_INVALID, flags[500]);
+    flags[0] |= ECG_FILE_FLAG_RESTARTED;
+    flags[42] |= ECG_FILE_FLAG_TIMEOUT | ECG_FILE_FLAG_MAYBE_INVALID;
+
+    round_trip(ECG_FILE_CODEC_VARINT, NULL);
+    round_trip(ECG_FILE_CODEC_RICE, NULL);
+}
+
+void test_ecg_file_sample_flags(void) {
+    CetiEcgSample sample = {
+        .flags = ECG_SAMPLE_FLAG_ZEROS | ECG_SAMPLE_FLAG_LEADS_OFF_P | ECG_SAMPLE_FLAG_ERROR,
+        .leadsOff_reading_n = 1,
+    };
+    // notes are kept, the rest follows the sample's readings
+    TEST_ASSERT_EQUAL_HEX16(ECG_SAMPLE_FLAG_ZEROS | ECG_SAMPLE_FLAG_LEADS_OFF_N, ecg_file_sample_flags(&sample, 1));
+    TEST_ASSERT_EQUAL_HEX16(ECG_SAMPLE_FLAG_ZEROS, ecg_file_sample_flags(&sample, 0));
+
+    // decoded samples carry their flags
+    fill_samples(TEST_SAMPLE_COUNT);
+    flags[7] |= ECG_FILE_FLAG_NEW_LOG;
+    size_t size = ecg_file_encode_block(block, samples, flags, TEST_SAMPLE_COUNT, ECG_FILE_CODEC_RICE);
+    TEST_ASSERT_EQUAL_INT(TEST_SAMPLE_COUNT, ecg_file_decode_block(block, size, decoded, decoded_flags, TEST_SAMPLE_COUNT, NULL));
+    for (uint32_t i = 0; i < TEST_SAMPLE_COUNT; i++) {
+        TEST_ASSERT_EQUAL_HEX32(flags[i], decoded[i].flags);
+    }
+}
+
+void test_ecg_file_rejects_bad_blocks(void) {
+    fill_samples(TEST_SAMPLE_COUNT);
+    size_t size = ecg_file_encode_block(block, samples, flags, TEST_SAMPLE_COUNT, ECG_FILE_CODEC_RICE);
+
+    // cut short, too many samples for the caller, or not a block at all
+    TEST_ASSERT_EQUAL_INT(-1, ecg_file_decode_block(block, size - 1, decoded, decoded_flags, TEST_SAMPLE_COUNT, NULL));
+    TEST_ASSERT_EQUAL_INT(-1, ecg_file_decode_block(block, size, decoded, decoded_flags, TEST_SAMPLE_COUNT - 1, NULL));
+    block[0] ^= 0xFF;
+    TEST_ASSERT_EQUAL_INT(-1, ecg_file_decode_block(block, size, decoded, decoded_flags, TEST_SAMPLE_COUNT, NULL));
+
+    // an empty block is valid
+    size = ecg_file_encode_block(block, samples, flags, 0, ECG_FILE_CODEC_RICE);
+    TEST_ASSERT_EQUAL_size_t(sizeof(EcgFileBlockHeader), size);
+    TEST_ASSERT_EQUAL_INT(0, ecg_file_decode_block(block, size, decoded, decoded_flags, TEST_SAMPLE_COUNT, NULL));
+
+    // unknown codec
+    size = ecg_file_encode_block(block, samples, flags, TEST_SAMPLE_COUNT, ECG_FILE_CODEC_RICE);
+    ((EcgFileBlockHeader *)block)->codec = 7;
+    TEST_ASSERT_EQUAL_INT(-1, ecg_file_decode_block(block, size, decoded, decoded_flags, TEST_SAMPLE_COUNT, NULL));
+}
+
+void test_ecg_file_to_csv(void) {
+    CetiEcgSample csv_samples[3] = {
+        {.sys_time_us = 1718000000000000ULL, .rtc_time_s = 1718000000, .sample_index = 7, .ecg_reading = -12},
+        {.sys_time_us = 1718000000001000ULL, .rtc_time_s = 1718000000, .sample_index = 8, .ecg_reading = 30, .leadsOff_reading_p = 1},
+        {.sys_time_us = 1718000000002001ULL, .rtc_time_s = 1718000001, .sample_index = 9, .ecg_reading = 31, .leadsOff_reading_n = 1},
+    };
+    uint16_t csv_flags[3];
+    for (int i = 0; i < 3; i++) {
+        csv_flags[i] = ecg_file_sample_flags(&csv_samples[i], 1);
+    }
+    csv_flags[0] |= ECG_FILE_FLAG_RESTARTED;
+    csv_flags[2] |= ECG_FILE_FLAG_ZEROS | ECG_FILE_FLAG_TIMEOUT;
+
+    FILE *in = tmpfile();
+    EcgFileHeader header;
+    CetiEcgFormat format = {.sampling_period_us = 1000, .gain = 1, .vref = ECG_VREF_EXTERNAL, .channel = 0};
+    ecg_file_header_init(&header, &format, 1, 0);
+    fwrite(&header, sizeof(header), 1, in);
+    size_t size = ecg_file_encode_block(block, csv_samples, csv_flags, 2, ECG_FILE_CODEC_VARINT);
+    fwrite(block, 1, size, in);
+    size = ecg_file_encode_block(block, &csv_samples[2], &csv_flags[2], 1, ECG_FILE_CODEC_RICE);
+    fwrite(block, 1, size, in);
+    fwrite(block, 1, size / 2, in); // torn final block is ignored
+    rewind(in);
+
+    char csv[1024] = {0};
+    FILE *out = fmemopen(csv, sizeof(csv) - 1, "w");
+    TEST_ASSERT_EQUAL_INT(3, ecg_file_to_csv(in, out));
+    fclose(out);
+    fclose(in);
+    TEST_ASSERT_EQUAL_STRING(
+        "Timestamp [us],RTC Count,Notes,Sample Index,ECG,Leads-Off-P,Leads-Off-N\n"
+        "1718000000000000,1718000000,Restarted! | ,7,-12,0,0\n"
+        "1718000000001000,1718000000,,8,30,1,0\n"
+        "1718000000002001,1718000001,ADC ZEROS | TIMEOUT | ,9,31,0,1\n",
+        csv);
+}
+
+void setUp(void) {
+    // set stuff up here
+}
+
+void tearDown(void) {
+    // clean stuff up here
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_ecg_file_header);
+    RUN_TEST(test_ecg_file_round_trip);
+    RUN_TEST(test_ecg_file_rice_escapes);
+    RUN_TEST(test_ecg_file_verify_detects_corruption);
+    RUN_TEST(test_ecg_file_flags_and_errors);
+    RUN_TEST(test_ecg_file_sample_flags);
+    RUN_TEST(test_ecg_file_rejects_bad_blocks);
+    RUN_TEST(test_ecg_file_to_csv);
+    return UNITY_END();
+}
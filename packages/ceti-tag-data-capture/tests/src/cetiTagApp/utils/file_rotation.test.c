@@ -0,0 +1,112 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unity.h>
+
+#include "cetiTagApp/utils/file_rotation.h"
+
+#define TEST_MINUTE_US (60LL * 1000000)
+#define TEST_FIVE_MINUTES_US (1718000100LL * 1000000) // a whole 5 minutes since 1970
+
+static FileRotation rotation;
+
+void test_file_rotation_boundaries_on_the_minute(void) {
+    int64_t base_us = TEST_FIVE_MINUTES_US;
+    TEST_ASSERT_EQUAL_INT64(base_us + 5 * TEST_MINUTE_US, file_rotation_boundary_after(base_us, 300));
+    TEST_ASSERT_EQUAL_INT64(base_us + 5 * TEST_MINUTE_US, file_rotation_boundary_after(base_us + 1, 300));
+    TEST_ASSERT_EQUAL_INT64(base_us + 5 * TEST_MINUTE_US, file_rotation_boundary_after(base_us + 3 * TEST_MINUTE_US + 7, 300));
+    TEST_ASSERT_EQUAL_INT64(base_us + TEST_MINUTE_US, file_rotation_boundary_after(base_us + TEST_MINUTE_US - 1, 60));
+    TEST_ASSERT_EQUAL_INT64(base_us + 2 * TEST_MINUTE_US, file_rotation_boundary_after(base_us + TEST_MINUTE_US, 60));
+
+    // every boundary is a whole number of periods since 1970
+    for (int64_t t = base_us; t < base_us + 20 * TEST_MINUTE_US; t += 12345678) {
+        int64_t boundary_us = file_rotation_boundary_after(t, 300);
+        TEST_ASSERT_EQUAL_INT64(0, boundary_us % (5 * TEST_MINUTE_US));
+        TEST_ASSERT_TRUE(boundary_us > t);
+        TEST_ASSERT_TRUE(boundary_us - t <= 5 * TEST_MINUTE_US);
+    }
+}
+
+void test_file_rotation_due(void) {
+    // the first file is cut short to line up with the clock
+    TEST_ASSERT_TRUE(file_rotation_due(&rotation, TEST_FIVE_MINUTES_US + 90 * 1000000LL));
+    TEST_ASSERT_EQUAL_INT64(TEST_FIVE_MINUTES_US + 5 * TEST_MINUTE_US, file_rotation_start(&rotation, TEST_FIVE_MINUTES_US + 90 * 1000000LL));
+    TEST_ASSERT_FALSE(file_rotation_due(&rotation, TEST_FIVE_MINUTES_US + 5 * TEST_MINUTE_US - 1));
+    TEST_ASSERT_TRUE(file_rotation_due(&rotation, TEST_FIVE_MINUTES_US + 5 * TEST_MINUTE_US));
+
+    // then whole periods
+    TEST_ASSERT_EQUAL_INT64(TEST_FIVE_MINUTES_US + 10 * TEST_MINUTE_US, file_rotation_start(&rotation, TEST_FIVE_MINUTES_US + 5 * TEST_MINUTE_US + 20000));
+}
+
+void test_file_rotation_estimate_learns_ratio(void) {
+    TEST_ASSERT_EQUAL_size_t(825000, file_rotation_estimate(&rotation, 1000000)); // 0.75 plus headroom
+
+    file_rotation_update(&rotation, 1000000, 500000);
+    TEST_ASSERT_EQUAL_size_t(550000, file_rotation_estimate(&rotation, 1000000));
+
+    // incompressible audio never needs more than its own size plus headroom
+    file_rotation_update(&rotation, 1000000, 1200000);
+    TEST_ASSERT_EQUAL_size_t(1100000, file_rotation_estimate(&rotation, 1000000));
+
+    // empty files say nothing about the next one
+    file_rotation_update(&rotation, 0, 0);
+    TEST_ASSERT_EQUAL_size_t(1100000, file_rotation_estimate(&rotation, 1000000));
+    file_rotation_update(&rotation, 1000000, 0);
+    TEST_ASSERT_TRUE(file_rotation_estimate(&rotation, 1000000) > 0);
+}
+
+void test_file_rotation_preallocate_and_trim(void) {
+    char path[] = "/tmp/file_rotation_testXXXXXX";
+    int fd = mkstemp(path);
+    TEST_ASSERT_TRUE(fd >= 0);
+
+    int result = file_rotation_preallocate(fd, 0, 4 << 20);
+    if (result == EOPNOTSUPP) {
+        close(fd);
+        unlink(path);
+        TEST_IGNORE_MESSAGE("filesystem can't preallocate");
+    }
+    TEST_ASSERT_EQUAL_INT(0, result);
+
+    // the reservation doesn't change the size
+    char data[4096];
+    memset(data, 0x5A, sizeof(data));
+    TEST_ASSERT_EQUAL_INT(sizeof(data), write(fd, data, sizeof(data)));
+    struct stat file_stat;
+    fstat(fd, &file_stat);
+    TEST_ASSERT_EQUAL_INT64(sizeof(data), file_stat.st_size);
+    TEST_ASSERT_TRUE((int64_t)file_stat.st_blocks * 512 >= (4 << 20));
+
+    TEST_ASSERT_EQUAL_INT(0, file_rotation_trim(fd));
+    fstat(fd, &file_stat);
+    TEST_ASSERT_EQUAL_INT64(sizeof(data), file_stat.st_size);
+    TEST_ASSERT_TRUE((int64_t)file_stat.st_blocks * 512 < (4 << 20));
+    close(fd);
+
+    off_t size = 0;
+    TEST_ASSERT_EQUAL_INT(0, file_rotation_trim_path(path, &size));
+    TEST_ASSERT_EQUAL_INT64(sizeof(data), size);
+    unlink(path);
+}
+
+void setUp(void) {
+    file_rotation_init(&rotation, 300, 0.75);
+}
+
+void tearDown(void) {
+    // clean stuff up here
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_file_rotation_boundaries_on_the_minute);
+    RUN_TEST(test_file_rotation_due);
+    RUN_TEST(test_file_rotation_estimate_learns_ratio);
+    RUN_TEST(test_file_rotation_preallocate_and_trim);
+    return UNITY_END();
+}
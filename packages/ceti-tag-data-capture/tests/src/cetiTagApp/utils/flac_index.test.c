@@ -0,0 +1,131 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+#include "cetiTagApp/cetiTag.h"
+#include "cetiTagApp/utils/flac_index.h"
+
+#define TEST_CAPACITY (4)
+
+static uint8_t stream[256];
+static size_t stream_length;
+static size_t payload_offset;
+
+static size_t append_metadata(size_t position, uint8_t type, int last, size_t length) {
+    stream[position] = type | (last ? 0x80 : 0);
+    stream[position + 1] = (length >> 16) & 0xff;
+    stream[position + 2] = (length >> 8) & 0xff;
+    stream[position + 3] = length & 0xff;
+    return position + 4;
+}
+
+// fLaC, STREAMINFO, SEEKTABLE with one point, the block index, then a frame
+static void build_stream(const char *application_id) {
+    size_t position = 4;
+    memset(stream, 0, sizeof(stream));
+    memcpy(stream, "fLaC", 4);
+    position = append_metadata(position, 0, 0, 34) + 34;
+    position = append_metadata(position, 3, 0, 18) + 18;
+    position = append_metadata(position, 2, 1, 4 + flac_index_payload_size(TEST_CAPACITY));
+    memcpy(stream + position, application_id, 4);
+    payload_offset = position + 4;
+    position = payload_offset + flac_index_payload_size(TEST_CAPACITY);
+    stream[position] = 0xff; // frame sync
+    stream[position + 1] = 0xf8;
+    stream_length = position + 2;
+}
+
+void test_flac_index_locate(void) {
+    size_t offset;
+    size_t length;
+    build_stream(FLAC_INDEX_APPLICATION_ID);
+    TEST_ASSERT_EQUAL_INT(0, flac_index_locate(stream, stream_length, &offset, &length));
+    TEST_ASSERT_EQUAL_size_t(payload_offset, offset);
+    TEST_ASSERT_EQUAL_size_t(flac_index_payload_size(TEST_CAPACITY), length);
+
+    // truncated before the end of the index
+    TEST_ASSERT_EQUAL_INT(-1, flac_index_locate(stream, payload_offset + 8, &offset, &length));
+
+    // some other application's block
+    build_stream("XYZW");
+    TEST_ASSERT_EQUAL_INT(-1, flac_index_locate(stream, stream_length, &offset, &length));
+
+    // not FLAC
+    build_stream(FLAC_INDEX_APPLICATION_ID);
+    stream[0] = 'R';
+    TEST_ASSERT_EQUAL_INT(-1, flac_index_locate(stream, stream_length, &offset, &length));
+}
+
+void test_flac_index_update_read(void) {
+    FlacIndexHeader header;
+    AudioFileIndexEntry entries[TEST_CAPACITY + 1] = {
+        {.sys_time_us = 1000, .rtc_count = 10, .flags = 0},
+        {.sys_time_us = 2000, .rtc_count = 10, .flags = AUDIO_BLOCK_FLAG_OVERFLOW},
+        {.sys_time_us = 9000, .rtc_count = 11, .flags = AUDIO_BLOCK_FLAG_DISCONTINUITY},
+    };
+    build_stream(FLAC_INDEX_APPLICATION_ID);
+    flac_index_header_init(&header, 6, 96000, TEST_CAPACITY);
+    header.block_count = 3;
+    TEST_ASSERT_EQUAL_INT(0, flac_index_update(stream, stream_length, &header, entries));
+    TEST_ASSERT_EQUAL_HEX8(0xff, stream[stream_length - 2]); // frames untouched
+
+    FlacIndexHeader read_header;
+    AudioFileIndexEntry *read_entries;
+    TEST_ASSERT_EQUAL_INT(0, flac_index_read(stream, stream_length, &read_header, &read_entries));
+    TEST_ASSERT_EQUAL_UINT32(3, read_header.block_count);
+    TEST_ASSERT_EQUAL_UINT32(SPI_BLOCK_SIZE, read_header.block_size);
+    TEST_ASSERT_EQUAL_UINT32(96000, read_header.sample_rate_hz);
+    TEST_ASSERT_EQUAL_INT64(9000, read_entries[2].sys_time_us);
+    TEST_ASSERT_EQUAL_UINT32(11, read_entries[2].rtc_count);
+    TEST_ASSERT_EQUAL_UINT32(AUDIO_BLOCK_FLAG_OVERFLOW, read_entries[1].flags);
+    free(read_entries);
+
+    // more blocks than were reserved
+    header.block_capacity = TEST_CAPACITY + 1;
+    header.block_count = TEST_CAPACITY + 1;
+    TEST_ASSERT_EQUAL_INT(-1, flac_index_update(stream, stream_length, &header, entries));
+}
+
+void test_flac_index_find_sample(void) {
+    FlacIndexHeader header;
+    // 16-bit, 3 channels: blocks do not hold a whole number of samples
+    flac_index_header_init(&header, 6, 96000, TEST_CAPACITY);
+    header.block_count = 3;
+    AudioFileIndexEntry entries[3] = {
+        {.sys_time_us = 1000000},
+        {.sys_time_us = 1028444},
+        {.sys_time_us = 2000000}, // after a gap
+    };
+    TEST_ASSERT_EQUAL_UINT64(0, flac_index_block_sample(&header, 0));
+    TEST_ASSERT_EQUAL_UINT64(2730, flac_index_block_sample(&header, 1));
+    TEST_ASSERT_EQUAL_UINT64(5461, flac_index_block_sample(&header, 2));
+
+    TEST_ASSERT_EQUAL_INT64(-1, flac_index_find_sample(&header, entries, 999999));
+    TEST_ASSERT_EQUAL_INT64(0, flac_index_find_sample(&header, entries, 1000000));
+    TEST_ASSERT_EQUAL_INT64(96, flac_index_find_sample(&header, entries, 1001000));
+    TEST_ASSERT_EQUAL_INT64(2730, flac_index_find_sample(&header, entries, 1028444));
+
+    // inside the gap, the last sample before it
+    TEST_ASSERT_EQUAL_INT64(5460, flac_index_find_sample(&header, entries, 1500000));
+    TEST_ASSERT_EQUAL_INT64(5461 + 960, flac_index_find_sample(&header, entries, 2010000));
+
+    // past the end, the last sample of the stream
+    TEST_ASSERT_EQUAL_INT64(8191, flac_index_find_sample(&header, entries, 2100000));
+}
+
+void setUp(void) {
+    // set stuff up here
+}
+
+void tearDown(void) {
+    // clean stuff up here
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_flac_index_locate);
+    RUN_TEST(test_flac_index_update_read);
+    RUN_TEST(test_flac_index_find_sample);
+    return UNITY_END();
+}
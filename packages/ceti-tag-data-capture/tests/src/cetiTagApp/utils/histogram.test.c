@@ -0,0 +1,93 @@
+#include <stdint.h>
+#include <unity.h>
+
+#include "cetiTagApp/utils/histogram.h"
+
+static Histogram hist;
+
+void test_histogram_bucket_index(void) {
+    TEST_ASSERT_EQUAL_INT(0, histogram_bucket_index(0));
+    TEST_ASSERT_EQUAL_INT(1, histogram_bucket_index(1));
+    TEST_ASSERT_EQUAL_INT(2, histogram_bucket_index(2));
+    TEST_ASSERT_EQUAL_INT(2, histogram_bucket_index(3));
+    TEST_ASSERT_EQUAL_INT(3, histogram_bucket_index(4));
+    TEST_ASSERT_EQUAL_INT(10, histogram_bucket_index(1023));
+    TEST_ASSERT_EQUAL_INT(11, histogram_bucket_index(1024));
+    TEST_ASSERT_EQUAL_INT(HISTOGRAM_BUCKET_COUNT - 1, histogram_bucket_index(UINT32_MAX));
+
+    // every value lands in a bucket whose bound covers it
+    for (uint32_t value = 0; value < (1 << 16); value++) {
+        int index = histogram_bucket_index(value);
+        TEST_ASSERT_TRUE(value <= histogram_bucket_upper_bound(index));
+        if (index > 0) {
+            TEST_ASSERT_TRUE(value > histogram_bucket_upper_bound(index - 1));
+        }
+    }
+}
+
+void test_histogram_stats(void) {
+    TEST_ASSERT_EQUAL_UINT32(0, histogram_percentile(&hist, 50.0));
+
+    for (uint32_t value = 1; value <= 100; value++) {
+        histogram_add(&hist, value);
+    }
+    TEST_ASSERT_EQUAL_UINT64(100, hist.count);
+    TEST_ASSERT_EQUAL_UINT32(1, hist.min);
+    TEST_ASSERT_EQUAL_UINT32(100, hist.max);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 50.5f, (float)histogram_mean(&hist));
+
+    // 50th value (50) is in bucket [32, 63]
+    TEST_ASSERT_EQUAL_UINT32(63, histogram_percentile(&hist, 50.0));
+    // 99th value (99) is in bucket [64, 127], clamped to max
+    TEST_ASSERT_EQUAL_UINT32(100, histogram_percentile(&hist, 99.0));
+    TEST_ASSERT_EQUAL_UINT32(100, histogram_percentile(&hist, 100.0));
+    // smallest percentile is clamped to min
+    TEST_ASSERT_EQUAL_UINT32(1, histogram_percentile(&hist, 0.0));
+}
+
+void test_histogram_reset(void) {
+    histogram_add(&hist, 12345);
+    histogram_reset(&hist);
+    TEST_ASSERT_EQUAL_UINT64(0, hist.count);
+    TEST_ASSERT_EQUAL_UINT64(0, hist.bucket[histogram_bucket_index(12345)]);
+    histogram_add(&hist, 7);
+    TEST_ASSERT_EQUAL_UINT32(7, hist.min);
+    TEST_ASSERT_EQUAL_UINT32(7, hist.max);
+}
+
+void test_histogram_merge(void) {
+    Histogram other;
+    histogram_reset(&other);
+    histogram_merge(&hist, &other);
+    TEST_ASSERT_EQUAL_UINT64(0, hist.count);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, hist.min);
+
+    histogram_add(&hist, 10);
+    histogram_add(&other, 3);
+    histogram_add(&other, 500);
+    histogram_merge(&hist, &other);
+    TEST_ASSERT_EQUAL_UINT64(3, hist.count);
+    TEST_ASSERT_EQUAL_UINT64(513, hist.sum);
+    TEST_ASSERT_EQUAL_UINT32(3, hist.min);
+    TEST_ASSERT_EQUAL_UINT32(500, hist.max);
+    TEST_ASSERT_EQUAL_UINT64(1, hist.bucket[histogram_bucket_index(3)]);
+    TEST_ASSERT_EQUAL_UINT64(1, hist.bucket[histogram_bucket_index(10)]);
+    TEST_ASSERT_EQUAL_UINT64(1, hist.bucket[histogram_bucket_index(500)]);
+}
+
+void setUp(void) {
+    histogram_reset(&hist);
+}
+
+void tearDown(void) {
+    // clean stuff up here
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_histogram_bucket_index);
+    RUN_TEST(test_histogram_stats);
+    RUN_TEST(test_histogram_reset);
+    RUN_TEST(test_histogram_merge);
+    return UNITY_END();
+}
@@ -0,0 +1,133 @@
+#include <stdint.h>
+#include <unity.h>
+
+#include "cetiTagApp/utils/ring.h"
+
+static CetiRing ring;
+
+void test_ring_fill_and_drain(void) {
+    uint32_t slot;
+    ring_init(&ring, 4, 16);
+    TEST_ASSERT_EQUAL_UINT64(0, ring_count(&ring));
+    TEST_ASSERT_EQUAL_UINT64(4, ring_space(&ring));
+    TEST_ASSERT_EQUAL_UINT32(0, ring_peek(&ring, &slot));
+
+    for (uint32_t i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL_INT(0, ring_reserve(&ring, &slot));
+        TEST_ASSERT_EQUAL_UINT32(i, slot);
+        ring_publish(&ring);
+    }
+    TEST_ASSERT_EQUAL_UINT64(4, ring_count(&ring));
+    TEST_ASSERT_EQUAL_UINT64(0, ring_space(&ring));
+
+    // full ring refuses new elements until the consumer releases
+    TEST_ASSERT_EQUAL_INT(-1, ring_reserve(&ring, &slot));
+
+    TEST_ASSERT_EQUAL_UINT32(4, ring_peek(&ring, &slot));
+    TEST_ASSERT_EQUAL_UINT32(0, slot);
+    ring_release(&ring, 3);
+    TEST_ASSERT_EQUAL_UINT64(1, ring_count(&ring));
+    TEST_ASSERT_EQUAL_UINT32(1, ring_peek(&ring, &slot));
+    TEST_ASSERT_EQUAL_UINT32(3, slot);
+}
+
+void test_ring_peek_stops_at_wrap(void) {
+    uint32_t slot;
+    ring_init(&ring, 6, 1);
+
+    // advance both counters to the middle of the ring
+    for (int i = 0; i < 4; i++) {
+        ring_reserve(&ring, &slot);
+        ring_publish(&ring);
+    }
+    ring_release(&ring, 4);
+
+    // publish 5 elements spanning the end of the ring
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL_INT(0, ring_reserve(&ring, &slot));
+        TEST_ASSERT_EQUAL_UINT32((4 + i) % 6, slot);
+        ring_publish(&ring);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(2, ring_peek(&ring, &slot));
+    TEST_ASSERT_EQUAL_UINT32(4, slot);
+    ring_release(&ring, 2);
+    TEST_ASSERT_EQUAL_UINT32(3, ring_peek(&ring, &slot));
+    TEST_ASSERT_EQUAL_UINT32(0, slot);
+}
+
+void test_ring_overruns(void) {
+    ring_init(&ring, 9, 1);
+    ring_drop(&ring, 9);
+    ring_drop(&ring, 9);
+    TEST_ASSERT_EQUAL_UINT64(18, atomic_load(&ring.overruns));
+    ring_reset(&ring);
+    TEST_ASSERT_EQUAL_UINT64(0, atomic_load(&ring.overruns));
+    TEST_ASSERT_EQUAL_UINT32(9, ring.capacity);
+}
+
+void test_ring_free_running_counters(void) {
+    uint32_t slot;
+    ring_init(&ring, 5, 1);
+
+    // counters keep counting past capacity
+    for (int i = 0; i < 23; i++) {
+        TEST_ASSERT_EQUAL_INT(0, ring_reserve(&ring, &slot));
+        TEST_ASSERT_EQUAL_UINT32(i % 5, slot);
+        ring_publish(&ring);
+        ring_peek(&ring, &slot);
+        TEST_ASSERT_EQUAL_UINT32(i % 5, slot);
+        ring_release(&ring, 1);
+    }
+    TEST_ASSERT_EQUAL_UINT64(23, atomic_load(&ring.head));
+    TEST_ASSERT_EQUAL_UINT64(23, atomic_load(&ring.tail));
+    TEST_ASSERT_EQUAL_UINT64(0, ring_count(&ring));
+}
+
+void test_ring_peek_at(void) {
+    uint32_t slot;
+    ring_init(&ring, 6, 1);
+
+    for (int i = 0; i < 8; i++) {
+        ring_reserve(&ring, &slot);
+        ring_publish(&ring);
+        if (i < 4) {
+            ring_release(&ring, 1);
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT64(4, ring_tail(&ring));
+
+    // elements 4..7 are published, element 6 wraps to slot 0
+    TEST_ASSERT_EQUAL_UINT32(2, ring_peek_at(&ring, 4, &slot));
+    TEST_ASSERT_EQUAL_UINT32(4, slot);
+    TEST_ASSERT_EQUAL_UINT32(1, ring_peek_at(&ring, 5, &slot));
+    TEST_ASSERT_EQUAL_UINT32(5, slot);
+    TEST_ASSERT_EQUAL_UINT32(2, ring_peek_at(&ring, 6, &slot));
+    TEST_ASSERT_EQUAL_UINT32(0, slot);
+
+    // nothing published yet at or beyond the head
+    TEST_ASSERT_EQUAL_UINT32(0, ring_peek_at(&ring, 8, &slot));
+    TEST_ASSERT_EQUAL_UINT32(2, slot);
+    TEST_ASSERT_EQUAL_UINT32(0, ring_peek_at(&ring, 9, &slot));
+
+    // peeking ahead does not release anything
+    TEST_ASSERT_EQUAL_UINT64(4, ring_count(&ring));
+}
+
+void setUp(void) {
+    // set stuff up here
+}
+
+void tearDown(void) {
+    // clean stuff up here
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_ring_fill_and_drain);
+    RUN_TEST(test_ring_peek_stops_at_wrap);
+    RUN_TEST(test_ring_overruns);
+    RUN_TEST(test_ring_free_running_counters);
+    RUN_TEST(test_ring_peek_at);
+    return UNITY_END();
+}
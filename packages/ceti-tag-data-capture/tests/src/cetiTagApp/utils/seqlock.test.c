@@ -0,0 +1,89 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <unity.h>
+
+#include "cetiTagApp/utils/seqlock.h"
+
+#define TEST_READS (20000)
+
+typedef struct {
+    _Atomic uint32_t sequence;
+    uint32_t reserved;
+    uint64_t a;
+    uint64_t b[8]; // every entry always equals `a` outside of an update
+} TestData;
+
+static TestData data;
+static _Atomic int reader_done;
+
+static void *writer_thread(void *arg) {
+    for (uint64_t i = 1; !atomic_load(&reader_done); i++) {
+        seqlock_write_begin(&data.sequence);
+        data.a = i;
+        for (int j = 0; j < 8; j++) {
+            data.b[j] = i;
+        }
+        seqlock_write_end(&data.sequence);
+    }
+    return NULL;
+}
+
+void test_seqlock_single_thread(void) {
+    TestData copy;
+    seqlock_write_begin(&data.sequence);
+    TEST_ASSERT_EQUAL_UINT32(1, atomic_load(&data.sequence));
+    // readers give up rather than copying an update in progress
+    TEST_ASSERT_EQUAL_INT(-1, seqlock_read(&data.sequence, &copy, &data, sizeof(data)));
+    data.a = 42;
+    seqlock_write_end(&data.sequence);
+    TEST_ASSERT_EQUAL_UINT32(2, atomic_load(&data.sequence));
+
+    TEST_ASSERT_EQUAL_INT(0, seqlock_read(&data.sequence, &copy, &data, sizeof(data)));
+    TEST_ASSERT_EQUAL_UINT64(42, copy.a);
+}
+
+void test_seqlock_copies_are_never_torn(void) {
+    pthread_t writer;
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&writer, NULL, writer_thread, NULL));
+
+    uint64_t reads = 0;
+    uint64_t last = 0;
+    while (reads < TEST_READS) {
+        TestData copy;
+        if (seqlock_read(&data.sequence, &copy, &data, sizeof(data)) != 0) {
+            continue;
+        }
+        for (int j = 0; j < 8; j++) {
+            TEST_ASSERT_EQUAL_UINT64(copy.a, copy.b[j]);
+        }
+        TEST_ASSERT_TRUE(copy.a >= last); // never goes back in time
+        TEST_ASSERT_EQUAL_UINT32(0, copy.sequence & 1);
+        last = copy.a;
+        reads++;
+    }
+    atomic_store(&reader_done, 1);
+    pthread_join(writer, NULL);
+    TEST_ASSERT_EQUAL_UINT32(0, atomic_load(&data.sequence) & 1);
+    TEST_ASSERT_EQUAL_UINT32(2 * data.a, atomic_load(&data.sequence));
+}
+
+void setUp(void) {
+    atomic_store(&data.sequence, 0);
+    data.a = 0;
+    for (int j = 0; j < 8; j++) {
+        data.b[j] = 0;
+    }
+    atomic_store(&reader_done, 0);
+}
+
+void tearDown(void) {
+    // clean stuff up here
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_seqlock_single_thread);
+    RUN_TEST(test_seqlock_copies_are_never_torn);
+    return UNITY_END();
+}
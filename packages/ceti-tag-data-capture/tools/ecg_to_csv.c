@@ -0,0 +1,53 @@
+//-----------------------------------------------------------------------------
+// Project:      CETI Tag Electronics
+// Version:      Refer to _versioning.h
+// Copyright:    Cummings Electronics Labs, Harvard University Wood Lab,
+//               MIT CSAIL
+// Contributors: Michael Salino-Hugg, [TODO: Add other contributors here]
+//-----------------------------------------------------------------------------
+// Converts ECG files written by the tag to the CSV layout it used to write,
+// for shore-side tools. Build with `make tools`.
+//
+// usage: ecg_to_csv <in.ecg> [out.csv (default stdout)]
+//-----------------------------------------------------------------------------
+#include "cetiTagApp/utils/ecg_file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ECG_TO_CSV_BUFFER_SIZE (1 << 20)
+
+int main(int argc, char **argv) {
+    if ((argc < 2) || (argc > 3)) {
+        fprintf(stderr, "usage: %s <in.ecg> [out.csv]\n", argv[0]);
+        return 2;
+    }
+
+    FILE *in = fopen(argv[1], "rb");
+    if (in == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    FILE *out = (argc == 3) ? fopen(argv[2], "w") : stdout;
+    if (out == NULL) {
+        perror(argv[2]);
+        fclose(in);
+        return 1;
+    }
+    setvbuf(in, NULL, _IOFBF, ECG_TO_CSV_BUFFER_SIZE);
+    setvbuf(out, NULL, _IOFBF, ECG_TO_CSV_BUFFER_SIZE);
+
+    int samples = ecg_file_to_csv(in, out);
+    if (samples < 0) {
+        fprintf(stderr, "%s: not an ECG file\n", argv[1]);
+    } else {
+        fprintf(stderr, "%s: %d samples\n", argv[1], samples);
+    }
+
+    fclose(in);
+    if ((fclose(out) != 0) && (samples >= 0)) {
+        perror((argc == 3) ? argv[2] : "stdout");
+        return 1;
+    }
+    return (samples < 0) ? 1 : 0;
+}